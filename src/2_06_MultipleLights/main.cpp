@@ -13,6 +13,8 @@
 #include <tools/shader.h>
 #include <tools/stb_image.h>
 #include <tools/camera.h>
+#include <tools/depth_prepass.h>
+#include <tools/gpu_timer.h>
 
 #include <iostream>
 #include <string>
@@ -126,6 +128,8 @@ int main()
     
     BoxGeometry boxGeometry(1.0f, 1.0f, 1.0f);
     SphereGeometry sphereGeometry(0.1f, 10.0f, 10.0f);
+    // 深度预渲染只需要位置
+    boxGeometry.buildPositionStream();
         
     unsigned int diffuseMap = loadTexture(std::string(ASSETS_DIR) + "/texture/container2.png");
     unsigned int specularMap = loadTexture(std::string(ASSETS_DIR) + "/texture/container2_specular.png");
@@ -165,6 +169,27 @@ int main()
     // 传递材质属性
     ourShader.setFloat("material.shininess", 32.0f);
 
+    // 三种光源的片段着色器比较贵，用深度预渲染避免给被遮挡的片段做光照
+    DepthPrepass prepass(SCREEN_WIDTH, SCREEN_HEIGHT);
+    bool showOverdraw = false;
+    GpuTimer sceneTimer;
+
+    // 不透明物体，预渲染、过度绘制统计和颜色 pass 共用；调用前着色器已经 use() 并设置好 view / projection
+    auto drawScene = [&](Shader& shader)
+    {
+        GLsizei indexCount = boxGeometry.bind(shader.positionOnly);
+        for (unsigned int i = 0; i < 10; i++)
+        {
+            glm::mat4 model = glm::mat4(1.0f);
+            model = glm::translate(model, cubePositions[i]);
+            float angle = 20.0f * i;
+            model = glm::rotate(model, glm::radians(angle), glm::vec3(1.0f, 0.3f, 0.5f));
+            shader.setMat4("model", model);
+
+            glDrawElements(GL_TRIANGLES, indexCount, GL_UNSIGNED_INT, 0);
+        }
+    };
+
     while (!glfwWindowShouldClose(window))
     {
         processInput(window);
@@ -181,6 +206,11 @@ int main()
         ImGui::Begin("ImGui");
             ImGui::Text("%.3f ms/frame (%.1f FPS)", 1000.0f / ImGui::GetIO().Framerate, ImGui::GetIO().Framerate);
             ImGui::Text("FOV: %.1f", camera.Zoom);
+            ImGui::Checkbox("Depth Prepass", &prepass.enabled);
+            ImGui::Checkbox("Overdraw Heatmap", &showOverdraw);
+            if (showOverdraw)
+                ImGui::Text("Shaded fragments per pixel: %.2f", prepass.averageOverdraw);
+            ImGui::Text("Scene pass (GPU): %.3f ms", sceneTimer.ms);
         ImGui::End();
 
         // ------------------------------------------------------------
@@ -194,33 +224,29 @@ int main()
         glActiveTexture(GL_TEXTURE1);
         glBindTexture(GL_TEXTURE_2D, specularMap);
 
-        // ------------------------------------------------------------
-        // 设置物体的着色器
-        ourShader.use();
         glm::mat4 model = glm::mat4(1.0f);
         glm::mat4 projection = glm::perspective(glm::radians(camera.Zoom), (float)SCREEN_WIDTH / (float)SCREEN_HEIGHT, 0.1f, 100.0f);
         glm::mat4 view = camera.GetViewMatrix();
-        
+
+        sceneTimer.begin();
+        prepass.renderDepth(view, projection, drawScene);
+
+        // ------------------------------------------------------------
+        // 设置物体的着色器
+        ourShader.use();
         ourShader.setMat4("projection", projection);
         ourShader.setMat4("view", view);
         ourShader.setVec3("viewPos", camera.Position);        
 
-        glBindVertexArray(boxGeometry.VAO);
-        for (unsigned int i = 0; i < 10; i++)
-        {
-            model = glm::mat4(1.0f);
-            model = glm::translate(model, cubePositions[i]);
-            float angle = 20.0f * i;
-            model = glm::rotate(model, glm::radians(angle), glm::vec3(1.0f, 0.3f, 0.5f));
-            ourShader.setMat4("model", model);
-
-            glDrawElements(GL_TRIANGLES, static_cast<int>(boxGeometry.indices.size()), GL_UNSIGNED_INT, 0);
-        }
-
         // 设置聚光的位置
         ourShader.setVec3("spotLight.position", camera.Position);
         ourShader.setVec3("spotLight.direction", camera.Front);
 
+        prepass.beginColor();
+        drawScene(ourShader);
+        prepass.endColor();
+        sceneTimer.end();
+
         // ------------------------------------------------------------
         // 设置灯光物体的着色器
 
@@ -238,6 +264,13 @@ int main()
             glDrawElements(GL_TRIANGLES, static_cast<int>(sphereGeometry.indices.size()), GL_UNSIGNED_INT, 0);
         }
 
+        // 过度绘制热度图，覆盖上面的画面
+        if (showOverdraw)
+        {
+            prepass.measureOverdraw(view, projection, drawScene);
+            prepass.showHeatmap();
+        }
+
         // ImGui 渲染
         ImGui::Render();
         ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
@@ -249,6 +282,8 @@ int main()
     // 资源释放
     boxGeometry.dispose();
     sphereGeometry.dispose();
+    prepass.dispose();
+    sceneTimer.dispose();
 
     glfwTerminate();
     return 0;
@@ -11,6 +11,9 @@ uniform mat4 model;         // 模型矩阵
 uniform mat4 view;          // 视图矩阵
 uniform mat4 projection;    // 投影矩阵
 
+// 深度预渲染后颜色 pass 用 GL_EQUAL 比较深度，和 depth_prepass.vert 写成同一个表达式才能保证深度逐位相等
+invariant gl_Position;
+
 void main()
 {
     outFragPos = vec3(model * vec4(Position, 1.0f));    
@@ -19,5 +22,5 @@ void main()
     outNormal = mat3(transpose(inverse(model))) * Normal;
     outTexCoord = TexCoords;
     // 注意乘法要从右向左读
-    gl_Position = projection * view * vec4(outFragPos, 1.0f);
+    gl_Position = projection * view * model * vec4(Position, 1.0f);
 }
\ No newline at end of file
@@ -15,11 +15,15 @@
 #include <tools/camera.h>
 #include <tools/mesh.h>
 #include <tools/model.h>
+#include <tools/transform_graph.h>
 
 #include <iostream>
 #include <string>
 #include <string_view>
 #include <format>
+#include <memory>
+#include <chrono>
+#include <random>
 
 static void processInput(GLFWwindow* window);
 static void keyCallback(GLFWwindow* window, int key, int scancode, int action, int mods);
@@ -27,6 +31,28 @@ static void mouseCallback(GLFWwindow* window, double posX, double posY);
 
 static unsigned int loadTexture(std::string_view path);
 
+// 用指针连接的节点树，基准测试里作为递归更新的对照
+struct TreeNode
+{
+    glm::mat4 local;
+    glm::mat4 world;
+    std::vector<std::unique_ptr<TreeNode>> children;
+};
+
+// 节点世界矩阵更新的耗时：指针树递归全部重算、扁平数组全部重算、扁平数组只改 1% 的节点
+struct TransformBenchmark
+{
+    size_t nodes;
+    float recursiveMs;
+    float flatMs;
+    float partialMs;
+    size_t partialNodes;
+};
+
+static void buildTransformTree(TreeNode& node, TransformGraph& graph, int parent, int depth, int branching, std::mt19937& random);
+static void updateRecursive(TreeNode& node, const glm::mat4& parentWorld);
+static TransformBenchmark benchmarkTransforms();
+
 const unsigned int SCREEN_WIDTH = 1280;
 const unsigned int SCREEN_HEIGHT = 720;
 
@@ -128,6 +154,15 @@ int main()
     BoxGeometry boxGeometry(1.0f, 1.0f, 1.0f);
     SphereGeometry sphereGeometry(0.1f, 10.0f, 10.0f);
     Model ourModel(std::string(ASSETS_DIR) + "/model/nanosuit/nanosuit.obj");
+
+    // 运行中加载的模型，纹理走异步上传队列，每帧最多上传 4MB
+    auto textureUploader = std::make_unique<TextureUploader>();
+    std::unique_ptr<Model> asyncModel;
+
+    // 帧时间记录，用于观察加载时是否卡顿
+    const int FRAME_TRACE_SIZE = 240;
+    float frameTrace[FRAME_TRACE_SIZE] = {};
+    int frameTraceOffset = 0;
         
     unsigned int diffuseMap = loadTexture(std::string(ASSETS_DIR) + "/texture/container2.png");
     unsigned int specularMap = loadTexture(std::string(ASSETS_DIR) + "/texture/container2_specular.png");
@@ -167,6 +202,8 @@ int main()
     // 传递材质属性
     ourShader.setFloat("material.shininess", 32.0f);
 
+    std::vector<TransformBenchmark> transformBenchmarks;
+
     while (!glfwWindowShouldClose(window))
     {
         processInput(window);
@@ -175,6 +212,11 @@ int main()
         deltaTime = currentFrameTime - prevFrameTime;
         prevFrameTime = currentFrameTime;
 
+        frameTrace[frameTraceOffset] = deltaTime * 1000.0f;
+        frameTraceOffset = (frameTraceOffset + 1) % FRAME_TRACE_SIZE;
+
+        textureUploader->update();
+
         // 开始 ImGui 帧
         ImGui_ImplOpenGL3_NewFrame();
         ImGui_ImplGlfw_NewFrame();
@@ -186,6 +228,18 @@ int main()
             ImGui::Text("L: Lock/Unlock Cursor");
             ImGui::Text("%.3f ms/frame (%.1f FPS)", 1000.0f / ImGui::GetIO().Framerate, ImGui::GetIO().Framerate);
             ImGui::Text("FOV: %.1f", camera.Zoom);
+            ImGui::PlotLines("Frame ms", frameTrace, FRAME_TRACE_SIZE, frameTraceOffset, nullptr, 0.0f, 50.0f, ImVec2(0, 80));
+            ImGui::Text("Upload: %zu KB, %.3f ms %s", textureUploader->lastFrameBytes / 1024, textureUploader->lastFrameMs, textureUploader->busy() ? "(busy)" : "");
+            if (!asyncModel && ImGui::Button("Load nanosuit (async textures)"))
+                asyncModel = std::make_unique<Model>(std::string(ASSETS_DIR) + "/model/nanosuit/nanosuit.obj", *textureUploader);
+            ImGui::Text("Model: %zu nodes, %zu meshes", ourModel.nodes.size(), ourModel.meshes.size());
+            if (ImGui::Button("Benchmark Node Transforms (111k nodes)"))
+                transformBenchmarks = { benchmarkTransforms() };
+            for (const TransformBenchmark& result : transformBenchmarks)
+            {
+                ImGui::Text("Recursive: %.3f ms, flat SIMD: %.3f ms", result.recursiveMs, result.flatMs);
+                ImGui::Text("Flat, 1%% dirty: %.3f ms (%zu / %zu nodes)", result.partialMs, result.partialNodes, result.nodes);
+            }
         ImGui::End();
 
         // ------------------------------------------------------------
@@ -231,8 +285,15 @@ int main()
         model = glm::rotate(model, glm::radians(15.0f * (float)glfwGetTime()), glm::vec3(0.0f, 1.0f, 0.0f));
         model = glm::translate(model, glm::vec3(0.0f, -1.0f, 0.0f));
         model = glm::scale(model, glm::vec3(0.13f, 0.13f, 0.13f));
-        ourShader.setMat4("model", model);
-        ourModel.Draw(ourShader);
+        ourModel.Draw(ourShader, model);
+
+        if (asyncModel)
+        {
+            model = glm::mat4(1.0f);
+            model = glm::translate(model, glm::vec3(2.0f, -1.0f, -2.0f));
+            model = glm::scale(model, glm::vec3(0.13f, 0.13f, 0.13f));
+            asyncModel->Draw(ourShader, model);
+        }
 
         // ------------------------------------------------------------
         // 设置灯光物体的着色器
@@ -262,6 +323,8 @@ int main()
     // 资源释放
     boxGeometry.dispose();
     sphereGeometry.dispose();
+    asyncModel.reset();
+    textureUploader.reset();
 
     glfwTerminate();
     return 0;
@@ -366,4 +429,76 @@ unsigned int loadTexture(std::string_view path)
     stbi_image_free(data);
 
     return textureID;
-}
\ No newline at end of file
+}
+
+// 先序建立 branching 叉、depth 层的树，指针树和扁平数组用同样的局部矩阵
+void buildTransformTree(TreeNode& node, TransformGraph& graph, int parent, int depth, int branching, std::mt19937& random)
+{
+    std::uniform_real_distribution<float> offset(-1.0f, 1.0f);
+    glm::mat4 local = glm::translate(glm::mat4(1.0f), glm::vec3(offset(random), offset(random), offset(random)));
+    node.local = glm::rotate(local, offset(random), glm::normalize(glm::vec3(offset(random), 1.0f, offset(random))));
+    int index = graph.addNode(parent, node.local);
+    if (depth == 0)
+        return;
+    for (int i = 0; i < branching; ++i)
+    {
+        node.children.push_back(std::make_unique<TreeNode>());
+        buildTransformTree(*node.children.back(), graph, index, depth - 1, branching, random);
+    }
+}
+
+void updateRecursive(TreeNode& node, const glm::mat4& parentWorld)
+{
+    node.world = parentWorld * node.local;
+    for (const std::unique_ptr<TreeNode>& child : node.children)
+        updateRecursive(*child, node.world);
+}
+
+// 10 叉 5 层共 111111 个节点，每种方式跑多次取平均
+TransformBenchmark benchmarkTransforms()
+{
+    using Clock = std::chrono::steady_clock;
+    const int runs = 20;
+    std::mt19937 random(42);
+    TreeNode root;
+    TransformGraph graph;
+    buildTransformTree(root, graph, -1, 5, 10, random);
+
+    TransformBenchmark result{ graph.size(), 0.0f, 0.0f, 0.0f, 0 };
+    for (int i = 0; i < runs; ++i)
+    {
+        auto start = Clock::now();
+        updateRecursive(root, glm::mat4(1.0f));
+        auto recursive = Clock::now();
+        graph.markAllDirty();
+        graph.update();
+        auto flat = Clock::now();
+        result.recursiveMs += std::chrono::duration<float, std::milli>(recursive - start).count() / runs;
+        result.flatMs += std::chrono::duration<float, std::milli>(flat - recursive).count() / runs;
+    }
+
+    // 随机改 1% 的节点，大部分是叶子，只有它们的子树需要重算
+    std::uniform_int_distribution<int> pick(0, static_cast<int>(graph.size()) - 1);
+    for (int i = 0; i < runs; ++i)
+    {
+        for (size_t j = 0; j < graph.size() / 100; ++j)
+        {
+            int node = pick(random);
+            graph.setLocal(node, graph.locals[node]);
+        }
+        auto start = Clock::now();
+        size_t updated = graph.update();
+        auto end = Clock::now();
+        result.partialMs += std::chrono::duration<float, std::milli>(end - start).count() / runs;
+        result.partialNodes = updated;
+    }
+
+    // 两种方式的结果应该一致
+    const TreeNode* leaf = &root;
+    while (!leaf->children.empty())
+        leaf = leaf->children.back().get();
+    std::cout << "Node transforms (" << result.nodes << " nodes): recursive " << result.recursiveMs << " ms, flat SIMD "
+              << result.flatMs << " ms, 1% dirty " << result.partialMs << " ms (" << result.partialNodes << " nodes), last leaf error "
+              << glm::length(glm::vec3(leaf->world[3] - graph.worlds.back()[3])) << std::endl;
+    return result;
+}
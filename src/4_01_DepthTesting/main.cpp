@@ -21,6 +21,7 @@
 #include <string>
 #include <string_view>
 #include <format>
+#include <chrono>
 
 static void processInput(GLFWwindow* window);
 static void keyCallback(GLFWwindow* window, int key, int scancode, int action, int mods);
@@ -28,6 +29,16 @@ static void mouseCallback(GLFWwindow* window, double posX, double posY);
 
 static unsigned int loadTexture(std::string_view path);
 
+// 2048 x 2048 段的平面和球体的构造耗时：第一次生成（包括计算切线和上传），以及参数相同时命中缓存（仍然生成顶点，只是不再创建和上传缓冲）
+struct GeometryBenchmark
+{
+    float planeMs;
+    float planeCachedMs;
+    float sphereMs;
+    float sphereCachedMs;
+};
+static GeometryBenchmark benchmarkGeometry();
+
 const unsigned int SCREEN_WIDTH = 1280;
 const unsigned int SCREEN_HEIGHT = 720;
 
@@ -131,6 +142,7 @@ int main()
     BoxGeometry boxGeometry(1.0f, 1.0f, 1.0f);
     SphereGeometry sphereGeometry(0.1f, 10.0f, 10.0f);
     PlaneGeometry planeGeometry(10.0f, 10.0f);
+    GeometryBenchmark geometryBenchmark{};
         
     unsigned int diffuseMap = loadTexture(std::string(ASSETS_DIR) + "/texture/container2.png");
     unsigned int specularMap = loadTexture(std::string(ASSETS_DIR) + "/texture/container2_specular.png");
@@ -188,8 +200,18 @@ int main()
             ImGui::Text("L: Lock/Unlock Cursor");
             ImGui::Text("%.3f ms/frame (%.1f FPS)", 1000.0f / ImGui::GetIO().Framerate, ImGui::GetIO().Framerate);
             ImGui::Text("FOV: %.1f", camera.Zoom);
+            ImGui::Text("Cached geometries: %zu", BufferGeometry::cachedCount());
+            bool runBenchmark = ImGui::Button("Benchmark 2048x2048 Geometry");
+            if (geometryBenchmark.planeMs > 0.0f)
+            {
+                ImGui::Text("Plane: %.1f ms, cached %.1f ms", geometryBenchmark.planeMs, geometryBenchmark.planeCachedMs);
+                ImGui::Text("Sphere: %.1f ms, cached %.1f ms", geometryBenchmark.sphereMs, geometryBenchmark.sphereCachedMs);
+            }
         ImGui::End();
 
+        if (runBenchmark)
+            geometryBenchmark = benchmarkGeometry();
+
         // ------------------------------------------------------------
         // 渲染指令
         glClearColor(bgColor.x, bgColor.y, bgColor.z, bgColor.w);
@@ -378,4 +400,31 @@ unsigned int loadTexture(std::string_view path)
     stbi_image_free(data);
 
     return textureID;
-}
\ No newline at end of file
+}
+
+GeometryBenchmark benchmarkGeometry()
+{
+    GeometryBenchmark result{};
+    auto measure = [](float& ms, auto&& build)
+    {
+        auto start = std::chrono::steady_clock::now();
+        auto geometry = build();
+        ms = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - start).count();
+        return geometry;
+    };
+
+    // 第二个参数完全相同，共用第一个的缓冲；两个都 dispose 后缓存才被清掉
+    PlaneGeometry plane = measure(result.planeMs, []() { return PlaneGeometry(10.0f, 10.0f, 2048.0f, 2048.0f); });
+    PlaneGeometry cachedPlane = measure(result.planeCachedMs, []() { return PlaneGeometry(10.0f, 10.0f, 2048.0f, 2048.0f); });
+    plane.dispose();
+    cachedPlane.dispose();
+
+    SphereGeometry sphere = measure(result.sphereMs, []() { return SphereGeometry(1.0f, 2048.0f, 2048.0f); });
+    SphereGeometry cachedSphere = measure(result.sphereCachedMs, []() { return SphereGeometry(1.0f, 2048.0f, 2048.0f); });
+    sphere.dispose();
+    cachedSphere.dispose();
+
+    std::cout << "Plane 2048x2048: " << result.planeMs << " ms, cached " << result.planeCachedMs << " ms" << std::endl;
+    std::cout << "Sphere 2048x2048: " << result.sphereMs << " ms, cached " << result.sphereCachedMs << " ms" << std::endl;
+    return result;
+}
@@ -16,6 +16,7 @@
 #include <tools/camera.h>
 #include <tools/mesh.h>
 #include <tools/model.h>
+#include <tools/texture_array.h>
 
 #include <iostream>
 #include <string>
@@ -26,8 +27,6 @@ static void processInput(GLFWwindow* window);
 static void keyCallback(GLFWwindow* window, int key, int scancode, int action, int mods);
 static void mouseCallback(GLFWwindow* window, double posX, double posY);
 
-static unsigned int loadTexture(std::string_view path);
-
 const unsigned int SCREEN_WIDTH = 1280;
 const unsigned int SCREEN_HEIGHT = 720;
 
@@ -135,9 +134,12 @@ int main()
     SphereGeometry sphereGeometry(0.1f, 10.0f, 10.0f);
     PlaneGeometry planeGeometry(1.0f, 1.0f);
         
-    unsigned int boxMap    =  loadTexture(std::string(ASSETS_DIR) + "/texture/metal.png");
-    unsigned int floorMap  =  loadTexture(std::string(ASSETS_DIR) + "/texture/wood.png");
-    unsigned int grassMap  = loadTexture(std::string(ASSETS_DIR) + "/texture/grass.png");    
+    // 箱子、地面和草的贴图放进同一个纹理数组，整帧只绑定一次
+    TextureArray materialArray(1024, 1024, 3, GL_CLAMP_TO_EDGE);
+    int boxLayer    =  materialArray.addFromFile(std::string(ASSETS_DIR) + "/texture/metal.png");
+    int floorLayer  =  materialArray.addFromFile(std::string(ASSETS_DIR) + "/texture/wood.png");
+    int grassLayer  =  materialArray.addFromFile(std::string(ASSETS_DIR) + "/texture/grass.png");
+    materialArray.generateMipmap();
 
     sceneShader.use();
     sceneShader.setInt("tempTex", 0);
@@ -195,10 +197,11 @@ int main()
         sceneShader.setVec3("viewPos", camera.Position);
 
         glActiveTexture(GL_TEXTURE0);
+        glBindTexture(GL_TEXTURE_2D_ARRAY, materialArray.ID);
 
         // 创建地面
         glBindVertexArray(planeGeometry.VAO);        
-        glBindTexture(GL_TEXTURE_2D, floorMap);
+        sceneShader.setInt("layer", floorLayer);
         model = glm::mat4(1.0f);
         model = glm::rotate(model, glm::radians(-90.0f), glm::vec3(1.0f, 0.0f, 0.0f));
         model = glm::translate(model, glm::vec3(0.0f, 0.0f, -0.5f));
@@ -208,7 +211,7 @@ int main()
 
         // 创建箱子
         glBindVertexArray(boxGeometry.VAO);
-        glBindTexture(GL_TEXTURE_2D, boxMap);
+        sceneShader.setInt("layer", boxLayer);
         for (unsigned int i = 0; i < cubePositions.size(); i++)
         {
             model = glm::mat4(1.0f);
@@ -219,7 +222,7 @@ int main()
 
         // 创建草或窗户
         glBindVertexArray(planeGeometry.VAO);
-        glBindTexture(GL_TEXTURE_2D, grassMap);
+        sceneShader.setInt("layer", grassLayer);
         for (unsigned int i = 0; i < grassPositions.size(); i++)
         {
             model = glm::mat4(1.0f);
@@ -254,6 +257,7 @@ int main()
     boxGeometry.dispose();
     sphereGeometry.dispose();
     planeGeometry.dispose();
+    materialArray.dispose();
 
     glfwTerminate();
     return 0;
@@ -322,45 +326,3 @@ void mouseCallback(GLFWwindow* window, double posXIn, double posYIn)
 
     camera.ProcessMouseMovement(offsetX, offsetY);
 }
-
-unsigned int loadTexture(std::string_view path)
-{
-    unsigned int textureID;
-    glGenTextures(1, &textureID);
-
-    // 图像y轴翻转
-    stbi_set_flip_vertically_on_load(true);
-    int width, height, nrComponents;
-    unsigned char* data = stbi_load(path.data(), &width, &height, &nrComponents, 0);
-    if (data)
-    {
-        /*
-            jpg 和 png格式不一样
-            jpg只有3个通道
-            png有4个通道，第4个通道设置透明度
-        */
-        GLenum format = GL_RGB;
-        if (nrComponents == 1)
-            format = GL_RED;
-        else if (nrComponents == 3)
-            format = GL_RGB;
-        else if (nrComponents == 4)
-            format = GL_RGBA;
-
-        glBindTexture(GL_TEXTURE_2D, textureID);
-        glTexImage2D(GL_TEXTURE_2D, 0, format, width, height, 0, format, GL_UNSIGNED_BYTE, data);
-        glGenerateMipmap(GL_TEXTURE_2D);
-
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, format == GL_RGBA ? GL_CLAMP_TO_EDGE : GL_REPEAT);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, format == GL_RGBA ? GL_CLAMP_TO_EDGE : GL_REPEAT);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-    }
-    else
-    {
-        std::cout << "Texture failed to load at path: " << path << std::endl;
-    }
-    stbi_image_free(data);
-
-    return textureID;
-}
\ No newline at end of file
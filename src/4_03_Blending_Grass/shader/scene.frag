@@ -59,7 +59,8 @@ uniform DirLight dirLight;
 uniform PointLight pointLights[NR_POINT_LIGHTS];
 uniform SpotLight spotLight;
 
-uniform sampler2D tempTex;
+uniform sampler2DArray tempTex;
+uniform int layer;              // 纹理数组中的层号
 
 // 函数
 vec3 CalcDirLight(DirLight light, vec3 normal, vec3 viewDir);
@@ -80,7 +81,7 @@ void main()
     // }
     // result += CalcSpotLight(spotLight, norm, outFragPos, viewDir);
     // FragColor = vec4(result, 1.0f);
-    vec4 texColor = texture(tempTex, outTexCoord);
+    vec4 texColor = texture(tempTex, vec3(outTexCoord, layer));
     if (texColor.a < 0.1)
         discard;
     FragColor = texColor;
@@ -16,17 +16,31 @@
 #include <tools/camera.h>
 #include <tools/mesh.h>
 #include <tools/model.h>
+#include <tools/texture_array.h>
+#include <tools/transparent_sorter.h>
+#include <tools/weighted_oit.h>
+#include <tools/gpu_timer.h>
 
 #include <iostream>
 #include <string>
 #include <string_view>
 #include <format>
+#include <map>
+#include <random>
+#include <chrono>
 
 static void processInput(GLFWwindow* window);
 static void keyCallback(GLFWwindow* window, int key, int scancode, int action, int mods);
 static void mouseCallback(GLFWwindow* window, double posX, double posY);
 
-static unsigned int loadTexture(std::string_view path);
+// 排序路径和 OIT 路径在同样数量的重叠窗户下的耗时
+struct TransparencyBenchmark
+{
+    int windows;
+    bool oit;
+    float sortMs;   // CPU 排序，OIT 为 0
+    float gpuMs;    // 透明部分的 GPU 时间
+};
 
 const unsigned int SCREEN_WIDTH = 1280;
 const unsigned int SCREEN_HEIGHT = 720;
@@ -135,14 +149,58 @@ int main()
 
     Shader sceneShader(std::string(SHADER_DIR) + "/scene.vert", std::string(SHADER_DIR) + "/scene.frag");
     Shader lightingShader(std::string(SHADER_DIR) + "/lighting.vert", std::string(SHADER_DIR) + "/lighting.frag");
+    Shader windowShader(std::string(SHADER_DIR) + "/sceneInstanced.vert", std::string(SHADER_DIR) + "/scene.frag");
+    Shader oitAccumShader(std::string(SHADER_DIR) + "/sceneInstanced.vert", std::string(SHADER_DIR) + "/oitAccum.frag");
+    Shader oitCompositeShader(std::string(SHADER_DIR) + "/oitComposite.vert", std::string(SHADER_DIR) + "/oitComposite.frag");
     
     BoxGeometry boxGeometry(1.0f, 1.0f, 1.0f);
     SphereGeometry sphereGeometry(0.1f, 10.0f, 10.0f);
     PlaneGeometry planeGeometry(1.0f, 1.0f);
+    PlaneGeometry screenGeometry(2.0f, 2.0f);
         
-    unsigned int boxMap    =  loadTexture(std::string(ASSETS_DIR) + "/texture/metal.png");
-    unsigned int floorMap  =  loadTexture(std::string(ASSETS_DIR) + "/texture/wood.png");
-    unsigned int windowMap =  loadTexture(std::string(ASSETS_DIR) + "/texture/blending_transparent_window.png");    
+    // 箱子、地面和窗户的贴图放进同一个纹理数组，整帧只绑定一次
+    TextureArray materialArray(1024, 1024, 3, GL_CLAMP_TO_EDGE);
+    int boxLayer    =  materialArray.addFromFile(std::string(ASSETS_DIR) + "/texture/metal.png");
+    int floorLayer  =  materialArray.addFromFile(std::string(ASSETS_DIR) + "/texture/wood.png");
+    int windowLayer =  materialArray.addFromFile(std::string(ASSETS_DIR) + "/texture/blending_transparent_window.png");
+    materialArray.generateMipmap();
+
+    // 窗户排序后用一次实例化绘制画完
+    TransparentSorter windowSorter(windowPositions.size());
+    // attach 会改动 VAO，先复制一份自己的缓冲，不影响参数相同的其他平面
+    planeGeometry.detachFromCache();
+    windowSorter.attach(planeGeometry.VAO);
+
+    // 额外随机生成的窗户，用于测试大量透明物体的排序
+    const size_t BASE_WINDOW_COUNT = windowPositions.size();
+    int windowCount = static_cast<int>(BASE_WINDOW_COUNT);
+    std::mt19937 rng(42);
+    std::uniform_real_distribution<float> randomPos(-50.0f, 50.0f);
+    float windowSpread = 50.0f;
+    float sortTime = 0.0f;
+    float mapSortTime = 0.0f;
+    bool compareWithMap = false;
+
+    // 顺序无关透明：不排序，一次累积 + 一次合成
+    WeightedOIT oit(SCREEN_WIDTH, SCREEN_HEIGHT);
+    bool useOIT = false;
+    GpuTimer transparentTimer;
+
+    // 10k / 100k 个窗户（Spread 固定为 5，大量重叠）各跑排序和 OIT 两种路径，
+    // 每种情况先等几帧让 GPU 计时的结果跟上，再取平均
+    const int BENCHMARK_COUNTS[] = { 10000, 100000 };
+    const int BENCHMARK_WARMUP_FRAMES = 10;
+    const int BENCHMARK_FRAMES = 60;
+    std::vector<TransparencyBenchmark> transparencyBenchmarks;
+    int benchmarkStep = -1; // -1 为没有在跑，否则为 [0, 4) 中的第几种情况
+    int benchmarkFrame = 0;
+
+    windowShader.use();
+    windowShader.setInt("tempTex", 0);
+    windowShader.setInt("layer", windowLayer);
+    oitAccumShader.use();
+    oitAccumShader.setInt("tempTex", 0);
+    oitAccumShader.setInt("layer", windowLayer);
 
     sceneShader.use();
     sceneShader.setInt("tempTex", 0);
@@ -185,6 +243,25 @@ int main()
             ImGui::Text("%.3f ms/frame (%.1f FPS)", 1000.0f / ImGui::GetIO().Framerate, ImGui::GetIO().Framerate);
             ImGui::Text("FOV: %.1f", camera.Zoom);
             ImGui::Text("x: %.1f, y: %.1f, z: %.1f", camera.Position.x, camera.Position.y, camera.Position.z);
+            ImGui::SliderInt("Windows", &windowCount, static_cast<int>(BASE_WINDOW_COUNT), 100000);
+            bool spreadChanged = ImGui::SliderFloat("Spread", &windowSpread, 1.0f, 50.0f);
+            ImGui::Checkbox("Weighted blended OIT", &useOIT);
+            ImGui::Text("Transparent pass (GPU): %.3f ms", transparentTimer.ms);
+            if (!useOIT)
+            {
+                ImGui::Text("Radix sort: %.3f ms", sortTime);
+                ImGui::Checkbox("Compare with std::map", &compareWithMap);
+                if (compareWithMap)
+                    ImGui::Text("std::map sort: %.3f ms", mapSortTime);
+            }
+            if (benchmarkStep < 0 && ImGui::Button("Benchmark Sorted vs OIT (10k / 100k)"))
+            {
+                transparencyBenchmarks.clear();
+                benchmarkStep = 0;
+                benchmarkFrame = 0;
+            }
+            for (const TransparencyBenchmark& result : transparencyBenchmarks)
+                ImGui::Text("%6d windows, %s: sort %.3f ms, GPU %.3f ms", result.windows, result.oit ? "OIT   " : "sorted", result.sortMs, result.gpuMs);
         ImGui::End();
 
         // ------------------------------------------------------------
@@ -192,11 +269,43 @@ int main()
         glClearColor(bgColor.x, bgColor.y, bgColor.z, bgColor.w);
         glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
         
-        std::map<float, glm::vec3> sorted; // 先给窗户排个序
-        for (size_t i = 0; i < windowPositions.size(); i++)
+        // 每种情况的第一帧切换窗户数量和路径
+        if (benchmarkStep >= 0 && benchmarkFrame == 0)
+        {
+            windowCount = BENCHMARK_COUNTS[benchmarkStep / 2];
+            useOIT = benchmarkStep % 2 == 1;
+            windowSpread = 5.0f;
+            spreadChanged = true;
+            transparencyBenchmarks.push_back({ windowCount, useOIT, 0.0f, 0.0f });
+        }
+
+        if (windowPositions.size() != static_cast<size_t>(windowCount) || spreadChanged)
+        {
+            windowPositions.resize(BASE_WINDOW_COUNT);
+            for (size_t i = BASE_WINDOW_COUNT; i < static_cast<size_t>(windowCount); ++i)
+                windowPositions.push_back(glm::vec3(randomPos(rng), 0.0f, randomPos(rng)) * (windowSpread / 50.0f));
+            windowSorter.reserve(windowPositions.size());
+        }
+
+        // 先给窗户排个序，由远到近
+        if (!useOIT)
         {
-            float distance = glm::length(camera.Position - windowPositions[i]);
-            sorted[distance] = windowPositions[i];
+            auto sortStart = std::chrono::steady_clock::now();
+            windowSorter.sort(windowPositions, camera.Position);
+            sortTime = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - sortStart).count();
+        }
+
+        if (compareWithMap && !useOIT)
+        {
+            // 原来的做法，仅用于对比耗时：每个窗户一次节点分配，距离相同的窗户会被覆盖
+            auto mapStart = std::chrono::steady_clock::now();
+            std::map<float, glm::vec3> sorted;
+            for (size_t i = 0; i < windowPositions.size(); i++)
+            {
+                float distance = glm::length(camera.Position - windowPositions[i]);
+                sorted[distance] = windowPositions[i];
+            }
+            mapSortTime = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - mapStart).count();
         }
 
         glm::mat4 projection = glm::perspective(glm::radians(camera.Zoom), (float)SCREEN_WIDTH / (float)SCREEN_HEIGHT, 0.1f, 100.0f);
@@ -223,10 +332,11 @@ int main()
         sceneShader.setVec3("viewPos", camera.Position);
 
         glActiveTexture(GL_TEXTURE0);
+        glBindTexture(GL_TEXTURE_2D_ARRAY, materialArray.ID);
 
         // 创建地面
         glBindVertexArray(planeGeometry.VAO);        
-        glBindTexture(GL_TEXTURE_2D, floorMap);
+        sceneShader.setInt("layer", floorLayer);
         sceneShader.setFloat("material.shininess", 2.0f);
         model = glm::mat4(1.0f);
         model = glm::rotate(model, glm::radians(-90.0f), glm::vec3(1.0f, 0.0f, 0.0f));
@@ -237,7 +347,7 @@ int main()
 
         // 创建箱子
         glBindVertexArray(boxGeometry.VAO);
-        glBindTexture(GL_TEXTURE_2D, boxMap);
+        sceneShader.setInt("layer", boxLayer);
         sceneShader.setFloat("material.shininess", 32.0f);
         for (unsigned int i = 0; i < cubePositions.size(); i++)
         {
@@ -247,16 +357,49 @@ int main()
             glDrawElements(GL_TRIANGLES, static_cast<int>(boxGeometry.indices.size()), GL_UNSIGNED_INT, 0);
         }
 
-        // 创建窗户，由远到近
-        glBindVertexArray(planeGeometry.VAO);
-        glBindTexture(GL_TEXTURE_2D, windowMap);
-        sceneShader.setFloat("material.shininess", 16.0f);
-        for (auto iter = sorted.rbegin(); iter != sorted.rend(); iter++)
+        transparentTimer.begin();
+        if (useOIT)
         {
-            model = glm::mat4(1.0f);
-            model = glm::translate(model, iter->second);
-            sceneShader.setMat4("model", model);
-            glDrawElements(GL_TRIANGLES, static_cast<int>(planeGeometry.indices.size()), GL_UNSIGNED_INT, 0);
+            // 创建窗户，不排序，累积后合成到默认帧缓冲
+            oit.beginAccumulate();
+            oitAccumShader.use();
+            oitAccumShader.setMat4("projection", projection);
+            oitAccumShader.setMat4("view", view);
+            oitAccumShader.setMat4("model", glm::mat4(1.0f));
+            oitAccumShader.setVec3("viewPos", camera.Position);
+            windowSorter.upload(windowPositions, false);
+            windowSorter.draw(planeGeometry.VAO, static_cast<GLsizei>(planeGeometry.indices.size()));
+            oit.composite(oitCompositeShader, screenGeometry.VAO, static_cast<GLsizei>(screenGeometry.indices.size()));
+        }
+        else
+        {
+            // 创建窗户，由远到近
+            windowShader.use();
+            windowShader.setMat4("projection", projection);
+            windowShader.setMat4("view", view);
+            windowShader.setMat4("model", glm::mat4(1.0f));
+            windowSorter.upload(windowPositions);
+            windowSorter.draw(planeGeometry.VAO, static_cast<GLsizei>(planeGeometry.indices.size()));
+        }
+        transparentTimer.end();
+
+        if (benchmarkStep >= 0)
+        {
+            if (benchmarkFrame >= BENCHMARK_WARMUP_FRAMES)
+            {
+                TransparencyBenchmark& result = transparencyBenchmarks.back();
+                result.sortMs += (useOIT ? 0.0f : sortTime) / BENCHMARK_FRAMES;
+                result.gpuMs += transparentTimer.ms / BENCHMARK_FRAMES;
+            }
+            if (++benchmarkFrame == BENCHMARK_WARMUP_FRAMES + BENCHMARK_FRAMES)
+            {
+                const TransparencyBenchmark& result = transparencyBenchmarks.back();
+                std::cout << result.windows << " windows, " << (result.oit ? "OIT" : "sorted") << ": sort " << result.sortMs
+                          << " ms, transparent pass (GPU) " << result.gpuMs << " ms" << std::endl;
+                benchmarkFrame = 0;
+                if (++benchmarkStep == 4)
+                    benchmarkStep = -1;
+            }
         }
 
         // ImGui 渲染
@@ -271,6 +414,11 @@ int main()
     boxGeometry.dispose();
     sphereGeometry.dispose();
     planeGeometry.dispose();
+    materialArray.dispose();
+    windowSorter.dispose();
+    screenGeometry.dispose();
+    oit.dispose();
+    transparentTimer.dispose();
 
     glfwTerminate();
     return 0;
@@ -339,45 +487,3 @@ void mouseCallback(GLFWwindow* window, double posXIn, double posYIn)
 
     camera.ProcessMouseMovement(offsetX, offsetY);
 }
-
-unsigned int loadTexture(std::string_view path)
-{
-    unsigned int textureID;
-    glGenTextures(1, &textureID);
-
-    // 图像y轴翻转
-    stbi_set_flip_vertically_on_load(true);
-    int width, height, nrComponents;
-    unsigned char* data = stbi_load(path.data(), &width, &height, &nrComponents, 0);
-    if (data)
-    {
-        /*
-            jpg 和 png格式不一样
-            jpg只有3个通道
-            png有4个通道，第4个通道设置透明度
-        */
-        GLenum format = GL_RGB;
-        if (nrComponents == 1)
-            format = GL_RED;
-        else if (nrComponents == 3)
-            format = GL_RGB;
-        else if (nrComponents == 4)
-            format = GL_RGBA;
-
-        glBindTexture(GL_TEXTURE_2D, textureID);
-        glTexImage2D(GL_TEXTURE_2D, 0, format, width, height, 0, format, GL_UNSIGNED_BYTE, data);
-        glGenerateMipmap(GL_TEXTURE_2D);
-
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, format == GL_RGBA ? GL_CLAMP_TO_EDGE : GL_REPEAT);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, format == GL_RGBA ? GL_CLAMP_TO_EDGE : GL_REPEAT);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-    }
-    else
-    {
-        std::cout << "Texture failed to load at path: " << path << std::endl;
-    }
-    stbi_image_free(data);
-
-    return textureID;
-}
\ No newline at end of file
@@ -0,0 +1,24 @@
+#version 330 core
+layout (location = 0) out vec4 accum;   // rgb: 加权的预乘颜色之和，a: revealage
+layout (location = 1) out float weight; // 加权的 alpha 之和
+
+in vec2 outTexCoord;            // 纹理坐标
+in vec3 outNormal;              // 法向量
+in vec3 outFragPos;             // 片段位置
+
+uniform sampler2DArray tempTex;
+uniform int layer;              // 纹理数组中的层号
+uniform vec3 viewPos;           // 摄像机位置
+
+void main()
+{
+    vec4 color = texture(tempTex, vec3(outTexCoord, layer));
+
+    // 论文中按距离的权重函数（式 7），离摄像机越近权重越大；只有 0.3 以内的片段才会到 3e3 的上限，
+    // 一般距离下权重在几到几十之间，很多层叠加也不会超过 RGBA16F 的上限（65504）
+    float d = length(outFragPos - viewPos);
+    float w = color.a * clamp(10.0 / (1e-5 + pow(d / 5.0, 2.0) + pow(d / 200.0, 6.0)), 1e-2, 3e3);
+
+    accum = vec4(color.rgb * color.a * w, color.a);
+    weight = color.a * w;
+}
@@ -0,0 +1,20 @@
+#version 330 core
+out vec4 FragColor;
+
+in vec2 outTexCoord;
+
+uniform sampler2D accumTexture;
+uniform sampler2D weightTexture;
+
+void main()
+{
+    vec4 accum = texture(accumTexture, outTexCoord);
+    float revealage = accum.a;
+    // 没有透明物体覆盖
+    if (revealage >= 1.0)
+        discard;
+
+    float weight = texture(weightTexture, outTexCoord).r;
+    vec3 averageColor = accum.rgb / max(weight, 1e-5);
+    FragColor = vec4(averageColor, 1.0 - revealage);
+}
@@ -0,0 +1,21 @@
+#version 330 core
+layout (location = 0) in vec3 Position;     // 顶点坐标
+layout (location = 1) in vec3 Normal;       // 法向量
+layout (location = 2) in vec2 TexCoords;    // 纹理坐标
+layout (location = 3) in vec3 Offset;       // 每个实例的位置，已经由远到近排好序
+
+out vec2 outTexCoord;       // 传出材质坐标
+out vec3 outNormal;         // 传出法向量
+out vec3 outFragPos;        // 传出片段位置
+
+uniform mat4 model;         // 模型矩阵，所有实例共用
+uniform mat4 view;          // 视图矩阵
+uniform mat4 projection;    // 投影矩阵
+
+void main()
+{
+    outFragPos = vec3(model * vec4(Position, 1.0f)) + Offset;
+    outNormal = mat3(transpose(inverse(model))) * Normal;
+    outTexCoord = TexCoords;
+    gl_Position = projection * view * vec4(outFragPos, 1.0f);
+}
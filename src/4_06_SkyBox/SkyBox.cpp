@@ -22,13 +22,13 @@
 #include <string_view>
 #include <format>
 #include <unordered_set>
+#include <memory>
 
 static void processInput(GLFWwindow* window);
 static void keyCallback(GLFWwindow* window, int key, int scancode, int action, int mods);
 static void mouseCallback(GLFWwindow* window, double posX, double posY);
 
 static unsigned int loadTexture(std::string_view path);
-static unsigned int loadCubeMap(std::vector<std::string_view> faces);
 static void drawSkyBox(Shader shader, BoxGeometry geometry, unsigned int cubeMap);
 
 int SCREEN_WIDTH = 1280;
@@ -146,7 +146,9 @@ int main()
         
     unsigned int boxMap    =  loadTexture(ASSETS_DIR "/texture/metal.png");
     unsigned int floorMap  =  loadTexture(ASSETS_DIR "/texture/wood.png");
-    unsigned int cubeMap   =  loadCubeMap(faces);
+    // 天空盒的六个面较大，交给异步上传队列，避免阻塞第一帧
+    auto textureUploader = std::make_unique<TextureUploader>();
+    unsigned int cubeMap   =  textureUploader->loadCubeMap({ faces.begin(), faces.end() });
 
     sceneShader.use();
     sceneShader.setInt("material.diffuse", 0);
@@ -180,6 +182,8 @@ int main()
         deltaTime = currentFrameTime - prevFrameTime;
         prevFrameTime = currentFrameTime;
 
+        textureUploader->update();
+
         // 开始 ImGui 帧
         ImGui_ImplOpenGL3_NewFrame();
         ImGui_ImplGlfw_NewFrame();
@@ -265,6 +269,7 @@ int main()
     pointLightGeometry.dispose();
     floorGeometry.dispose();
     skyBoxGeometry.dispose();
+    textureUploader.reset();
 
     glfwTerminate();
     return 0;
@@ -376,37 +381,6 @@ unsigned int loadTexture(std::string_view path)
     return textureID;
 }
 
-unsigned int loadCubeMap(std::vector<std::string_view> faces)
-{
-    unsigned int textureID;
-    glGenTextures(1, &textureID);
-    glBindTexture(GL_TEXTURE_CUBE_MAP, textureID);
-
-    stbi_set_flip_vertically_on_load(false);
-    for (unsigned int i = 0; i < faces.size(); i++)
-    {
-        int width, height, nrChannels;
-        unsigned char* data = stbi_load(faces[i].data(), &width, &height, &nrChannels, 0);
-        if (data)
-        {
-            glTexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + i,
-                0, GL_RGB, width, height, 0, GL_RGB, GL_UNSIGNED_BYTE, data);            
-        }
-        else
-        {
-            std::cout << "Cube map texture failed to load at path: " << faces[i] << std::endl;
-        }
-        stbi_image_free(data);
-    }
-    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
-
-    return textureID;
-}
-
 void drawSkyBox(Shader shader, BoxGeometry geometry, unsigned int cubeMap)
 {
     glDepthFunc(GL_LEQUAL);
@@ -105,9 +105,15 @@ int main()
     ImVec4 bgColor = ImVec4(0.12f, 0.12f, 0.15f, 1.0f);
 
     Shader ourShader(SHADER_DIR "/scene.vert", SHADER_DIR "/scene.frag");
+    Shader arrayShader(SHADER_DIR "/scene.vert", SHADER_DIR "/sceneArray.frag");
     Shader normalShader(SHADER_DIR "/renderingNormal.vert", SHADER_DIR "/renderingNormal.frag", SHADER_DIR "/renderingNormal.geom");
 
     Model ourModel(ASSETS_DIR "/model/nanosuit/nanosuit.obj");
+    ourModel.buildTextureArray();
+
+    arrayShader.use();
+    arrayShader.setInt("materialArray", 0);
+    bool useTextureArray = true;
 
     float magnitude = 0.05f;
     float normalColor[] = { 1.0f, 1.0f, 0.0f };
@@ -136,6 +142,8 @@ int main()
             ImGui::SliderInt("Height", &SCREEN_HEIGHT, 600, 1080);
             ImGui::SliderFloat("Magnitude", &magnitude, 0.0f, 0.2f);
             ImGui::SliderFloat3("Normal color", normalColor, 0.0f, 1.0f);
+            ImGui::Checkbox("Texture array", &useTextureArray);
+            ImGui::Text("Texture array: %d layers, %dx%d", ourModel.textureArray.layers, ourModel.textureArray.width, ourModel.textureArray.height);
         ImGui::End();
 
         // ------------------------------------------------------------
@@ -147,12 +155,23 @@ int main()
         glm::mat4 view = camera.GetViewMatrix();;
         glm::mat4 model = glm::mat4(1.0f);
         model = glm::scale(model, glm::vec3(0.1f));
-        ourShader.use();
-        ourShader.setMat4("projection", projection);
-        ourShader.setMat4("view", view);
-        ourShader.setMat4("model", model);
-
-        ourModel.Draw(ourShader);
+        if (useTextureArray)
+        {
+            // 纹理数组只绑定一次，网格之间不再切换纹理
+            arrayShader.use();
+            arrayShader.setMat4("projection", projection);
+            arrayShader.setMat4("view", view);
+            arrayShader.setMat4("model", model);
+            ourModel.DrawLayered(arrayShader);
+        }
+        else
+        {
+            ourShader.use();
+            ourShader.setMat4("projection", projection);
+            ourShader.setMat4("view", view);
+            ourShader.setMat4("model", model);
+            ourModel.Draw(ourShader);
+        }
 
         normalShader.use();
         normalShader.setMat4("projection", projection);
@@ -172,6 +191,7 @@ int main()
     }
 
     // 资源释放
+    ourModel.textureArray.dispose();
 
     glfwTerminate();
     return 0;
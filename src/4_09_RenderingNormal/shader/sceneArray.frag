@@ -0,0 +1,13 @@
+#version 330 core
+out vec4 FragColor;
+
+in vec2 TexCoords;
+
+// 整个模型的贴图都在同一个纹理数组里，每个网格只传层号
+uniform sampler2DArray materialArray;
+uniform ivec4 materialLayers; // diffuse, specular, normal, height
+
+void main()
+{
+    FragColor = texture(materialArray, vec3(TexCoords, materialLayers.x));
+}
@@ -16,17 +16,21 @@
 #include <tools/camera.h>
 #include <tools/mesh.h>
 #include <tools/model.h>
+#include <tools/instance_culler.h>
+#include <tools/gpu_timer.h>
 
 #include <iostream>
 #include <string>
 #include <string_view>
 #include <format>
+#include <vector>
 
 static void processInput(GLFWwindow* window);
 static void keyCallback(GLFWwindow* window, int key, int scancode, int action, int mods);
 static void mouseCallback(GLFWwindow* window, double posX, double posY);
 
 static unsigned int loadTexture(std::string_view path);
+static std::vector<glm::mat4> generateAsteroids(unsigned int amount);
 
 int SCREEN_WIDTH = 1280;
 int SCREEN_HEIGHT = 720;
@@ -103,69 +107,37 @@ int main()
 
     ImVec4 bgColor = ImVec4(0.12f, 0.12f, 0.15f, 1.0f);
 
+    // 有 GL 4.4 时可见数量由 GPU 直接写进间接绘制的参数
+    IndirectGL::load(reinterpret_cast<GLADloadproc>(glfwGetProcAddress));
+
     Shader planetShader(SHADER_DIR "/planet.vert", SHADER_DIR "/planet.frag");
     Shader meteoriteShader(SHADER_DIR "/meteorite.vert", SHADER_DIR "/meteorite.frag");
 
     Model planetModel(ASSETS_DIR "/model/planet/planet.obj");
-    Model rockModel(ASSETS_DIR "/model/rock/rock.obj");
-    
-    unsigned int amount = 1000;
-    std::vector<glm::mat4> modelMatrices(amount);
+    // 岩石只用到位置和纹理坐标，location 3 留给实例下标
+    BasicModel<UnlitVertexLayout> rockModel(ASSETS_DIR "/model/rock/rock.obj");
+
+    // 岩石模型的包围球半径，剔除时按实例矩阵的缩放放大
+    float rockRadius = 0.0f;
+    for (const auto& mesh : rockModel.meshes)
+        for (const Vertex& vertex : mesh.vertices)
+            rockRadius = glm::max(rockRadius, glm::length(vertex.Position));
+    // 远处的岩石只有几个像素，用低面数的球代替（第 1 级 LOD）
+    BasicSphereGeometry<UnlitVertexLayout> rockLodGeometry(rockRadius * 0.8f, 8.0f, 6.0f);
+
+    const unsigned int amounts[] = { 1000, 10000, 100000, 1000000 };
+    const char* amountNames[] = { "1000", "10000", "100000", "1000000" };
+    int amountIndex = 0;
     srand(static_cast<unsigned int>(glfwGetTime())); // 初始化随机种子
-    float radius = 50.0f;
-    float offset = 2.5f;
-    for (unsigned int i = 0; i < amount; i++)
-    {
-        glm::mat4 model = glm::mat4(1.0f);
-        // 1.位移：分布在半径为radius的圆形上，偏移的范围是 [-offset, offset]
-        float angle = (float)i / (float)amount * 360.0f;
-        float displacement = (rand() % (int)(2 * offset * 100)) / 100.0f - offset;
-        float x = glm::sin(angle) * radius + displacement;
-        displacement = (rand() % (int)(2 * offset * 100)) / 100.0f - offset;
-        float y = displacement * 0.4f; // 让行星带的高度比x和z的宽度要小
-        displacement = (rand() % (int)(2 * offset * 100)) / 100.0f - offset;
-        float z = glm::cos(angle) * radius + displacement;
-        model = glm::translate(model, glm::vec3(x, y, z));
-
-        // 2.缩放：在0.05和0.25之间缩放
-        float scale = static_cast<float>(rand() % 20) / 100.0f + 0.05f;
-        model = glm::scale(model, glm::vec3(scale));
-
-        // 3.旋转：绕着一个（半）随机选择的旋转轴向量进行随机的旋转
-        float rotAngle = static_cast<float>(rand() % 360);
-        model = glm::rotate(model, rotAngle, glm::vec3(0.4f, 0.6f, 0.8f));
-
-        // 4.添加到矩阵的数组中
-        modelMatrices[i] = model;
-    }
-
-    // 配置实例化数组
-    unsigned int instancingBuffer;
-    glGenBuffers(1, &instancingBuffer);
-    glBindBuffer(GL_ARRAY_BUFFER, instancingBuffer);
-    glBufferData(GL_ARRAY_BUFFER, amount * sizeof(glm::mat4), modelMatrices.data(), GL_STATIC_DRAW);
 
+    // 实例矩阵只上传一次，之后每帧由 GPU 剔除并按距离分到两级 LOD
+    InstanceCuller culler(generateAsteroids(amounts[amountIndex]), rockRadius, 2);
     for (unsigned int i = 0; i < rockModel.meshes.size(); i++)
-    {
-        unsigned int VAO = rockModel.meshes[i].VAO;
-        glBindVertexArray(VAO);
-        // 给矩阵设置属性指针
-        glEnableVertexAttribArray(3);
-        glVertexAttribPointer(3, 4, GL_FLOAT, GL_FALSE, sizeof(glm::mat4), (void*)0);
-        glEnableVertexAttribArray(5);
-        glVertexAttribPointer(4, 4, GL_FLOAT, GL_FALSE, sizeof(glm::mat4), (void*)(sizeof(glm::vec4)));
-        glEnableVertexAttribArray(6);
-        glVertexAttribPointer(5, 4, GL_FLOAT, GL_FALSE, sizeof(glm::mat4), (void*)(2 * sizeof(glm::vec4)));
-        glEnableVertexAttribArray(7);
-        glVertexAttribPointer(6, 4, GL_FLOAT, GL_FALSE, sizeof(glm::mat4), (void*)(3 * sizeof(glm::vec4)));
-
-        glVertexAttribDivisor(3, 1);
-        glVertexAttribDivisor(4, 1);
-        glVertexAttribDivisor(5, 1);
-        glVertexAttribDivisor(6, 1);
-
-        glBindVertexArray(0);
-    }
+        culler.attach(rockModel.meshes[i].VAO, 0, 3);
+    // attach 会改动 VAO，先复制一份自己的缓冲，不影响参数相同的其他球体
+    rockLodGeometry.detachFromCache();
+    culler.attach(rockLodGeometry.VAO, 1, 3);
+    GpuTimer asteroidTimer;
 
     while (!glfwWindowShouldClose(window))
     {
@@ -189,6 +161,14 @@ int main()
             ImGui::Text("Actual resolution");
             ImGui::SliderInt("Width", &SCREEN_WIDTH, 800, 1920);
             ImGui::SliderInt("Height", &SCREEN_HEIGHT, 600, 1080);
+            if (ImGui::Combo("Asteroids", &amountIndex, amountNames, IM_ARRAYSIZE(amountNames)))
+                culler.setInstances(generateAsteroids(amounts[amountIndex]));
+            ImGui::Checkbox("Frustum Culling", &culler.frustumCulling);
+            ImGui::Checkbox("LOD Selection", &culler.lodSelection);
+            ImGui::SliderFloat("LOD Distance", &culler.lodDistances[0], 5.0f, 200.0f);
+            ImGui::Text("Visible: %u (LOD 0) + %u (LOD 1) / %d", culler.visibleCounts[0], culler.visibleCounts[1], culler.count());
+            ImGui::Text("Instance count: %s", IndirectGL::supported ? "written by GPU (indirect draw)" : "query readback");
+            ImGui::Text("Asteroids (GPU): %.3f ms", asteroidTimer.ms);
         ImGui::End();
 
         // ------------------------------------------------------------
@@ -196,7 +176,7 @@ int main()
         glClearColor(bgColor.x, bgColor.y, bgColor.z, bgColor.w);
         glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
-        glm::mat4 projection = glm::perspective(glm::radians(camera.Zoom), (float)SCREEN_WIDTH / (float)SCREEN_HEIGHT, 1.0f, 100.0f);
+        glm::mat4 projection = glm::perspective(glm::radians(camera.Zoom), (float)SCREEN_WIDTH / (float)SCREEN_HEIGHT, 1.0f, 300.0f);
         glm::mat4 view = camera.GetViewMatrix();;
         glm::mat4 model = glm::mat4(1.0f);
 
@@ -210,19 +190,22 @@ int main()
 
         planetModel.Draw(planetShader);
 
-        // 设置岩石
+        // 设置岩石：先在 GPU 上剔除，再只画可见的实例
+        asteroidTimer.begin();
+        culler.cull(projection * view, camera.Position);
+
         meteoriteShader.use();
         meteoriteShader.setMat4("projection", projection);
         meteoriteShader.setMat4("view", view);
         meteoriteShader.setInt("diffuseTexture", 0);
+        meteoriteShader.setInt("instanceMatrices", 1);
         glActiveTexture(GL_TEXTURE0);
         glBindTexture(GL_TEXTURE_2D, rockModel.textures_loaded[0].id);
+        culler.bindInstanceTexture(1);
         for (unsigned int i = 0; i < rockModel.meshes.size(); i++)
-        {
-            glBindVertexArray(rockModel.meshes[i].VAO);
-            glDrawElementsInstanced(GL_TRIANGLES, static_cast<unsigned int>(rockModel.meshes[i].indices.size()), GL_UNSIGNED_INT, 0, amount);
-            glBindVertexArray(0);
-        }
+            culler.draw(0, rockModel.meshes[i].VAO, static_cast<GLsizei>(rockModel.meshes[i].indices.size()));
+        culler.draw(1, rockLodGeometry.VAO, static_cast<GLsizei>(rockLodGeometry.indices.size()));
+        asteroidTimer.end();
 
         // ImGui 渲染
         ImGui::Render();
@@ -233,6 +216,9 @@ int main()
     }
 
     // 资源释放
+    culler.dispose();
+    rockLodGeometry.dispose();
+    asteroidTimer.dispose();
 
     glfwTerminate();
     return 0;
@@ -342,4 +328,37 @@ unsigned int loadTexture(std::string_view path)
     stbi_image_free(data);
 
     return textureID;
-}
\ No newline at end of file
+}
+
+// 分布在半径为 radius 的环上，数量越多环越宽，密度大致不变
+std::vector<glm::mat4> generateAsteroids(unsigned int amount)
+{
+    std::vector<glm::mat4> modelMatrices(amount);
+    float radius = 50.0f;
+    float offset = 2.5f * glm::sqrt(amount / 1000.0f);
+    for (unsigned int i = 0; i < amount; i++)
+    {
+        glm::mat4 model = glm::mat4(1.0f);
+        // 1.位移：分布在半径为radius的圆形上，偏移的范围是 [-offset, offset]
+        float angle = (float)i / (float)amount * 360.0f;
+        float displacement = (rand() % (int)(2 * offset * 100)) / 100.0f - offset;
+        float x = glm::sin(angle) * radius + displacement;
+        displacement = (rand() % (int)(2 * offset * 100)) / 100.0f - offset;
+        float y = displacement * 0.4f; // 让行星带的高度比x和z的宽度要小
+        displacement = (rand() % (int)(2 * offset * 100)) / 100.0f - offset;
+        float z = glm::cos(angle) * radius + displacement;
+        model = glm::translate(model, glm::vec3(x, y, z));
+
+        // 2.缩放：在0.05和0.25之间缩放
+        float scale = static_cast<float>(rand() % 20) / 100.0f + 0.05f;
+        model = glm::scale(model, glm::vec3(scale));
+
+        // 3.旋转：绕着一个（半）随机选择的旋转轴向量进行随机的旋转
+        float rotAngle = static_cast<float>(rand() % 360);
+        model = glm::rotate(model, rotAngle, glm::vec3(0.4f, 0.6f, 0.8f));
+
+        // 4.添加到矩阵的数组中
+        modelMatrices[i] = model;
+    }
+    return modelMatrices;
+}
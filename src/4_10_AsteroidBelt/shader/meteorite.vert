@@ -1,16 +1,19 @@
 #version 330 core
 layout (location = 0) in vec3 aPos;
-layout (location = 1) in vec3 aNormal;
 layout (location = 2) in vec2 aTexCoords;
-layout (location = 3) in mat4 instanceMatrix;
+// 剔除后可见实例的下标，矩阵从纹理缓冲里取（tools/instance_culler.h）
+layout (location = 3) in uint instanceIndex;
+
+#include "instance_matrix.glsl"
 
 out vec2 TexCoords;
 
 uniform mat4 projection;
 uniform mat4 view;
+uniform samplerBuffer instanceMatrices;
 
 void main()
 {
     TexCoords = aTexCoords;
-    gl_Position = projection * view * instanceMatrix * vec4(aPos, 1.0f);
+    gl_Position = projection * view * fetchInstanceMatrix(instanceMatrices, instanceIndex) * vec4(aPos, 1.0f);
 }
\ No newline at end of file
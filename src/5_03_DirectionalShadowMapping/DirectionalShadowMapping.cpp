@@ -14,26 +14,34 @@
 #include <tools/shader.h>
 #include <tools/stb_image.h>
 #include <tools/camera.h>
+#include <tools/cascaded_shadow_map.h>
+#include <tools/shadow_filter.h>
+#include <tools/gpu_timer.h>
 
 #include <iostream>
 #include <string>
 #include <string_view>
 #include <format>
 #include <unordered_set>
+#include <vector>
+#include <fstream>
 
 static void processInput(GLFWwindow* window);
 static void keyCallback(GLFWwindow* window, int key, int scancode, int action, int mods);
 static void mouseCallback(GLFWwindow* window, double posX, double posY);
 
 static unsigned int loadTexture(std::string_view path);
-static void renderScene(const Shader& shader);
+static void buildScene();
+static int renderScene(const Shader& shader, const CascadedShadowMap* csm = nullptr, int cascade = 0);
 static void renderQuad();
+static void saveScreenshot(std::string_view path, int width, int height);
 
 int SCREEN_WIDTH = 1280;
 int SCREEN_HEIGHT = 720;
 
-const unsigned int SHADOW_WIDTH = 1024;
-const unsigned int SHADOW_HEIGHT = 1024;
+// 每个级联的分辨率
+const int SHADOW_RESOLUTION = 1024;
+const int CASCADE_COUNT = 4;
 
 // 摄像机
 Camera camera(glm::vec3(0.0f, 0.0f, 3.0f), glm::vec3(0.0f, 1.0f, 0.0f));
@@ -49,6 +57,18 @@ float prevFrameTime = 0.0f; // 上一针的时间
 // 几何形状
 std::unique_ptr<BoxGeometry> cubeGeometry;
 std::unique_ptr<PlaneGeometry> planeGeometry;
+// 深度 pass 用只有位置的顶点流（12 字节 / 顶点，相同位置合并），关掉用来对比
+bool usePositionStream = true;
+
+// 场景中的方块，包围球用于按级联剔除
+struct SceneCube
+{
+    glm::mat4 model;
+    glm::vec3 center;
+    float radius;
+};
+std::vector<SceneCube> sceneCubes;
+const float FLOOR_SIZE = 200.0f;
 
 unsigned int quadVAO = 0;
 unsigned int quadVBO;
@@ -116,46 +136,50 @@ int main()
 
     ImVec4 bgColor = ImVec4(0.12f, 0.12f, 0.15f, 1.0f);
 
-    Shader sceneShader(SHADER_DIR "/scene.vert", SHADER_DIR "/scene.frag");
+    // 每种阴影过滤方式编译一个场景着色器变体
+    std::vector<Shader> sceneShaders;
+    for (int i = 0; i < ShadowFilter::TECHNIQUE_COUNT; ++i)
+        sceneShaders.emplace_back(SHADER_DIR "/scene.vert", SHADER_DIR "/scene.frag", std::string_view{ }, ShadowFilter::defines(static_cast<ShadowFilter::Technique>(i)));
     Shader simpleDepthShader(SHADER_DIR "/shadowMappingDepth.vert", SHADER_DIR "/shadowMappingDepth.frag");
     Shader debugDepthQuad(SHADER_DIR "/debugQuad.vert", SHADER_DIR "/debugQuad.frag");    
 
     cubeGeometry  = std::make_unique<BoxGeometry>(1.0f, 1.0f, 1.0f);
     planeGeometry = std::make_unique<PlaneGeometry>(1.0f, 1.0f);
+    cubeGeometry->buildPositionStream();
+    planeGeometry->buildPositionStream();
 
     unsigned int woodMap = loadTexture(ASSETS_DIR "/texture/wood.png");
 
-    // 为渲染的深度贴图创建一个帧缓冲对象
-    unsigned int depthMapFBO;
-    glGenFramebuffers(1, &depthMapFBO);
-    
-    // 创建一个2D纹理，提供给帧缓冲的深度缓冲使用
-    unsigned int depthMap;
-    glGenTextures(1, &depthMap);
-    glBindTexture(GL_TEXTURE_2D, depthMap);
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_DEPTH_COMPONENT,
-        SHADOW_WIDTH, SHADOW_HEIGHT, 0, GL_DEPTH_COMPONENT, GL_FLOAT, nullptr); // 纹理格式指定为GL_DEPTH_COMPONENT
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_BORDER);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_BORDER);
-    float borderColor[] = { 1.0f, 1.0f, 1.0f, 1.0f };
-    glTexParameterfv(GL_TEXTURE_2D, GL_TEXTURE_BORDER_COLOR, borderColor);
-
-    // 把生成的深度纹理作为帧缓冲的深度缓冲
-    glBindFramebuffer(GL_FRAMEBUFFER, depthMapFBO);
-    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_TEXTURE_2D, depthMap, 0);
-    glDrawBuffer(GL_NONE);
-    glReadBuffer(GL_NONE);
-    glBindFramebuffer(GL_FRAMEBUFFER, 0);
-
-    sceneShader.use();
-    sceneShader.setInt("diffuseTexture", 0);
-    sceneShader.setInt("shadowMap", 1);
+    buildScene();
+
+    // 级联阴影贴图，所有级联共用一张深度纹理数组
+    CascadedShadowMap csm(SHADOW_RESOLUTION, CASCADE_COUNT);
+    ShadowFilter shadowFilter(SHADOW_RESOLUTION, CASCADE_COUNT);
+
+    for (const Shader& shader : sceneShaders)
+    {
+        shader.use();
+        shader.setInt("diffuseTexture", 0);
+        shader.setInt("shadowMap", 1);
+        shader.setInt("cascadeCount", csm.cascadeCount);
+    }
+
+    // 各过滤方式最近一次测得的 GPU 时间：预过滤 + 场景着色
+    int technique = static_cast<int>(ShadowFilter::Technique::HardwarePCF);
+    GpuTimer prefilterTimer;
+    GpuTimer shadingTimer;
+    float prefilterTimes[ShadowFilter::TECHNIQUE_COUNT] = {};
+    float shadingTimes[ShadowFilter::TECHNIQUE_COUNT] = {};
+    // 依次用每种方式渲染一帧并截图，-1 表示不在截图
+    int screenshotIndex = -1;
     debugDepthQuad.use();
     debugDepthQuad.setInt("depthMap", 0);
 
     glm::vec3 lightPos(-2.0f, 4.0f, -1.0f);
+    float nearPlane = 0.1f;
+    float shadowDistance = 100.0f;
+    bool showCascades = false;
+    int casterCounts[CascadedShadowMap::MAX_CASCADES] = {};
 
     while (!glfwWindowShouldClose(window))
     {
@@ -178,33 +202,60 @@ int main()
             ImGui::Text("x: %.1f, y: %.1f, z: %.1f", camera.Position.x, camera.Position.y, camera.Position.z);
             ImGui::SliderInt("Screen Width", &SCREEN_WIDTH, 800, 1920);
             ImGui::SliderInt("Screen Height", &SCREEN_HEIGHT, 600, 1080);
-            // ImGui::SliderInt("Shadow Width", &SHADOW_WIDTH, 256, 4096); // 不能这么修改，depthMap由于已经预定了大小，无法实时修改
-            // ImGui::SliderInt("Shadow Height", &SHADOW_HEIGHT, 256, 4096);
+            ImGui::SliderFloat("Shadow Distance", &shadowDistance, 10.0f, 200.0f);
+            ImGui::SliderFloat("Split Lambda", &csm.splitLambda, 0.0f, 1.0f);
+            ImGui::Checkbox("Show Cascades", &showCascades);
+            ImGui::Checkbox("Position-only Depth Stream", &usePositionStream);
+            ImGui::Text("Cube vertices in depth pass: %zu x %zu B -> %zu x %zu B", cubeGeometry->vertices.size(), sizeof(Vertex),
+                cubeGeometry->positionStream.vertexCount, sizeof(glm::vec3));
+            for (int i = 0; i < csm.cascadeCount; ++i)
+                ImGui::Text("Cascade %d: %.1f m, %d casters", i, csm.splits[i], casterCounts[i]);
+            ImGui::Separator();
+            for (int i = 0; i < ShadowFilter::TECHNIQUE_COUNT; ++i)
+            {
+                ImGui::RadioButton(ShadowFilter::name(static_cast<ShadowFilter::Technique>(i)), &technique, i);
+                ImGui::SameLine(140.0f);
+                ImGui::Text("prefilter %.3f ms, shading %.3f ms", prefilterTimes[i], shadingTimes[i]);
+            }
+            ImGui::SliderInt("Vogel Taps", &shadowFilter.taps, 4, 64);
+            ImGui::SliderFloat("Vogel Radius", &shadowFilter.radius, 0.5f, 8.0f);
+            ImGui::SliderInt("Prefilter Radius", &shadowFilter.blurRadius, 0, 8);
+            ImGui::SliderFloat("VSM Bleed Reduction", &shadowFilter.bleedReduction, 0.0f, 0.9f);
+            ImGui::SliderFloat("ESM Exponent", &shadowFilter.exponent, 10.0f, 87.0f);
+            if (ImGui::Button("Save Screenshots") && screenshotIndex < 0)
+                screenshotIndex = 0;
         ImGui::End();
 
+        if (screenshotIndex >= 0)
+            technique = screenshotIndex;
+        ShadowFilter::Technique filterTechnique = static_cast<ShadowFilter::Technique>(technique);
+        const Shader& sceneShader = sceneShaders[technique];
+
         // ------------------------------------------------------------
         // 渲染指令
         glClearColor(bgColor.x, bgColor.y, bgColor.z, bgColor.w);
         glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
-        // 1.将场景深度渲染为纹理（从灯光的角度）
-        float nearPlane = 1.0f;
-        float farPlane  = 7.5f;
-        // glm::mat4 lightProjection = glm::perspective(glm::radians(45.0f), (GLfloat)SHADOW_WIDTH / (GLfloat)SHADOW_HEIGHT, near_plane, far_plane);
-        glm::mat4 lightProjection = glm::ortho(-10.0f, 10.0f, -10.0f, 10.0f, nearPlane, farPlane);
-        glm::mat4 lightView = glm::lookAt(lightPos, glm::vec3(0.0f), glm::vec3(0.0f, 1.0f, 0.0f));
-        glm::mat4 lightSpaceMatrix = lightProjection * lightView;
-        
+        // 1.将场景深度渲染为纹理（从灯光的角度），每个级联只画和它相交的投射物
+        // 平行光，方向由 lightPos 指向原点
+        glm::vec3 lightDir = glm::normalize(-lightPos);
+        float aspect = (float)SCREEN_WIDTH / (float)SCREEN_HEIGHT;
+        csm.update(camera, aspect, nearPlane, shadowDistance, lightDir);
+
         simpleDepthShader.use();
-        simpleDepthShader.setMat4("lightSpaceMatrix", lightSpaceMatrix);
+        for (int i = 0; i < csm.cascadeCount; ++i)
+        {
+            csm.beginCascade(i);
+            simpleDepthShader.setMat4("lightSpaceMatrix", csm.lightSpaceMatrices[i]);
+            casterCounts[i] = renderScene(simpleDepthShader, &csm, i);
+        }
+        csm.end();
 
-        glViewport(0, 0, SHADOW_WIDTH, SHADOW_HEIGHT);
-            glBindFramebuffer(GL_FRAMEBUFFER, depthMapFBO);
-            glClear(GL_DEPTH_BUFFER_BIT);
-            glActiveTexture(GL_TEXTURE0);
-            glBindTexture(GL_TEXTURE_2D, woodMap);
-            renderScene(simpleDepthShader);
-        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+        // VSM / ESM 把深度转换成矩并预过滤
+        prefilterTimer.begin();
+        shadowFilter.prefilter(filterTechnique, csm.depthArray, csm.cascadeCount);
+        prefilterTimer.end();
+        prefilterTimes[technique] = prefilterTimer.ms;
 
         // 重置视口大小
         glViewport(0, 0, SCREEN_WIDTH, SCREEN_HEIGHT);
@@ -212,26 +263,44 @@ int main()
 
         // 2.使用生成的深度/阴影贴图，正常渲染场景
         sceneShader.use();
-        glm::mat4 projection = glm::perspective(glm::radians(camera.Zoom), (float)SCREEN_WIDTH / (float)SCREEN_HEIGHT, 0.1f, 100.0f);
+        glm::mat4 projection = glm::perspective(glm::radians(camera.Zoom), aspect, nearPlane, glm::max(shadowDistance, 100.0f));
         glm::mat4 view = camera.GetViewMatrix();
         sceneShader.setMat4("projection", projection);
         sceneShader.setMat4("view", view);
         // 设置灯光属性
         sceneShader.setVec3("viewPos", camera.Position);
-        sceneShader.setVec3("lightPos", lightPos);
-        sceneShader.setMat4("lightSpaceMatrix", lightSpaceMatrix);
+        sceneShader.setVec3("lightDir", lightDir);
+        sceneShader.setBool("showCascades", showCascades);
+        shadowFilter.setUniforms(sceneShader);
+        for (int i = 0; i < csm.cascadeCount; ++i)
+        {
+            std::string index = std::to_string(i);
+            sceneShader.setMat4("lightSpaceMatrices[" + index + "]", csm.lightSpaceMatrices[i]);
+            sceneShader.setFloat("cascadeSplits[" + index + "]", csm.splits[i]);
+            sceneShader.setFloat("cascadeTexelSizes[" + index + "]", 2.0f * csm.radii[i] / csm.resolution);
+        }
         glActiveTexture(GL_TEXTURE0);
         glBindTexture(GL_TEXTURE_2D, woodMap);
-        glActiveTexture(GL_TEXTURE1);
-        glBindTexture(GL_TEXTURE_2D, depthMap);
+        shadowFilter.bind(filterTechnique, csm.depthArray, 1);
+        shadingTimer.begin();
         renderScene(sceneShader);
+        shadingTimer.end();
+        shadingTimes[technique] = shadingTimer.ms;
+        shadowFilter.unbind(1);
+
+        // 截图不包含界面
+        if (screenshotIndex >= 0)
+        {
+            saveScreenshot(std::format("shadow_{}.ppm", technique), SCREEN_WIDTH, SCREEN_HEIGHT);
+            if (++screenshotIndex == ShadowFilter::TECHNIQUE_COUNT)
+                screenshotIndex = -1;
+        }
 
         // 将深度贴图渲染为四边形以进行可视化调试
         debugDepthQuad.use();
-        debugDepthQuad.setFloat("nearPlane", nearPlane);
-        debugDepthQuad.setFloat("farPlane", farPlane);
+        debugDepthQuad.setInt("layer", 0);
         glActiveTexture(GL_TEXTURE0);
-        glBindTexture(GL_TEXTURE_2D, depthMap);
+        glBindTexture(GL_TEXTURE_2D_ARRAY, csm.depthArray);
         // renderQuad();
 
         // ImGui 渲染
@@ -245,6 +314,10 @@ int main()
     // 资源释放
     cubeGeometry->dispose();
     planeGeometry->dispose();
+    csm.dispose();
+    shadowFilter.dispose();
+    prefilterTimer.dispose();
+    shadingTimer.dispose();
     glDeleteVertexArrays(1, &quadVAO);
     glDeleteBuffers(1, &quadVBO);
 
@@ -358,52 +431,95 @@ unsigned int loadTexture(std::string_view path)
     return textureID;
 }
 
-void renderScene(const Shader& shader)
+void buildScene()
 {
-    std::vector<glm::vec3> cubePositions
+    // 教程中原有的三个方块
+    glm::mat4 model = glm::mat4(1.0f);
+    model = glm::translate(model, glm::vec3(0.0f, 1.5f, 0.0f));
+    model = glm::scale(model, glm::vec3(0.5f));
+    sceneCubes.push_back({ model, glm::vec3(0.0f, 1.5f, 0.0f), 0.5f });
+
+    model = glm::mat4(1.0f);
+    model = glm::translate(model, glm::vec3(2.0f, 0.0f, 1.0f));
+    model = glm::scale(model, glm::vec3(0.5f));
+    sceneCubes.push_back({ model, glm::vec3(2.0f, 0.0f, 1.0f), 0.5f });
+
+    model = glm::mat4(1.0f);
+    model = glm::translate(model, glm::vec3(-1.0f, 0.0f, 2.0f));
+    model = glm::rotate(model, glm::radians(60.0f), glm::normalize(glm::vec3(1.0f, 0.0f, 1.0f)));
+    model = glm::scale(model, glm::vec3(0.25f));
+    sceneCubes.push_back({ model, glm::vec3(-1.0f, 0.0f, 2.0f), 0.25f });
+
+    // 向远处铺开的方块阵列，覆盖原来 10 倍的视距
+    for (int x = -10; x <= 10; ++x)
     {
-        glm::vec3( 0.0f,  1.5f,  0.0f),
-        glm::vec3( 2.0f,  0.0f,  1.0f),
-        glm::vec3(-1.0f,  0.0f,  2.0f)
-    };
+        for (int z = -10; z <= 10; ++z)
+        {
+            if (glm::abs(x) <= 1 && glm::abs(z) <= 1)
+                continue;
+            float height = 1.0f + static_cast<float>((x * 7 + z * 13) & 3);
+            glm::vec3 position(x * 8.0f, height * 0.5f - 0.26f, z * 8.0f);
+            model = glm::mat4(1.0f);
+            model = glm::translate(model, position);
+            model = glm::scale(model, glm::vec3(1.0f, height, 1.0f));
+            sceneCubes.push_back({ model, position, glm::length(glm::vec3(0.5f, height * 0.5f, 0.5f)) });
+        }
+    }
+}
+
+// 传入 csm 时只画和第 cascade 段相交的方块，返回画了多少个
+int renderScene(const Shader& shader, const CascadedShadowMap* csm, int cascade)
+{
+    // 深度着色器只读位置，换用位置流
+    bool positionOnly = usePositionStream && shader.positionOnly;
 
     // ------------------------------------------------------------
     // floor
-    glBindVertexArray(planeGeometry->VAO);
+    GLsizei planeIndexCount = planeGeometry->bind(positionOnly);
 
     glm::mat4 model = glm::mat4(1.0f);
     model = glm::translate(model, glm::vec3(0.0f, -0.26f, 0.0f));
     model = glm::rotate(model, glm::radians(-90.0f), glm::vec3(1.0f, 0.0f, 0.0f));
-    model = glm::scale(model, glm::vec3(10.0f));
+    model = glm::scale(model, glm::vec3(FLOOR_SIZE));
     shader.setMat4("model", model);
-    shader.setFloat("uvScale", 4.0f);
-    glDrawElements(GL_TRIANGLES, static_cast<GLsizei>(planeGeometry->indices.size()), GL_UNSIGNED_INT, 0);
+    shader.setFloat("uvScale", FLOOR_SIZE * 0.4f);
+    glDrawElements(GL_TRIANGLES, planeIndexCount, GL_UNSIGNED_INT, 0);
 
     // ------------------------------------------------------------
     // cubes
-    glBindVertexArray(cubeGeometry->VAO);
+    GLsizei cubeIndexCount = cubeGeometry->bind(positionOnly);
 
-    model = glm::mat4(1.0f);
-    model = glm::translate(model, cubePositions[0]);
-    model = glm::scale(model, glm::vec3(0.5f));
-    shader.setMat4("model", model);
+    int drawn = 0;
     shader.setFloat("uvScale", 1.0f);
-    glDrawElements(GL_TRIANGLES, static_cast<GLsizei>(cubeGeometry->indices.size()), GL_UNSIGNED_INT, 0);
+    for (const SceneCube& cube : sceneCubes)
+    {
+        if (csm && !csm->intersects(cascade, cube.center, cube.radius))
+            continue;
+        shader.setMat4("model", cube.model);
+        glDrawElements(GL_TRIANGLES, cubeIndexCount, GL_UNSIGNED_INT, 0);
+        ++drawn;
+    }
+    return drawn;
+}
 
-    model = glm::mat4(1.0f);
-    model = glm::translate(model, cubePositions[1]);
-    model = glm::scale(model, glm::vec3(0.5f));
-    shader.setMat4("model", model);
-    shader.setFloat("uvScale", 1.0f);
-    glDrawElements(GL_TRIANGLES, static_cast<GLsizei>(cubeGeometry->indices.size()), GL_UNSIGNED_INT, 0);
+// 以二进制 PPM 保存默认帧缓冲的内容，不依赖额外的图片库
+void saveScreenshot(std::string_view path, int width, int height)
+{
+    std::vector<unsigned char> pixels(static_cast<size_t>(width) * height * 3);
+    glPixelStorei(GL_PACK_ALIGNMENT, 1);
+    glReadPixels(0, 0, width, height, GL_RGB, GL_UNSIGNED_BYTE, pixels.data());
 
-    model = glm::mat4(1.0f);
-    model = glm::translate(model, cubePositions[2]);
-    model = glm::rotate(model, glm::radians(60.0f), glm::normalize(glm::vec3(1.0f, 0.0f, 1.0f)));
-    model = glm::scale(model, glm::vec3(0.25f));
-    shader.setMat4("model", model);
-    shader.setFloat("uvScale", 1.0f);
-    glDrawElements(GL_TRIANGLES, static_cast<GLsizei>(cubeGeometry->indices.size()), GL_UNSIGNED_INT, 0);
+    std::ofstream file(std::string(path), std::ios::binary);
+    if (!file)
+    {
+        std::cout << "Failed to save screenshot: " << path << std::endl;
+        return;
+    }
+    file << "P6\n" << width << " " << height << "\n255\n";
+    // OpenGL 的原点在左下角，按行倒着写
+    for (int y = height - 1; y >= 0; --y)
+        file.write(reinterpret_cast<const char*>(pixels.data() + static_cast<size_t>(y) * width * 3), static_cast<std::streamsize>(width) * 3);
+    std::cout << "Saved screenshot: " << path << std::endl;
 }
 
 void renderQuad()
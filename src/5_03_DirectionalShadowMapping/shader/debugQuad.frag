@@ -3,19 +3,11 @@ out vec4 FragColor;
 
 in vec2 TexCoords;
 
-uniform sampler2D depthMap;
-uniform float nearPlane;
-uniform float farPlane;
-
-float LinearizeDepth(float depth)
-{
-	float z = depth * 2.0f - 1.0f;
-	return (2.0f * nearPlane * farPlane) / (farPlane + nearPlane - z * (farPlane - nearPlane));
-}
+uniform sampler2DArray depthMap;
+uniform int layer;
 
 void main()
 {
-	float depthValue = texture(depthMap, TexCoords).r;
-	// FragColor = vec4(vec3(LinearizeDepth(depthValue) / farPlane), 1.0); // 透视
+	float depthValue = texture(depthMap, vec3(TexCoords, layer)).r;
     FragColor = vec4(vec3(depthValue), 1.0); // 正交
-}
\ No newline at end of file
+}
@@ -5,16 +5,28 @@ in VS_OUT {
     vec3 FragPos;
     vec3 Normal;
     vec2 TexCoords;
-    vec4 FragPosLightSpace;
+    float ViewDepth;
 } fs_in;
 
+// 过滤方式由 C++ 端传入的宏决定，见 glsl/shadow_filtering.glsl
+#include "shadow_filtering.glsl"
+
+const int MAX_CASCADES = 8;
+
 uniform sampler2D diffuseTexture;
-uniform sampler2D shadowMap;
+uniform SHADOW_MAP_ARRAY shadowMap;
+uniform ShadowParams shadowParams;
 
-uniform vec3 lightPos;
+uniform mat4 lightSpaceMatrices[MAX_CASCADES];
+uniform float cascadeSplits[MAX_CASCADES];      // 每个级联在观察空间下的远平面
+uniform float cascadeTexelSizes[MAX_CASCADES];  // 每个级联一个阴影纹素在世界空间的大小
+uniform int cascadeCount;
+uniform bool showCascades;
+
+uniform vec3 lightDir; // 平行光的传播方向
 uniform vec3 viewPos;
 
-float ShadowCalculation(vec4 fragPosLightSpace);
+float ShadowCalculation(int cascade, vec3 normal);
 
 void main()
 {           
@@ -25,58 +37,57 @@ void main()
     // 环境光
     vec3 ambient = 0.3f * lightColor;
     // 漫反射
-    vec3 lightDir = normalize(lightPos - fs_in.FragPos);
-    float diff = max(dot(lightDir, normal), 0.0);
+    vec3 toLight = -normalize(lightDir);
+    float diff = max(dot(toLight, normal), 0.0);
     vec3 diffuse = diff * lightColor;
     // 镜面反射
     vec3 viewDir = normalize(viewPos - fs_in.FragPos);
-    vec3 reflectDir = reflect(-lightDir, normal);
-    float spec = 0.0;
-    vec3 halfwayDir = normalize(lightDir + viewDir);  
-    spec = pow(max(dot(normal, halfwayDir), 0.0), 64.0);
+    vec3 halfwayDir = normalize(toLight + viewDir);  
+    float spec = pow(max(dot(normal, halfwayDir), 0.0), 64.0);
     vec3 specular = spec * lightColor;    
 
-    // 计算阴影
-    float shadow = ShadowCalculation(fs_in.FragPosLightSpace);                      
+    // 按观察空间深度选择级联
+    int cascade = cascadeCount;
+    for (int i = 0; i < cascadeCount; ++i)
+    {
+        if (fs_in.ViewDepth < cascadeSplits[i])
+        {
+            cascade = i;
+            break;
+        }
+    }
+
+    // 计算阴影，超出阴影距离的部分不投影
+    float shadow = cascade < cascadeCount ? ShadowCalculation(cascade, normal) : 0.0;
     vec3 lighting = (ambient + (1.0 - shadow) * (diffuse + specular)) * color;    
+
+    if (showCascades && cascade < cascadeCount)
+    {
+        const vec3 cascadeColors[4] = vec3[](vec3(1.0, 0.3, 0.3), vec3(0.3, 1.0, 0.3), vec3(0.3, 0.3, 1.0), vec3(1.0, 1.0, 0.3));
+        lighting *= cascadeColors[cascade % 4];
+    }
     
     FragColor = vec4(lighting, 1.0);
 }
 
-float ShadowCalculation(vec4 fragPosLightSpace)
+float ShadowCalculation(int cascade, vec3 normal)
 {
-    // 执行透视除法
-    vec3 projCoords = fragPosLightSpace.xyz / fragPosLightSpace.w;
-    // 变换到[0,1]的范围
-    projCoords = projCoords * 0.5 + 0.5;
-    // // 取得最近点的深度(使用[0,1]范围下的fragPosLight当坐标)
-    float closestDepth = texture(shadowMap, projCoords.xy).r; 
-    // 取得当前片段在光源视角下的深度
+    // 沿法线偏移一个多纹素再投影，级联越远纹素越大，偏移也跟着变大
+    vec3 toLight = -normalize(lightDir);
+    float slope = 1.0 - max(dot(normal, toLight), 0.0);
+    vec3 offsetPos = fs_in.FragPos + normal * cascadeTexelSizes[cascade] * (1.0 + slope);
+    vec4 fragPosLightSpace = lightSpaceMatrices[cascade] * vec4(offsetPos, 1.0);
+    // 正交投影，w 为 1，变换到[0,1]的范围
+    vec3 projCoords = fragPosLightSpace.xyz * 0.5 + 0.5;
+    // 取得当前片段在光源视角下的深度，在近平面之前被压平的投射物深度为 0
     float currentDepth = projCoords.z;
-    // float shadow = currentDepth > closestDepth  ? 1.0 : 0.0;
+    float bias = 0.001;
 
-    // 计算 阴影偏移 (基于表面法线和光照方向)
-    vec3 normal = normalize(fs_in.Normal);
-    vec3 lightDir = normalize(lightPos - fs_in.FragPos);
-    float bias = max(0.05 * (1.0 - dot(normal, lightDir)), 0.005);
-    // check whether current frag pos is in shadow
-    // float shadow = currentDepth - bias > closestDepth  ? 1.0 : 0.0;
-    // PCF
-    float shadow = 0.0;
-    vec2 texelSize = 1.0 / textureSize(shadowMap, 0);
-    for(int x = -1; x <= 1; ++x)
-    {
-        for(int y = -1; y <= 1; ++y)
-        {
-            float pcfDepth = texture(shadowMap, projCoords.xy + vec2(x, y) * texelSize).r; 
-            shadow += currentDepth - bias > pcfDepth  ? 1.0 : 0.0;        
-        }    
-    }
-    shadow /= 9.0;
+    float shadow = filterShadow(shadowMap, vec3(projCoords.xy, cascade), currentDepth - bias, shadowParams);
     
     // keep the shadow at 0.0 when outside the far_plane region of the light's frustum.
     if(projCoords.z > 1.0)
         shadow = 0.0;
         
     return shadow;
-}
\ No newline at end of file
+}
@@ -21,26 +21,33 @@
 #include <tools/stb_image.h>
 #include <tools/shader.h>
 #include <tools/camera.h>
+#include <tools/shadow_atlas.h>
+#include <tools/gpu_timer.h>
 
 #include <iostream>
 #include <string>
 #include <string_view>
 #include <format>
 #include <unordered_set>
+#include <vector>
+#include <random>
 
 static void processInput(GLFWwindow* window);
 static void keyCallback(GLFWwindow* window, GLint key, GLint scancode, GLint action, GLint mods);
 static void mouseCallback(GLFWwindow* window, GLdouble posX, GLdouble posY);
 
 static GLuint loadTexture(std::string_view path);
-static void renderScene(const Shader& shader);
+static void buildScene();
+static void renderScene(const Shader& shader, const PointShadowAtlas::Light* light = nullptr, int face = 0);
 static void renderQuad();
 
 GLint SCREEN_WIDTH = 1280;
 GLint SCREEN_HEIGHT = 720;
 
-constexpr GLuint SHADOW_WIDTH = 1024;
-constexpr GLuint SHADOW_HEIGHT = 1024;
+// 所有点光源共用一张阴影图集
+constexpr GLint SHADOW_ATLAS_SIZE = 4096;
+constexpr GLint MAX_LIGHTS = 32;
+constexpr GLfloat LIGHT_RANGE = 8.0f;
 
 // 摄像机
 Camera camera(glm::vec3(0.0f, 0.0f, 3.0f), glm::vec3(0.0f, 1.0f, 0.0f));
@@ -56,6 +63,17 @@ GLfloat prevFrameTime = 0.0f; // 上一针的时间
 
 // 几何形状
 std::unique_ptr<BoxGeometry> cubeGeometry;
+// 深度 pass 用只有位置的顶点流（12 字节 / 顶点，相同位置合并），关掉用来对比
+bool usePositionStream = true;
+
+// 房间里的方块，包围球用于判断是否落在光源某个面的视锥内
+struct SceneCube
+{
+    glm::mat4 model;
+    glm::vec3 center;
+    GLfloat radius;
+};
+std::vector<SceneCube> sceneCubes;
 
 GLuint quadVAO = 0;
 GLuint quadVBO;
@@ -123,44 +141,46 @@ int main()
 
     Shader sceneShader(SHADER_DIR "/scene.vert", SHADER_DIR "/scene.frag");
     Shader lightObjShader(SHADER_DIR "/lightObj.vert", SHADER_DIR "/lightObj.frag");
-    Shader simpleDepthShader(SHADER_DIR "/pointShadowsDepth.vert", SHADER_DIR "/pointShadowsDepth.frag", SHADER_DIR "/pointShadowsDepth.geom");
+    Shader simpleDepthShader(SHADER_DIR "/pointShadowsDepth.vert", SHADER_DIR "/pointShadowsDepth.frag");
 
     cubeGeometry  = std::make_unique<BoxGeometry>(1.0f, 1.0f, 1.0f);
+    cubeGeometry->buildPositionStream();
     SphereGeometry sphereGeometry(0.01f, 10.0f, 10.0f);
 
     GLuint woodTexture = loadTexture(ASSETS_DIR "/texture/wood.png");
 
     GLfloat lightPos[3] = { 0.0f, 0.0f, 0.0f };
 
-    // 为渲染的深度贴图创建一个帧缓冲对象
-    GLuint depthMapFBO;
-    glGenFramebuffers(1, &depthMapFBO);
-    
-    // 创建一个2D纹理，提供给帧缓冲的深度缓冲使用
-    GLuint depthCubeMap;
-    glGenTextures(1, &depthCubeMap);
-    glBindTexture(GL_TEXTURE_CUBE_MAP, depthCubeMap);
-    for (GLuint i = 0; i < 6; ++i)
+    buildScene();
+
+    // 点光源阴影图集：第 0 个光源由界面控制，其余随机分布在房间里
+    PointShadowAtlas shadowAtlas(SHADOW_ATLAS_SIZE, MAX_LIGHTS);
+    std::vector<glm::vec3> lightBasePositions;
+    std::vector<glm::vec3> lightColors;
+    std::vector<glm::vec3> lightPositions(MAX_LIGHTS);
+    std::mt19937 rng(7);
+    std::uniform_real_distribution<GLfloat> randomPos(-4.0f, 4.0f);
+    std::uniform_real_distribution<GLfloat> randomColor(0.2f, 1.0f);
+    for (GLint i = 0; i < MAX_LIGHTS; ++i)
     {
-        glTexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + i, 0, GL_DEPTH_COMPONENT,
-            SHADOW_WIDTH, SHADOW_HEIGHT, 0, GL_DEPTH_COMPONENT, GL_FLOAT, nullptr); // 纹理格式指定为GL_DEPTH_COMPONENT
+        glm::vec3 position = i == 0 ? glm::vec3(0.0f) : glm::vec3(randomPos(rng), randomPos(rng), randomPos(rng));
+        glm::vec3 color = i == 0 ? glm::vec3(1.0f) : glm::vec3(randomColor(rng), randomColor(rng), randomColor(rng));
+        lightBasePositions.push_back(position);
+        lightColors.push_back(color);
+        shadowAtlas.addLight(position, LIGHT_RANGE);
     }
-    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
-
-    // 把生成的深度纹理作为帧缓冲的深度缓冲
-    glBindFramebuffer(GL_FRAMEBUFFER, depthMapFBO);
-    glFramebufferTexture(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, depthCubeMap, 0);
-    glDrawBuffer(GL_NONE);
-    glReadBuffer(GL_NONE);
-    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+    GLint lightCount = 24;
+    GLint faceBudget = 24;
+    bool animateLights = false;
+    bool animateCube = true;
+    GpuTimer shadowTimer;
 
     sceneShader.use();
     sceneShader.setInt("diffuseTexture", 0);
-    sceneShader.setInt("shadowMap", 1);    
+    sceneShader.setInt("shadowAtlas", 1);
+    sceneShader.setInt("faceTable", 2);
+    sceneShader.setFloat("farPlane", LIGHT_RANGE);
 
     while (!glfwWindowShouldClose(window))
     {
@@ -186,40 +206,55 @@ int main()
             ImGui::SliderInt("Screen Height", &SCREEN_HEIGHT, 600, 1080);
             ImGui::SliderFloat3("Light Position", lightPos, -5.0f, 5.0f);
             ImGui::Checkbox("Use Shadows", &useShadows);
+            ImGui::SliderInt("Lights", &lightCount, 1, MAX_LIGHTS);
+            ImGui::SliderInt("Face Budget", &faceBudget, 6, 6 * MAX_LIGHTS);
+            ImGui::Checkbox("Animate Lights", &animateLights);
+            ImGui::Checkbox("Animate Cube", &animateCube);
+            ImGui::Checkbox("Position-only Depth Stream", &usePositionStream);
+            ImGui::Text("Cube vertices in depth pass: %zu x %zu B -> %zu x %zu B", cubeGeometry->vertices.size(), sizeof(Vertex),
+                cubeGeometry->positionStream.vertexCount, sizeof(glm::vec3));
+            ImGui::Text("Faces rendered: %d", shadowAtlas.facesRendered);
+            ImGui::Text("Shadow pass (GPU): %.3f ms", shadowTimer.ms);
         ImGui::End();
 
-        glm::vec3 curLightPos(lightPos[0], lightPos[1], lightPos[2]);
+        // 更新光源位置，没动的光源 setLightPosition 不会把面标记为脏
+        for (GLint i = 0; i < lightCount; ++i)
+        {
+            glm::vec3 position = lightBasePositions[i];
+            if (i == 0)
+                position = glm::vec3(lightPos[0], lightPos[1], lightPos[2]);
+            else if (animateLights)
+                position += glm::vec3(glm::sin(currFrameTime + i), 0.0f, glm::cos(currFrameTime * 0.7f + i)) * 0.5f;
+            lightPositions[i] = position;
+            shadowAtlas.setLightPosition(i, position);
+        }
+
+        // 最后一个方块是动态的，移动前后两个位置所在的面都要重画
+        if (animateCube)
+        {
+            SceneCube& cube = sceneCubes.back();
+            shadowAtlas.invalidate(cube.center, cube.radius);
+            cube.center = glm::vec3(3.0f * glm::cos(currFrameTime * 0.5f), -2.0f, 3.0f * glm::sin(currFrameTime * 0.5f));
+            cube.model = glm::translate(glm::mat4(1.0f), cube.center);
+            cube.model = glm::rotate(cube.model, currFrameTime, glm::vec3(0.0f, 1.0f, 0.0f));
+            shadowAtlas.invalidate(cube.center, cube.radius);
+        }
 
         // ------------------------------------------------------------
         // 渲染指令
         glClearColor(bgColor.x, bgColor.y, bgColor.z, bgColor.w);
         glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
-        // 1.将场景深度渲染为纹理（从灯光的角度）
-        GLfloat aspect = (GLfloat)SHADOW_WIDTH / (GLfloat)SHADOW_HEIGHT;
-        GLfloat nearPlane = 1.0f;
-        GLfloat farPlane  = 25.0f;
-        glm::mat4 shadowProj = glm::perspective(glm::radians(90.0f), aspect, nearPlane, farPlane);
-        std::vector<glm::mat4> shadowTransforms;
-        shadowTransforms.push_back(shadowProj * glm::lookAt(curLightPos, curLightPos + glm::vec3( 1.0f,  0.0f,  0.0f), glm::vec3( 0.0f, -1.0f,  0.0f)));
-        shadowTransforms.push_back(shadowProj * glm::lookAt(curLightPos, curLightPos + glm::vec3(-1.0f,  0.0f,  0.0f), glm::vec3( 0.0f, -1.0f,  0.0f)));
-        shadowTransforms.push_back(shadowProj * glm::lookAt(curLightPos, curLightPos + glm::vec3( 0.0f,  1.0f,  0.0f), glm::vec3( 0.0f,  0.0f,  1.0f)));
-        shadowTransforms.push_back(shadowProj * glm::lookAt(curLightPos, curLightPos + glm::vec3( 0.0f, -1.0f,  0.0f), glm::vec3( 0.0f,  0.0f, -1.0f)));
-        shadowTransforms.push_back(shadowProj * glm::lookAt(curLightPos, curLightPos + glm::vec3( 0.0f,  0.0f,  1.0f), glm::vec3( 0.0f, -1.0f,  0.0f)));
-        shadowTransforms.push_back(shadowProj * glm::lookAt(curLightPos, curLightPos + glm::vec3( 0.0f,  0.0f, -1.0f), glm::vec3( 0.0f, -1.0f,  0.0f)));
-
-        simpleDepthShader.use();
-        glViewport(0, 0, SHADOW_WIDTH, SHADOW_HEIGHT);
-            glBindFramebuffer(GL_FRAMEBUFFER, depthMapFBO);
-            glClear(GL_DEPTH_BUFFER_BIT);
-            for (GLuint i = 0; i < 6; ++i)
+        // 1.按屏幕上的覆盖范围给光源分配图集中的块，只重新渲染脏的面
+        for (GLint i = 0; i < MAX_LIGHTS; ++i)
+            shadowAtlas.setLightEnabled(i, i < lightCount);
+        shadowAtlas.assignResolutions(camera.Position, camera.Zoom, SCREEN_HEIGHT);
+        shadowTimer.begin();
+        shadowAtlas.render(simpleDepthShader, faceBudget, [&](GLint light, GLint face)
             {
-                simpleDepthShader.setMat4(std::format("shadowMatrices[{}]", i), shadowTransforms[i]);
-            }
-            simpleDepthShader.setFloat("farPlane", farPlane);
-            simpleDepthShader.setVec3("lightPos", curLightPos);
-            renderScene(simpleDepthShader);
-        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+                renderScene(simpleDepthShader, &shadowAtlas.lights[light], face);
+            });
+        shadowTimer.end();
 
         // 2.使用生成的深度/阴影贴图，正常渲染场景
         // 重置视口大小
@@ -233,24 +268,34 @@ int main()
         sceneShader.setMat4("view", view);
         // 设置其它属性
         sceneShader.setVec3("viewPos", camera.Position);
-        sceneShader.setVec3("lightPos", curLightPos);
-        sceneShader.setFloat("farPlane", farPlane);        
+        sceneShader.setInt("lightCount", lightCount);
+        for (GLint i = 0; i < lightCount; ++i)
+        {
+            sceneShader.setVec3(std::format("lightPositions[{}]", i), lightPositions[i]);
+            sceneShader.setVec3(std::format("lightColors[{}]", i), lightColors[i]);
+        }
+        sceneShader.setFloat("atlasSize", static_cast<GLfloat>(SHADOW_ATLAS_SIZE));
         sceneShader.setBool("useShadows", useShadows);
         glActiveTexture(GL_TEXTURE0);
         glBindTexture(GL_TEXTURE_2D, woodTexture);
         glActiveTexture(GL_TEXTURE1);
-        glBindTexture(GL_TEXTURE_CUBE_MAP, depthCubeMap);
+        glBindTexture(GL_TEXTURE_2D, shadowAtlas.atlas.depthTexture);
+        glActiveTexture(GL_TEXTURE2);
+        glBindTexture(GL_TEXTURE_2D, shadowAtlas.faceTable);
         renderScene(sceneShader);
 
         // 渲染灯光
         lightObjShader.use();
-        glm::mat4 model = glm::mat4(1.0f);
-        model = glm::translate(model, curLightPos);
         lightObjShader.setMat4("projection", projection);
         lightObjShader.setMat4("view", view);
-        lightObjShader.setMat4("model", model);
         glBindVertexArray(sphereGeometry.VAO);
-        glDrawElements(GL_TRIANGLES, static_cast<GLsizei>(sphereGeometry.indices.size()), GL_UNSIGNED_INT, 0);
+        for (GLint i = 0; i < lightCount; ++i)
+        {
+            glm::mat4 model = glm::mat4(1.0f);
+            model = glm::translate(model, lightPositions[i]);
+            lightObjShader.setMat4("model", model);
+            glDrawElements(GL_TRIANGLES, static_cast<GLsizei>(sphereGeometry.indices.size()), GL_UNSIGNED_INT, 0);
+        }
 
         // ImGui 渲染
         ImGui::Render();
@@ -262,6 +307,9 @@ int main()
 
     // 资源释放
     cubeGeometry->dispose();
+    sphereGeometry.dispose();
+    shadowAtlas.dispose();
+    shadowTimer.dispose();
     glDeleteVertexArrays(1, &quadVAO);
     glDeleteBuffers(1, &quadVBO);
 
@@ -380,24 +428,8 @@ GLuint loadTexture(std::string_view path)
     return textureID;
 }
 
-void renderScene(const Shader& shader)
+void buildScene()
 {
-    // ------------------------------------------------------------
-    // Room cube
-    glBindVertexArray(cubeGeometry->VAO);
-
-    glm::mat4 model = glm::mat4(1.0f);
-    model = glm::scale(model, glm::vec3(10.0f));
-    shader.setMat4("model", model);
-    shader.setFloat("uvScale", 4.0f);
-    glDisable(GL_CULL_FACE);
-    shader.setInt("isReverseNormals", 1);
-    glDrawElements(GL_TRIANGLES, static_cast<GLsizei>(cubeGeometry->indices.size()), GL_UNSIGNED_INT, 0);
-    shader.setInt("isReverseNormals", 0);
-    glEnable(GL_CULL_FACE);
-
-    // ------------------------------------------------------------
-    // cubes
     std::vector<glm::vec3> cubePositions
     {
         glm::vec3( 4.0f, -3.5f,  0.0f),
@@ -424,18 +456,49 @@ void renderScene(const Shader& shader)
         1.0f,
         1.5f
     };    
-    
-    glBindVertexArray(cubeGeometry->VAO);
-    shader.setFloat("uvScale", 1.0f);
+
     for (GLuint i = 0; i < cubePositions.size(); ++i)
     {
-        model = glm::mat4(1.0f);
+        glm::mat4 model = glm::mat4(1.0f);
         model = glm::translate(model, cubePositions[i]);
         model = glm::rotate(model, glm::radians(rotateAngles[i]), glm::normalize(glm::vec3(1.0f, 0.0f, 1.0f)));
         model = glm::scale(model, glm::vec3(scaleFactors[i]));
-        shader.setMat4("model", model);
-        
-        glDrawElements(GL_TRIANGLES, static_cast<GLsizei>(cubeGeometry->indices.size()), GL_UNSIGNED_INT, 0);
+        // 半个对角线
+        sceneCubes.push_back({ model, cubePositions[i], 0.87f * scaleFactors[i] });
+    }
+
+    // 动态方块，位置每帧在主循环里更新
+    sceneCubes.push_back({ glm::mat4(1.0f), glm::vec3(3.0f, -2.0f, 0.0f), 0.87f });
+}
+
+// 传入 light 时只画落在它第 face 个面视锥内的方块
+void renderScene(const Shader& shader, const PointShadowAtlas::Light* light, int face)
+{
+    // 深度着色器只读位置，换用位置流
+    GLsizei indexCount = cubeGeometry->bind(usePositionStream && shader.positionOnly);
+
+    // ------------------------------------------------------------
+    // Room cube
+
+    glm::mat4 model = glm::mat4(1.0f);
+    model = glm::scale(model, glm::vec3(10.0f));
+    shader.setMat4("model", model);
+    shader.setFloat("uvScale", 4.0f);
+    glDisable(GL_CULL_FACE);
+    shader.setInt("isReverseNormals", 1);
+    glDrawElements(GL_TRIANGLES, indexCount, GL_UNSIGNED_INT, 0);
+    shader.setInt("isReverseNormals", 0);
+    glEnable(GL_CULL_FACE);
+
+    // ------------------------------------------------------------
+    // cubes
+    shader.setFloat("uvScale", 1.0f);
+    for (const SceneCube& cube : sceneCubes)
+    {
+        if (light && !PointShadowAtlas::faceIntersects(*light, face, cube.center, cube.radius))
+            continue;
+        shader.setMat4("model", cube.model);
+        glDrawElements(GL_TRIANGLES, indexCount, GL_UNSIGNED_INT, 0);
     }
 }
 
@@ -1,5 +1,5 @@
 #version 330 core
-in vec4 FragPos;
+in vec4 FragPos; // 世界空间位置，来自顶点着色器
 
 uniform vec3 lightPos;
 uniform float farPlane;
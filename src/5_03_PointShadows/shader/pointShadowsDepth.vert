@@ -2,8 +2,12 @@
 layout (location = 0) in vec3 aPos;
 
 uniform mat4 model;
+uniform mat4 shadowMatrix; // 当前立方体面的投影 * 观察矩阵
+
+out vec4 FragPos;
 
 void main()
 {
-	gl_Position = model * vec4(aPos, 1.0f);
-}
\ No newline at end of file
+	FragPos = model * vec4(aPos, 1.0f);
+	gl_Position = shadowMatrix * FragPos;
+}
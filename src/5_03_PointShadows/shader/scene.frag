@@ -7,94 +7,105 @@ in VS_OUT {
     vec2 TexCoords;
 } fs_in;
 
+#include "shadow_filtering.glsl"
+
+const int MAX_LIGHTS = 32;
+
 uniform sampler2D diffuseTexture;
-uniform samplerCube depthMap; // 修改的地方
+uniform sampler2DShadow shadowAtlas; // 所有点光源的立方体面都在这张图集里
+uniform sampler2D faceTable;         // (face, light) 处存放该面在图集中的 uv 范围，宽度为 0 表示没有阴影
 
-uniform vec3 lightPos;
+uniform vec3 lightPositions[MAX_LIGHTS];
+uniform vec3 lightColors[MAX_LIGHTS];
+uniform int lightCount;
 uniform vec3 viewPos;
 
-uniform float farPlane;
+uniform float farPlane; // 光源的照射范围
+uniform float atlasSize;
 uniform bool useShadows;
 
-float ShadowCalculation(vec3 fragPos);
+float ShadowCalculation(int light, vec3 fragPos);
 
 void main()
 {           
     vec3 color = texture(diffuseTexture, fs_in.TexCoords).rgb;
     vec3 normal = normalize(fs_in.Normal);
-    vec3 lightColor = vec3(0.3f);
+    vec3 viewDir = normalize(viewPos - fs_in.FragPos);
 
     // 环境光
-    vec3 ambient = 0.3f * lightColor;
-    // 漫反射
-    vec3 lightDir = normalize(lightPos - fs_in.FragPos);
-    float diff = max(dot(lightDir, normal), 0.0);
-    vec3 diffuse = diff * lightColor;
-    // 镜面反射
-    vec3 viewDir = normalize(viewPos - fs_in.FragPos);
-    vec3 reflectDir = reflect(-lightDir, normal);
-    float spec = 0.0;
-    vec3 halfwayDir = normalize(lightDir + viewDir);  
-    spec = pow(max(dot(normal, halfwayDir), 0.0), 64.0);
-    vec3 specular = spec * lightColor;    
-
-    // 计算阴影
-    float shadow = useShadows ? ShadowCalculation(fs_in.FragPos) : 0.0f;
-    vec3 lighting = (ambient + (1.0 - shadow) * (diffuse + specular)) * color;    
-    
-    FragColor = vec4(lighting, 1.0);
+    vec3 lighting = vec3(0.09f);
+    for (int i = 0; i < lightCount; ++i)
+    {
+        vec3 lightToFrag = fs_in.FragPos - lightPositions[i];
+        float distance = length(lightToFrag);
+        if (distance > farPlane)
+            continue;
+        float attenuation = 1.0 - distance / farPlane;
+        attenuation *= attenuation;
+        vec3 lightColor = lightColors[i] * 0.3f;
+
+        // 漫反射
+        vec3 lightDir = -lightToFrag / distance;
+        float diff = max(dot(lightDir, normal), 0.0);
+        vec3 diffuse = diff * lightColor;
+        // 镜面反射
+        vec3 halfwayDir = normalize(lightDir + viewDir);  
+        float spec = pow(max(dot(normal, halfwayDir), 0.0), 64.0);
+        vec3 specular = spec * lightColor;    
 
+        // 计算阴影
+        float shadow = useShadows ? ShadowCalculation(i, fs_in.FragPos) : 0.0f;
+        lighting += (1.0 - shadow) * (diffuse + specular) * attenuation;
+    }
+    
+    FragColor = vec4(lighting * color, 1.0);
 }
 
-float ShadowCalculation(vec3 fragPos)
+float ShadowCalculation(int light, vec3 fragPos)
 {
-    vec3 lightToFrag = fragPos - lightPos;
-    float closestDepth = texture(depthMap, lightToFrag).r;
-    closestDepth *= farPlane;
-    float currentDepth = length(lightToFrag); // 当前片段和光源之间的深度值
+    vec3 v = fragPos - lightPositions[light];
+    vec3 a = abs(v);
 
-    float bias = 0.05f;
-    // float shadow = currentDepth - bias > closestDepth ? 1.0f : 0.0f;
-    // 调试
-    // FragColor = vec4(vec3(closestDepth / farPlane), 1.0);
-    float shadow = 0.0f;
-    // float samples = 4.0f;
-    // float offset = 0.1f;
-    // for (float x = -offset; x < offset; x += offset / (samples * 0.5))
-    // {
-    //     for (float y = -offset; y < offset; y += offset / (samples * 0.5))
-    //     {
-    //         for (float z = -offset; z < offset; z += offset / (samples * 0.5))
-    //         {
-    //             float closestDepth = texture(depthMap, lightToFrag + vec3(x, y, z)).r;
-    //             closestDepth *= farPlane;
-    //             if (currentDepth - bias > closestDepth)
-    //                 shadow += 1.0f;
-    //         }
-    //     }
-    // }
-    // shadow /= (samples * samples * samples);
-
-    vec3 sampleOffsetDirections[20] = vec3[]
-    (
-        vec3( 1,  1,  1), vec3( 1, -1,  1), vec3(-1, -1,  1), vec3(-1,  1,  1), 
-        vec3( 1,  1, -1), vec3( 1, -1, -1), vec3(-1, -1, -1), vec3(-1,  1, -1),
-        vec3( 1,  1,  0), vec3( 1, -1,  0), vec3(-1, -1,  0), vec3(-1,  1,  0),
-        vec3( 1,  0,  1), vec3(-1,  0,  1), vec3( 1,  0, -1), vec3(-1,  0, -1),
-        vec3( 0,  1,  1), vec3( 0, -1,  1), vec3( 0, -1, -1), vec3( 0,  1, -1)
-    );
-
-    int samples = 20;
-    float viewDistance = length(viewPos - fragPos);
-    float diskRadius = (1.0f + (viewDistance / farPlane)) / 25.0f;
-    for (int i = 0; i < samples; ++i)
+    // 选出主轴所在的面，s / u 与 C++ 中 lookAt(FACE_DIRECTIONS, FACE_UPS) 得到的右、上方向一致
+    int face;
+    float z;
+    vec3 s;
+    vec3 u;
+    if (a.x >= a.y && a.x >= a.z)
     {
-        float closestDepth = texture(depthMap, lightToFrag + sampleOffsetDirections[i] * diskRadius).r;
-        closestDepth *= farPlane;
-        if (currentDepth - bias > closestDepth)
-            shadow += 1.0f;
+        face = v.x > 0.0 ? 0 : 1;
+        z = a.x;
+        s = vec3(0.0, 0.0, v.x > 0.0 ? -1.0 : 1.0);
+        u = vec3(0.0, -1.0, 0.0);
     }
-    shadow /= float(samples);
+    else if (a.y >= a.z)
+    {
+        face = v.y > 0.0 ? 2 : 3;
+        z = a.y;
+        s = vec3(1.0, 0.0, 0.0);
+        u = vec3(0.0, 0.0, v.y > 0.0 ? 1.0 : -1.0);
+    }
+    else
+    {
+        face = v.z > 0.0 ? 4 : 5;
+        z = a.z;
+        s = vec3(v.z > 0.0 ? 1.0 : -1.0, 0.0, 0.0);
+        u = vec3(0.0, -1.0, 0.0);
+    }
+
+    vec4 rect = texelFetch(faceTable, ivec2(face, light), 0);
+    if (rect.z == 0.0)
+        return 0.0;
 
-    return shadow;
-}
\ No newline at end of file
+    // 面的视锥比 90 度宽，边缘各留了一个纹素
+    float tileSize = rect.z * atlasSize;
+    float k = tileSize / (tileSize - 2.0);
+    vec2 ndc = vec2(dot(s, v), dot(u, v)) / (z * k);
+    vec2 uv = rect.xy + (ndc * 0.5 + 0.5) * rect.zw;
+
+    float bias = 0.05f;
+    float currentDepth = (length(v) - bias) / farPlane;
+
+    // 面的边缘留了一个纹素，硬件 PCF 错开半个纹素采样不会读到相邻的块
+    return shadowPCF(shadowAtlas, uv, currentDepth);
+}
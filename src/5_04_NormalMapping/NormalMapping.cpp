@@ -16,10 +16,15 @@
 #include <tools/camera.h>
 #include <tools/mesh.h>
 #include <tools/model.h>
+#include <tools/depth_prepass.h>
+#include <tools/gpu_timer.h>
 
 #include <iostream>
 #include <string>
 #include <format>
+#include <sstream>
+#include <chrono>
+#include <thread>
 
 static void processInput(GLFWwindow* window);
 static void keyCallback(GLFWwindow* window, GLint key, GLint scancode, GLint action, GLint mods);
@@ -28,7 +33,17 @@ static void mouseCallback(GLFWwindow* window, GLdouble posX, GLdouble posY);
 static GLuint loadTexture(std::string_view path);
 static void drawMesh(BufferGeometry geometry);
 static void drawLightObject(Shader shader, BufferGeometry geometry, glm::vec3 position);
-static void renderQuad();
+
+// 切线计算的耗时：单线程、多线程，以及 Assimp 的 aiProcess_CalcTangentSpace
+struct TangentBenchmark
+{
+    size_t triangles;
+    unsigned int threads;
+    float singleThreadMs;
+    float multiThreadMs;
+    float assimpMs;
+};
+static TangentBenchmark benchmarkTangents();
 
 
 const GLuint SCREEN_WIDTH = 1280;
@@ -107,9 +122,15 @@ int main()
     Shader sceneShader(std::string(SHADER_DIR) + "/scene.vert", std::string(SHADER_DIR) + "/scene.frag");
     Shader lightObjShader(std::string(SHADER_DIR) + "/lightObj.vert", std::string(SHADER_DIR) + "/lightObj.frag");
     
-    SphereGeometry pointLightGeometry(0.05f, 10.0f, 10.0f);
+    // 灯光物体只用到位置和纹理坐标
+    BasicSphereGeometry<UnlitVertexLayout> pointLightGeometry(0.05f, 10.0f, 10.0f);
+    // 切线由 BufferGeometry::computeTangents 生成，不再手动计算
+    PlaneGeometry quadGeometry(2.0f, 2.0f);
 
     Model ourModel(ASSETS_DIR "/model/nanosuit/nanosuit.obj");
+    // 深度预渲染只需要位置
+    quadGeometry.buildPositionStream();
+    ourModel.buildPositionStreams();
 
     // 生成纹理
     GLuint diffuseMap = loadTexture(ASSETS_DIR "/texture/brickwall.jpg");
@@ -130,6 +151,31 @@ int main()
     sceneShader.setVec3("light.specular", glm::vec3(specularStrength));
 
     ImVec4 bgColor = ImVec4(0.1f, 0.1f, 0.1f, 1.0f);    
+    TangentBenchmark tangentBenchmark{};
+
+    // 法线贴图的片段着色器比较贵，人物自身和地面重叠的部分用深度预渲染避免重复着色
+    DepthPrepass prepass(SCREEN_WIDTH, SCREEN_HEIGHT);
+    bool showOverdraw = false;
+    GpuTimer sceneTimer;
+
+    // 不透明物体，预渲染、过度绘制统计和颜色 pass 共用；调用前着色器已经 use() 并设置好 view / projection
+    auto drawScene = [&](Shader& shader)
+    {
+        glm::mat4 model = glm::mat4(1.0f);
+        model = glm::translate(model, glm::vec3(0.0f, -0.5f, 0.0f));
+        model = glm::scale(model, glm::vec3(5.0f));
+        model = glm::rotate(model, glm::radians(-90.0f), glm::vec3(1.0, 0.0, 0.0));
+        shader.setMat4("model", model);
+        GLsizei indexCount = quadGeometry.bind(shader.positionOnly);
+        glDrawElements(GL_TRIANGLES, indexCount, GL_UNSIGNED_INT, 0);
+        glBindVertexArray(0);
+
+        model = glm::mat4(1.0f);
+        model = glm::translate(model, glm::vec3(0.0f, -0.5f, -2.0f));
+        model = glm::scale(model, glm::vec3(0.2f));
+        shader.setMat4("model", model);
+        ourModel.Draw(shader);
+    };
 
     while (!glfwWindowShouldClose(window))
     {
@@ -152,8 +198,23 @@ int main()
             ImGui::Text("FOV: %.1f", camera.Zoom);
             ImGui::Text("x: %.1f, y: %.1f, z: %.1f", camera.Position.x, camera.Position.y, camera.Position.z);
             ImGui::SliderFloat3("Light Position", lightPos, -5.0f, 5.0f);
+            bool runBenchmark = ImGui::Button("Benchmark Tangents (1M triangles)");
+            if (tangentBenchmark.triangles > 0)
+            {
+                ImGui::Text("%zu triangles", tangentBenchmark.triangles);
+                ImGui::Text("1 thread: %.2f ms, %u threads: %.2f ms", tangentBenchmark.singleThreadMs, tangentBenchmark.threads, tangentBenchmark.multiThreadMs);
+                ImGui::Text("Assimp CalcTangentSpace: %.2f ms", tangentBenchmark.assimpMs);
+            }
+            ImGui::Checkbox("Depth Prepass", &prepass.enabled);
+            ImGui::Checkbox("Overdraw Heatmap", &showOverdraw);
+            if (showOverdraw)
+                ImGui::Text("Shaded fragments per pixel: %.2f", prepass.averageOverdraw);
+            ImGui::Text("Scene pass (GPU): %.3f ms", sceneTimer.ms);
         ImGui::End();
 
+        if (runBenchmark)
+            tangentBenchmark = benchmarkTangents();
+
         // ------------------------------------------------------------
         // 渲染指令
         glClearColor(bgColor.x, bgColor.y, bgColor.z, bgColor.w);
@@ -161,26 +222,19 @@ int main()
 
         glm::mat4 projection = glm::perspective(glm::radians(camera.Zoom), static_cast<float>(SCREEN_WIDTH) / static_cast<float>(SCREEN_HEIGHT), 0.1f, 100.0f);
         glm::mat4 view = camera.GetViewMatrix();
-        glm::mat4 model = glm::mat4(1.0f);
-        // ------------------------------------------------------------
-        // 设置灯光物体的着色器
         glm::vec3 curLightPos = glm::vec3(lightPos[0], lightPos[1], lightPos[2]);
-        drawLightObject(lightObjShader, pointLightGeometry, curLightPos);
+
+        sceneTimer.begin();
+        prepass.renderDepth(view, projection, drawScene);
 
         // ------------------------------------------------------------
         // 设置物体的着色器
         sceneShader.use();
-        model = glm::mat4(1.0f);
-        model = glm::translate(model, glm::vec3(0.0f, -0.5f, 0.0f));
-        model = glm::scale(model, glm::vec3(5.0f));
-        model = glm::rotate(model, glm::radians(-90.0f), glm::vec3(1.0, 0.0, 0.0));
-
         sceneShader.setMat4("projection", projection);
         sceneShader.setMat4("view", view);
         sceneShader.setVec3("viewPos", camera.Position);
         sceneShader.setVec3("light.position", curLightPos);
 
-        sceneShader.setMat4("model", model);
         sceneShader.setFloat("uvScale", 1.0f);
         sceneShader.setFloat("material.shininess", 64.0f);
         glActiveTexture(GL_TEXTURE0);
@@ -188,13 +242,21 @@ int main()
         glActiveTexture(GL_TEXTURE1);
         glBindTexture(GL_TEXTURE_2D, normalMap);
 
-        renderQuad();
-        
-        model = glm::mat4(1.0f);
-        model = glm::translate(model, glm::vec3(0.0f, -0.5f, -2.0f));
-        model = glm::scale(model, glm::vec3(0.2f));
-        sceneShader.setMat4("model", model);
-        ourModel.Draw(sceneShader);
+        prepass.beginColor();
+        drawScene(sceneShader);
+        prepass.endColor();
+        sceneTimer.end();
+
+        // ------------------------------------------------------------
+        // 设置灯光物体的着色器，灯光物体不参与预渲染，在颜色 pass 之后按普通的深度测试画
+        drawLightObject(lightObjShader, pointLightGeometry, curLightPos);
+
+        // 过度绘制热度图，覆盖上面的画面
+        if (showOverdraw)
+        {
+            prepass.measureOverdraw(view, projection, drawScene);
+            prepass.showHeatmap();
+        }
 
         // ImGui 渲染
         ImGui::Render();
@@ -206,6 +268,9 @@ int main()
 
     // 资源释放
     pointLightGeometry.dispose();    
+    quadGeometry.dispose();
+    prepass.dispose();
+    sceneTimer.dispose();
 
     glfwTerminate();
     return 0;
@@ -350,94 +415,56 @@ void drawLightObject(Shader shader, BufferGeometry geometry, glm::vec3 position)
     drawMesh(geometry);
 }
 
-GLuint quadVAO = 0;
-GLuint quadVBO;
-void renderQuad()
+TangentBenchmark benchmarkTangents()
 {
-    if (quadVAO == 0) // 第一次使用初始化
-    {
-        // 位置
-        glm::vec3 pos1(-1.0f,  1.0f,  0.0f);
-        glm::vec3 pos2(-1.0f, -1.0f,  0.0f);
-        glm::vec3 pos3( 1.0f, -1.0f,  0.0f);
-        glm::vec3 pos4( 1.0f,  1.0f,  0.0f);
-        // 纹理坐标
-        glm::vec2 uv1(0.0f, 1.0f);
-        glm::vec2 uv2(0.0f, 0.0f);
-        glm::vec2 uv3(1.0f, 0.0f);
-        glm::vec2 uv4(1.0f, 1.0f);
-        // 法向量
-        glm::vec3 nm(0.0f, 0.0f, 1.0f);
-
-        // 计算两个三角形的切线向量和副切线向量
-        glm::vec3 tangent1, bitangent1;
-        glm::vec3 tangent2, bitangent2;
-        // ------------------------------------------------------------
-        // 三角形 1
-        glm::vec3 edge1 = pos2 - pos1;
-        glm::vec3 edge2 = pos3 - pos1;
-        glm::vec2 deltaUV1 = uv2 - uv1;
-        glm::vec2 deltaUV2 = uv3 - uv1;
-
-        GLfloat f = 1.0f / (deltaUV1.x * deltaUV2.y - deltaUV2.x * deltaUV1.y);
-
-        tangent1.x = f * (deltaUV2.y * edge1.x - deltaUV1.y * edge2.x);
-        tangent1.y = f * (deltaUV2.y * edge1.y - deltaUV1.y * edge2.y);
-        tangent1.z = f * (deltaUV2.y * edge1.z - deltaUV1.y * edge2.z);
-        tangent1 = glm::normalize(tangent1);
-
-        bitangent1.x = f * (-deltaUV2.x * edge1.x + deltaUV1.x * edge2.x);
-        bitangent1.y = f * (-deltaUV2.x * edge1.y + deltaUV1.x * edge2.y);
-        bitangent1.z = f * (-deltaUV2.x * edge1.z + deltaUV1.x * edge2.z);
-        bitangent1 = glm::normalize(bitangent1);
-
-        // ------------------------------------------------------------
-        // 三角形 2
-        edge1 = pos3 - pos1;
-        edge2 = pos4 - pos1;
-        deltaUV1 = uv3 - uv1;
-        deltaUV2 = uv4 - uv1;
-
-        f = 1.0f / (deltaUV1.x * deltaUV2.y - deltaUV2.x * deltaUV1.y);
-
-        tangent2.x = f * (deltaUV2.y * edge1.x - deltaUV1.y * edge2.x);
-        tangent2.y = f * (deltaUV2.y * edge1.y - deltaUV1.y * edge2.y);
-        tangent2.z = f * (deltaUV2.y * edge1.z - deltaUV1.y * edge2.z);
-        tangent2 = glm::normalize(tangent2);
+    const int runs = 5;
+    // 707 x 707 个格子，约 100 万个三角形
+    PlaneGeometry plane(10.0f, 10.0f, 707.0f, 707.0f);
+    TangentBenchmark result{ plane.indices.size() / 3, glm::max(std::thread::hardware_concurrency(), 1u), 0.0f, 0.0f, 0.0f };
 
-        bitangent2.x = f * (-deltaUV2.x * edge1.x + deltaUV1.x * edge2.x);
-        bitangent2.y = f * (-deltaUV2.x * edge1.y + deltaUV1.x * edge2.y);
-        bitangent2.z = f * (-deltaUV2.x * edge1.z + deltaUV1.x * edge2.z);
-        bitangent2 = glm::normalize(bitangent2);
-
-        // ------------------------------------------------------------
-        GLfloat quadVertices[] = {
-            // 位置                  // 法线           // 纹理坐标     // 切线                             // 副切线
-            pos1.x, pos1.y, pos1.z, nm.x, nm.y, nm.z, uv1.x, uv1.y, tangent1.x, tangent1.y, tangent1.z, bitangent1.x, bitangent1.y, bitangent1.z,
-            pos2.x, pos2.y, pos2.z, nm.x, nm.y, nm.z, uv2.x, uv2.y, tangent1.x, tangent1.y, tangent1.z, bitangent1.x, bitangent1.y, bitangent1.z,
-            pos3.x, pos3.y, pos3.z, nm.x, nm.y, nm.z, uv3.x, uv3.y, tangent1.x, tangent1.y, tangent1.z, bitangent1.x, bitangent1.y, bitangent1.z,
-
-            pos1.x, pos1.y, pos1.z, nm.x, nm.y, nm.z, uv1.x, uv1.y, tangent2.x, tangent2.y, tangent2.z, bitangent2.x, bitangent2.y, bitangent2.z,
-            pos3.x, pos3.y, pos3.z, nm.x, nm.y, nm.z, uv3.x, uv3.y, tangent2.x, tangent2.y, tangent2.z, bitangent2.x, bitangent2.y, bitangent2.z,
-            pos4.x, pos4.y, pos4.z, nm.x, nm.y, nm.z, uv4.x, uv4.y, tangent2.x, tangent2.y, tangent2.z, bitangent2.x, bitangent2.y, bitangent2.z };
-        // 设置平面VAO
-        glGenVertexArrays(1, &quadVAO);
-        glGenBuffers(1, &quadVBO);
-        glBindVertexArray(quadVAO);
-        glBindBuffer(GL_ARRAY_BUFFER, quadVBO);
-        glBufferData(GL_ARRAY_BUFFER, sizeof(quadVertices), &quadVertices, GL_STATIC_DRAW);
-        glEnableVertexAttribArray(0);
-        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 14 * sizeof(GLfloat), (GLvoid*)0);
-        glEnableVertexAttribArray(1);
-        glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 14 * sizeof(GLfloat), (GLvoid*)(3 * sizeof(GLfloat)));
-        glEnableVertexAttribArray(2);
-        glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, 14 * sizeof(GLfloat), (GLvoid*)(6 * sizeof(GLfloat)));
-        glEnableVertexAttribArray(3);
-        glVertexAttribPointer(3, 3, GL_FLOAT, GL_FALSE, 14 * sizeof(GLfloat), (GLvoid*)(8 * sizeof(GLfloat)));
-        glEnableVertexAttribArray(4);
-        glVertexAttribPointer(4, 3, GL_FLOAT, GL_FALSE, 14 * sizeof(GLfloat), (GLvoid*)(11 * sizeof(GLfloat)));
+    auto measure = [&](auto&& work)
+    {
+        auto start = std::chrono::steady_clock::now();
+        for (int i = 0; i < runs; ++i)
+            work();
+        return std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - start).count() / runs;
+    };
+    result.singleThreadMs = measure([&]() { plane.computeTangents(1); });
+    result.multiThreadMs = measure([&]() { plane.computeTangents(result.threads); });
+
+    // 同一个网格导出成 OBJ 交给 Assimp
+    std::ostringstream obj;
+    for (const Vertex& vertex : plane.vertices)
+    {
+        obj << "v " << vertex.Position.x << " " << vertex.Position.y << " " << vertex.Position.z << "\n";
+        obj << "vt " << vertex.TexCoords.x << " " << vertex.TexCoords.y << "\n";
     }
-    glBindVertexArray(quadVAO);
-    glDrawArrays(GL_TRIANGLES, 0, 6);
-    glBindVertexArray(0);
-}
\ No newline at end of file
+    obj << "vn 0 0 1\n";
+    for (size_t i = 0; i < plane.indices.size(); i += 3)
+    {
+        obj << "f";
+        for (size_t corner = 0; corner < 3; ++corner)
+            obj << " " << plane.indices[i + corner] + 1 << "/" << plane.indices[i + corner] + 1 << "/1";
+        obj << "\n";
+    }
+    std::string objText = obj.str();
+    // 每次重新导入，只计时切线这一步后处理
+    for (int i = 0; i < runs; ++i)
+    {
+        Assimp::Importer importer;
+        if (!importer.ReadFileFromMemory(objText.data(), objText.size(), aiProcess_JoinIdenticalVertices, "obj"))
+        {
+            std::cout << "ERROR::ASSIMP:: " << importer.GetErrorString() << std::endl;
+            break;
+        }
+        auto start = std::chrono::steady_clock::now();
+        importer.ApplyPostProcessing(aiProcess_CalcTangentSpace);
+        result.assimpMs += std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - start).count();
+    }
+    result.assimpMs /= runs;
+    plane.dispose();
+
+    std::cout << result.triangles << " triangles: 1 thread " << result.singleThreadMs << " ms, "
+              << result.threads << " threads " << result.multiThreadMs << " ms, Assimp " << result.assimpMs << " ms" << std::endl;
+    return result;
+}
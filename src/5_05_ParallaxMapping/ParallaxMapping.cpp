@@ -14,6 +14,8 @@
 #include <tools/shader.h>
 #include <tools/stb_image.h>
 #include <tools/camera.h>
+#include <tools/depth_prepass.h>
+#include <tools/gpu_timer.h>
 
 #include <iostream>
 #include <string>
@@ -26,7 +28,6 @@ static void mouseCallback(GLFWwindow* window, GLdouble posX, GLdouble posY);
 static GLuint loadTexture(std::string_view path);
 static void drawMesh(const BufferGeometry& geometry);
 static void drawLightObject(const Shader& shader, const BufferGeometry& geometry, const glm::vec3& position);
-static void renderQuad();
 
 
 const GLuint SCREEN_WIDTH = 1280;
@@ -105,7 +106,12 @@ int main()
     Shader sceneShader(std::string(SHADER_DIR) + "/scene.vert", std::string(SHADER_DIR) + "/scene.frag");
     Shader lightObjShader(std::string(SHADER_DIR) + "/lightObj.vert", std::string(SHADER_DIR) + "/lightObj.frag");
     
-    SphereGeometry pointLightGeometry(0.05f, 10.0f, 10.0f);
+    // 灯光物体只用到位置和纹理坐标
+    BasicSphereGeometry<UnlitVertexLayout> pointLightGeometry(0.05f, 10.0f, 10.0f);
+    // 切线由 BufferGeometry::computeTangents 生成，不再手动计算
+    PlaneGeometry quadGeometry(2.0f, 2.0f);
+    // 深度预渲染只需要位置
+    quadGeometry.buildPositionStream();
 
     // 生成纹理
     // GLuint diffuseMap = loadTexture(ASSETS_DIR "/texture/bricks2.jpg");
@@ -135,6 +141,25 @@ int main()
 
     ImVec4 bgColor = ImVec4(0.1f, 0.1f, 0.1f, 1.0f);    
 
+    // 陡峭视差 / 视差遮蔽的片段着色器要循环采样高度图，用深度预渲染避免给被遮挡的片段做视差
+    // 平面边缘视差偏移出 [0, 1] 时片段着色器会 discard，预渲染不会，开启时那里露出背景色
+    DepthPrepass prepass(SCREEN_WIDTH, SCREEN_HEIGHT);
+    bool showOverdraw = false;
+    GpuTimer sceneTimer;
+
+    // 不透明物体，预渲染、过度绘制统计和颜色 pass 共用；调用前着色器已经 use() 并设置好 view / projection
+    auto drawScene = [&](Shader& shader)
+    {
+        glm::mat4 model = glm::mat4(1.0f);
+        model = glm::translate(model, glm::vec3(0.0f, -0.5f, 0.0f));
+        model = glm::scale(model, glm::vec3(5.0f));
+        model = glm::rotate(model, glm::radians(-90.0f), glm::vec3(1.0, 0.0, 0.0));
+        shader.setMat4("model", model);
+        GLsizei indexCount = quadGeometry.bind(shader.positionOnly);
+        glDrawElements(GL_TRIANGLES, indexCount, GL_UNSIGNED_INT, 0);
+        glBindVertexArray(0);
+    };
+
     while (!glfwWindowShouldClose(window))
     {
         processInput(window);
@@ -157,6 +182,11 @@ int main()
             ImGui::Text("x: %.1f, y: %.1f, z: %.1f", camera.Position.x, camera.Position.y, camera.Position.z);
             ImGui::SliderFloat3("Light Position", lightPos, -5.0f, 5.0f);
             ImGui::SliderFloat("Height Scale", &heightScale, 0.0f, 1.0f);
+            ImGui::Checkbox("Depth Prepass", &prepass.enabled);
+            ImGui::Checkbox("Overdraw Heatmap", &showOverdraw);
+            if (showOverdraw)
+                ImGui::Text("Shaded fragments per pixel: %.2f", prepass.averageOverdraw);
+            ImGui::Text("Scene pass (GPU): %.3f ms", sceneTimer.ms);
         ImGui::End();
 
         // ------------------------------------------------------------
@@ -166,26 +196,19 @@ int main()
 
         glm::mat4 projection = glm::perspective(glm::radians(camera.Zoom), static_cast<float>(SCREEN_WIDTH) / static_cast<float>(SCREEN_HEIGHT), 0.1f, 100.0f);
         glm::mat4 view = camera.GetViewMatrix();
-        glm::mat4 model = glm::mat4(1.0f);
-        // ------------------------------------------------------------
-        // 设置灯光物体的着色器
         glm::vec3 curLightPos = glm::vec3(lightPos[0], lightPos[1], lightPos[2]);
-        drawLightObject(lightObjShader, pointLightGeometry, curLightPos);
+
+        sceneTimer.begin();
+        prepass.renderDepth(view, projection, drawScene);
 
         // ------------------------------------------------------------
         // 设置物体的着色器
         sceneShader.use();
-        model = glm::mat4(1.0f);
-        model = glm::translate(model, glm::vec3(0.0f, -0.5f, 0.0f));
-        model = glm::scale(model, glm::vec3(5.0f));
-        model = glm::rotate(model, glm::radians(-90.0f), glm::vec3(1.0, 0.0, 0.0));
-
         sceneShader.setMat4("projection", projection);
         sceneShader.setMat4("view", view);
         sceneShader.setVec3("viewPos", camera.Position);
         sceneShader.setVec3("light.position", curLightPos);
 
-        sceneShader.setMat4("model", model);
         sceneShader.setFloat("uvScale", 1.0f);
         sceneShader.setFloat("heightScale", heightScale);
         sceneShader.setFloat("material.shininess", 32.0f);
@@ -196,7 +219,21 @@ int main()
         glActiveTexture(GL_TEXTURE2);
         glBindTexture(GL_TEXTURE_2D, heightMap);
 
-        renderQuad();        
+        prepass.beginColor();
+        drawScene(sceneShader);
+        prepass.endColor();
+        sceneTimer.end();
+
+        // ------------------------------------------------------------
+        // 设置灯光物体的着色器，灯光物体不参与预渲染，在颜色 pass 之后按普通的深度测试画
+        drawLightObject(lightObjShader, pointLightGeometry, curLightPos);
+
+        // 过度绘制热度图，覆盖上面的画面
+        if (showOverdraw)
+        {
+            prepass.measureOverdraw(view, projection, drawScene);
+            prepass.showHeatmap();
+        }
 
         // ImGui 渲染
         ImGui::Render();
@@ -207,7 +244,10 @@ int main()
     }
 
     // 资源释放
-    pointLightGeometry.dispose();    
+    pointLightGeometry.dispose();
+    quadGeometry.dispose();    
+    prepass.dispose();
+    sceneTimer.dispose();
 
     glfwTerminate();
     return 0;
@@ -350,96 +390,4 @@ void drawLightObject(const Shader& shader, const BufferGeometry& geometry, const
 
     shader.setMat4("model", model);
     drawMesh(geometry);
-}
-
-GLuint quadVAO = 0;
-GLuint quadVBO;
-void renderQuad()
-{
-    if (quadVAO == 0) // 第一次使用初始化
-    {
-        // 位置
-        glm::vec3 pos1(-1.0f,  1.0f,  0.0f);
-        glm::vec3 pos2(-1.0f, -1.0f,  0.0f);
-        glm::vec3 pos3( 1.0f, -1.0f,  0.0f);
-        glm::vec3 pos4( 1.0f,  1.0f,  0.0f);
-        // 纹理坐标
-        glm::vec2 uv1(0.0f, 1.0f);
-        glm::vec2 uv2(0.0f, 0.0f);
-        glm::vec2 uv3(1.0f, 0.0f);
-        glm::vec2 uv4(1.0f, 1.0f);
-        // 法向量
-        glm::vec3 nm(0.0f, 0.0f, 1.0f);
-
-        // 计算两个三角形的切线向量和副切线向量
-        glm::vec3 tangent1, bitangent1;
-        glm::vec3 tangent2, bitangent2;
-        // ------------------------------------------------------------
-        // 三角形 1
-        glm::vec3 edge1 = pos2 - pos1;
-        glm::vec3 edge2 = pos3 - pos1;
-        glm::vec2 deltaUV1 = uv2 - uv1;
-        glm::vec2 deltaUV2 = uv3 - uv1;
-
-        GLfloat f = 1.0f / (deltaUV1.x * deltaUV2.y - deltaUV2.x * deltaUV1.y);
-
-        tangent1.x = f * (deltaUV2.y * edge1.x - deltaUV1.y * edge2.x);
-        tangent1.y = f * (deltaUV2.y * edge1.y - deltaUV1.y * edge2.y);
-        tangent1.z = f * (deltaUV2.y * edge1.z - deltaUV1.y * edge2.z);
-        tangent1 = glm::normalize(tangent1);
-
-        bitangent1.x = f * (-deltaUV2.x * edge1.x + deltaUV1.x * edge2.x);
-        bitangent1.y = f * (-deltaUV2.x * edge1.y + deltaUV1.x * edge2.y);
-        bitangent1.z = f * (-deltaUV2.x * edge1.z + deltaUV1.x * edge2.z);
-        bitangent1 = glm::normalize(bitangent1);
-
-        // ------------------------------------------------------------
-        // 三角形 2
-        edge1 = pos3 - pos1;
-        edge2 = pos4 - pos1;
-        deltaUV1 = uv3 - uv1;
-        deltaUV2 = uv4 - uv1;
-
-        f = 1.0f / (deltaUV1.x * deltaUV2.y - deltaUV2.x * deltaUV1.y);
-
-        tangent2.x = f * (deltaUV2.y * edge1.x - deltaUV1.y * edge2.x);
-        tangent2.y = f * (deltaUV2.y * edge1.y - deltaUV1.y * edge2.y);
-        tangent2.z = f * (deltaUV2.y * edge1.z - deltaUV1.y * edge2.z);
-        tangent2 = glm::normalize(tangent2);
-
-        bitangent2.x = f * (-deltaUV2.x * edge1.x + deltaUV1.x * edge2.x);
-        bitangent2.y = f * (-deltaUV2.x * edge1.y + deltaUV1.x * edge2.y);
-        bitangent2.z = f * (-deltaUV2.x * edge1.z + deltaUV1.x * edge2.z);
-        bitangent2 = glm::normalize(bitangent2);
-
-        // ------------------------------------------------------------
-        GLfloat quadVertices[] = {
-            // 位置                  // 法线           // 纹理坐标     // 切线                             // 副切线
-            pos1.x, pos1.y, pos1.z, nm.x, nm.y, nm.z, uv1.x, uv1.y, tangent1.x, tangent1.y, tangent1.z, bitangent1.x, bitangent1.y, bitangent1.z,
-            pos2.x, pos2.y, pos2.z, nm.x, nm.y, nm.z, uv2.x, uv2.y, tangent1.x, tangent1.y, tangent1.z, bitangent1.x, bitangent1.y, bitangent1.z,
-            pos3.x, pos3.y, pos3.z, nm.x, nm.y, nm.z, uv3.x, uv3.y, tangent1.x, tangent1.y, tangent1.z, bitangent1.x, bitangent1.y, bitangent1.z,
-
-            pos1.x, pos1.y, pos1.z, nm.x, nm.y, nm.z, uv1.x, uv1.y, tangent2.x, tangent2.y, tangent2.z, bitangent2.x, bitangent2.y, bitangent2.z,
-            pos3.x, pos3.y, pos3.z, nm.x, nm.y, nm.z, uv3.x, uv3.y, tangent2.x, tangent2.y, tangent2.z, bitangent2.x, bitangent2.y, bitangent2.z,
-            pos4.x, pos4.y, pos4.z, nm.x, nm.y, nm.z, uv4.x, uv4.y, tangent2.x, tangent2.y, tangent2.z, bitangent2.x, bitangent2.y, bitangent2.z };
-        // 设置平面VAO
-        glGenVertexArrays(1, &quadVAO);
-        glGenBuffers(1, &quadVBO);
-        glBindVertexArray(quadVAO);
-        glBindBuffer(GL_ARRAY_BUFFER, quadVBO);
-        glBufferData(GL_ARRAY_BUFFER, sizeof(quadVertices), &quadVertices, GL_STATIC_DRAW);
-        glEnableVertexAttribArray(0);
-        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 14 * sizeof(GLfloat), (GLvoid*)0);
-        glEnableVertexAttribArray(1);
-        glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 14 * sizeof(GLfloat), (GLvoid*)(3 * sizeof(GLfloat)));
-        glEnableVertexAttribArray(2);
-        glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, 14 * sizeof(GLfloat), (GLvoid*)(6 * sizeof(GLfloat)));
-        glEnableVertexAttribArray(3);
-        glVertexAttribPointer(3, 3, GL_FLOAT, GL_FALSE, 14 * sizeof(GLfloat), (GLvoid*)(8 * sizeof(GLfloat)));
-        glEnableVertexAttribArray(4);
-        glVertexAttribPointer(4, 3, GL_FLOAT, GL_FALSE, 14 * sizeof(GLfloat), (GLvoid*)(11 * sizeof(GLfloat)));
-    }
-    glBindVertexArray(quadVAO);
-    glDrawArrays(GL_TRIANGLES, 0, 6);
-    glBindVertexArray(0);
 }//////////////////
\ No newline at end of file
@@ -32,6 +32,9 @@ uniform float uvScale;
 uniform vec3 viewPos;           // 摄像机位置
 uniform Light light;            // 灯光
 
+// 深度预渲染后颜色 pass 用 GL_EQUAL 比较深度，和 depth_prepass.vert 写成同一个表达式才能保证深度逐位相等
+invariant gl_Position;
+
 void main()
 {
     vs_out.FragPos = vec3(model * vec4(aPos, 1.0f));    
@@ -16,6 +16,10 @@
 #include <tools/camera.h>
 #include <tools/mesh.h>
 #include <tools/model.h>
+#include <tools/compute_shader.h>
+#include <tools/auto_exposure.h>
+#include <tools/gpu_timer.h>
+#include <tools/uber_post.h>
 
 #include <iostream>
 #include <string>
@@ -38,6 +42,7 @@ float lastY = SCREEN_HEIGHT / 2.0f;
 bool isFirstMouse = true;
 bool isMouseCaptured = true; // 初始为捕获状态（隐藏鼠标，控制视角）
 bool useHDR = true;
+bool useAutoExposure = true;
 
 // 时机
 float deltaTime = 0.0f; // 当前帧与上一帧的时间差
@@ -68,6 +73,7 @@ int main()
         std::cout << "Failed to initialize GLAD" << std::endl;
         return -1;
     }
+    ComputeGL::load(reinterpret_cast<GLADloadproc>(glfwGetProcAddress));
     /*
         回调函数注册
         1.注册窗口变化监听
@@ -132,19 +138,17 @@ int main()
 
     Shader sceneShader(std::string(SHADER_DIR) + "/scene.vert", std::string(SHADER_DIR) + "/scene.frag");
     Shader lightingShader(std::string(SHADER_DIR) + "/lighting.vert", std::string(SHADER_DIR) + "/lighting.frag");
-    Shader hdrShader(std::string(SHADER_DIR) + "/frameBuffer.vert", std::string(SHADER_DIR) + "/frameBuffer.frag");
     
     BoxGeometry boxGeometry(1.0f, 1.0f, 1.0f);
     SphereGeometry sphereGeometry(0.05f, 10.0f, 10.0f);
     PlaneGeometry planeGeometry(1.0f, 1.0f);
-    PlaneGeometry frameGeometry(2.0f, 2.0f);
         
     unsigned int boxMap    =  loadTexture(std::string(ASSETS_DIR) + "/texture/container2.png");
     unsigned int floorMap  =  loadTexture(std::string(ASSETS_DIR) + "/texture/wood.png");
 
     float exposure = 1.0f;
-    const char* toneMappingItems[] = { "Reinhard", "Exposure" };
-    int curToneMapping = 0; // 0 = Exposure, 1 = Reinhard
+    const char* toneMappingItems[] = { "Reinhard", "Exposure", "ACES" };
+    int curToneMapping = 0; // 0 = Reinhard, 1 = Exposure, 2 = ACES
 
     sceneShader.use();
     sceneShader.setInt("material.diffuse", 0);
@@ -163,8 +167,12 @@ int main()
     }
 
     // 帧缓冲设置
-    hdrShader.use();
-    hdrShader.setInt("screenTexture", 0);
+    // 曝光、色调映射和 sRGB 编码合并在一个 pass 里
+    UberPost uberPost;
+
+    // 自动曝光，结果留在 GPU 上，色调映射时直接采样
+    AutoExposure autoExposure;
+    GpuTimer exposureTimer;
 
     unsigned int hdrFBO;
     glGenFramebuffers(1, &hdrFBO);
@@ -213,7 +221,19 @@ int main()
             ImGui::Text("x: %.1f, y: %.1f, z: %.1f", camera.Position.x, camera.Position.y, camera.Position.z);
             ImGui::Checkbox("HDR", &useHDR);
             ImGui::Combo("Tone Mapping", &curToneMapping, toneMappingItems, IM_ARRAYSIZE(toneMappingItems));
-            ImGui::SliderFloat("Exposure", &exposure, 0.0f, 1.0f);
+            ImGui::Checkbox("Auto Exposure", &useAutoExposure);
+            if (useAutoExposure)
+            {
+                if (autoExposure.computeAvailable())
+                    ImGui::Checkbox("Histogram (Compute Shader)", &autoExposure.useCompute);
+                ImGui::SliderFloat("Key Value", &autoExposure.keyValue, 0.05f, 0.5f);
+                ImGui::SliderFloat("Adaptation Speed", &autoExposure.adaptationSpeed, 0.1f, 10.0f);
+                ImGui::Text("Auto Exposure (GPU): %.3f ms", exposureTimer.ms);
+            }
+            else
+            {
+                ImGui::SliderFloat("Exposure", &exposure, 0.0f, 1.0f);
+            }
         ImGui::End();
 
         // ------------------------------------------------------------
@@ -273,15 +293,22 @@ int main()
         // ------------------------------------------------------------
         // 回到默认的帧缓冲上
         glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+        // 统计 HDR 缓冲的亮度，更新曝光
+        if (useHDR && useAutoExposure)
+        {
+            exposureTimer.begin();
+            autoExposure.update(texColorBuffer, SCREEN_WIDTH, SCREEN_HEIGHT, deltaTime);
+            exposureTimer.end();
+        }
+
         glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
-        hdrShader.use();
-        hdrShader.setBool("useHDR", useHDR);
-        hdrShader.setFloat("exposure", exposure);
-        hdrShader.setInt("toneMappingMode", curToneMapping);
-        glBindVertexArray(frameGeometry.VAO);
-        glBindTexture(GL_TEXTURE_2D, texColorBuffer);
-        glDrawElements(GL_TRIANGLES, static_cast<int>(frameGeometry.indices.size()), GL_UNSIGNED_INT, 0);
+        // 关闭 HDR 时不做色调映射，直接截断；手动曝光时 Reinhard 和原来一样不乘曝光
+        uberPost.options.tonemap = useHDR ? static_cast<UberPost::Tonemap>(curToneMapping + 1) : UberPost::Tonemap::None;
+        uberPost.options.autoExposure = useHDR && useAutoExposure;
+        uberPost.exposure = useHDR && curToneMapping != 0 ? exposure : 1.0f;
+        uberPost.apply(texColorBuffer, 0, autoExposure.texture());
 
         // ImGui 渲染
         ImGui::Render();
@@ -295,9 +322,11 @@ int main()
     boxGeometry.dispose();
     sphereGeometry.dispose();
     planeGeometry.dispose();
-    frameGeometry.dispose();
     glDeleteFramebuffers(1, &hdrFBO);
     glDeleteRenderbuffers(1, &rboDepth);
+    autoExposure.dispose();
+    uberPost.dispose();
+    exposureTimer.dispose();
 
     glfwTerminate();
     return 0;
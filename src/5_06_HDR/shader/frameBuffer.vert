@@ -1,11 +0,0 @@
-#version 330 core
-layout(location = 0) in vec3 aPos;
-layout(location = 1) in vec3 aNormal;
-layout(location = 2) in vec2 aTexCoords;
-
-out vec2 TexCoords;
-
-void main() {
-    gl_Position = vec4(aPos.x, aPos.y, 0.0f, 1.0f);
-    TexCoords = aTexCoords;
-}
\ No newline at end of file
@@ -16,11 +16,17 @@
 #include <tools/camera.h>
 #include <tools/mesh.h>
 #include <tools/model.h>
+#include <tools/mip_bloom.h>
+#include <tools/render_graph.h>
+#include <tools/uber_post.h>
+#include <tools/compute_shader.h>
+#include <tools/separable_filter.h>
 
 #include <iostream>
 #include <string>
 #include <string_view>
 #include <format>
+#include <vector>
 
 static void processInput(GLFWwindow* window);
 static void keyCallback(GLFWwindow* window, int key, int scancode, int action, int mods);
@@ -29,6 +35,16 @@ static void mouseCallback(GLFWwindow* window, double posX, double posY);
 static unsigned int loadTexture(std::string_view path);
 static void drawMesh(const BufferGeometry& geometry);
 
+struct BlurBenchmark
+{
+    int width;
+    int height;
+    SeparableFilter::Kind kind;
+    float computeMs;
+    float fragmentMs;
+};
+static std::vector<BlurBenchmark> benchmarkBlur();
+
 const unsigned int SCREEN_WIDTH = 1280;
 const unsigned int SCREEN_HEIGHT = 720;
 
@@ -39,6 +55,11 @@ float lastY = SCREEN_HEIGHT / 2.0f;
 bool isFirstMouse = true;
 bool isMouseCaptured = true; // 初始为捕获状态（隐藏鼠标，控制视角）
 bool useBloom = true;
+bool useMipBloom = true;
+bool useSeparableFilter = true;
+// 当前帧缓冲大小，窗口缩放时由回调更新
+int framebufferWidth = SCREEN_WIDTH;
+int framebufferHeight = SCREEN_HEIGHT;
 
 // 时机
 float deltaTime = 0.0f; // 当前帧与上一帧的时间差
@@ -69,6 +90,8 @@ int main()
         std::cout << "Failed to initialize GLAD" << std::endl;
         return -1;
     }
+    // 上下文支持 4.3 时加载计算着色器的函数
+    ComputeGL::load(reinterpret_cast<GLADloadproc>(glfwGetProcAddress));
     /*
         回调函数注册
         1.注册窗口变化监听
@@ -77,6 +100,8 @@ int main()
     glfwSetFramebufferSizeCallback(window, [](GLFWwindow* window, int width, int height)
         {
             glViewport(0, 0, width, height);
+            framebufferWidth = width;
+            framebufferHeight = height;
         });
     glfwSetKeyCallback(window, keyCallback);
     glfwSetCursorPosCallback(window, mouseCallback);
@@ -134,7 +159,8 @@ int main()
     Shader sceneShader(SHADER_DIR "/scene.vert", SHADER_DIR "/scene.frag");
     Shader lightObjShader(SHADER_DIR "/lightObj.vert", SHADER_DIR "/lightObj.frag");
     Shader blurShader(SHADER_DIR "/blur.vert", SHADER_DIR "/blur.frag");
-    Shader bloomFinalShader(SHADER_DIR "/bloomFinal.vert", SHADER_DIR "/bloomFinal.frag");
+    Shader bloomDownsampleShader(SHADER_DIR "/blur.vert", SHADER_DIR "/bloomDownsample.frag");
+    Shader bloomUpsampleShader(SHADER_DIR "/blur.vert", SHADER_DIR "/bloomUpsample.frag");
     
     BoxGeometry boxGeometry(1.0f, 1.0f, 1.0f);
     BoxGeometry pointLightGeometry(0.2f, 0.2f, 0.2f);
@@ -147,6 +173,7 @@ int main()
 
     float exposure = 0.5f;
     float bloomThreshold = 1.0f;
+    float bloomStrength = 1.0f;
 
     sceneShader.use();
     sceneShader.setInt("material.diffuse", 0);
@@ -167,61 +194,174 @@ int main()
     // 帧缓冲设置
     blurShader.use();
     blurShader.setInt("image", 0);
-    bloomFinalShader.use();
-    bloomFinalShader.setInt("screenTex", 0);
-    bloomFinalShader.setInt("bloomBlur", 1);
 
-    unsigned int hdrFBO;
-    glGenFramebuffers(1, &hdrFBO);
-    glBindFramebuffer(GL_FRAMEBUFFER, hdrFBO);
-    // ------------------------------------------------------------
-    // 创建两个颜色缓冲区，一个用于渲染，一个用于亮度提取
-    unsigned int colorBuffers[2];
-    glGenTextures(2, colorBuffers);
-    for (unsigned int i = 0; i < 2; ++i)
-    {
-        glBindTexture(GL_TEXTURE_2D, colorBuffers[i]);
-        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA16F, SCREEN_WIDTH, SCREEN_HEIGHT, 0, GL_RGBA, GL_FLOAT, nullptr); // GL_RGB16F  GL_FLOAT 更改
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);  // we clamp to the edge as the blur filter would otherwise sample repeated texture values!
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0 + i, GL_TEXTURE_2D, colorBuffers[i], 0);
-    }
+    // 最终合成：泛光叠加、曝光、色调映射、调色、sRGB 编码一次完成
+    UberPost uberPost;
+    UberPost::Grading grading;
+    int tonemapIndex = static_cast<int>(UberPost::Tonemap::Exposure);
 
-    unsigned int rboDepth;
-    glGenRenderbuffers(1, &rboDepth);
-    glBindRenderbuffer(GL_RENDERBUFFER, rboDepth);
-    glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT, SCREEN_WIDTH, SCREEN_HEIGHT);
-    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, rboDepth);
-    // 使用帧缓冲区的颜色附件
-    unsigned int attachments[2] = { GL_COLOR_ATTACHMENT0, GL_COLOR_ATTACHMENT1 };
-    glDrawBuffers(2, attachments);
-    if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
-        std::cout << "ERROR::FRAMEBUFFER:: Framebuffer is not complete!" << std:: endl;
-    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    // ------------------------------------------------------------
+    // 逐级降采样 / 升采样的泛光，降到 1/64 分辨率
+    MipBloom mipBloom(SCREEN_WIDTH, SCREEN_HEIGHT, 6);
+    float gaussianBloomTime = 0.0f;
+    float mipBloomTime = 0.0f;
+
+    // 可分离的高斯模糊，有计算着色器时走共享内存的版本
+    // sigma 取 1.8 与 blur.frag 里的固定权重基本一致
+    SeparableFilter blurFilter(SCREEN_WIDTH, SCREEN_HEIGHT);
+    blurFilter.radius = 4;
+    blurFilter.sigma = 1.8f;
+    std::vector<BlurBenchmark> benchmarks;
 
     // ------------------------------------------------------------
-    // 创建用于模糊的帧缓冲区
-    unsigned int pingpongFBO[2];
-    unsigned int pingpongColorbuffers[2];
-    glGenFramebuffers(2, pingpongFBO);
-    glGenTextures(2, pingpongColorbuffers);
-    for (unsigned int i = 0; i < 2; ++i)
+    // 渲染图：HDR 缓冲和模糊用的缓冲都由渲染图分配
+    // ping-pong 模糊的 10 张中间纹理生命周期互不重叠，实际只分配两张；关闭泛光时模糊的 pass 全部被剔除
+    glm::mat4 projection(1.0f);
+    glm::mat4 view(1.0f);
+    RenderGraph graph(SCREEN_WIDTH, SCREEN_HEIGHT);
+    RenderGraph::Handle sceneColor, brightColor, bloomResult;
+    std::vector<RenderGraph::Handle> blurTargets(10);
+    bool rebuildGraph = true;
+
+    auto buildGraph = [&]()
     {
-        glBindFramebuffer(GL_FRAMEBUFFER, pingpongFBO[i]);
-        glBindTexture(GL_TEXTURE_2D, pingpongColorbuffers[i]);
-        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA16F, SCREEN_WIDTH, SCREEN_HEIGHT,
-            0, GL_RGBA, GL_FLOAT, nullptr);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE); // we clamp to the edge as the blur filter would otherwise sample repeated texture values!
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D,
-            pingpongColorbuffers[i], 0);
-        if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
-            std::cout << "Framebuffer not complete!" << std::endl;
-    }
+        graph.reset();
+        if (framebufferWidth > 0 && framebufferHeight > 0)
+            graph.resize(framebufferWidth, framebufferHeight);
+
+        // 1.将场景渲染到 HDR 缓冲，第二个颜色附件为亮度提取
+        graph.addPass("Scene", [&](RenderGraph::PassBuilder& builder)
+            {
+                sceneColor = builder.create("sceneColor", { GL_RGBA16F });
+                brightColor = builder.create("brightColor", { GL_RGBA16F });
+                builder.create("sceneDepth", { GL_DEPTH24_STENCIL8, 1.0f, GL_NEAREST });
+                builder.clear(glm::vec4(bgColor.x, bgColor.y, bgColor.z, bgColor.w));
+            },
+            [&](const RenderGraph::PassContext&)
+            {
+                // 绘制灯光物体
+                lightObjShader.use();
+                lightObjShader.setFloat("bloomThreshold", bloomThreshold);
+                lightObjShader.setMat4("projection", projection);
+                lightObjShader.setMat4("view", view);
+                for (unsigned int i = 0; i < pointLightPositions.size(); i++)
+                {
+                    glm::mat4 model = glm::mat4(1.0f);
+                    model = glm::translate(model, pointLightPositions[i]);
+                    lightObjShader.setMat4("model", model);
+                    lightObjShader.setVec3("lightColor", pointLightColors[i]);
+                    drawMesh(pointLightGeometry);
+                }
+
+                // 绘制场景
+                sceneShader.use();
+                sceneShader.setMat4("projection", projection);
+                sceneShader.setMat4("view", view);
+                sceneShader.setVec3("viewPos", camera.Position);
+                sceneShader.setFloat("bloomThreshold", bloomThreshold);
+
+                // 创建地面
+                glActiveTexture(GL_TEXTURE0);
+                glBindTexture(GL_TEXTURE_2D, floorMap);
+                glActiveTexture(GL_TEXTURE1);
+                glBindTexture(GL_TEXTURE_2D, floorMap);
+                sceneShader.setFloat("uvScale", 4.0f);
+                sceneShader.setFloat("material.shininess", 32.0f);
+                glm::mat4 model = glm::mat4(1.0f);
+                model = glm::rotate(model, glm::radians(-90.0f), glm::vec3(1.0f, 0.0f, 0.0f));
+                model = glm::translate(model, glm::vec3(0.0f, 0.0f, -0.5f));
+                sceneShader.setMat4("model", model);
+                drawMesh(floorGeometry);
+
+                // 创建箱子
+                glActiveTexture(GL_TEXTURE0);
+                glBindTexture(GL_TEXTURE_2D, boxMap);
+                glActiveTexture(GL_TEXTURE1);
+                glBindTexture(GL_TEXTURE_2D, boxSpecMap);
+                sceneShader.setFloat("uvScale", 1.0f);
+                sceneShader.setFloat("material.shininess", 4.0f);
+                for (unsigned int i = 0; i < cubePositions.size(); i++)
+                {
+                    model = glm::mat4(1.0f);
+                    model = glm::translate(model, cubePositions[i]);
+                    sceneShader.setMat4("model", model);
+                    drawMesh(boxGeometry);
+                }
+            });
+
+        // 2.模糊明亮的片段
+        if (useMipBloom)
+        {
+            // 逐级降采样再升采样，MipBloom 自己管理帧缓冲
+            bloomResult = graph.importTexture("mipBloom", mipBloom.texture(), mipBloom.mips[0].width, mipBloom.mips[0].height, GL_R11F_G11F_B10F);
+            graph.addPass("MipBloom", [&](RenderGraph::PassBuilder& builder)
+                {
+                    builder.read(brightColor);
+                    builder.write(bloomResult);
+                },
+                [&](const RenderGraph::PassContext& context)
+                {
+                    mipBloom.render(context.texture(brightColor), graph.getWidth(), graph.getHeight(),
+                        bloomDownsampleShader, bloomUpsampleShader, frameGeometry.VAO, static_cast<GLsizei>(frameGeometry.indices.size()));
+                });
+        }
+        else if (useSeparableFilter)
+        {
+            // 横竖各 5 次，和下面的 ping-pong 相同
+            bloomResult = graph.importTexture("separableBlur", blurFilter.texture(), blurFilter.width, blurFilter.height);
+            graph.addPass("SeparableBlur", [&](RenderGraph::PassBuilder& builder)
+                {
+                    builder.read(brightColor);
+                    builder.write(bloomResult);
+                },
+                [&](const RenderGraph::PassContext& context)
+                {
+                    blurFilter.apply(context.texture(brightColor), 0, 5);
+                });
+        }
+        else
+        {
+            // 全分辨率的高斯模糊，横竖交替 10 次，每次写一张新的临时纹理
+            for (size_t i = 0; i < blurTargets.size(); ++i)
+            {
+                graph.addPass(std::format("Blur {}", i), [&](RenderGraph::PassBuilder& builder)
+                    {
+                        builder.read(i == 0 ? brightColor : blurTargets[i - 1]);
+                        blurTargets[i] = builder.create(std::format("blur{}", i), { GL_RGBA16F });
+                    },
+                    [&, i](const RenderGraph::PassContext& context)
+                    {
+                        blurShader.use();
+                        blurShader.setInt("isHorizontal", i % 2 == 0);
+                        glActiveTexture(GL_TEXTURE0);
+                        glBindTexture(GL_TEXTURE_2D, context.texture(i == 0 ? brightColor : blurTargets[i - 1]));
+                        drawMesh(frameGeometry);
+                    });
+            }
+            bloomResult = blurTargets.back();
+        }
+
+        // 3.绘制hdr输出的texture
+        graph.addPass("Composite", [&](RenderGraph::PassBuilder& builder)
+            {
+                builder.read(sceneColor);
+                if (useBloom)
+                    builder.read(bloomResult);
+                builder.writeBackbuffer();
+                builder.clear();
+            },
+            [&](const RenderGraph::PassContext& context)
+            {
+                uberPost.options.bloom = useBloom;
+                uberPost.options.tonemap = static_cast<UberPost::Tonemap>(tonemapIndex);
+                uberPost.exposure = exposure;
+                // 升采样把每一级都叠加了一次，按级数归一化，两种方式的亮度才能直接比较
+                uberPost.bloomStrength = useMipBloom ? bloomStrength / mipBloom.mips.size() : bloomStrength;
+                uberPost.apply(context.texture(sceneColor), useBloom ? context.texture(bloomResult) : 0);
+            });
+
+        graph.compile();
+    };
 
     while (!glfwWindowShouldClose(window))
     {
@@ -243,104 +383,79 @@ int main()
             ImGui::Text("FOV: %.1f", camera.Zoom);
             ImGui::Text("x: %.1f, y: %.1f, z: %.1f", camera.Position.x, camera.Position.y, camera.Position.z);
             ImGui::SliderFloat("HDR Exposure", &exposure, 0.0f, 1.0f);
-            ImGui::Checkbox("Bloom", &useBloom);
+            ImGui::Combo("Tone Mapping", &tonemapIndex, "None\0Reinhard\0Exposure\0ACES\0");
+            ImGui::Checkbox("sRGB Encode", &uberPost.options.srgb);
+            ImGui::Checkbox("Color Grading", &uberPost.options.colorGrading);
+            if (uberPost.options.colorGrading)
+            {
+                bool rebake = ImGui::SliderFloat("Contrast", &grading.contrast, 0.5f, 1.5f);
+                rebake |= ImGui::SliderFloat("Saturation", &grading.saturation, 0.0f, 2.0f);
+                rebake |= ImGui::SliderFloat("Temperature", &grading.temperature, -1.0f, 1.0f);
+                if (rebake)
+                    uberPost.bakeLUT(grading);
+            }
+            {
+                // 和每一步单独一个全屏 pass 相比，合并后每帧少读写的字节数
+                UberPost::Options postOptions = uberPost.options;
+                postOptions.bloom = useBloom;
+                size_t saved = (UberPost::separateBytesPerPixel(postOptions) - UberPost::fusedBytesPerPixel(postOptions)) * graph.getWidth() * graph.getHeight();
+                ImGui::Text("Uber post: %zu B/px, saves %.1f MB/frame", UberPost::fusedBytesPerPixel(postOptions), saved / 1048576.0f);
+            }
+            rebuildGraph |= ImGui::Checkbox("Bloom", &useBloom);
             ImGui::SliderFloat("Bloom Threshold", &bloomThreshold, 0.0f, 5.0f);
+            ImGui::SliderFloat("Bloom Strength", &bloomStrength, 0.0f, 2.0f);
+            rebuildGraph |= ImGui::Checkbox("Mip-chain Bloom", &useMipBloom);
+            if (useMipBloom)
+                ImGui::SliderFloat("Filter Radius", &mipBloom.filterRadius, 0.001f, 0.02f);
+            else
+            {
+                rebuildGraph |= ImGui::Checkbox("Separable Filter", &useSeparableFilter);
+                if (!blurFilter.computeAvailable())
+                    ImGui::Text("Compute shaders need an OpenGL 4.3 context");
+                else if (useSeparableFilter)
+                    ImGui::Checkbox("Compute Shader", &blurFilter.useCompute);
+            }
+            ImGui::Text("Gaussian x10 (GPU): %.3f ms", gaussianBloomTime);
+            ImGui::Text("Mip-chain (GPU): %.3f ms", mipBloomTime);
+            // 原来手动创建的帧缓冲：两张 HDR 颜色缓冲 + 两张 ping-pong 缓冲（RGBA16F）+ 深度
+            ImGui::Text("Fixed FBOs: %.1f MB", SCREEN_WIDTH * SCREEN_HEIGHT * (4 * 8 + 4) / 1048576.0f);
+            ImGui::Text("Graph targets: %.1f MB (%.1f MB without aliasing)",
+                graph.transientBytes() / 1048576.0f, graph.unaliasedBytes() / 1048576.0f);
+            for (const RenderGraph::PassStats& pass : graph.stats())
+                ImGui::Text("%s: %s", pass.name.c_str(), pass.culled ? "culled" : std::format("{:.3f} ms", pass.ms).c_str());
+            bool runBenchmark = ImGui::Button("Benchmark 1080p / 4K");
+            for (const BlurBenchmark& result : benchmarks)
+                ImGui::Text("%s %dx%d: compute %.3f ms, fragment %.3f ms", SeparableFilter::name(result.kind),
+                    result.width, result.height, result.computeMs, result.fragmentMs);
         ImGui::End();
 
-        // ------------------------------------------------------------
-        // 1.将场景渲染到缓冲区
-        glBindFramebuffer(GL_FRAMEBUFFER, hdrFBO);
-
-        glClearColor(bgColor.x, bgColor.y, bgColor.z, bgColor.w);
-        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-
-        glm::mat4 projection = glm::perspective(glm::radians(camera.Zoom), (float)SCREEN_WIDTH / (float)SCREEN_HEIGHT, 0.1f, 100.0f);
-        glm::mat4 view = camera.GetViewMatrix();
-        glm::mat4 model = glm::mat4(1.0f);
+        if (runBenchmark)
+            benchmarks = benchmarkBlur();
 
-        // 创建灯光
-        // 绘制灯光物体
-        lightObjShader.use();
-        lightObjShader.setFloat("bloomThreshold", bloomThreshold);
-        lightObjShader.setMat4("projection", projection);
-        lightObjShader.setMat4("view", view);
-        for (unsigned int i = 0; i < pointLightPositions.size(); i++)
+        // 窗口缩放后外部的泛光纹理和渲染图一起重建，最小化时帧缓冲大小为 0，保持原来的分配
+        if (framebufferWidth > 0 && framebufferHeight > 0
+            && (framebufferWidth != graph.getWidth() || framebufferHeight != graph.getHeight()))
         {
-            model = glm::mat4(1.0f);
-            model = glm::translate(model, pointLightPositions[i]);
-            lightObjShader.setMat4("model", model);
-            lightObjShader.setVec3("lightColor", pointLightColors[i]);
-            drawMesh(pointLightGeometry);
+            mipBloom.resize(framebufferWidth, framebufferHeight);
+            blurFilter.resize(framebufferWidth, framebufferHeight);
+            rebuildGraph = true;
         }
-
-        // 绘制场景
-        sceneShader.use();
-        sceneShader.setMat4("projection", projection);
-        sceneShader.setMat4("view", view);
-        sceneShader.setVec3("viewPos", camera.Position);
-        sceneShader.setFloat("bloomThreshold", bloomThreshold);
-
-
-        // 创建地面
-        glActiveTexture(GL_TEXTURE0);
-        glBindTexture(GL_TEXTURE_2D, floorMap);
-        glActiveTexture(GL_TEXTURE1);
-        glBindTexture(GL_TEXTURE_2D, floorMap);
-        sceneShader.setFloat("uvScale", 4.0f);
-        sceneShader.setFloat("material.shininess", 32.0f);
-        model = glm::mat4(1.0f);
-        model = glm::rotate(model, glm::radians(-90.0f), glm::vec3(1.0f, 0.0f, 0.0f));
-        model = glm::translate(model, glm::vec3(0.0f, 0.0f, -0.5f));
-        sceneShader.setMat4("model", model);
-        drawMesh(floorGeometry);
-
-        // 创建箱子
-        glActiveTexture(GL_TEXTURE0);
-        glBindTexture(GL_TEXTURE_2D, boxMap);
-        glActiveTexture(GL_TEXTURE1);
-        glBindTexture(GL_TEXTURE_2D, boxSpecMap);
-        sceneShader.setFloat("uvScale", 1.0f);
-        sceneShader.setFloat("material.shininess", 4.0f);
-        for (unsigned int i = 0; i < cubePositions.size(); i++)
+        if (rebuildGraph)
         {
-            model = glm::mat4(1.0f);
-            model = glm::translate(model, cubePositions[i]);
-            sceneShader.setMat4("model", model);
-            drawMesh(boxGeometry);
+            buildGraph();
+            rebuildGraph = false;
         }
 
-        // ------------------------------------------------------------
-        // 2.高斯模糊去处理明亮的片段
-        glBindFramebuffer(GL_FRAMEBUFFER, 0);
-        bool isHorizontal = true;
-        bool isFirstIteration = true;
-        unsigned int amount = 10;
-        blurShader.use();
-        glActiveTexture(GL_TEXTURE0);
-        for (unsigned int i = 0; i < amount; i++)
-        {
-            glBindFramebuffer(GL_FRAMEBUFFER, pingpongFBO[isHorizontal]);
-            blurShader.setInt("isHorizontal", isHorizontal);
-            glBindTexture(GL_TEXTURE_2D, isFirstIteration ? colorBuffers[1] : pingpongColorbuffers[!isHorizontal]);  // bind texture of other framebuffer (or scene if first iteration)            
-            drawMesh(frameGeometry);
-            isHorizontal = !isHorizontal;
-            if (isFirstIteration)
-                isFirstIteration = false;
-        }
+        projection = glm::perspective(glm::radians(camera.Zoom), (float)graph.getWidth() / (float)graph.getHeight(), 0.1f, 100.0f);
+        view = camera.GetViewMatrix();
+        graph.execute();
 
-        // ------------------------------------------------------------
-        // 3.绘制hdr输出的texture
-        glBindFramebuffer(GL_FRAMEBUFFER, 0);
-        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-
-        bloomFinalShader.use();
-        bloomFinalShader.setFloat("exposure", exposure);
-        bloomFinalShader.setBool("useBloom", useBloom);
-        glActiveTexture(GL_TEXTURE0);
-        glBindTexture(GL_TEXTURE_2D, colorBuffers[0]);
-        glActiveTexture(GL_TEXTURE1);
-        glBindTexture(GL_TEXTURE_2D, pingpongColorbuffers[!isHorizontal]);
-        drawMesh(frameGeometry);
+        // 场景和合成之外的 pass 都属于泛光
+        float bloomTime = 0.0f;
+        for (const RenderGraph::PassStats& pass : graph.stats())
+            if (pass.name != "Scene" && pass.name != "Composite")
+                bloomTime += pass.ms;
+        (useMipBloom ? mipBloomTime : gaussianBloomTime) = bloomTime;
 
         // ImGui 渲染
         ImGui::Render();
@@ -350,6 +465,11 @@ int main()
         glfwPollEvents();
     }
 
+    mipBloom.dispose();
+    uberPost.dispose();
+    blurFilter.dispose();
+    graph.dispose();
+
     glfwTerminate();
     return 0;
 }
@@ -458,6 +578,61 @@ unsigned int loadTexture(std::string_view path)
     return textureID;
 }
 
+// 在 1080p 和 4K 的临时纹理上比较计算着色器和片段着色器两条路径
+// 每种滤波横竖各 5 次，跑 10 遍取平均，阻塞等待查询结果，只在按下按钮时运行
+std::vector<BlurBenchmark> benchmarkBlur()
+{
+    const int runs = 10;
+    const int iterations = 5;
+    std::vector<BlurBenchmark> results;
+
+    unsigned int query;
+    glGenQueries(1, &query);
+    for (glm::ivec2 size : { glm::ivec2(1920, 1080), glm::ivec2(3840, 2160) })
+    {
+        SeparableFilter filter(size.x, size.y);
+        filter.radius = 4;
+        filter.sigma = 1.8f;
+
+        unsigned int srcTexture;
+        glGenTextures(1, &srcTexture);
+        glBindTexture(GL_TEXTURE_2D, srcTexture);
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA16F, size.x, size.y, 0, GL_RGBA, GL_FLOAT, nullptr);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+
+        for (int k = 0; k < SeparableFilter::KIND_COUNT; ++k)
+        {
+            BlurBenchmark result{ size.x, size.y, static_cast<SeparableFilter::Kind>(k), -1.0f, -1.0f };
+            filter.kind = result.kind;
+            for (bool compute : { true, false })
+            {
+                if (compute && !filter.computeAvailable())
+                    continue;
+                filter.useCompute = compute;
+                // 双边滤波的引导纹理直接用源纹理，只关心耗时
+                filter.apply(srcTexture, srcTexture, iterations);
+
+                glBeginQuery(GL_TIME_ELAPSED, query);
+                for (int i = 0; i < runs; ++i)
+                    filter.apply(srcTexture, srcTexture, iterations);
+                glEndQuery(GL_TIME_ELAPSED);
+                GLuint64 elapsed = 0;
+                glGetQueryObjectui64v(query, GL_QUERY_RESULT, &elapsed);
+                (compute ? result.computeMs : result.fragmentMs) = static_cast<float>(elapsed) / 1.0e6f / runs;
+            }
+            std::cout << SeparableFilter::name(result.kind) << " " << size.x << "x" << size.y
+                      << ": compute " << result.computeMs << " ms, fragment " << result.fragmentMs << " ms" << std::endl;
+            results.push_back(result);
+        }
+
+        glDeleteTextures(1, &srcTexture);
+        filter.dispose();
+    }
+    glDeleteQueries(1, &query);
+    return results;
+}
+
 // 绘制物体
 void drawMesh(const BufferGeometry& geometry)
 {
@@ -0,0 +1,77 @@
+#version 330 core
+out vec3 FragColor;
+
+in vec2 TexCoords;
+
+uniform sampler2D srcTexture;
+uniform vec2 srcResolution; // 上一级的分辨率
+uniform bool karisAverage;  // 只在第一次降采样时开启
+
+/*
+    13 个采样点的降采样（Jimenez, "Next Generation Post Processing in Call of Duty: Advanced Warfare"）
+    a - b - c
+    - j - k -
+    d - e - f
+    - l - m -
+    g - h - i
+    分成 5 个 2x2 的块：中间的 j k l m 占 0.5，四角的 4 个块各占 0.125
+*/
+
+float luma(vec3 color)
+{
+    return dot(color, vec3(0.2126, 0.7152, 0.0722));
+}
+
+// Karis 平均：每块按 1 / (1 + 亮度) 加权，单个极亮像素不会被放大成一团闪烁
+vec3 karisBlock(vec3 p0, vec3 p1, vec3 p2, vec3 p3, float blockWeight, inout float weightSum)
+{
+    vec3 average = (p0 + p1 + p2 + p3) * 0.25;
+    float w = blockWeight / (1.0 + luma(average));
+    weightSum += w;
+    return average * w;
+}
+
+void main()
+{
+    vec2 texel = 1.0 / srcResolution;
+    float x = texel.x;
+    float y = texel.y;
+
+    vec3 a = texture(srcTexture, TexCoords + vec2(-2.0 * x,  2.0 * y)).rgb;
+    vec3 b = texture(srcTexture, TexCoords + vec2( 0.0,      2.0 * y)).rgb;
+    vec3 c = texture(srcTexture, TexCoords + vec2( 2.0 * x,  2.0 * y)).rgb;
+
+    vec3 d = texture(srcTexture, TexCoords + vec2(-2.0 * x,  0.0)).rgb;
+    vec3 e = texture(srcTexture, TexCoords).rgb;
+    vec3 f = texture(srcTexture, TexCoords + vec2( 2.0 * x,  0.0)).rgb;
+
+    vec3 g = texture(srcTexture, TexCoords + vec2(-2.0 * x, -2.0 * y)).rgb;
+    vec3 h = texture(srcTexture, TexCoords + vec2( 0.0,     -2.0 * y)).rgb;
+    vec3 i = texture(srcTexture, TexCoords + vec2( 2.0 * x, -2.0 * y)).rgb;
+
+    vec3 j = texture(srcTexture, TexCoords + vec2(-x,  y)).rgb;
+    vec3 k = texture(srcTexture, TexCoords + vec2( x,  y)).rgb;
+    vec3 l = texture(srcTexture, TexCoords + vec2(-x, -y)).rgb;
+    vec3 m = texture(srcTexture, TexCoords + vec2( x, -y)).rgb;
+
+    vec3 result;
+    if (karisAverage)
+    {
+        float weightSum = 0.0;
+        result  = karisBlock(j, k, l, m, 0.5, weightSum);
+        result += karisBlock(a, b, d, e, 0.125, weightSum);
+        result += karisBlock(b, c, e, f, 0.125, weightSum);
+        result += karisBlock(d, e, g, h, 0.125, weightSum);
+        result += karisBlock(e, f, h, i, 0.125, weightSum);
+        result /= weightSum;
+    }
+    else
+    {
+        result  = e * 0.125;
+        result += (a + c + g + i) * 0.03125;
+        result += (b + d + f + h) * 0.0625;
+        result += (j + k + l + m) * 0.125;
+    }
+    // 防止出现 0 以下的值在后面的加法混合中变成黑块
+    FragColor = max(result, 0.0001);
+}
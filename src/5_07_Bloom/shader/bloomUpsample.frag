@@ -0,0 +1,31 @@
+#version 330 core
+out vec3 FragColor;
+
+in vec2 TexCoords;
+
+uniform sampler2D srcTexture;
+uniform float filterRadius; // 帐篷滤波半径，单位为 uv
+
+// 3x3 帐篷滤波，结果由 C++ 端加法混合到上一级
+void main()
+{
+    float x = filterRadius;
+    float y = filterRadius;
+
+    vec3 a = texture(srcTexture, TexCoords + vec2(-x,  y)).rgb;
+    vec3 b = texture(srcTexture, TexCoords + vec2( 0,  y)).rgb;
+    vec3 c = texture(srcTexture, TexCoords + vec2( x,  y)).rgb;
+
+    vec3 d = texture(srcTexture, TexCoords + vec2(-x,  0)).rgb;
+    vec3 e = texture(srcTexture, TexCoords).rgb;
+    vec3 f = texture(srcTexture, TexCoords + vec2( x,  0)).rgb;
+
+    vec3 g = texture(srcTexture, TexCoords + vec2(-x, -y)).rgb;
+    vec3 h = texture(srcTexture, TexCoords + vec2( 0, -y)).rgb;
+    vec3 i = texture(srcTexture, TexCoords + vec2( x, -y)).rgb;
+
+    vec3 result = e * 4.0;
+    result += (b + d + f + h) * 2.0;
+    result += (a + c + g + i);
+    FragColor = result / 16.0;
+}
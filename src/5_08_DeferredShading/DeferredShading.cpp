@@ -16,11 +16,20 @@
 #include <tools/camera.h>
 #include <tools/mesh.h>
 #include <tools/model.h>
+#include <tools/render_graph.h>
+#include <tools/occlusion_culler.h>
+#include <tools/software_occlusion.h>
 
 #include <iostream>
 #include <string>
 #include <string_view>
 #include <format>
+#include <array>
+#include <vector>
+#include <cfloat>
+#include <chrono>
+#include <random>
+#include <thread>
 
 static void processInput(GLFWwindow* window);
 static void keyCallback(GLFWwindow* window, int key, int scancode, int action, int mods);
@@ -28,6 +37,50 @@ static void mouseCallback(GLFWwindow* window, double posX, double posY);
 
 static unsigned int loadTexture(std::string_view path);
 static void drawMesh(const BufferGeometry& geometry);
+static size_t gBufferBytesPerPixel(bool compact);
+static std::vector<glm::mat4> generateCity(int blocks, unsigned int seed);
+
+// 一张渲染图里 G-Buffer 相关的句柄，紧凑布局时 position 为空
+struct GBufferTargets
+{
+    RenderGraph::Handle position = RenderGraph::INVALID_HANDLE;
+    RenderGraph::Handle normal = RenderGraph::INVALID_HANDLE;
+    RenderGraph::Handle albedoSpec = RenderGraph::INVALID_HANDLE;
+    RenderGraph::Handle depth = RenderGraph::INVALID_HANDLE;
+    RenderGraph::Handle color = RenderGraph::INVALID_HANDLE;
+};
+
+struct GBufferBenchmark
+{
+    int width;
+    int height;
+    bool compact;
+    size_t bytesPerPixel;
+    float geometryMs;
+    float lightingMs;
+};
+
+// 遮挡剔除开关前后的对比：几何 pass 和整帧（所有 pass）的 GPU 耗时，以及被剔除的物体数
+struct OcclusionBenchmark
+{
+    bool occlusion;
+    float geometryMs;
+    float frameMs;
+    int occluded;
+    int objects;
+};
+
+// 软件遮挡剔除在城市场景里的耗时：光栅化遮挡物（含变换、设置、层级深度）和测试所有楼的包围盒
+struct SoftwareOcclusionBenchmark
+{
+    unsigned int threads;
+    size_t occluderTriangles;
+    float rasterizeMs;
+    float testMs;
+    int inFrustum;
+    int visible;
+    int objects;
+};
 
 const unsigned int SCREEN_WIDTH = 1280;
 const unsigned int SCREEN_HEIGHT = 720;
@@ -38,6 +91,17 @@ float lastX = SCREEN_WIDTH / 2.0f;
 float lastY = SCREEN_HEIGHT / 2.0f;
 bool isFirstMouse = true;
 bool isMouseCaptured = true; // 初始为捕获状态（隐藏鼠标，控制视角）
+// 当前帧缓冲大小，窗口缩放时由回调更新
+int framebufferWidth = SCREEN_WIDTH;
+int framebufferHeight = SCREEN_HEIGHT;
+// 紧凑 G-Buffer：RG16 八面体法线 + RGBA8（反照率、高光、材质 ID）+ 深度，位置从深度重建
+bool compactGBuffer = true;
+// 遮挡剔除：墙先画进 G-Buffer，背包用包围盒的遮挡查询 + 条件渲染
+bool occlusionCulling = false;
+// CPU 软件遮挡剔除：墙画进低分辨率的深度缓冲，背包的包围盒测试通过才进入绘制列表，当帧生效
+bool softwareOcclusion = false;
+// 遮挡物很多的测试场景：几排背包之间隔着墙
+bool occluderScene = false;
 
 // 时机
 float deltaTime = 0.0f; // 当前帧与上一帧的时间差
@@ -76,6 +140,8 @@ int main()
     glfwSetFramebufferSizeCallback(window, [](GLFWwindow* window, int width, int height)
         {
             glViewport(0, 0, width, height);
+            framebufferWidth = width;
+            framebufferHeight = height;
         });
     glfwSetKeyCallback(window, keyCallback);
     glfwSetCursorPosCallback(window, mouseCallback);
@@ -115,6 +181,23 @@ int main()
         glm::vec3(0.0, -1.0, 3.0),
         glm::vec3(3.0, -1.0, 3.0)
     };
+    // 测试场景里藏在墙后的背包
+    std::vector<glm::vec3> hiddenObjectPositions
+    {
+        glm::vec3(-3.0, -1.0, -6.0),
+        glm::vec3(0.0, -1.0, -6.0),
+        glm::vec3(3.0, -1.0, -6.0),
+        glm::vec3(-3.0, -1.0, -9.0),
+        glm::vec3(0.0, -1.0, -9.0),
+        glm::vec3(3.0, -1.0, -9.0)
+    };
+    // 测试场景的墙，挡在每两排背包之间
+    std::vector<glm::mat4> wallModels;
+    for (float z : { -1.5f, -4.5f, -7.5f })
+    {
+        glm::mat4 model = glm::translate(glm::mat4(1.0f), glm::vec3(0.0f, -0.5f, z));
+        wallModels.push_back(glm::scale(model, glm::vec3(10.0f, 4.0f, 0.3f)));
+    }
 
     const unsigned int NR_LIGHTS = 32;
     std::vector<glm::vec3> lightPositions;
@@ -138,68 +221,384 @@ int main()
     ImVec4 bgColor = ImVec4(0.02f, 0.02f, 0.03f, 1.0f);
     stbi_set_flip_vertically_on_load(true);
 
-    Shader shaderGeometryPass(SHADER_DIR "/geometryPass.vert", SHADER_DIR "/geometryPass.frag");    
-    Shader shaderLightingPass(SHADER_DIR "/lightingPass.vert", SHADER_DIR "/lightingPass.frag");
+    // 0 为原来的布局，1 为紧凑布局
+    const std::string_view compactDefine = "#define COMPACT_GBUFFER\n";
+    std::array<Shader, 2> shaderGeometryPasses = {
+        Shader(SHADER_DIR "/geometryPass.vert", SHADER_DIR "/geometryPass.frag"),
+        Shader(SHADER_DIR "/geometryPass.vert", SHADER_DIR "/geometryPass.frag", { }, compactDefine)
+    };
+    std::array<Shader, 2> shaderLightingPasses = {
+        Shader(SHADER_DIR "/lightingPass.vert", SHADER_DIR "/lightingPass.frag"),
+        Shader(SHADER_DIR "/lightingPass.vert", SHADER_DIR "/lightingPass.frag", { }, compactDefine)
+    };
     Shader shaderLightObj(SHADER_DIR "/lightObj.vert", SHADER_DIR "/lightObj.frag");
     
-    BoxGeometry pointLightGeometry(0.2f, 0.2f, 0.2f);
-    SphereGeometry objectGeometry(1.0, 50.0, 50.0); // 圆球
-    Model backpack(ASSETS_DIR "/model/backpack/backpack.obj");
+    // 灯光物体和全屏四边形只用到位置和纹理坐标，G-Buffer 的着色器不用切线，按各自的顶点布局上传
+    BasicBoxGeometry<UnlitVertexLayout> pointLightGeometry(0.2f, 0.2f, 0.2f);
+    BasicSphereGeometry<LitVertexLayout> objectGeometry(1.0, 50.0, 50.0); // 圆球
+    BasicModel<LitVertexLayout> backpack(ASSETS_DIR "/model/backpack/backpack.obj");
+    BasicBoxGeometry<LitVertexLayout> wallGeometry(1.0f, 1.0f, 1.0f);
+    unsigned int wallTexture = loadTexture(ASSETS_DIR "/texture/brickwall.jpg");
+
+    // 背包在模型空间的包围盒，遮挡查询时画成代理
+    glm::vec3 backpackMin(FLT_MAX), backpackMax(-FLT_MAX);
+    for (const auto& mesh : backpack.meshes)
+        for (const Vertex& vertex : mesh.vertices)
+        {
+            backpackMin = glm::min(backpackMin, vertex.Position);
+            backpackMax = glm::max(backpackMax, vertex.Position);
+        }
+    OcclusionCuller occlusion;
+    SoftwareOcclusion softwareCuller;
+    // 墙和城市里的楼都是缩放过的单位立方体，共用一个遮挡物网格
+    const SoftwareOcclusion::OccluderMesh boxOccluder = SoftwareOcclusion::simplify(wallGeometry);
+    int softwareCulled = 0;
 
-    PlaneGeometry frameGeometry(2.0f, 2.0f);
+    BasicPlaneGeometry<UnlitVertexLayout> frameGeometry(2.0f, 2.0f);
     
-    shaderLightingPass.use();
-    shaderLightingPass.setInt("material.gPosition", 0);
-    shaderLightingPass.setInt("material.gNormal", 1);
-    shaderLightingPass.setInt("material.gAlbedoSpec", 2);
-    shaderLightingPass.setFloat("material.shininess", 32.0f);
+    for (const Shader& shaderLightingPass : shaderLightingPasses)
+    {
+        shaderLightingPass.use();
+        shaderLightingPass.setInt("material.gPosition", 0);
+        shaderLightingPass.setInt("material.gNormal", 1);
+        shaderLightingPass.setInt("material.gAlbedoSpec", 2);
+        shaderLightingPass.setFloat("material.shininess", 32.0f);
+        // 紧凑布局按材质 ID 查高光指数，这里所有材质都和原来的布局一样，方便对比
+        for (int i = 0; i < 8; ++i)
+            shaderLightingPass.setFloat(std::format("materialShininess[{}]", i), 32.0f);
+    }
 
-    shaderGeometryPass.use();
-    shaderGeometryPass.setInt("texture_diffuse1", 0);
-    shaderGeometryPass.setInt("texture_specular1", 1);
+    for (const Shader& shaderGeometryPass : shaderGeometryPasses)
+    {
+        shaderGeometryPass.use();
+        shaderGeometryPass.setInt("texture_diffuse1", 0);
+        shaderGeometryPass.setInt("texture_specular1", 1);
+        shaderGeometryPass.setInt("materialID", 0);
+    }
 
     // ------------------------------------------------------------
-    unsigned int gBuffer;
-    glGenFramebuffers(1, &gBuffer);
-    glBindFramebuffer(GL_FRAMEBUFFER, gBuffer);
-    unsigned int gPosition, gNormal, gAlbedoSpec;
-
-    // 位置颜色缓冲
-    glGenTextures(1, &gPosition);
-    glBindTexture(GL_TEXTURE_2D, gPosition);
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB16F, SCREEN_WIDTH, SCREEN_HEIGHT, 0, GL_RGB, GL_FLOAT, nullptr);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, gPosition, 0);
-
-    // 法线颜色缓冲
-    glGenTextures(1, &gNormal);
-    glBindTexture(GL_TEXTURE_2D, gNormal);
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB16F, SCREEN_WIDTH, SCREEN_HEIGHT, 0, GL_RGB, GL_FLOAT, nullptr);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT1, GL_TEXTURE_2D, gNormal, 0);
-
-    // 颜色 + 颜色缓冲
-    glGenTextures(1, &gAlbedoSpec);
-    glBindTexture(GL_TEXTURE_2D, gAlbedoSpec);
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, SCREEN_WIDTH, SCREEN_HEIGHT, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT2, GL_TEXTURE_2D, gAlbedoSpec, 0);
-
-    unsigned int attachments[3] = { GL_COLOR_ATTACHMENT0, GL_COLOR_ATTACHMENT1, GL_COLOR_ATTACHMENT2 };
-    glDrawBuffers(3, attachments);
-
-    // 深度缓冲
-    unsigned int rboDepth;
-    glGenRenderbuffers(1, &rboDepth);
-    glBindRenderbuffer(GL_RENDERBUFFER, rboDepth);
-    glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT, SCREEN_WIDTH, SCREEN_HEIGHT);
-    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, rboDepth);
-    if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
-        std::cout << "Framebuffer not complete!" << std::endl;
-    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    // 渲染图：G-Buffer 由渲染图按窗口大小分配，窗口缩放时自动重建
+    RenderGraph graph(SCREEN_WIDTH, SCREEN_HEIGHT);
+    GBufferTargets targets;
+    glm::mat4 projection(1.0f);
+    glm::mat4 view(1.0f);
+
+    // offscreen 为 true 时光照结果写进一张临时纹理而不是默认帧缓冲，用于在任意分辨率下测试
+    auto buildGraph = [&](RenderGraph& target, GBufferTargets& handles, bool compact, bool offscreen)
+    {
+        Shader& shaderGeometryPass = shaderGeometryPasses[compact];
+        const Shader& shaderLightingPass = shaderLightingPasses[compact];
+
+        // 1. 几何阶段：将场景的几何/颜色数据渲染到 G-Buffer 中
+        target.addPass("GBuffer", [&, compact](RenderGraph::PassBuilder& builder)
+            {
+                handles.position = compact ? RenderGraph::INVALID_HANDLE : builder.create("gPosition", { GL_RGB16F, 1.0f, GL_NEAREST });
+                handles.normal = builder.create("gNormal", { static_cast<GLenum>(compact ? GL_RG16 : GL_RGB16F), 1.0f, GL_NEAREST });
+                handles.albedoSpec = builder.create("gAlbedoSpec", { GL_RGBA8, 1.0f, GL_NEAREST });
+                handles.depth = builder.create("gDepth", { GL_DEPTH24_STENCIL8, 1.0f, GL_NEAREST });
+                builder.clear();
+            },
+            [&](const RenderGraph::PassContext&)
+            {
+                shaderGeometryPass.use();
+                shaderGeometryPass.setMat4("projection", projection);
+                shaderGeometryPass.setMat4("view", view);
+
+                // 遮挡物先画，深度缓冲里有了墙，后面的包围盒代理才能被挡住
+                if (occluderScene)
+                {
+                    glActiveTexture(GL_TEXTURE0);
+                    glBindTexture(GL_TEXTURE_2D, wallTexture);
+                    glActiveTexture(GL_TEXTURE1);
+                    glBindTexture(GL_TEXTURE_2D, wallTexture);
+                    for (const glm::mat4& model : wallModels)
+                    {
+                        shaderGeometryPass.setMat4("model", model);
+                        drawMesh(wallGeometry);
+                    }
+                }
+
+                // id 在剔除前按顺序编号，两种遮挡剔除同时打开时，硬件查询的 id 不会因为软件剔除掉了物体而错位
+                std::vector<glm::mat4> objectModels;
+                std::vector<int> objectIds;
+                for (const std::vector<glm::vec3>* positions : { &objectPositions, &hiddenObjectPositions })
+                {
+                    if (positions == &hiddenObjectPositions && !occluderScene)
+                        continue;
+                    for (const glm::vec3& position : *positions)
+                    {
+                        glm::mat4 model = glm::mat4(1.0f);
+                        model = glm::translate(model, position);
+                        model = glm::scale(model, glm::vec3(0.5f));
+                        objectIds.push_back(static_cast<int>(objectModels.size()));
+                        objectModels.push_back(model);
+                    }
+                }
+
+                // 软件遮挡剔除：被墙挡住的背包直接不进入绘制列表
+                if (softwareOcclusion)
+                {
+                    softwareCuller.begin(projection * view);
+                    if (occluderScene)
+                        for (const glm::mat4& model : wallModels)
+                            softwareCuller.addOccluder(boxOccluder, model);
+                    softwareCuller.rasterize();
+
+                    size_t kept = 0;
+                    for (size_t i = 0; i < objectModels.size(); i++)
+                    {
+                        if (!softwareCuller.isVisible(objectModels[i], backpackMin, backpackMax))
+                            continue;
+                        objectModels[kept] = objectModels[i];
+                        objectIds[kept] = objectIds[i];
+                        ++kept;
+                    }
+                    softwareCulled = static_cast<int>(objectModels.size() - kept);
+                    objectModels.resize(kept);
+                    objectIds.resize(kept);
+                }
+
+                // 这一帧的查询留给下一帧的条件渲染
+                if (occlusionCulling)
+                {
+                    occlusion.beginQueries(view, projection, camera.Position);
+                    for (size_t i = 0; i < objectModels.size(); i++)
+                        occlusion.query(objectIds[i], objectModels[i], backpackMin, backpackMax);
+                    occlusion.endQueries();
+                    shaderGeometryPass.use();
+                }
+
+                for (size_t i = 0; i < objectModels.size(); i++)
+                {
+                    shaderGeometryPass.setMat4("model", objectModels[i]);
+                    // drawMesh(objectGeometry);
+                    if (occlusionCulling)
+                        occlusion.draw(objectIds[i], [&] { backpack.Draw(shaderGeometryPass); });
+                    else
+                        backpack.Draw(shaderGeometryPass);
+                }
+                if (occlusionCulling)
+                    occlusion.endFrame();
+            });
+
+        // 2. 光照阶段：通过遍历一个覆盖全屏的四边形，逐像素地利用 G-Buffer 中的内容计算光照
+        // 再把 G-Buffer 的深度复制到目标的深度缓冲，在场景之上正向渲染光源
+        target.addPass("Lighting", [&, compact, offscreen](RenderGraph::PassBuilder& builder)
+            {
+                if (!compact)
+                    builder.read(handles.position);
+                builder.read(handles.normal);
+                builder.read(handles.albedoSpec);
+                builder.read(handles.depth);
+                if (offscreen)
+                {
+                    handles.color = builder.create("color", { GL_RGBA8 });
+                    builder.create("colorDepth", { GL_DEPTH24_STENCIL8 });
+                }
+                else
+                {
+                    builder.writeBackbuffer();
+                }
+                builder.clear();
+            },
+            [&, compact](const RenderGraph::PassContext& context)
+            {
+                shaderLightingPass.use();
+                // 紧凑布局没有位置纹理，0 号纹理单元换成深度缓冲
+                glActiveTexture(GL_TEXTURE0);
+                glBindTexture(GL_TEXTURE_2D, context.texture(compact ? handles.depth : handles.position));
+
+                glActiveTexture(GL_TEXTURE1);
+                glBindTexture(GL_TEXTURE_2D, context.texture(handles.normal));
+
+                glActiveTexture(GL_TEXTURE2);
+                glBindTexture(GL_TEXTURE_2D, context.texture(handles.albedoSpec));
+
+                for (unsigned int i = 0; i < lightPositions.size(); ++i)
+                {
+                    shaderLightingPass.setVec3(std::format("pointLights[{}].position", i), lightPositions[i]);
+                    shaderLightingPass.setVec3(std::format("pointLights[{}].ambient", i), 0.01f, 0.01f, 0.01f);
+                    shaderLightingPass.setVec3(std::format("pointLights[{}].diffuse", i), lightColors[i]);
+                    shaderLightingPass.setVec3(std::format("pointLights[{}].specular", i), 0.1f, 0.1f, 0.1f);
+
+                    const float constant = 1.0f; // note that we don't send this to the shader, we assume it is always 1.0 (in our case)
+                    const float linear = 0.7f;
+                    const float quadratic = 1.8f;
+                    shaderLightingPass.setFloat(std::format("pointLights[{}].constant", i), constant);
+                    shaderLightingPass.setFloat(std::format("pointLights[{}].linear", i), linear);
+                    shaderLightingPass.setFloat(std::format("pointLights[{}].quadratic", i), quadratic);
+                    const float maxBrightness = std::max({ lightColors[i].r, lightColors[i].g, lightColors[i].b });
+                    float radius = (-linear + std::sqrt(linear * linear - 4 * quadratic * (constant - (256.0f / 5.0f) * maxBrightness))) / (2.0f * quadratic);
+                    shaderLightingPass.setFloat(std::format("pointLights[{}].radius", i), radius);
+                }
+                shaderLightingPass.setMat4("view", view);
+                shaderLightingPass.setMat4("projection", projection);
+                shaderLightingPass.setMat4("inverseViewProjection", glm::inverse(projection * view));
+                shaderLightingPass.setVec3("viewPos", camera.Position);
+                shaderLightingPass.setMat4("model", glm::mat4(1.0f));
+                drawMesh(frameGeometry);
+
+                // 延迟结合正向渲染：复制gbuffer的深度信息到目标的深度缓冲
+                context.blit(handles.depth, GL_DEPTH_BUFFER_BIT);
+
+                // 绘制灯光物体
+                shaderLightObj.use();
+                shaderLightObj.setMat4("projection", projection);
+                shaderLightObj.setMat4("view", view);
+
+                for (unsigned int i = 0; i < lightPositions.size(); i++)
+                {
+                    glm::mat4 model = glm::mat4(1.0f);
+                    model = glm::translate(model, lightPositions[i]);
+
+                    shaderLightObj.setMat4("model", model);
+                    shaderLightObj.setVec3("lightColor", lightColors[i]);
+
+                    drawMesh(pointLightGeometry);
+                }
+            });
+        if (offscreen)
+            target.setOutput(handles.color);
+        target.compile();
+    };
+    buildGraph(graph, targets, compactGBuffer, false);
+
+    // 在 1080p 和 4K 的离屏渲染图上比较两种布局：每个像素的 G-Buffer 字节数、几何和光照 pass 的耗时
+    // 每帧结束后 glFinish，GpuTimer 的结果就是几帧前那一帧的耗时，预热几帧后取平均，只在按下按钮时运行
+    auto benchmarkGBuffer = [&]()
+    {
+        const int warmup = 5;
+        const int runs = 20;
+        std::vector<GBufferBenchmark> results;
+        const glm::mat4 savedProjection = projection;
+        for (glm::ivec2 size : { glm::ivec2(1920, 1080), glm::ivec2(3840, 2160) })
+        {
+            projection = glm::perspective(glm::radians(camera.Zoom), (float)size.x / (float)size.y, 0.1f, 100.0f);
+            for (bool compact : { false, true })
+            {
+                RenderGraph benchGraph(size.x, size.y);
+                GBufferTargets benchTargets;
+                buildGraph(benchGraph, benchTargets, compact, true);
+
+                GBufferBenchmark result{ size.x, size.y, compact, gBufferBytesPerPixel(compact), 0.0f, 0.0f };
+                for (int i = 0; i < warmup + runs; ++i)
+                {
+                    benchGraph.execute();
+                    glFinish();
+                    if (i < warmup)
+                        continue;
+                    std::vector<RenderGraph::PassStats> stats = benchGraph.stats();
+                    result.geometryMs += stats[0].ms / runs;
+                    result.lightingMs += stats[1].ms / runs;
+                }
+                std::cout << (compact ? "Compact" : "Original") << " G-Buffer " << size.x << "x" << size.y << ": "
+                          << result.bytesPerPixel << " B/px, geometry " << result.geometryMs << " ms, lighting " << result.lightingMs << " ms" << std::endl;
+                results.push_back(result);
+                benchGraph.dispose();
+            }
+        }
+        projection = savedProjection;
+        glViewport(0, 0, graph.getWidth(), graph.getHeight());
+        return results;
+    };
+    std::vector<GBufferBenchmark> benchmarks;
+
+    // 在遮挡物很多的测试场景里，从当前视角比较开关遮挡剔除时的耗时
+    auto benchmarkOcclusion = [&]()
+    {
+        const int warmup = 5;
+        const int runs = 20;
+        std::vector<OcclusionBenchmark> results;
+        const bool savedScene = occluderScene;
+        const bool savedOcclusion = occlusionCulling;
+        occluderScene = true;
+        for (bool enabled : { false, true })
+        {
+            occlusionCulling = enabled;
+            occlusion.reset();
+            OcclusionBenchmark result{ enabled, 0.0f, 0.0f, 0, 0 };
+            for (int i = 0; i < warmup + runs; ++i)
+            {
+                graph.execute();
+                glFinish();
+                if (i < warmup)
+                    continue;
+                std::vector<RenderGraph::PassStats> stats = graph.stats();
+                result.geometryMs += stats[0].ms / runs;
+                for (const RenderGraph::PassStats& pass : stats)
+                    result.frameMs += pass.ms / runs;
+            }
+            result.occluded = occlusion.occludedCount;
+            result.objects = occlusion.objectCount;
+            std::cout << "Occlusion culling " << (enabled ? "ON" : "OFF") << ": geometry " << result.geometryMs << " ms, frame "
+                      << result.frameMs << " ms, occluded " << result.occluded << " / " << result.objects << std::endl;
+            results.push_back(result);
+        }
+        occluderScene = savedScene;
+        occlusionCulling = savedOcclusion;
+        occlusion.reset();
+        return results;
+    };
+    std::vector<OcclusionBenchmark> occlusionBenchmarks;
+
+    // 软件遮挡剔除的基准测试：程序生成的城市（BoxGeometry 的单位立方体缩放成楼），摄像机站在街道上，
+    // 离摄像机近的楼作为遮挡物，所有楼的包围盒都做测试；分别用单线程和全部线程比较，只在 CPU 上运行，不画出来
+    auto benchmarkSoftwareOcclusion = [&]()
+    {
+        using Clock = std::chrono::steady_clock;
+        const int warmup = 5;
+        const int runs = 50;
+        const float occluderDistance = 80.0f;
+        const std::vector<glm::mat4> buildings = generateCity(48, 7);
+        const glm::vec3 eye(1.0f, 1.7f, 1.0f);
+        const glm::mat4 cityView = glm::lookAt(eye, eye + glm::vec3(0.3f, 0.0f, -1.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+        const glm::mat4 cityProjection = glm::perspective(glm::radians(60.0f), 16.0f / 9.0f, 0.1f, 500.0f);
+        const glm::vec3 unitMin(-0.5f), unitMax(0.5f);
+
+        std::vector<SoftwareOcclusionBenchmark> results;
+        SoftwareOcclusion cityCuller;
+        std::vector<unsigned int> threadCounts{ 1 };
+        if (std::thread::hardware_concurrency() > 1)
+            threadCounts.push_back(std::thread::hardware_concurrency());
+        for (unsigned int threads : threadCounts)
+        {
+            cityCuller.threadCount = threads;
+            SoftwareOcclusionBenchmark result{ threads, 0, 0.0f, 0.0f, 0, 0, static_cast<int>(buildings.size()) };
+
+            // 没有遮挡物时测试结果就是视锥剔除
+            cityCuller.begin(cityProjection * cityView);
+            cityCuller.rasterize();
+            for (const glm::mat4& model : buildings)
+                result.inFrustum += cityCuller.isVisible(model, unitMin, unitMax);
+
+            for (int i = 0; i < warmup + runs; ++i)
+            {
+                auto start = Clock::now();
+                cityCuller.begin(cityProjection * cityView);
+                for (const glm::mat4& model : buildings)
+                    if (glm::distance(glm::vec3(model[3]), eye) < occluderDistance)
+                        cityCuller.addOccluder(boxOccluder, model);
+                cityCuller.rasterize();
+                auto rasterized = Clock::now();
+                int visible = 0;
+                for (const glm::mat4& model : buildings)
+                    visible += cityCuller.isVisible(model, unitMin, unitMax);
+                auto tested = Clock::now();
+                if (i < warmup)
+                    continue;
+                result.rasterizeMs += std::chrono::duration<float, std::milli>(rasterized - start).count() / runs;
+                result.testMs += std::chrono::duration<float, std::milli>(tested - rasterized).count() / runs;
+                result.visible = visible;
+                result.occluderTriangles = cityCuller.stats.submittedTriangles;
+            }
+            std::cout << "Software occlusion, " << threads << " thread(s): rasterize " << result.rasterizeMs << " ms ("
+                      << result.occluderTriangles << " triangles), test " << result.testMs << " ms, visible " << result.visible
+                      << " / " << result.inFrustum << " in frustum / " << result.objects << " buildings" << std::endl;
+            results.push_back(result);
+        }
+        return results;
+    };
+    std::vector<SoftwareOcclusionBenchmark> softwareBenchmarks;
 
     while (!glfwWindowShouldClose(window))
     {
@@ -220,100 +619,62 @@ int main()
             ImGui::Text("%.3f ms/frame (%.1f FPS)", 1000.0f / ImGui::GetIO().Framerate, ImGui::GetIO().Framerate);
             ImGui::Text("FOV: %.1f", camera.Zoom);
             ImGui::Text("x: %.1f, y: %.1f, z: %.1f", camera.Position.x, camera.Position.y, camera.Position.z);
+            ImGui::Text("Resolution: %d x %d", graph.getWidth(), graph.getHeight());
+            for (const RenderGraph::PassStats& pass : graph.stats())
+                ImGui::Text("%s: %s", pass.name.c_str(), pass.culled ? "culled" : std::format("{:.3f} ms", pass.ms).c_str());
+            // 原来的 G-Buffer：两张 RGB16F + RGBA8 + 深度；紧凑布局：RG16 + RGBA8 + 深度
+            ImGui::Text("G-Buffer: %zu B/px", gBufferBytesPerPixel(compactGBuffer));
+            ImGui::Text("Graph targets: %.1f MB (%.1f MB without aliasing)",
+                graph.transientBytes() / 1048576.0f, graph.unaliasedBytes() / 1048576.0f);
+            bool rebuildGraph = ImGui::Checkbox("Compact G-Buffer", &compactGBuffer);
+            bool runBenchmark = ImGui::Button("Benchmark 1080p / 4K");
+            for (const GBufferBenchmark& result : benchmarks)
+                ImGui::Text("%s %dx%d: %zu B/px, geometry %.3f ms, lighting %.3f ms", result.compact ? "Compact" : "Original",
+                    result.width, result.height, result.bytesPerPixel, result.geometryMs, result.lightingMs);
+            ImGui::Checkbox("Occluder Scene", &occluderScene);
+            if (ImGui::Checkbox("Occlusion Culling", &occlusionCulling))
+                occlusion.reset();
+            if (occlusionCulling)
+                ImGui::Text("Occluded: %d / %d objects (%zu queries, %s)", occlusion.occludedCount, occlusion.objectCount,
+                    occlusion.queryCount(), occlusion.conservative() ? "conservative" : "exact");
+            ImGui::Checkbox("Software Occlusion (CPU)", &softwareOcclusion);
+            if (softwareOcclusion)
+                ImGui::Text("CPU culled: %d, %d x %d depth, rasterize %.3f ms (%u threads)", softwareCulled, softwareCuller.getWidth(),
+                    softwareCuller.getHeight(), softwareCuller.stats.setupMs + softwareCuller.stats.rasterMs + softwareCuller.stats.hierarchyMs,
+                    softwareCuller.stats.threads);
+            bool runOcclusionBenchmark = ImGui::Button("Benchmark Occlusion Culling");
+            if (occlusionBenchmarks.size() == 2)
+            {
+                const OcclusionBenchmark& off = occlusionBenchmarks[0];
+                const OcclusionBenchmark& on = occlusionBenchmarks[1];
+                ImGui::Text("Geometry: %.3f -> %.3f ms (%+.3f ms)", off.geometryMs, on.geometryMs, on.geometryMs - off.geometryMs);
+                ImGui::Text("Frame: %.3f -> %.3f ms (%+.3f ms), occluded %d / %d", off.frameMs, on.frameMs, on.frameMs - off.frameMs, on.occluded, on.objects);
+            }
+            bool runSoftwareBenchmark = ImGui::Button("Benchmark Software Occlusion (City)");
+            for (const SoftwareOcclusionBenchmark& result : softwareBenchmarks)
+                ImGui::Text("%u thread(s): rasterize %.3f ms, test %.3f ms, visible %d / %d / %d", result.threads,
+                    result.rasterizeMs, result.testMs, result.visible, result.inFrustum, result.objects);
         ImGui::End();
 
-        // ------------------------------------------------------------
-        // 1. 几何阶段：将场景的几何/颜色数据渲染到 G-Buffer 中
-        // glClearColor(bgColor.x, bgColor.y, bgColor.z, 1.0);
-        glClearColor(0, 0, 0, 1.0);
-
-        glBindFramebuffer(GL_FRAMEBUFFER, gBuffer);
-        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-
-        glm::mat4 projection = glm::perspective(glm::radians(camera.Zoom), (float)SCREEN_WIDTH / (float)SCREEN_HEIGHT, 0.1f, 100.0f);
-        glm::mat4 view = camera.GetViewMatrix();
-        glm::mat4 model = glm::mat4(1.0f);
-        shaderGeometryPass.use();
-        shaderGeometryPass.setMat4("projection", projection);
-        shaderGeometryPass.setMat4("view", view);
-        
-        for (unsigned int i = 0; i < objectPositions.size(); i++)
-        {
-            model = glm::mat4(1.0f);
-            model = glm::translate(model, objectPositions[i]);
-            model = glm::scale(model, glm::vec3(0.5f));
-            shaderGeometryPass.setMat4("model", model);
-            // drawMesh(objectGeometry);
-            backpack.Draw(shaderGeometryPass);
-        }
-
-        // ------------------------------------------------------------
-        // 2. 光照阶段：通过遍历一个覆盖全屏的四边形，逐像素地利用 G-Buffer 中的内容计算光照
-        glBindFramebuffer(GL_FRAMEBUFFER, 0);
-        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-
-        shaderLightingPass.use();
-        glActiveTexture(GL_TEXTURE0);
-        glBindTexture(GL_TEXTURE_2D, gPosition);
-
-        glActiveTexture(GL_TEXTURE1);
-        glBindTexture(GL_TEXTURE_2D, gNormal);
-
-        glActiveTexture(GL_TEXTURE2);
-        glBindTexture(GL_TEXTURE_2D, gAlbedoSpec);
-
-        for (unsigned int i = 0; i < lightPositions.size(); ++i)
+        if (runBenchmark)
+            benchmarks = benchmarkGBuffer();
+        if (runOcclusionBenchmark)
+            occlusionBenchmarks = benchmarkOcclusion();
+        if (runSoftwareBenchmark)
+            softwareBenchmarks = benchmarkSoftwareOcclusion();
+        if (rebuildGraph)
         {
-            shaderLightingPass.setVec3(std::format("pointLights[{}].position", i), lightPositions[i]);
-            shaderLightingPass.setVec3(std::format("pointLights[{}].ambient", i), 0.01f, 0.01f, 0.01f);
-            shaderLightingPass.setVec3(std::format("pointLights[{}].diffuse", i), lightColors[i]);
-            shaderLightingPass.setVec3(std::format("pointLights[{}].specular", i), 0.1f, 0.1f, 0.1f);
-
-            const float constant = 1.0f; // note that we don't send this to the shader, we assume it is always 1.0 (in our case)
-            const float linear = 0.7f;
-            const float quadratic = 1.8f;
-            shaderLightingPass.setFloat(std::format("pointLights[{}].constant", i), constant);
-            shaderLightingPass.setFloat(std::format("pointLights[{}].linear", i), linear);
-            shaderLightingPass.setFloat(std::format("pointLights[{}].quadratic", i), quadratic);
-            const float maxBrightness = std::max({ lightColors[i].r, lightColors[i].g, lightColors[i].b });
-            float radius = (-linear + std::sqrt(linear * linear - 4 * quadratic * (constant - (256.0f / 5.0f) * maxBrightness))) / (2.0f * quadratic);
-            shaderLightingPass.setFloat(std::format("pointLights[{}].radius", i), radius);
+            graph.reset();
+            buildGraph(graph, targets, compactGBuffer, false);
         }
-        shaderLightingPass.setMat4("view", view);
-        shaderLightingPass.setMat4("projection", projection);
-        shaderLightingPass.setVec3("viewPos", camera.Position);
-
-        model = glm::mat4(1.0f);
-        shaderLightingPass.setMat4("model", model);
-        drawMesh(frameGeometry);
-
-        // ------------------------------------------------------------
-        // 2.5. 将几何阶段的深度缓冲区内容复制到默认帧缓冲区的深度缓冲区中
-        // 延迟结合正向渲染
-        glBindFramebuffer(GL_READ_FRAMEBUFFER, gBuffer);
-        glBindFramebuffer(GL_DRAW_FRAMEBUFFER, 0); // 指定默认的帧缓冲为写缓冲
-        // 复制gbuffer的深度信息到默认帧缓冲的深度缓冲
-        glBlitFramebuffer(0, 0, SCREEN_WIDTH, SCREEN_HEIGHT, 0, 0, SCREEN_WIDTH, SCREEN_HEIGHT, GL_DEPTH_BUFFER_BIT, GL_NEAREST);
-        
-        // ------------------------------------------------------------
-        // 3. 在场景之上渲染光源
-        glBindFramebuffer(GL_FRAMEBUFFER, 0);
 
-        // 绘制灯光物体
-        shaderLightObj.use();
-        shaderLightObj.setMat4("projection", projection);
-        shaderLightObj.setMat4("view", view);
+        // 窗口最小化时帧缓冲大小为 0，保持原来的分配
+        if (framebufferWidth > 0 && framebufferHeight > 0)
+            graph.resize(framebufferWidth, framebufferHeight);
 
-        for (unsigned int i = 0; i < lightPositions.size(); i++)
-        {
-            model = glm::mat4(1.0f);
-            model = glm::translate(model, lightPositions[i]);
-
-            shaderLightObj.setMat4("model", model);
-            shaderLightObj.setVec3("lightColor", lightColors[i]);
-
-            drawMesh(pointLightGeometry);
-        }
+        projection = glm::perspective(glm::radians(camera.Zoom), (float)graph.getWidth() / (float)graph.getHeight(), 0.1f, 100.0f);
+        view = camera.GetViewMatrix();
+        graph.execute();
 
         // ImGui 渲染
         ImGui::Render();
@@ -323,6 +684,10 @@ int main()
         glfwPollEvents();
     }
 
+    graph.dispose();
+    occlusion.dispose();
+    wallGeometry.dispose();
+
     glfwTerminate();
     return 0;
 }
@@ -432,6 +797,14 @@ unsigned int loadTexture(std::string_view path)
     return textureID;
 }
 
+// G-Buffer 每个像素写入（以及光照阶段读取）的字节数
+size_t gBufferBytesPerPixel(bool compact)
+{
+    if (compact)
+        return RenderGraph::bytesPerPixel(GL_RG16) + RenderGraph::bytesPerPixel(GL_RGBA8) + RenderGraph::bytesPerPixel(GL_DEPTH24_STENCIL8);
+    return 2 * RenderGraph::bytesPerPixel(GL_RGB16F) + RenderGraph::bytesPerPixel(GL_RGBA8) + RenderGraph::bytesPerPixel(GL_DEPTH24_STENCIL8);
+}
+
 // 绘制物体
 void drawMesh(const BufferGeometry& geometry)
 {
@@ -439,3 +812,28 @@ void drawMesh(const BufferGeometry& geometry)
     glDrawElements(GL_TRIANGLES, static_cast<GLsizei>(geometry.indices.size()), GL_UNSIGNED_INT, 0);
     glBindVertexArray(0);
 }
+
+// 程序生成的城市：blocks x blocks 个街区，每个街区一栋楼，街道宽 2，楼高随机
+// 返回每栋楼的模型矩阵（把 [-0.5, 0.5] 的单位立方体缩放、平移到位），摄像机在原点附近的街道上
+std::vector<glm::mat4> generateCity(int blocks, unsigned int seed)
+{
+    const float blockSize = 8.0f;
+    const float streetWidth = 2.0f;
+    std::mt19937 random(seed);
+    std::uniform_real_distribution<float> footprint(0.7f, 1.0f);
+    // 大部分是矮楼，少数高楼
+    std::lognormal_distribution<float> height(2.0f, 0.6f);
+
+    std::vector<glm::mat4> buildings;
+    buildings.reserve(static_cast<size_t>(blocks) * blocks);
+    for (int i = 0; i < blocks; ++i)
+        for (int j = 0; j < blocks; ++j)
+        {
+            float size = blockSize - streetWidth;
+            glm::vec3 scale(size * footprint(random), glm::clamp(height(random), 2.0f, 60.0f), size * footprint(random));
+            glm::vec3 center((i - blocks / 2) * blockSize + blockSize / 2.0f, scale.y / 2.0f, -j * blockSize - blockSize / 2.0f);
+            glm::mat4 model = glm::translate(glm::mat4(1.0f), center);
+            buildings.push_back(glm::scale(model, scale));
+        }
+    return buildings;
+}
@@ -1,7 +1,17 @@
 #version 330 core
+// 定义 COMPACT_GBUFFER 时使用紧凑布局：不写位置，法线八面体编码，高光和材质 ID 打包进 alpha
+#ifdef COMPACT_GBUFFER
+#include "gbuffer_packing.glsl"
+
+layout(location = 0) out vec2 gNormal;
+layout(location = 1) out vec4 gAlbedoSpec;
+
+uniform int materialID;
+#else
 layout(location = 0) out vec3 gPosition;
 layout(location = 1) out vec3 gNormal;
 layout(location = 2) out vec4 gAlbedoSpec;
+#endif
 
 in VS_OUT
 {
@@ -14,8 +24,13 @@ uniform sampler2D texture_diffuse1;
 uniform sampler2D texture_specular1;
 
 void main() {
+	gAlbedoSpec.rgb = texture(texture_diffuse1, fs_in.TexCoords).rgb;
+#ifdef COMPACT_GBUFFER
+	gNormal = encodeNormal(normalize(fs_in.Normal));
+	gAlbedoSpec.a = packSpecularMaterial(texture(texture_specular1, fs_in.TexCoords).r, materialID);
+#else
 	gPosition = fs_in.FragPos;
 	gNormal = normalize(fs_in.Normal);
-	gAlbedoSpec.rgb = texture(texture_diffuse1, fs_in.TexCoords).rgb;
 	gAlbedoSpec.a = texture(texture_specular1, fs_in.TexCoords).r;
-}
\ No newline at end of file
+#endif
+}
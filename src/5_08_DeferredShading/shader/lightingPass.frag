@@ -1,10 +1,15 @@
 #version 330 core
 out vec4 FragColor;
 
+// 定义 COMPACT_GBUFFER 时从深度重建位置，gNormal 为八面体编码，gAlbedoSpec.a 为高光 + 材质 ID
+#ifdef COMPACT_GBUFFER
+#include "gbuffer_packing.glsl"
+#endif
+
 // 定义材质结构体
 struct Material
 {
-    sampler2D gPosition;
+    sampler2D gPosition;    // 紧凑布局时为深度缓冲
     sampler2D gNormal;
     sampler2D gAlbedoSpec;
     float shininess;        // 高光指数
@@ -30,17 +35,32 @@ in vec2 TexCoords;
 uniform vec3 viewPos;           // 摄像机位置
 uniform Material material;
 uniform PointLight pointLights[NR_POINT_LIGHTS];
+#ifdef COMPACT_GBUFFER
+uniform mat4 inverseViewProjection;
+// 按材质 ID 查高光指数
+uniform float materialShininess[GBUFFER_MATERIAL_COUNT];
+#endif
 
 // 函数
-vec3 CalcPointLight(PointLight light, vec3 normal, vec3 fragPos, vec3 viewDir, vec3 Diffuse, float Specular);
+vec3 CalcPointLight(PointLight light, vec3 normal, vec3 fragPos, vec3 viewDir, vec3 Diffuse, float Specular, float Shininess);
 
 void main()
 {
     // 属性
+#ifdef COMPACT_GBUFFER
+    vec4 AlbedoSpec = texture(material.gAlbedoSpec, TexCoords);
+    vec3 FragPos = reconstructPosition(TexCoords, texture(material.gPosition, TexCoords).r, inverseViewProjection);
+    vec3 Normal = decodeNormal(texture(material.gNormal, TexCoords).rg);
+    vec3 Diffuse = AlbedoSpec.rgb;
+    float Specular = unpackSpecular(AlbedoSpec.a);
+    float Shininess = materialShininess[unpackMaterialID(AlbedoSpec.a)];
+#else
     vec3 FragPos = texture(material.gPosition, TexCoords).rgb;
     vec3 Normal = texture(material.gNormal, TexCoords).rgb;
     vec3 Diffuse = texture(material.gAlbedoSpec, TexCoords).rgb;
     float Specular = texture(material.gAlbedoSpec, TexCoords).a;
+    float Shininess = material.shininess;
+#endif
 
     vec3 viewDir = normalize(viewPos - FragPos);
     
@@ -49,13 +69,13 @@ void main()
     {
         float distance = length(pointLights[i].position - FragPos);
         if(distance < pointLights[i].radius)
-            result += CalcPointLight(pointLights[i], Normal, FragPos, viewDir, Diffuse, Specular);
+            result += CalcPointLight(pointLights[i], Normal, FragPos, viewDir, Diffuse, Specular, Shininess);
     }
 
     FragColor = vec4(result, 1.0f);
 }
 
-vec3 CalcPointLight(PointLight light, vec3 normal, vec3 fragPos, vec3 viewDir, vec3 Diffuse, float Specular)
+vec3 CalcPointLight(PointLight light, vec3 normal, vec3 fragPos, vec3 viewDir, vec3 Diffuse, float Specular, float Shininess)
 {
     vec3 lightDir = normalize(light.position - fragPos);
 
@@ -68,7 +88,7 @@ vec3 CalcPointLight(PointLight light, vec3 normal, vec3 fragPos, vec3 viewDir, v
     
     // 镜面反射
     vec3 reflectDir = reflect(-lightDir, normal);
-    float spec = pow(max(dot(viewDir, reflectDir), 0.0), material.shininess);
+    float spec = pow(max(dot(viewDir, reflectDir), 0.0), Shininess);
     vec3 specular = light.specular * (spec * Specular);
     
     // 衰减
@@ -16,12 +16,18 @@
 #include <tools/camera.h>
 #include <tools/mesh.h>
 #include <tools/model.h>
+#include <tools/compute_shader.h>
+#include <tools/separable_filter.h>
+#include <tools/render_graph.h>
+#include <tools/temporal_accumulator.h>
 
 #include <iostream>
 #include <string>
 #include <string_view>
 #include <format>
 #include <random>
+#include <array>
+#include <vector>
 
 static void processInput(GLFWwindow* window);
 static void keyCallback(GLFWwindow* window, int key, int scancode, int action, int mods);
@@ -40,6 +46,19 @@ float lastY = SCREEN_HEIGHT / 2.0f;
 bool isFirstMouse = true;
 bool isMouseCaptured = true; // 初始为捕获状态（隐藏鼠标，控制视角）
 bool useSSAO = true;
+// 0 为 ssaoBlur.frag 的 4x4 均值，其余为 SeparableFilter 的方框 / 双边滤波
+int ssaoBlurMode = 2;
+// AO 的分辨率：0 全分辨率，1 半分辨率，2 四分之一分辨率
+int aoResolution = 1;
+// 采样数的变体：8 / 16 / 32 / 64
+int kernelIndex = 1;
+// 时间累积：每帧旋转采样核，和重投影的历史结果混合，16 个采样就能接近 64 个采样的效果
+bool useTemporal = true;
+// 紧凑 G-Buffer：RG16 八面体法线 + RGBA8 + 深度，观察空间位置从深度重建
+bool compactGBuffer = true;
+// 当前帧缓冲大小，窗口缩放时由回调更新
+int framebufferWidth = SCREEN_WIDTH;
+int framebufferHeight = SCREEN_HEIGHT;
 
 // 时机
 float deltaTime = 0.0f; // 当前帧与上一帧的时间差
@@ -50,6 +69,28 @@ static float ourLerp(float a, float b, float f)
     return a + f * (b - a);
 }
 
+// 生成切线空间半球内的采样核，std140 下 vec3 数组按 vec4 对齐，直接生成 vec4
+static std::vector<glm::vec4> generateKernel(unsigned int kernelSize, std::default_random_engine& generator)
+{
+    std::uniform_real_distribution<float> randomFloats(0.0f, 1.0f); // 生成在范围[0, 1]之间的随机浮点数
+    std::vector<glm::vec4> kernel;
+    for (unsigned int i = 0; i < kernelSize; ++i)
+    {
+        glm::vec3 sample(randomFloats(generator) * 2.0 - 1.0,
+            randomFloats(generator) * 2.0 - 1.0,
+            randomFloats(generator));
+        sample = glm::normalize(sample);
+        sample *= randomFloats(generator);
+        float scale = float(i) / kernelSize;
+
+        // 缩放样本，使得样本尽量靠近核的中心
+        scale = ourLerp(0.1f, 1.0f, scale * scale);
+        sample *= scale;
+        kernel.push_back(glm::vec4(sample, 0.0f));
+    }
+    return kernel;
+}
+
 int main()
 {
 
@@ -74,6 +115,8 @@ int main()
         std::cout << "Failed to initialize GLAD" << std::endl;
         return -1;
     }
+    // 上下文支持 4.3 时加载计算着色器的函数
+    ComputeGL::load(reinterpret_cast<GLADloadproc>(glfwGetProcAddress));
     /*
         回调函数注册
         1.注册窗口变化监听
@@ -82,6 +125,8 @@ int main()
     glfwSetFramebufferSizeCallback(window, [](GLFWwindow* window, int width, int height)
         {
             glViewport(0, 0, width, height);
+            framebufferWidth = width;
+            framebufferHeight = height;
         });
     glfwSetKeyCallback(window, keyCallback);
     glfwSetCursorPosCallback(window, mouseCallback);
@@ -114,9 +159,24 @@ int main()
 
     ImVec4 bgColor = ImVec4(0.02f, 0.02f, 0.03f, 1.0f);
 
-    Shader shaderGeometryPass(SHADER_DIR "/geometryPass.vert", SHADER_DIR "/geometryPass.frag");
-    Shader shaderLightingPass(SHADER_DIR "/lightingPass.vert", SHADER_DIR "/lightingPass.frag");
-    Shader shaderSSAO(SHADER_DIR "/ssao.vert", SHADER_DIR "/ssao.frag");
+    // 读写 G-Buffer 的着色器各有两个变体：0 为原来的布局，1 为紧凑布局
+    const std::string_view compactDefine = "#define COMPACT_GBUFFER\n";
+    std::array<Shader, 2> shaderGeometryPasses = {
+        Shader(SHADER_DIR "/geometryPass.vert", SHADER_DIR "/geometryPass.frag"),
+        Shader(SHADER_DIR "/geometryPass.vert", SHADER_DIR "/geometryPass.frag", { }, compactDefine)
+    };
+    std::array<Shader, 2> shaderLightingPasses = {
+        Shader(SHADER_DIR "/lightingPass.vert", SHADER_DIR "/lightingPass.frag"),
+        Shader(SHADER_DIR "/lightingPass.vert", SHADER_DIR "/lightingPass.frag", { }, compactDefine)
+    };
+    std::array<Shader, 2> shaderSSAODownsamples = {
+        Shader(SHADER_DIR "/ssao.vert", SHADER_DIR "/ssaoDownsample.frag"),
+        Shader(SHADER_DIR "/ssao.vert", SHADER_DIR "/ssaoDownsample.frag", { }, compactDefine)
+    };
+    std::array<Shader, 2> shaderSSAOUpsamples = {
+        Shader(SHADER_DIR "/ssao.vert", SHADER_DIR "/ssaoUpsample.frag"),
+        Shader(SHADER_DIR "/ssao.vert", SHADER_DIR "/ssaoUpsample.frag", { }, compactDefine)
+    };
     Shader shaderSSAOBlur(SHADER_DIR "/ssaoBlur.vert", SHADER_DIR "/ssaoBlur.frag");
     Shader shaderLightObj(SHADER_DIR "/lightObj.vert", SHADER_DIR "/lightObj.frag");
     
@@ -128,104 +188,47 @@ int main()
     Model ourModel(ASSETS_DIR "/model/backpack/backpack.obj");
     // Model ourModel(ASSETS_DIR "/model/nanosuit/nanosuit.obj");
 
-    // ------------------------------------------------------------
-    // 创建GBuffer
-    unsigned int gBuffer;
-    glGenFramebuffers(1, &gBuffer);
-    glBindFramebuffer(GL_FRAMEBUFFER, gBuffer);
-    unsigned int gPosition, gNormal, gAlbedo;
-
-    // 位置颜色缓冲
-    glGenTextures(1, &gPosition);
-    glBindTexture(GL_TEXTURE_2D, gPosition);
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA16F, SCREEN_WIDTH, SCREEN_HEIGHT, 0, GL_RGBA, GL_FLOAT, nullptr);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, gPosition, 0);
-
-    // 法线颜色缓冲
-    glGenTextures(1, &gNormal);
-    glBindTexture(GL_TEXTURE_2D, gNormal);
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA16F, SCREEN_WIDTH, SCREEN_HEIGHT, 0, GL_RGBA, GL_FLOAT, nullptr);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT1, GL_TEXTURE_2D, gNormal, 0);
-
-    // 颜色 + 颜色缓冲
-    glGenTextures(1, &gAlbedo);
-    glBindTexture(GL_TEXTURE_2D, gAlbedo);
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, SCREEN_WIDTH, SCREEN_HEIGHT, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT2, GL_TEXTURE_2D, gAlbedo, 0);
-
-    unsigned int attachments[3] = { GL_COLOR_ATTACHMENT0, GL_COLOR_ATTACHMENT1, GL_COLOR_ATTACHMENT2 };
-    glDrawBuffers(3, attachments);
-
-    // 深度缓冲
-    unsigned int rboDepth;
-    glGenRenderbuffers(1, &rboDepth);
-    glBindRenderbuffer(GL_RENDERBUFFER, rboDepth);
-    glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT, SCREEN_WIDTH, SCREEN_HEIGHT);
-    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, rboDepth);
-    if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
-        std::cout << "Framebuffer not complete!" << std::endl;
-    glBindFramebuffer(GL_FRAMEBUFFER, 0);
-
-    // ------------------------------------------------------------
-    // 还要创建帧缓冲区来保存SSAO处理阶段的数据
-    unsigned int ssaoFBO, ssaoBlurFBO;
-    glGenFramebuffers(1, &ssaoFBO);
-    glGenFramebuffers(1, &ssaoBlurFBO);
-    unsigned int ssaoColorBuffer, ssaoColorBufferBlur;
-
-    // SSAO 颜色缓冲
-    glBindFramebuffer(GL_FRAMEBUFFER, ssaoFBO);
-
-    glGenTextures(1, &ssaoColorBuffer);
-    glBindTexture(GL_TEXTURE_2D, ssaoColorBuffer);
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RED, SCREEN_WIDTH, SCREEN_HEIGHT, 0, GL_RED, GL_FLOAT, nullptr);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, ssaoColorBuffer, 0);
-    if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
-        std::cout << "SSAO Framebuffer not complete!" << std::endl;
-
-    // 模糊阶段
-    glBindFramebuffer(GL_FRAMEBUFFER, ssaoBlurFBO);
-
-    glGenTextures(1, &ssaoColorBufferBlur);
-    glBindTexture(GL_TEXTURE_2D, ssaoColorBufferBlur);
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RED, SCREEN_WIDTH, SCREEN_HEIGHT, 0, GL_RED, GL_FLOAT, nullptr);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, ssaoColorBufferBlur, 0);
-    if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
-        std::cout << "SSAO Blur Framebuffer not complete!" << std::endl;
-    glBindFramebuffer(GL_FRAMEBUFFER, 0);
-
     // ------------------------------------------------------------
     // 生成采样的核
-    std::uniform_real_distribution<float> randomFloats(0.0f, 1.0f); // 生成在范围[0, 1]之间的随机浮点数
+    // 采样数是着色器的编译期常量，每种采样数一个变体；三组核放在同一个 UBO 里，启动时上传一次
+    // 每组的起点按 GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT 对齐，绘制前用 glBindBufferRange 选中对应的一组
+    const std::array<unsigned int, 4> kernelSizes = { 8, 16, 32, 64 };
     std::default_random_engine generator;
-    std::vector<glm::vec3> ssaoKernel;
-    for (unsigned int i = 0; i < 64; ++i)
+    GLint uboAlignment = 256;
+    glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &uboAlignment);
+    std::array<GLintptr, kernelSizes.size()> kernelOffsets{};
+    GLsizeiptr kernelBufferSize = 0;
+    for (size_t k = 0; k < kernelSizes.size(); ++k)
     {
-        glm::vec3 sample(randomFloats(generator) * 2.0 - 1.0,
-            randomFloats(generator) * 2.0 - 1.0,
-            randomFloats(generator));
-        sample = glm::normalize(sample);
-        sample *= randomFloats(generator);
-        float scale = float(i) / 64.0f;
+        kernelOffsets[k] = kernelBufferSize;
+        GLsizeiptr bytes = kernelSizes[k] * sizeof(glm::vec4);
+        kernelBufferSize += (bytes + uboAlignment - 1) / uboAlignment * uboAlignment;
+    }
 
-        // 缩放样本，使得样本尽量靠近核的中心
-        scale = ourLerp(0.1f, 1.0f, scale * scale);
-        sample *= scale;
-        ssaoKernel.push_back(sample);
+    unsigned int kernelUBO;
+    glGenBuffers(1, &kernelUBO);
+    glBindBuffer(GL_UNIFORM_BUFFER, kernelUBO);
+    glBufferData(GL_UNIFORM_BUFFER, kernelBufferSize, nullptr, GL_STATIC_DRAW);
+    std::vector<Shader> ssaoShaders;
+    for (size_t k = 0; k < kernelSizes.size(); ++k)
+    {
+        std::vector<glm::vec4> kernel = generateKernel(kernelSizes[k], generator);
+        glBufferSubData(GL_UNIFORM_BUFFER, kernelOffsets[k], kernel.size() * sizeof(glm::vec4), kernel.data());
+
+        ssaoShaders.emplace_back(SHADER_DIR "/ssao.vert", SHADER_DIR "/ssao.frag", std::string_view{ },
+            std::format("#define KERNEL_SIZE {}\n", kernelSizes[k]));
+        const Shader& shader = ssaoShaders.back();
+        glUniformBlockBinding(shader.ID, glGetUniformBlockIndex(shader.ID, "SSAOKernel"), 0);
+        shader.use();
+        shader.setInt("gPosition", 0);
+        shader.setInt("gNormal", 1);
+        shader.setInt("texNoise", 2);
     }
+    glBindBuffer(GL_UNIFORM_BUFFER, 0);
 
     // ------------------------------------------------------------
     // 生成噪声材质
+    std::uniform_real_distribution<float> randomFloats(0.0f, 1.0f);
     std::vector<glm::vec3> ssaoNoise;
     for (unsigned int i = 0; i < 16; ++i)
     {
@@ -244,21 +247,300 @@ int main()
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
 
     // ------------------------------------------------------------
-    shaderLightingPass.use();
-    shaderLightingPass.setInt("gPosition", 0);
-    shaderLightingPass.setInt("gNormal", 1);
-    shaderLightingPass.setInt("gAlbedo", 2);
-    shaderLightingPass.setInt("ssao", 3);
-    shaderLightingPass.setFloat("shininess", 32.0f);
-
-    shaderSSAO.use();
-    shaderSSAO.setInt("gPosition", 0);
-    shaderSSAO.setInt("gNormal", 1);
-    shaderSSAO.setInt("texNoise", 2);
+    for (int i = 0; i < 2; ++i)
+    {
+        shaderLightingPasses[i].use();
+        shaderLightingPasses[i].setInt("gPosition", 0);
+        shaderLightingPasses[i].setInt("gNormal", 1);
+        shaderLightingPasses[i].setInt("gAlbedo", 2);
+        shaderLightingPasses[i].setInt("ssao", 3);
+        shaderLightingPasses[i].setFloat("shininess", 32.0f);
+
+        shaderSSAODownsamples[i].use();
+        shaderSSAODownsamples[i].setInt("gPosition", 0);
+        shaderSSAODownsamples[i].setInt("gNormal", 1);
+
+        shaderSSAOUpsamples[i].use();
+        shaderSSAOUpsamples[i].setInt("aoInput", 0);
+        shaderSSAOUpsamples[i].setInt("aoPosition", 1);
+        shaderSSAOUpsamples[i].setInt("aoNormal", 2);
+        shaderSSAOUpsamples[i].setInt("gPosition", 3);
+        shaderSSAOUpsamples[i].setInt("gNormal", 4);
+    }
 
     shaderSSAOBlur.use();
     shaderSSAOBlur.setInt("ssaoInput", 0);
 
+    // 可分离的 SSAO 模糊，双边滤波以 AO 分辨率下位置的观察空间深度为引导，不会把遮蔽模糊到物体边缘外
+    SeparableFilter ssaoFilter(SCREEN_WIDTH, SCREEN_HEIGHT, GL_R16F);
+    ssaoFilter.sigma = 2.0f;
+    ssaoFilter.depthSigma = 0.3f;
+
+    // SSAO 的时间累积，在 AO 分辨率上进行
+    TemporalAccumulator temporalAO(SCREEN_WIDTH, SCREEN_HEIGHT, GL_R16F);
+
+    // ------------------------------------------------------------
+    // 渲染图
+    // 半分辨率 / 四分之一分辨率时：先把位置和法线降采样，在低分辨率上计算并模糊 AO，
+    // 再按全分辨率的深度和法线做联合双边升采样
+    glm::mat4 projection(1.0f);
+    glm::mat4 view(1.0f);
+    glm::vec3 curLightPos(0.0f);
+    glm::vec3 curLightColor(0.0f);
+    RenderGraph graph(SCREEN_WIDTH, SCREEN_HEIGHT);
+    RenderGraph::Handle gPosition, gNormal, gAlbedo, gDepth;
+    RenderGraph::Handle aoPosition, aoNormal, aoRaw, aoTemporal, aoNoisy, aoBlurred, ao;
+    bool rebuildGraph = true;
+
+    auto buildGraph = [&]()
+    {
+        graph.reset();
+        if (framebufferWidth > 0 && framebufferHeight > 0)
+            graph.resize(framebufferWidth, framebufferHeight);
+        const int factor = 1 << aoResolution;
+        const float aoScale = 1.0f / factor;
+        const bool compact = compactGBuffer;
+        Shader& shaderGeometryPass = shaderGeometryPasses[compact];
+        const Shader& shaderLightingPass = shaderLightingPasses[compact];
+        const Shader& shaderSSAODownsample = shaderSSAODownsamples[compact];
+        const Shader& shaderSSAOUpsample = shaderSSAOUpsamples[compact];
+
+        // 1. 几何阶段：将场景的几何/颜色数据渲染到 G-Buffer 中
+        // 紧凑布局没有位置纹理，gPosition 直接指向深度缓冲，读它的着色器用对应的变体从深度重建位置
+        graph.addPass("GBuffer", [&](RenderGraph::PassBuilder& builder)
+            {
+                if (!compact)
+                    gPosition = builder.create("gPosition", { GL_RGBA16F, 1.0f, GL_NEAREST });
+                gNormal = builder.create("gNormal", { static_cast<GLenum>(compact ? GL_RG16 : GL_RGBA16F), 1.0f, GL_NEAREST });
+                gAlbedo = builder.create("gAlbedo", { GL_RGBA8, 1.0f, GL_NEAREST });
+                gDepth = builder.create("gDepth", { GL_DEPTH24_STENCIL8, 1.0f, GL_NEAREST });
+                if (compact)
+                    gPosition = gDepth;
+                builder.clear();
+            },
+            [&](const RenderGraph::PassContext&)
+            {
+                shaderGeometryPass.use();
+                shaderGeometryPass.setMat4("projection", projection);
+                shaderGeometryPass.setMat4("view", view);
+
+                // 正方体房间
+                glm::mat4 model = glm::mat4(1.0f);
+                model = glm::translate(model, glm::vec3(0.0, 7.0f, 0.0f));
+                shaderGeometryPass.setMat4("model", model);
+                shaderGeometryPass.setBool("invertedNormals", true); // 在房间内，反转法向量
+                glCullFace(GL_FRONT);
+                drawMesh(roomGeometry);
+                glCullFace(GL_BACK);
+                shaderGeometryPass.setBool("invertedNormals", false);
+
+                // 在地板上的背包
+                model = glm::mat4(1.0f);
+                model = glm::translate(model, glm::vec3(0.0f, 0.5f, 0.0));
+                model = glm::rotate(model, glm::radians(-90.0f), glm::vec3(1.0, 0.0, 0.0));
+                shaderGeometryPass.setMat4("model", model);
+                ourModel.Draw(shaderGeometryPass);
+            });
+
+        // 2.降采样位置和法线，紧凑布局时即使是全分辨率也要先解码成 SSAO 用的位置和法线
+        aoPosition = gPosition;
+        aoNormal = gNormal;
+        if (factor > 1 || compact)
+        {
+            graph.addPass("AO Downsample", [&](RenderGraph::PassBuilder& builder)
+                {
+                    builder.read(gPosition);
+                    builder.read(gNormal);
+                    aoPosition = builder.create("aoPosition", { GL_RGBA16F, aoScale, GL_NEAREST });
+                    aoNormal = builder.create("aoNormal", { GL_RGBA16F, aoScale, GL_NEAREST });
+                },
+                [&, factor](const RenderGraph::PassContext& context)
+                {
+                    shaderSSAODownsample.use();
+                    shaderSSAODownsample.setInt("factor", factor);
+                    shaderSSAODownsample.setMat4("inverseProjection", glm::inverse(projection));
+                    glActiveTexture(GL_TEXTURE0);
+                    glBindTexture(GL_TEXTURE_2D, context.texture(gPosition));
+                    glActiveTexture(GL_TEXTURE1);
+                    glBindTexture(GL_TEXTURE_2D, context.texture(gNormal));
+                    drawMesh(frameGeometry);
+                });
+        }
+
+        // 3.生成 SSAO 贴图
+        graph.addPass("SSAO", [&](RenderGraph::PassBuilder& builder)
+            {
+                builder.read(aoPosition);
+                builder.read(aoNormal);
+                aoRaw = builder.create("aoRaw", { GL_R8, aoScale, GL_NEAREST });
+            },
+            [&](const RenderGraph::PassContext& context)
+            {
+                const Shader& shaderSSAO = ssaoShaders[kernelIndex];
+                shaderSSAO.use();
+                shaderSSAO.setMat4("projection", projection);
+                shaderSSAO.setInt("frameIndex", useTemporal ? static_cast<int>(temporalAO.frameIndex()) : 0);
+                glBindBufferRange(GL_UNIFORM_BUFFER, 0, kernelUBO, kernelOffsets[kernelIndex], kernelSizes[kernelIndex] * sizeof(glm::vec4));
+
+                glActiveTexture(GL_TEXTURE0);
+                glBindTexture(GL_TEXTURE_2D, context.texture(aoPosition));
+                glActiveTexture(GL_TEXTURE1);
+                glBindTexture(GL_TEXTURE_2D, context.texture(aoNormal));
+                glActiveTexture(GL_TEXTURE2);
+                glBindTexture(GL_TEXTURE_2D, noiseTexture);
+                drawMesh(frameGeometry);
+            });
+
+        // 4.时间累积：用上一帧的矩阵把历史 AO 重投影过来，深度对不上的像素丢弃历史
+        aoNoisy = aoRaw;
+        if (useTemporal)
+        {
+            const int aoWidth = glm::max(1, static_cast<int>(graph.getWidth() * aoScale));
+            const int aoHeight = glm::max(1, static_cast<int>(graph.getHeight() * aoScale));
+            if (aoWidth != temporalAO.width || aoHeight != temporalAO.height)
+                temporalAO.resize(aoWidth, aoHeight);
+            aoTemporal = graph.importTexture("aoTemporal", temporalAO.texture(), aoWidth, aoHeight, GL_R16F);
+            graph.addPass("AO Temporal", [&](RenderGraph::PassBuilder& builder)
+                {
+                    builder.read(aoRaw);
+                    builder.read(aoPosition);
+                    aoNoisy = builder.write(aoTemporal);
+                },
+                [&](const RenderGraph::PassContext& context)
+                {
+                    // 历史纹理乒乓交换，之后的 pass 要读到这一帧的结果
+                    graph.setImportedTexture(aoTemporal, temporalAO.accumulate(context.texture(aoRaw), context.texture(aoPosition), view, projection));
+                });
+        }
+        else
+        {
+            temporalAO.reset();
+        }
+
+        // 5.在 AO 分辨率上模糊 SSAO 材质来去除噪声
+        if (ssaoBlurMode == 0)
+        {
+            graph.addPass("AO Blur", [&](RenderGraph::PassBuilder& builder)
+                {
+                    builder.read(aoNoisy);
+                    aoBlurred = builder.create("aoBlurred", { GL_R8, aoScale, GL_NEAREST });
+                },
+                [&](const RenderGraph::PassContext& context)
+                {
+                    shaderSSAOBlur.use();
+                    glActiveTexture(GL_TEXTURE0);
+                    glBindTexture(GL_TEXTURE_2D, context.texture(aoNoisy));
+                    drawMesh(frameGeometry);
+                });
+        }
+        else
+        {
+            // 和渲染图里 aoRaw 的尺寸算法一致
+            ssaoFilter.resize(glm::max(1, static_cast<int>(graph.getWidth() * aoScale)), glm::max(1, static_cast<int>(graph.getHeight() * aoScale)));
+            aoBlurred = graph.importTexture("aoFiltered", ssaoFilter.texture(), ssaoFilter.width, ssaoFilter.height, GL_R16F);
+            graph.addPass("AO Filter", [&](RenderGraph::PassBuilder& builder)
+                {
+                    builder.read(aoNoisy);
+                    builder.read(aoPosition);
+                    builder.write(aoBlurred);
+                },
+                [&](const RenderGraph::PassContext& context)
+                {
+                    ssaoFilter.kind = ssaoBlurMode == 1 ? SeparableFilter::Kind::Box : SeparableFilter::Kind::Bilateral;
+                    ssaoFilter.radius = ssaoBlurMode == 1 ? 2 : 4;
+                    ssaoFilter.apply(context.texture(aoNoisy), context.texture(aoPosition));
+                });
+        }
+
+        // 6.联合双边升采样回全分辨率
+        ao = aoBlurred;
+        if (factor > 1)
+        {
+            graph.addPass("AO Upsample", [&](RenderGraph::PassBuilder& builder)
+                {
+                    builder.read(aoBlurred);
+                    builder.read(aoPosition);
+                    builder.read(aoNormal);
+                    builder.read(gPosition);
+                    builder.read(gNormal);
+                    ao = builder.create("ao", { GL_R8, 1.0f, GL_NEAREST });
+                },
+                [&](const RenderGraph::PassContext& context)
+                {
+                    shaderSSAOUpsample.use();
+                    shaderSSAOUpsample.setMat4("inverseProjection", glm::inverse(projection));
+                    RenderGraph::Handle inputs[] = { aoBlurred, aoPosition, aoNormal, gPosition, gNormal };
+                    for (int i = 0; i < 5; ++i)
+                    {
+                        glActiveTexture(GL_TEXTURE0 + i);
+                        glBindTexture(GL_TEXTURE_2D, context.texture(inputs[i]));
+                    }
+                    drawMesh(frameGeometry);
+                });
+        }
+
+        // 7.光照阶段: 传统延迟布林冯光照 + SSAO，关闭 SSAO 时上面的 AO pass 全部被剔除
+        graph.addPass("Lighting", [&](RenderGraph::PassBuilder& builder)
+            {
+                builder.read(gPosition);
+                builder.read(gNormal);
+                builder.read(gAlbedo);
+                builder.read(gDepth);
+                if (useSSAO)
+                    builder.read(ao);
+                builder.writeBackbuffer();
+                builder.clear();
+            },
+            [&](const RenderGraph::PassContext& context)
+            {
+                shaderLightingPass.use();
+                shaderLightingPass.setBool("useSSAO", useSSAO);
+                shaderLightingPass.setMat4("inverseProjection", glm::inverse(projection));
+
+                glm::vec3 lightPosView = glm::vec3(view * glm::vec4(curLightPos, 1.0));
+
+                shaderLightingPass.setVec3(std::format("pointLights[{}].position", 0), lightPosView);
+                shaderLightingPass.setVec3(std::format("pointLights[{}].ambient", 0), 0.3f, 0.3f, 0.3f);
+                shaderLightingPass.setVec3(std::format("pointLights[{}].diffuse", 0), curLightColor);
+                shaderLightingPass.setVec3(std::format("pointLights[{}].specular", 0), 0.1f, 0.1f, 0.1f);
+
+                const float constant = 1.0f; // note that we don't send this to the shader, we assume it is always 1.0 (in our case)
+                const float linear = 0.09f;
+                const float quadratic = 0.032f;
+                shaderLightingPass.setFloat(std::format("pointLights[{}].constant", 0), constant);
+                shaderLightingPass.setFloat(std::format("pointLights[{}].linear", 0), linear);
+                shaderLightingPass.setFloat(std::format("pointLights[{}].quadratic", 0), quadratic);
+
+                glActiveTexture(GL_TEXTURE0);
+                glBindTexture(GL_TEXTURE_2D, context.texture(gPosition));
+                glActiveTexture(GL_TEXTURE1);
+                glBindTexture(GL_TEXTURE_2D, context.texture(gNormal));
+                glActiveTexture(GL_TEXTURE2);
+                glBindTexture(GL_TEXTURE_2D, context.texture(gAlbedo));
+                glActiveTexture(GL_TEXTURE3); // add extra SSAO texture to lighting pass
+                glBindTexture(GL_TEXTURE_2D, useSSAO ? context.texture(ao) : 0);
+                drawMesh(frameGeometry);
+
+                // 延迟结合正向渲染：复制gbuffer的深度信息到默认帧缓冲的深度缓冲
+                context.blit(gDepth, GL_DEPTH_BUFFER_BIT);
+
+                // 在场景之上渲染光源
+                shaderLightObj.use();
+                shaderLightObj.setMat4("projection", projection);
+                shaderLightObj.setMat4("view", view);
+
+                glm::mat4 model = glm::mat4(1.0f);
+                model = glm::translate(model, curLightPos);
+
+                shaderLightObj.setMat4("model", model);
+                shaderLightObj.setVec3("lightColor", curLightColor);
+
+                drawMesh(pointLightGeometry);
+            });
+
+        graph.compile();
+    };
+
     while (!glfwWindowShouldClose(window))
     {
         processInput(window);
@@ -280,130 +562,49 @@ int main()
             ImGui::Text("x: %.1f, y: %.1f, z: %.1f", camera.Position.x, camera.Position.y, camera.Position.z);
             ImGui::SliderFloat3("Light Position", lightPos, -15.0f, 15.0f);
             ImGui::SliderFloat3("Light Color", lightColor, 0.0f, 2.0f);
-            ImGui::Checkbox("SSAO", &useSSAO);
+            rebuildGraph |= ImGui::Checkbox("Compact G-Buffer", &compactGBuffer);
+            // 原来的布局：两张 RGBA16F + RGBA8 + 深度；紧凑布局：RG16 + RGBA8 + 深度
+            ImGui::Text("G-Buffer: %d B/px", compactGBuffer ? 4 + 4 + 4 : 8 + 8 + 4 + 4);
+            rebuildGraph |= ImGui::Checkbox("SSAO", &useSSAO);
+            rebuildGraph |= ImGui::Combo("AO Resolution", &aoResolution, "Full\0Half\0Quarter\0");
+            ImGui::Combo("Kernel Size", &kernelIndex, "8\0" "16\0" "32\0" "64\0");
+            rebuildGraph |= ImGui::Checkbox("Temporal Accumulation", &useTemporal);
+            if (useTemporal)
+            {
+                ImGui::SliderInt("History Frames", &temporalAO.maxFrames, 1, 32);
+                ImGui::SliderFloat("Depth Tolerance", &temporalAO.depthTolerance, 0.005f, 0.2f);
+            }
+            rebuildGraph |= ImGui::RadioButton("4x4 Blur", &ssaoBlurMode, 0); ImGui::SameLine();
+            rebuildGraph |= ImGui::RadioButton("Box", &ssaoBlurMode, 1); ImGui::SameLine();
+            rebuildGraph |= ImGui::RadioButton("Bilateral", &ssaoBlurMode, 2);
+            if (ssaoBlurMode != 0 && ssaoFilter.computeAvailable())
+                ImGui::Checkbox("Compute Shader", &ssaoFilter.useCompute);
+            // 名字里带 AO 的 pass 都算作 SSAO 的开销
+            float aoTime = 0.0f;
+            for (const RenderGraph::PassStats& pass : graph.stats())
+            {
+                ImGui::Text("%s: %s", pass.name.c_str(), pass.culled ? "culled" : std::format("{:.3f} ms", pass.ms).c_str());
+                if (pass.name.find("AO") != std::string::npos)
+                    aoTime += pass.ms;
+            }
+            ImGui::Text("SSAO total (GPU): %.3f ms", aoTime);
         ImGui::End();
 
-        glm::vec3 curLightPos(lightPos[0], lightPos[1], lightPos[2]);
-        glm::vec3 curLightColor(lightColor[0], lightColor[1], lightColor[2]);
-
-        // ------------------------------------------------------------
-        // 1. 几何阶段：将场景的几何/颜色数据渲染到 G-Buffer 中
-        // glClearColor(bgColor.x, bgColor.y, bgColor.z, 1.0);
-        glClearColor(0, 0, 0, 1.0);
-
-        glBindFramebuffer(GL_FRAMEBUFFER, gBuffer);
-        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+        // 最小化时帧缓冲大小为 0，保持原来的分配
+        if (framebufferWidth > 0 && framebufferHeight > 0
+            && (framebufferWidth != graph.getWidth() || framebufferHeight != graph.getHeight()))
+            rebuildGraph = true;
+        if (rebuildGraph)
+        {
+            buildGraph();
+            rebuildGraph = false;
+        }
 
-        glm::mat4 projection = glm::perspective(glm::radians(camera.Zoom), (float)SCREEN_WIDTH / (float)SCREEN_HEIGHT, 0.1f, 100.0f);
-        glm::mat4 view = camera.GetViewMatrix();
-        glm::mat4 model = glm::mat4(1.0f);
-
-        shaderGeometryPass.use();
-        shaderGeometryPass.setMat4("projection", projection);
-        shaderGeometryPass.setMat4("view", view);
-        
-        // 正方体房间
-        model = glm::mat4(1.0f);
-        model = glm::translate(model, glm::vec3(0.0, 7.0f, 0.0f));
-        shaderGeometryPass.setMat4("model", model);
-        shaderGeometryPass.setBool("invertedNormals", true); // 在房间内，反转法向量
-        glCullFace(GL_FRONT);
-        drawMesh(roomGeometry);
-        glCullFace(GL_BACK);
-        shaderGeometryPass.setBool("invertedNormals", false);
-
-        // 在地板上的背包
-        model = glm::mat4(1.0f);
-        model = glm::translate(model, glm::vec3(0.0f, 0.5f, 0.0));
-        model = glm::rotate(model, glm::radians(-90.0f), glm::vec3(1.0, 0.0, 0.0));
-        shaderGeometryPass.setMat4("model", model);
-        ourModel.Draw(shaderGeometryPass);
-
-        // ------------------------------------------------------------
-        // 2.生成 SSAO 贴图
-        glBindFramebuffer(GL_FRAMEBUFFER, ssaoFBO);
-        glClear(GL_COLOR_BUFFER_BIT);
-
-        shaderSSAO.use();
-        for (unsigned int i = 0; i < 64; ++i)
-            shaderSSAO.setVec3(std::format("samples[{}]", i), ssaoKernel[i]);
-        shaderSSAO.setMat4("projection", projection);
-
-        glActiveTexture(GL_TEXTURE0);
-        glBindTexture(GL_TEXTURE_2D, gPosition);
-
-        glActiveTexture(GL_TEXTURE1);
-        glBindTexture(GL_TEXTURE_2D, gNormal);
-
-        glActiveTexture(GL_TEXTURE2);
-        glBindTexture(GL_TEXTURE_2D, noiseTexture);
-        drawMesh(frameGeometry);
-
-        // ------------------------------------------------------------
-        // 3.模糊 SSAO 材质来去除噪声
-        glBindFramebuffer(GL_FRAMEBUFFER, ssaoBlurFBO);
-        glClear(GL_COLOR_BUFFER_BIT);
-        shaderSSAOBlur.use();
-        glActiveTexture(GL_TEXTURE0);
-        glBindTexture(GL_TEXTURE_2D, ssaoColorBuffer);
-        drawMesh(frameGeometry);
-
-        // ------------------------------------------------------------
-        // 4.光照阶段: 传统延迟布林冯光照 + SSAO
-        glBindFramebuffer(GL_FRAMEBUFFER, 0);
-        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-        shaderLightingPass.use();
-        shaderLightingPass.use();
-        shaderLightingPass.setBool("useSSAO", useSSAO);
-
-        glm::vec3 lightPosView = glm::vec3(camera.GetViewMatrix() * glm::vec4(curLightPos, 1.0));
-
-        shaderLightingPass.setVec3(std::format("pointLights[{}].position", 0), lightPosView);
-        shaderLightingPass.setVec3(std::format("pointLights[{}].ambient", 0), 0.3f, 0.3f, 0.3f);
-        shaderLightingPass.setVec3(std::format("pointLights[{}].diffuse", 0), curLightColor);
-        shaderLightingPass.setVec3(std::format("pointLights[{}].specular", 0), 0.1f, 0.1f, 0.1f);
-
-        const float constant = 1.0f; // note that we don't send this to the shader, we assume it is always 1.0 (in our case)
-        const float linear = 0.09f;
-        const float quadratic = 0.032f;
-        shaderLightingPass.setFloat(std::format("pointLights[{}].constant", 0), constant);
-        shaderLightingPass.setFloat(std::format("pointLights[{}].linear", 0), linear);
-        shaderLightingPass.setFloat(std::format("pointLights[{}].quadratic", 0), quadratic);
-
-        glActiveTexture(GL_TEXTURE0);
-        glBindTexture(GL_TEXTURE_2D, gPosition);
-        glActiveTexture(GL_TEXTURE1);
-        glBindTexture(GL_TEXTURE_2D, gNormal);
-        glActiveTexture(GL_TEXTURE2);
-        glBindTexture(GL_TEXTURE_2D, gAlbedo);
-        glActiveTexture(GL_TEXTURE3); // add extra SSAO texture to lighting pass
-        glBindTexture(GL_TEXTURE_2D, ssaoColorBufferBlur);
-        drawMesh(frameGeometry);
-
-        // ------------------------------------------------------------
-        // 4.5. 将几何阶段的深度缓冲区内容复制到默认帧缓冲区的深度缓冲区中
-        // 延迟结合正向渲染
-        glBindFramebuffer(GL_READ_FRAMEBUFFER, gBuffer);
-        glBindFramebuffer(GL_DRAW_FRAMEBUFFER, 0); // 指定默认的帧缓冲为写缓冲
-        // 复制gbuffer的深度信息到默认帧缓冲的深度缓冲
-        glBlitFramebuffer(0, 0, SCREEN_WIDTH, SCREEN_HEIGHT, 0, 0, SCREEN_WIDTH, SCREEN_HEIGHT, GL_DEPTH_BUFFER_BIT, GL_NEAREST);
-
-        // ------------------------------------------------------------
-        // 5. 在场景之上渲染光源
-        glBindFramebuffer(GL_FRAMEBUFFER, 0);
-
-        // 绘制灯光物体
-        shaderLightObj.use();
-        shaderLightObj.setMat4("projection", projection);
-        shaderLightObj.setMat4("view", view);
-
-        model = glm::mat4(1.0f);
-        model = glm::translate(model, curLightPos);
-
-        shaderLightObj.setMat4("model", model);
-        shaderLightObj.setVec3("lightColor", curLightColor);
-
-        drawMesh(pointLightGeometry);
+        curLightPos = glm::vec3(lightPos[0], lightPos[1], lightPos[2]);
+        curLightColor = glm::vec3(lightColor[0], lightColor[1], lightColor[2]);
+        projection = glm::perspective(glm::radians(camera.Zoom), (float)graph.getWidth() / (float)graph.getHeight(), 0.1f, 100.0f);
+        view = camera.GetViewMatrix();
+        graph.execute();
 
         // ImGui 渲染
         ImGui::Render();
@@ -413,6 +614,12 @@ int main()
         glfwPollEvents();
     }
 
+    ssaoFilter.dispose();
+    temporalAO.dispose();
+    graph.dispose();
+    glDeleteBuffers(1, &kernelUBO);
+    glDeleteTextures(1, &noiseTexture);
+
     glfwTerminate();
     return 0;
 }
@@ -1,7 +1,15 @@
 #version 330 core
+// 定义 COMPACT_GBUFFER 时使用紧凑布局：不写位置，法线八面体编码，高光和材质 ID 打包进 alpha
+#ifdef COMPACT_GBUFFER
+#include "gbuffer_packing.glsl"
+
+layout(location = 0) out vec2 gNormal;
+layout(location = 1) out vec4 gAlbedo;
+#else
 layout(location = 0) out vec3 gPosition;
 layout(location = 1) out vec3 gNormal;
 layout(location = 2) out vec3 gAlbedo;
+#endif
 
 in VS_OUT
 {
@@ -11,7 +19,12 @@ in VS_OUT
 } fs_in;
 
 void main() {
+	gAlbedo.rgb = vec3(0.95);
+#ifdef COMPACT_GBUFFER
+	gNormal = encodeNormal(normalize(fs_in.Normal));
+	gAlbedo.a = packSpecularMaterial(1.0, 0);
+#else
 	gPosition = fs_in.FragPos;
 	gNormal = normalize(fs_in.Normal);
-	gAlbedo.rgb = vec3(0.95);
-}
\ No newline at end of file
+#endif
+}
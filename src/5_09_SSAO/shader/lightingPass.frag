@@ -1,6 +1,13 @@
 #version 330 core
 out vec4 FragColor;
 
+// 定义 COMPACT_GBUFFER 时 gPosition 为深度缓冲，位置用 inverseProjection 重建，gNormal 为八面体编码
+#ifdef COMPACT_GBUFFER
+#include "gbuffer_packing.glsl"
+
+uniform mat4 inverseProjection;
+#endif
+
 // 定义材质结构体
 uniform sampler2D gPosition;
 uniform sampler2D gNormal;
@@ -28,14 +35,23 @@ uniform PointLight pointLights[NR_POINT_LIGHTS];
 uniform bool useSSAO;
 
 // 函数
-vec3 CalcPointLight(PointLight light, vec3 normal, vec3 fragPos, vec3 viewDir, vec3 Diffuse, float ambientOcclusion);
+vec3 CalcPointLight(PointLight light, vec3 normal, vec3 fragPos, vec3 viewDir, vec3 Diffuse, float Specular, float ambientOcclusion);
 
 void main()
 {
     // 属性
+#ifdef COMPACT_GBUFFER
+    vec4 AlbedoSpec = texture(gAlbedo, TexCoords);
+    vec3 FragPos = reconstructPosition(TexCoords, texture(gPosition, TexCoords).r, inverseProjection);
+    vec3 Normal = decodeNormal(texture(gNormal, TexCoords).rg);
+    vec3 Diffuse = AlbedoSpec.rgb;
+    float Specular = unpackSpecular(AlbedoSpec.a);
+#else
     vec3 FragPos = texture(gPosition, TexCoords).rgb;
     vec3 Normal = texture(gNormal, TexCoords).rgb;
     vec3 Diffuse = texture(gAlbedo, TexCoords).rgb;
+    float Specular = 1.0f;
+#endif
     float AmbientOcclusion = useSSAO ? texture(ssao, TexCoords).r : 1.0f;
 
     vec3 viewDir = normalize(-FragPos);
@@ -43,13 +59,13 @@ void main()
     vec3 result = vec3(0.0f);
     for (int i = 0; i < NR_POINT_LIGHTS; i++)
     {
-        result += CalcPointLight(pointLights[i], Normal, FragPos, viewDir, Diffuse, AmbientOcclusion);
+        result += CalcPointLight(pointLights[i], Normal, FragPos, viewDir, Diffuse, Specular, AmbientOcclusion);
     }
 
     FragColor = vec4(result, 1.0f);
 }
 
-vec3 CalcPointLight(PointLight light, vec3 normal, vec3 fragPos, vec3 viewDir, vec3 Diffuse, float ambientOcclusion)
+vec3 CalcPointLight(PointLight light, vec3 normal, vec3 fragPos, vec3 viewDir, vec3 Diffuse, float Specular, float ambientOcclusion)
 {
     vec3 lightDir = normalize(light.position - fragPos);
 
@@ -63,7 +79,7 @@ vec3 CalcPointLight(PointLight light, vec3 normal, vec3 fragPos, vec3 viewDir, v
     // 镜面反射
     vec3 halfwayDir = normalize(lightDir + viewDir);
     float spec = pow(max(dot(normal, halfwayDir), 0.0), shininess);
-    vec3 specular = light.specular * spec;
+    vec3 specular = light.specular * (spec * Specular);
     
     // 衰减
     float distance = length(light.position - fragPos);
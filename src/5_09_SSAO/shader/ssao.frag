@@ -3,41 +3,58 @@ out float FragColor;
 
 in vec2 TexCoords;
 
+// 半分辨率 / 四分之一分辨率时为降采样后的位置和法线
 uniform sampler2D gPosition;
 uniform sampler2D gNormal;
 uniform sampler2D texNoise;
 
-uniform vec3 samples[64];
+// 采样数作为编译期常量，由 C++ 端通过 defines 选择 8 / 16 / 32 / 64
+#ifndef KERNEL_SIZE
+#define KERNEL_SIZE 64
+#endif
+
+// 采样核只在启动时上传一次
+layout (std140) uniform SSAOKernel
+{
+    vec4 samples[KERNEL_SIZE];
+};
 
 // 参数
-int kernelSize = 64;
 float radius = 0.5f;
 float bias = 0.025f;
 
-// 根据屏幕尺寸除以噪声大小在屏幕上平铺纹理
-const vec2 noiseScale = vec2(1280.0f / 4.0f, 720.0f / 4.0f);
-
 uniform mat4 projection;
+// 时间累积时每帧不同，用来旋转采样核；不累积时为 0
+uniform int frameIndex;
 
 void main()
 {
+    // 根据目标尺寸除以噪声大小在屏幕上平铺纹理
+    vec2 noiseScale = vec2(textureSize(gPosition, 0)) / 4.0f;
+
     // 获取SSAO算法的输入
     vec3 fragPos = texture(gPosition, TexCoords).xyz;
     vec3 normal = normalize(texture(gNormal, TexCoords).rgb);
-    vec3 randomVec = normalize(texture(texNoise, TexCoords * noiseScale).xyz);
+    // 噪声纹理每帧错开一个像素，16 帧走完 4x4 的所有偏移
+    vec2 noiseOffset = vec2(frameIndex % 4, (frameIndex / 4) % 4) / 4.0f;
+    vec3 randomVec = normalize(texture(texNoise, TexCoords * noiseScale + noiseOffset).xyz);
 
     // 创建 TBN
     // 从切线空间转换到视图空间
     vec3 tangent = normalize(randomVec - normal * dot(randomVec, normal));
     vec3 bitangent = cross(normal, tangent);
+    // 再绕法线转一个黄金角，相邻帧的采样方向尽量不重复
+    float angle = float(frameIndex) * 2.39996323f;
+    tangent = cos(angle) * tangent + sin(angle) * bitangent;
+    bitangent = cross(normal, tangent);
     mat3 TBN = mat3(tangent, bitangent, normal);
 
     // 计算遮挡因子
     float occlusion = 0.0f;
-    for (int i = 0; i < kernelSize; ++i)
+    for (int i = 0; i < KERNEL_SIZE; ++i)
     {
         // 获取该样本的位置
-        vec3 samplePos = TBN * samples[i]; // 从切线空间到视图空间
+        vec3 samplePos = TBN * samples[i].xyz; // 从切线空间到视图空间
         samplePos = fragPos + samplePos * radius;
 
         // 投影样本位置并且采样纹理，获取纹理上的位置
@@ -54,7 +71,7 @@ void main()
         float rangeCheck = smoothstep(0.0f, 1.0f, radius / abs(fragPos.z - sampleDepth));
         occlusion += (sampleDepth >= samplePos.z + bias ? 1.0f : 0.0f) * rangeCheck;
     }
-    occlusion = 1.0f - (occlusion / kernelSize);
+    occlusion = 1.0f - (occlusion / KERNEL_SIZE);
 
     FragColor = occlusion;
-}
\ No newline at end of file
+}
@@ -0,0 +1,60 @@
+#version 330 core
+layout(location = 0) out vec4 aoPosition;
+layout(location = 1) out vec4 aoNormal;
+
+// 定义 COMPACT_GBUFFER 时 gPosition 为深度缓冲、gNormal 为八面体编码，这里顺便解码成 AO 用的观察空间位置和法线
+uniform sampler2D gPosition;
+uniform sampler2D gNormal;
+
+// 全分辨率和 AO 分辨率之比（紧凑布局时可以为 1，只解码）
+uniform int factor;
+
+#ifdef COMPACT_GBUFFER
+#include "gbuffer_packing.glsl"
+
+uniform mat4 inverseProjection;
+
+vec3 fetchPosition(ivec2 pixel)
+{
+    return reconstructPosition(gPosition, pixel, inverseProjection);
+}
+
+vec3 fetchNormal(ivec2 pixel)
+{
+    return decodeNormal(texelFetch(gNormal, pixel, 0).rg);
+}
+#else
+vec3 fetchPosition(ivec2 pixel)
+{
+    return texelFetch(gPosition, pixel, 0).xyz;
+}
+
+vec3 fetchNormal(ivec2 pixel)
+{
+    return texelFetch(gNormal, pixel, 0).xyz;
+}
+#endif
+
+// 在 factor x factor 的范围内取离摄像机最近的一个像素，位置和法线取自同一个像素，
+// 不做平均，避免物体边缘处混出一个不存在的深度
+void main()
+{
+    ivec2 base = ivec2(gl_FragCoord.xy) * factor;
+    ivec2 best = base;
+    float bestDepth = -1.0e30f;
+    for (int y = 0; y < factor; ++y)
+    {
+        for (int x = 0; x < factor; ++x)
+        {
+            // 观察空间中 z 为负，越大越近
+            float z = fetchPosition(base + ivec2(x, y)).z;
+            if (z > bestDepth)
+            {
+                bestDepth = z;
+                best = base + ivec2(x, y);
+            }
+        }
+    }
+    aoPosition = vec4(fetchPosition(best), 1.0f);
+    aoNormal = vec4(fetchNormal(best), 0.0f);
+}
@@ -0,0 +1,57 @@
+#version 330 core
+out float FragColor;
+
+// 低分辨率的 AO 以及计算它时用的位置 / 法线
+uniform sampler2D aoInput;
+uniform sampler2D aoPosition;
+uniform sampler2D aoNormal;
+// 全分辨率的 G-Buffer，定义 COMPACT_GBUFFER 时 gPosition 为深度缓冲、gNormal 为八面体编码
+uniform sampler2D gPosition;
+uniform sampler2D gNormal;
+
+#ifdef COMPACT_GBUFFER
+#include "gbuffer_packing.glsl"
+
+uniform mat4 inverseProjection;
+#endif
+
+// 深度容差，相对于像素到摄像机的距离
+uniform float depthTolerance = 0.05f;
+
+// 联合双边升采样：在双线性插值的 4 个低分辨率像素上，再乘以深度和法线的相似度，
+// 跨越物体边缘的低分辨率像素几乎不参与插值，边缘不会出现光晕
+void main()
+{
+    ivec2 pixel = ivec2(gl_FragCoord.xy);
+#ifdef COMPACT_GBUFFER
+    vec3 position = reconstructPosition(gPosition, pixel, inverseProjection);
+    vec3 normal = decodeNormal(texelFetch(gNormal, pixel, 0).rg);
+#else
+    vec3 position = texelFetch(gPosition, pixel, 0).xyz;
+    vec3 normal = texelFetch(gNormal, pixel, 0).xyz;
+#endif
+
+    ivec2 lowSize = textureSize(aoInput, 0);
+    vec2 lowCoord = (vec2(pixel) + 0.5f) * vec2(lowSize) / vec2(textureSize(gPosition, 0)) - 0.5f;
+    ivec2 base = ivec2(floor(lowCoord));
+    vec2 f = fract(lowCoord);
+
+    float tolerance = depthTolerance * max(abs(position.z), 0.1f);
+    float result = 0.0f;
+    float total = 0.0f;
+    for (int i = 0; i < 4; ++i)
+    {
+        ivec2 offset = ivec2(i & 1, i >> 1);
+        ivec2 q = clamp(base + offset, ivec2(0), lowSize - 1);
+
+        vec2 bilinear = mix(1.0f - f, f, vec2(offset));
+        float depthWeight = exp(-abs(texelFetch(aoPosition, q, 0).z - position.z) / tolerance);
+        float normalWeight = pow(max(dot(texelFetch(aoNormal, q, 0).xyz, normal), 0.0f), 8.0f);
+        // 加一个很小的值，四个都被拒绝时退化成双线性
+        float w = bilinear.x * bilinear.y * depthWeight * normalWeight + 1.0e-4f;
+
+        result += texelFetch(aoInput, q, 0).r * w;
+        total += w;
+    }
+    FragColor = result / total;
+}
@@ -0,0 +1,456 @@
+#define STB_IMAGE_IMPLEMENTATION
+
+#include <glad/glad.h>
+#include <GLFW/glfw3.h>
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/type_ptr.hpp>
+#include <imgui/imgui.h>
+#include <imgui/imgui_impl_glfw.h>
+#include <imgui/imgui_impl_opengl3.h>
+#include <geometry/BoxGeometry.h>
+#include <tools/shader.h>
+#include <tools/stb_image.h>
+#include <tools/camera.h>
+#include <tools/mesh.h>
+#include <tools/model.h>
+#include <tools/animation.h>
+#include <tools/thread_pool.h>
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include <memory>
+#include <chrono>
+#include <random>
+
+static void processInput(GLFWwindow* window);
+static void keyCallback(GLFWwindow* window, int key, int scancode, int action, int mods);
+static void mouseCallback(GLFWwindow* window, double posX, double posY);
+
+// 程序生成的角色：一根分成 BONE_COUNT 节的柱子，每节一根骨骼，像触手一样摆动
+struct ProceduralCharacter
+{
+    Skeleton skeleton;
+    std::vector<AnimationClip> clips;
+    std::unique_ptr<BasicMesh<LitVertexLayout>> mesh;
+};
+
+struct AnimationBenchmark
+{
+    size_t instances;
+    size_t bones;
+    unsigned int threads;
+    float scalarMs;     // 单线程，glm::slerp
+    float simdMs;       // 单线程，SSE slerp
+    float pooledMs;     // 线程池，SSE slerp
+};
+
+static ProceduralCharacter createCharacter();
+static AnimationBenchmark benchmarkAnimation(const Skeleton& skeleton, const std::vector<AnimationClip>& clips, size_t instanceCount, ThreadPool& pool);
+
+const unsigned int SCREEN_WIDTH = 1280;
+const unsigned int SCREEN_HEIGHT = 720;
+const int BONE_COUNT = 16;
+const float CHARACTER_HEIGHT = 4.0f;
+const size_t INSTANCE_COUNT = 1000;
+const int COLUMNS = 40;
+
+// 摄像机
+Camera camera(glm::vec3(0.0f, 12.0f, 45.0f));
+float lastX = SCREEN_WIDTH / 2.0f;
+float lastY = SCREEN_HEIGHT / 2.0f;
+bool isFirstMouse = true;
+bool isMouseCaptured = true; // 初始为捕获状态（隐藏鼠标，控制视角）
+
+// 时机
+float deltaTime = 0.0f; // 当前帧与上一帧的时间差
+float prevFrameTime = 0.0f; // 上一针的时间
+
+// 用法：8_01_SkeletalAnimation [带骨骼动画的模型路径]，不传时用程序生成的角色
+int main(int argc, char* argv[])
+{
+    const char* glslVersion = "#version 330";
+
+    glfwInit();
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+    glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+
+    // 这是创建的窗口
+    GLFWwindow* window = glfwCreateWindow(SCREEN_WIDTH, SCREEN_HEIGHT, "LearnOpenGL", nullptr, nullptr);
+    if (window == nullptr)
+    {
+        std::cout << "Failed to create GLFW window" << std::endl;
+        glfwTerminate();
+        return -1;
+    }
+    glfwMakeContextCurrent(window);
+    if (!gladLoadGLLoader(reinterpret_cast<GLADloadproc>(glfwGetProcAddress)))
+    {
+        std::cout << "Failed to initialize GLAD" << std::endl;
+        return -1;
+    }
+    /*
+        回调函数注册
+        1.注册窗口变化监听
+        2.注册鼠标事件
+    */
+    glfwSetFramebufferSizeCallback(window, [](GLFWwindow* window, int width, int height)
+        {
+            glViewport(0, 0, width, height);
+        });
+
+    glfwSetKeyCallback(window, keyCallback);
+    glfwSetCursorPosCallback(window, mouseCallback);
+
+    glfwSetScrollCallback(window, [](GLFWwindow* window, double offsetX, double offsetY)
+        {
+            camera.ProcessMouseScroll(static_cast<float>(offsetY));
+        });
+    glfwSetInputMode(window, GLFW_CURSOR, GLFW_CURSOR_DISABLED);
+
+    // ------------------------------------------------------------
+    // 创建 imgui 上下文
+    ImGui::CreateContext();
+
+    // 设置样式
+    ImGui::StyleColorsDark();
+    // 设置平台和渲染器
+    ImGui_ImplGlfw_InitForOpenGL(window, true);
+    ImGui_ImplOpenGL3_Init(glslVersion);
+    // ------------------------------------------------------------
+
+    // 设置视口
+    // 从左下到右上
+    // 这是渲染窗口
+    glViewport(0, 0, SCREEN_WIDTH, SCREEN_HEIGHT);
+    glEnable(GL_DEPTH_TEST);
+
+    ImVec4 bgColor = ImVec4(0.12f, 0.12f, 0.15f, 1.0f);
+
+    Shader skinnedShader(SHADER_DIR "/skinned.vert", SHADER_DIR "/skinned.frag");
+
+    // 传了模型路径且模型带骨骼和动画时画模型里有蒙皮的网格，否则画程序生成的角色
+    ProceduralCharacter character = createCharacter();
+    std::unique_ptr<BasicModel<LitVertexLayout>> animatedModel;
+    if (argc > 1)
+    {
+        animatedModel = std::make_unique<BasicModel<LitVertexLayout>>(argv[1]);
+        if (animatedModel->skeleton.boneCount() == 0 || animatedModel->animations.empty())
+        {
+            std::cout << "ERROR::ANIMATION:: " << argv[1] << " has no skeletal animation, using the procedural character" << std::endl;
+            animatedModel.reset();
+        }
+    }
+    const Skeleton& skeleton = animatedModel ? animatedModel->skeleton : character.skeleton;
+    const std::vector<AnimationClip>& clips = animatedModel ? animatedModel->animations : character.clips;
+    std::vector<BasicMesh<LitVertexLayout>*> skinnedMeshes;
+    if (animatedModel)
+    {
+        for (auto& mesh : animatedModel->meshes)
+            if (!mesh.skin.empty())
+                skinnedMeshes.push_back(&mesh);
+    }
+    else
+    {
+        skinnedMeshes.push_back(character.mesh.get());
+    }
+    // 模型的尺寸各不相同，缩放到和程序生成的角色差不多高
+    float modelScale = 1.0f;
+    if (animatedModel)
+    {
+        float height = 0.0f;
+        for (const auto* mesh : skinnedMeshes)
+            for (const Vertex& vertex : mesh->vertices)
+                height = glm::max(height, glm::abs(vertex.Position.y));
+        modelScale = height > 0.0f ? CHARACTER_HEIGHT / height : 1.0f;
+    }
+
+    // 每个实例随机选一个动画，随机的起始时间和播放速度
+    SkeletonAnimator animator(skeleton, clips, INSTANCE_COUNT);
+    std::mt19937 random(7);
+    std::uniform_real_distribution<float> startTime(0.0f, 10.0f);
+    std::uniform_real_distribution<float> speed(0.5f, 1.5f);
+    for (SkeletonAnimator::Instance& instance : animator.instances)
+    {
+        instance.clip = static_cast<int>(random() % clips.size());
+        instance.time = startTime(random);
+        instance.speed = speed(random);
+    }
+
+    ThreadPool pool;
+    BonePaletteBuffer paletteBuffer;
+    bool useThreadPool = true;
+    float updateMs = 0.0f;
+    float uploadMs = 0.0f;
+    std::vector<AnimationBenchmark> animationBenchmarks;
+
+    while (!glfwWindowShouldClose(window))
+    {
+        processInput(window);
+
+        float currentFrameTime = static_cast<float>(glfwGetTime());
+        deltaTime = currentFrameTime - prevFrameTime;
+        prevFrameTime = currentFrameTime;
+
+        // 开始 ImGui 帧
+        ImGui_ImplOpenGL3_NewFrame();
+        ImGui_ImplGlfw_NewFrame();
+        ImGui::NewFrame();
+
+        ImGui::Begin("ImGui");
+            ImGui::Text("ESC: Exit  L: Lock/Unlock Cursor");
+            ImGui::Text("WASD: Movement  Space: Up  LCtrl: Down");
+            ImGui::Text("%.3f ms/frame (%.1f FPS)", 1000.0f / ImGui::GetIO().Framerate, ImGui::GetIO().Framerate);
+            ImGui::Text("FOV: %.1f", camera.Zoom);
+            ImGui::Text("x: %.1f, y: %.1f, z: %.1f", camera.Position.x, camera.Position.y, camera.Position.z);
+            ImGui::Text("%s: %zu instances x %zu bones, %zu clips", animatedModel ? argv[1] : "Procedural character",
+                        animator.instances.size(), animator.boneCount(), clips.size());
+            ImGui::Checkbox("Thread Pool", &useThreadPool);
+            ImGui::SameLine();
+            ImGui::Text("(%u threads)", pool.size());
+            ImGui::Checkbox("SIMD Slerp", &animator.simdSlerp);
+            ImGui::Text("Sampling: %.3f ms, palette upload: %.3f ms (%.1f KB)", updateMs, uploadMs, paletteBuffer.bytes() / 1024.0f);
+            if (ImGui::Button("Benchmark Animation Sampling"))
+                animationBenchmarks = { benchmarkAnimation(skeleton, clips, INSTANCE_COUNT, pool) };
+            for (const AnimationBenchmark& result : animationBenchmarks)
+            {
+                ImGui::Text("%zu x %zu bones: glm::slerp %.3f ms, SIMD %.3f ms", result.instances, result.bones, result.scalarMs, result.simdMs);
+                ImGui::Text("SIMD + %u threads: %.3f ms", result.threads, result.pooledMs);
+            }
+        ImGui::End();
+
+        // ------------------------------------------------------------
+        // 动画采样，骨骼矩阵整体上传到纹理缓冲
+        auto updateStart = std::chrono::steady_clock::now();
+        animator.update(deltaTime, useThreadPool ? &pool : nullptr);
+        auto uploadStart = std::chrono::steady_clock::now();
+        paletteBuffer.upload(animator.palettes);
+        auto uploadEnd = std::chrono::steady_clock::now();
+        updateMs = std::chrono::duration<float, std::milli>(uploadStart - updateStart).count();
+        uploadMs = std::chrono::duration<float, std::milli>(uploadEnd - uploadStart).count();
+
+        // ------------------------------------------------------------
+        // 渲染指令
+        glClearColor(bgColor.x, bgColor.y, bgColor.z, bgColor.w);
+        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+        glm::mat4 projection = glm::perspective(glm::radians(camera.Zoom), (float)SCREEN_WIDTH / (float)SCREEN_HEIGHT, 0.1f, 300.0f);
+        glm::mat4 view = camera.GetViewMatrix();
+
+        skinnedShader.use();
+        skinnedShader.setMat4("projection", projection);
+        skinnedShader.setMat4("view", view);
+        skinnedShader.setMat4("model", glm::scale(glm::mat4(1.0f), glm::vec3(modelScale)));
+        skinnedShader.setInt("bonePalette", 0);
+        skinnedShader.setInt("boneCount", static_cast<int>(animator.boneCount()));
+        skinnedShader.setInt("columns", COLUMNS);
+        skinnedShader.setFloat("spacing", 1.5f);
+        skinnedShader.setVec3("lightDir", glm::vec3(-0.3f, -1.0f, -0.4f));
+        skinnedShader.setVec3("viewPos", camera.Position);
+        paletteBuffer.bind(0);
+
+        // 所有实例一次画完，实例号决定骨骼矩阵的位置和网格中的位置
+        for (auto* mesh : skinnedMeshes)
+        {
+            glBindVertexArray(mesh->VAO);
+            glDrawElementsInstanced(GL_TRIANGLES, static_cast<GLsizei>(mesh->indices.size()), GL_UNSIGNED_INT, 0, static_cast<GLsizei>(animator.instances.size()));
+        }
+        glBindVertexArray(0);
+
+        // ImGui 渲染
+        ImGui::Render();
+        ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
+
+        glfwSwapBuffers(window);
+        glfwPollEvents();
+    }
+
+    // 资源释放
+    paletteBuffer.dispose();
+    glDeleteProgram(skinnedShader.ID);
+
+    glfwTerminate();
+    return 0;
+}
+
+void processInput(GLFWwindow* window)
+{
+    if (glfwGetKey(window, GLFW_KEY_ESCAPE) == GLFW_PRESS)
+        glfwSetWindowShouldClose(window, true);
+
+    std::unordered_set<Camera_Movement> operations{};
+
+    if (glfwGetKey(window, GLFW_KEY_W) == GLFW_PRESS)
+        operations.insert(Camera_Movement::FORWARD);
+    if (glfwGetKey(window, GLFW_KEY_S) == GLFW_PRESS)
+        operations.insert(Camera_Movement::BACKWARD);
+    if (glfwGetKey(window, GLFW_KEY_A) == GLFW_PRESS)
+        operations.insert(Camera_Movement::LEFT);
+    if (glfwGetKey(window, GLFW_KEY_D) == GLFW_PRESS)
+        operations.insert(Camera_Movement::RIGHT);
+    if (glfwGetKey(window, GLFW_KEY_SPACE) == GLFW_PRESS)
+        operations.insert(Camera_Movement::UP);
+    if (glfwGetKey(window, GLFW_KEY_LEFT_CONTROL) == GLFW_PRESS)
+        operations.insert(Camera_Movement::DOWN);
+
+    camera.ProcessKeyboard(operations, deltaTime);
+}
+
+void keyCallback(GLFWwindow* window, int key, int scancode, int action, int mods)
+{
+    if (key == GLFW_KEY_L && action == GLFW_RELEASE)
+    {
+        isMouseCaptured = !isMouseCaptured;
+        if (isMouseCaptured)
+        {
+            glfwSetInputMode(window, GLFW_CURSOR, GLFW_CURSOR_DISABLED);
+            isFirstMouse = true;
+        }
+        else
+        {
+            glfwSetInputMode(window, GLFW_CURSOR, GLFW_CURSOR_NORMAL);
+        }
+    }
+}
+
+void mouseCallback(GLFWwindow* window, double posXIn, double posYIn)
+{
+    if (!isMouseCaptured)
+        return; // 如果鼠标未被捕获（即已释放），不处理视角移动
+
+    float posX = static_cast<float>(posXIn);
+    float posY = static_cast<float>(posYIn);
+
+    if (isFirstMouse)
+    {
+        lastX = posX;
+        lastY = posY;
+        isFirstMouse = false;
+    }
+
+    float offsetX = posX - lastX;
+    float offsetY = lastY - posY;
+
+    lastX = posX;
+    lastY = posY;
+
+    camera.ProcessMouseMovement(offsetX, offsetY);
+}
+
+/*
+    骨骼 i 的节点在柱子上 i * segment 的高度，子节点相对父节点向上平移 segment
+    每个顶点由最近的两根骨骼按高度线性混合；两个动画：左右摇摆、绕两个轴画圈，每根骨骼的相位依次落后
+*/
+ProceduralCharacter createCharacter()
+{
+    ProceduralCharacter character;
+    const float segment = CHARACTER_HEIGHT / BONE_COUNT;
+
+    TransformGraph nodes;
+    int parent = -1;
+    for (int i = 0; i < BONE_COUNT; ++i)
+    {
+        std::string name = "bone" + std::to_string(i);
+        glm::mat4 local = glm::translate(glm::mat4(1.0f), glm::vec3(0.0f, i == 0 ? 0.0f : segment, 0.0f));
+        parent = nodes.addNode(parent, local, name);
+        // 绑定姿势下骨骼的世界矩阵的逆
+        character.skeleton.addBone(name, glm::translate(glm::mat4(1.0f), glm::vec3(0.0f, -i * segment, 0.0f)));
+    }
+    character.skeleton.setHierarchy(nodes);
+
+    const int keyCount = 33;
+    const float duration = 32.0f;
+    const char* clipNames[] = { "Sway", "Circle" };
+    for (int c = 0; c < 2; ++c)
+    {
+        AnimationClip clip;
+        clip.name = clipNames[c];
+        clip.duration = duration;
+        clip.ticksPerSecond = 16.0f;
+        for (int bone = 0; bone < BONE_COUNT; ++bone)
+        {
+            AnimationChannel channel;
+            channel.node = character.skeleton.boneNodes[bone];
+            channel.positionTimes = { 0.0f };
+            channel.positions = { glm::vec3(nodes.locals[channel.node][3]) };
+            for (int k = 0; k < keyCount; ++k)
+            {
+                float phase = glm::two_pi<float>() * k / (keyCount - 1) - bone * 0.35f;
+                float amplitude = bone == 0 ? 0.0f : 0.18f;
+                glm::quat rotation = glm::angleAxis(amplitude * glm::sin(phase), glm::vec3(0.0f, 0.0f, 1.0f));
+                if (c == 1)
+                    rotation = rotation * glm::angleAxis(amplitude * glm::cos(phase), glm::vec3(1.0f, 0.0f, 0.0f));
+                channel.rotationTimes.push_back(duration * k / (keyCount - 1));
+                channel.rotations.push_back(rotation);
+            }
+            clip.channels.push_back(std::move(channel));
+        }
+        character.clips.push_back(std::move(clip));
+    }
+
+    // 盒子以原点为中心，移到 [0, CHARACTER_HEIGHT]
+    BasicBoxGeometry<LitVertexLayout> box(0.35f, CHARACTER_HEIGHT, 0.35f, 1.0f, BONE_COUNT * 3.0f, 1.0f);
+    std::vector<Vertex> vertices = box.vertices;
+    std::vector<SkinVertex> skin(vertices.size());
+    for (size_t i = 0; i < vertices.size(); ++i)
+    {
+        vertices[i].Position.y += CHARACTER_HEIGHT * 0.5f;
+        // 骨骼 b 的中心在 (b + 0.5) * segment
+        float u = vertices[i].Position.y / segment - 0.5f;
+        int bone = glm::clamp(static_cast<int>(glm::floor(u)), 0, BONE_COUNT - 2);
+        float weight = glm::clamp(u - bone, 0.0f, 1.0f);
+        // 量化后两个权重之和仍然正好是 65535
+        std::uint16_t upper = static_cast<std::uint16_t>(std::lround(weight * 65535.0f));
+        skin[i] = { { static_cast<std::uint8_t>(bone), static_cast<std::uint8_t>(bone + 1), 0, 0 },
+                    { static_cast<std::uint16_t>(65535 - upper), upper, 0, 0 } };
+    }
+    character.mesh = std::make_unique<BasicMesh<LitVertexLayout>>(vertices, box.indices, std::vector<Texture>{});
+    character.mesh->setSkin(std::move(skin));
+    box.dispose();
+    return character;
+}
+
+// 同样的实例分别用 glm::slerp、SSE slerp、SSE slerp + 线程池各采样 runs 帧
+AnimationBenchmark benchmarkAnimation(const Skeleton& skeleton, const std::vector<AnimationClip>& clips, size_t instanceCount, ThreadPool& pool)
+{
+    using Clock = std::chrono::steady_clock;
+    const int runs = 60;
+    const float frameTime = 1.0f / 60.0f;
+
+    SkeletonAnimator animator(skeleton, clips, instanceCount);
+    std::mt19937 random(42);
+    for (SkeletonAnimator::Instance& instance : animator.instances)
+    {
+        instance.clip = static_cast<int>(random() % clips.size());
+        instance.time = static_cast<float>(random() % 1000) / 100.0f;
+    }
+
+    auto measure = [&](bool simdSlerp, ThreadPool* threads)
+        {
+            animator.simdSlerp = simdSlerp;
+            auto start = Clock::now();
+            for (int i = 0; i < runs; ++i)
+                animator.update(frameTime, threads);
+            return std::chrono::duration<float, std::milli>(Clock::now() - start).count() / runs;
+        };
+
+    AnimationBenchmark result{ instanceCount, animator.boneCount(), pool.size(), 0.0f, 0.0f, 0.0f };
+    result.scalarMs = measure(false, nullptr);
+    result.simdMs = measure(true, nullptr);
+    result.pooledMs = measure(true, &pool);
+
+    // 三次采样的时间点不同，只对比同一时刻：再用 glm::slerp 采一帧，SIMD 的结果应该很接近
+    std::vector<glm::mat4> simd = animator.palettes;
+    animator.simdSlerp = false;
+    animator.update(0.0f, &pool);
+    float maxError = 0.0f;
+    for (size_t i = 0; i < simd.size(); ++i)
+        maxError = glm::max(maxError, glm::length(glm::vec3(simd[i][3] - animator.palettes[i][3])));
+
+    std::cout << "Animation sampling (" << result.instances << " x " << result.bones << " bones): glm::slerp " << result.scalarMs
+              << " ms, SIMD " << result.simdMs << " ms, SIMD + " << result.threads << " threads " << result.pooledMs
+              << " ms, max SIMD error " << maxError << std::endl;
+    return result;
+}
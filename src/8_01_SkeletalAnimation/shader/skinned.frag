@@ -0,0 +1,21 @@
+#version 330 core
+out vec4 FragColor;
+
+in vec3 Normal;
+in vec3 FragPos;
+in float Tint;
+
+uniform vec3 lightDir;
+uniform vec3 viewPos;
+
+void main()
+{
+    vec3 baseColor = mix(vec3(0.9f, 0.45f, 0.3f), vec3(0.3f, 0.6f, 0.9f), Tint);
+    vec3 normal = normalize(Normal);
+    vec3 toLight = normalize(-lightDir);
+    vec3 halfway = normalize(toLight + normalize(viewPos - FragPos));
+
+    float diffuse = max(dot(normal, toLight), 0.0f);
+    float specular = pow(max(dot(normal, halfway), 0.0f), 32.0f);
+    FragColor = vec4(baseColor * (0.15f + diffuse) + vec3(0.3f) * specular, 1.0f);
+}
@@ -0,0 +1,36 @@
+#version 330 core
+layout (location = 0) in vec3 aPos;
+layout (location = 1) in vec3 aNormal;
+// 蒙皮数据（SkinVertexLayout），第二个顶点缓冲
+layout (location = 5) in uvec4 aBoneIDs;
+layout (location = 6) in vec4 aBoneWeights;
+
+#include "skinning.glsl"
+
+out vec3 Normal;
+out vec3 FragPos;
+out float Tint;
+
+uniform mat4 projection;
+uniform mat4 view;
+uniform mat4 model;
+// 所有实例的骨骼矩阵，实例 gl_InstanceID 从 gl_InstanceID * boneCount 开始
+uniform samplerBuffer bonePalette;
+uniform int boneCount;
+// 实例按 columns 列排成网格，间距 spacing
+uniform int columns;
+uniform float spacing;
+
+void main()
+{
+    mat4 skin = skinMatrix(bonePalette, gl_InstanceID * boneCount, aBoneIDs, aBoneWeights);
+    vec2 cell = vec2(gl_InstanceID % columns, gl_InstanceID / columns) - vec2(columns - 1, 0.0f) * 0.5f;
+    vec4 worldPos = model * skin * vec4(aPos, 1.0f);
+    worldPos.xz += cell * spacing;
+
+    FragPos = worldPos.xyz;
+    // 骨骼矩阵只有旋转和等比缩放时可以直接变换法线
+    Normal = mat3(model) * mat3(skin) * aNormal;
+    Tint = fract(float(gl_InstanceID) * 0.618034f);
+    gl_Position = projection * view * worldPos;
+}
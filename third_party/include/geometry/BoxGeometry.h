@@ -2,7 +2,8 @@
 
 #include <geometry/BufferGeometry.h>
 
-class BoxGeometry : public BufferGeometry
+template <typename Layout = FullVertexLayout>
+class BasicBoxGeometry : public BufferGeometry
 {
 public:
   float width;
@@ -10,12 +11,12 @@ public:
   float widthSegments;
   float heightSegments;
   float depthSegments;
-  BoxGeometry(float width = 1.0f, float height = 1.0f, float depth = 1.0, float widthSegments = 1.0f, float heightSegments = 1.0f, float depthSegments = 1.0f)
+  BasicBoxGeometry(float width = 1.0f, float height = 1.0f, float depth = 1.0, float widthSegments = 1.0f, float heightSegments = 1.0f, float depthSegments = 1.0f)
   {
 
-    widthSegments = glm::floor(widthSegments);
-    heightSegments = glm::floor(heightSegments);
-    depthSegments = glm::floor(depthSegments);
+    widthSegments = glm::max(1.0f, glm::floor(widthSegments));
+    heightSegments = glm::max(1.0f, glm::floor(heightSegments));
+    depthSegments = glm::max(1.0f, glm::floor(depthSegments));
 
     this->width = width;
     this->height = height;
@@ -23,6 +24,15 @@ public:
     this->heightSegments = heightSegments;
     this->depthSegments = depthSegments;
 
+    this->useCache("Box", { width, height, depth, widthSegments, heightSegments, depthSegments }, Layout::mask);
+
+    // 六个面的顶点和索引数量，一次分配好，每个面写到自己的那一段
+    const size_t w = static_cast<size_t>(widthSegments);
+    const size_t h = static_cast<size_t>(heightSegments);
+    const size_t d = static_cast<size_t>(depthSegments);
+    this->vertices.resize(2 * ((d + 1) * (h + 1) + (w + 1) * (d + 1) + (w + 1) * (h + 1)));
+    this->indices.resize(12 * (d * h + w * d + w * h));
+
     /**
      * 三分量对应
      * vec3(u, v, w)
@@ -39,12 +49,12 @@ public:
     this->buildPlane(0, 1, 2, 1, -1, width, height, depth, widthSegments, heightSegments, 4);   // pz
     this->buildPlane(0, 1, 2, -1, -1, width, height, -depth, widthSegments, heightSegments, 5); // nz
 
-    this->setupBuffers();
+    this->template setupBuffers<Layout>();
   }
 
 private:
-  int numberOfVertices = 0;
-  float groupStart = 0;
+  unsigned int numberOfVertices = 0;
+  size_t numberOfIndices = 0;
 
   /**
    * 三分量对应
@@ -62,66 +72,66 @@ private:
     float heightHalf = height / 2.0f;
     float depthHalf = depth / 2.0f;
 
-    float gridX1 = gridX + 1.0f;
-    float gridY1 = gridY + 1.0f;
-
-    int vertexCounter = 0;
-    float groupCount = 0.0f;
-
-    glm::vec3 vector = glm::vec3(0.0f, 0.0f, 0.0f);
-
-    Vertex vertex{};
+    const unsigned int cols = static_cast<unsigned int>(gridX);
+    const unsigned int rows = static_cast<unsigned int>(gridY);
+    const unsigned int gridX1 = cols + 1;
+    const unsigned int gridY1 = rows + 1;
+    const unsigned int vertexStart = numberOfVertices;
+    const size_t indexStart = numberOfIndices;
 
     // 生成 顶点数据
-    for (unsigned int iy = 0; iy < gridY1; ++iy)
+    parallelRows(gridY1, gridX1, [&](unsigned int iy)
     {
+      glm::vec3 vector = glm::vec3(0.0f, 0.0f, 0.0f);
+      Vertex *row = &this->vertices[vertexStart + size_t(iy) * gridX1];
+
       float y = iy * segmentHeight - heightHalf;
       for (unsigned int ix = 0; ix < gridX1; ++ix)
       {
         float x = ix * segmentWidth - widthHalf;
+        row[ix] = Vertex{};
 
         // position
         vector[u] = x * udir;
         vector[v] = y * vdir;
         vector[w] = depthHalf;
-        vertex.Position = glm::vec3(vector.x, vector.y, vector.z);
+        row[ix].Position = glm::vec3(vector.x, vector.y, vector.z);
 
         // normals
         vector[u] = 0;
         vector[v] = 0;
         vector[w] = depth > 0 ? 1.0f : -1.0f;
-        vertex.Normal = glm::vec3(vector.x, vector.y, vector.z);
+        row[ix].Normal = glm::vec3(vector.x, vector.y, vector.z);
 
         // uvs
-        vertex.TexCoords = glm::vec2(ix / gridX, 1 - (iy / gridY));
-
-        this->vertices.push_back(vertex);
-
-        // counters
-        vertexCounter++;
+        row[ix].TexCoords = glm::vec2(ix / gridX, 1 - (iy / gridY));
       }
-    }
+    });
 
     // indices
-
-    for (unsigned int iy = 0; iy < gridY; ++iy)
+    parallelRows(rows, cols, [&](unsigned int iy)
     {
-      for (unsigned int ix = 0; ix < gridX; ++ix)
+      unsigned int *index = &this->indices[indexStart + size_t(iy) * cols * 6];
+      for (unsigned int ix = 0; ix < cols; ++ix)
       {
-        float a = numberOfVertices + ix + gridX1 * iy;
-        float b = numberOfVertices + ix + gridX1 * (iy + 1);
-        float c = numberOfVertices + (ix + 1) + gridX1 * (iy + 1);
-        float d = numberOfVertices + (ix + 1) + gridX1 * iy;
-
-        this->indices.push_back(static_cast<unsigned int>(a));
-        this->indices.push_back(static_cast<unsigned int>(b));
-        this->indices.push_back(static_cast<unsigned int>(d));
-
-        this->indices.push_back(static_cast<unsigned int>(b));
-        this->indices.push_back(static_cast<unsigned int>(c));
-        this->indices.push_back(static_cast<unsigned int>(d));
+        unsigned int a = vertexStart + ix + gridX1 * iy;
+        unsigned int b = vertexStart + ix + gridX1 * (iy + 1);
+        unsigned int c = vertexStart + (ix + 1) + gridX1 * (iy + 1);
+        unsigned int d = vertexStart + (ix + 1) + gridX1 * iy;
+
+        *index++ = a;
+        *index++ = b;
+        *index++ = d;
+
+        *index++ = b;
+        *index++ = c;
+        *index++ = d;
       }
-    }
-    numberOfVertices += vertexCounter;
+    });
+    numberOfVertices += gridX1 * gridY1;
+    numberOfIndices += size_t(cols) * rows * 6;
   }
-};
\ No newline at end of file
+};
+
+// 完整顶点布局，其它布局用 BasicBoxGeometry<Layout>
+using BoxGeometry = BasicBoxGeometry<>;
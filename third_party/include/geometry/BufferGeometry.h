@@ -5,32 +5,35 @@
 #include <glm/gtc/matrix_transform.hpp>
 #include <glm/gtc/type_ptr.hpp>
 
+#include <tools/vertex_layout.h>
+#include <tools/position_stream.h>
+
+#include <bit>
 #include <string>
 #include <vector>
+#include <thread>
+#include <cstddef>
+#include <cstdint>
+#include <unordered_map>
+#include <initializer_list>
 #include <iostream>
+#include <algorithm>
 
-const float PI = glm::pi<float>();
-
-// mesh.h中也定义此属性
-#ifndef DEFINE_VERTEX
-#define DEFINE_VERTEX
-struct Vertex
-{
-  glm::vec3 Position;  // 顶点位置
-  glm::vec3 Normal;    // 法线
-  glm::vec2 TexCoords; // 纹理坐标
-
-  glm::vec3 Tangent;   // 切线
-  glm::vec3 Bitangent; // 副切线
-};
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define GEOMETRY_USE_SSE
 #endif
 
+const float PI = glm::pi<float>();
+
 class BufferGeometry
 {
 public:
   std::vector<Vertex> vertices;
   std::vector<unsigned int> indices;
   unsigned int VAO = 0; // 初始化VAO
+  // buildPositionStream() 之后有效，只写深度的 pass 用它绘制
+  PositionStream positionStream;
 
   void logParameters()
   {
@@ -45,28 +48,356 @@ public:
   }
 
   // 计算切线向量并添加到顶点属性中
-  void computeTangents()
+  // 1. 每个三角形按 UV 求出切线 / 副切线，不归一化直接累加到三个顶点上（相当于按面积加权）
+  // 2. 三角形较多时分给多个线程，每个线程只累加到自己的一份数组里，不需要原子操作，最后按顶点分段合并
+  // 3. 每个顶点用 Gram-Schmidt 让切线和法线正交，副切线取 cross(N, T)，方向（手性）和累加的副切线一致
+  // 支持 SSE 时一次算 4 个三角形；threadCount 为 0 时按硬件线程数和三角形数自动决定
+  void computeTangents(unsigned int threadCount = 0)
   {
+    const size_t vertexCount = vertices.size();
+    const size_t triangleCount = indices.size() / 3;
+    if (vertexCount == 0 || triangleCount == 0)
+      return;
+
+    threadCount = threadsFor(triangleCount, MIN_TRIANGLES_PER_THREAD, threadCount);
+
+    // 每个线程负责一段连续的三角形，累加数组只覆盖这段三角形用到的顶点下标范围 [first, last)
+    // 网格顶点通常按空间顺序排列，相邻三角形的下标很接近，这样额外的内存很少
+    struct Partial
+    {
+      size_t first = 0;
+      size_t last = 0;
+      std::vector<glm::vec3> tangents;
+      std::vector<glm::vec3> bitangents;
+    };
+    std::vector<Partial> partials(threadCount);
+
+    runParallel(threadCount, [&](unsigned int t)
+    {
+      size_t begin = triangleCount * t / threadCount;
+      size_t end = triangleCount * (t + 1) / threadCount;
+      Partial &partial = partials[t];
+      auto [minIt, maxIt] = std::minmax_element(indices.begin() + begin * 3, indices.begin() + end * 3);
+      partial.first = *minIt;
+      partial.last = static_cast<size_t>(*maxIt) + 1;
+      partial.tangents.assign(partial.last - partial.first, glm::vec3(0.0f));
+      partial.bitangents.assign(partial.last - partial.first, glm::vec3(0.0f));
+      accumulateTangents(begin, end, partial.first, partial.tangents.data(), partial.bitangents.data());
+    });
+
+    // 合并和正交化按顶点分段，同样分给多个线程
+    runParallel(threadCount, [&](unsigned int t)
+    {
+      size_t begin = vertexCount * t / threadCount;
+      size_t end = vertexCount * (t + 1) / threadCount;
+      for (size_t i = begin; i < end; ++i)
+      {
+        glm::vec3 tangent(0.0f), bitangent(0.0f);
+        for (const Partial &partial : partials)
+          if (i >= partial.first && i < partial.last)
+          {
+            tangent += partial.tangents[i - partial.first];
+            bitangent += partial.bitangents[i - partial.first];
+          }
+        orthogonalize(vertices[i], tangent, bitangent);
+      }
+    });
+  }
+
+  // 建立只有位置的紧凑顶点流（相同位置的顶点合并），不进入几何体缓存，每个几何体各自 dispose
+  void buildPositionStream()
+  {
+    positionStream.build(vertices, indices);
   }
 
+  // 绑定绘制用的 VAO，返回索引数量；positionOnly 一般直接传 Shader::positionOnly，
+  // 为 true 且建立了位置流时绑定位置流
+  GLsizei bind(bool positionOnly = false) const
+  {
+    if (positionOnly && positionStream.valid())
+    {
+      glBindVertexArray(positionStream.VAO);
+      return positionStream.indexCount;
+    }
+    glBindVertexArray(VAO);
+    return static_cast<GLsizei>(indices.size());
+  }
+
+  // 缓存中的几何体数量，用来确认参数相同的几何体确实共用了缓冲
+  static size_t cachedCount()
+  {
+    return cache().size();
+  }
+
+  // 共用缓冲时复制一份自己的 VBO / EBO 并重建 VAO，之后改动 VAO（比如 TransparentSorter::attach、
+  // InstanceCuller::attach 添加实例属性）不会影响参数相同的其他几何体；只有自己在用时直接接管
+  void detachFromCache()
+  {
+    if (cacheKey.empty())
+      return;
+    auto it = cache().find(cacheKey);
+    cacheKey.clear();
+    if (it == cache().end())
+      return;
+    if (--it->second.refCount == 0)
+    {
+      cache().erase(it);
+      return;
+    }
+
+    unsigned int sharedVBO = VBO;
+    unsigned int sharedEBO = EBO;
+    glGenVertexArrays(1, &VAO);
+    glGenBuffers(1, &VBO);
+    glGenBuffers(1, &EBO);
+    copyBuffer(sharedVBO, VBO, GL_DYNAMIC_DRAW);
+    copyBuffer(sharedEBO, EBO, GL_STATIC_DRAW);
+
+    glBindVertexArray(VAO);
+    glBindBuffer(GL_ARRAY_BUFFER, VBO);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
+    layoutSetup();
+    glBindVertexArray(0);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+  }
+
+  // 使用缓存的几何体只有最后一个 dispose 时才真正删除缓冲
   void dispose()
   {
     glBindBuffer(GL_ARRAY_BUFFER, 0);
     glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+    positionStream.dispose();
+    if (!cacheKey.empty())
+    {
+      auto it = cache().find(cacheKey);
+      cacheKey.clear();
+      if (it != cache().end() && --it->second.refCount > 0)
+      {
+        VAO = VBO = EBO = 0;
+        return;
+      }
+      if (it != cache().end())
+        cache().erase(it);
+    }
     glDeleteVertexArrays(1, &VAO);
     glDeleteBuffers(1, &VBO);
     glDeleteBuffers(1, &EBO);
+    VAO = VBO = EBO = 0;
   }
-
 private:
   glm::mat4 matrix = glm::mat4(1.0f);
 
+  // 少于这个数量的三角形不值得开线程
+  static constexpr size_t MIN_TRIANGLES_PER_THREAD = 32768;
+
+  // 构造参数相同的几何体共用的 GL 缓冲，只记句柄和引用计数，顶点数据每个几何体各自一份
+  struct CacheEntry
+  {
+    unsigned int VAO = 0;
+    unsigned int VBO = 0;
+    unsigned int EBO = 0;
+    unsigned int refCount = 0;
+  };
+
+  std::string cacheKey;
+  // setupBuffers 时的 Layout::setup，detachFromCache 重建 VAO 时用
+  void (*layoutSetup)() = nullptr;
+
+  static std::unordered_map<std::string, CacheEntry> &cache()
+  {
+    static std::unordered_map<std::string, CacheEntry> entries;
+    return entries;
+  }
+
+  static void copyBuffer(unsigned int source, unsigned int target, GLenum usage)
+  {
+    GLint size = 0;
+    glBindBuffer(GL_COPY_READ_BUFFER, source);
+    glGetBufferParameteriv(GL_COPY_READ_BUFFER, GL_BUFFER_SIZE, &size);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, target);
+    glBufferData(GL_COPY_WRITE_BUFFER, size, nullptr, usage);
+    glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, 0, size);
+    glBindBuffer(GL_COPY_READ_BUFFER, 0);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+  }
+
+  // 三角形 [begin, end) 的切线和副切线累加到 tangents / bitangents[index - first]
+  void accumulateTangents(size_t begin, size_t end, size_t first, glm::vec3 *tangents, glm::vec3 *bitangents) const
+  {
+    const unsigned int *tri = indices.data();
+    size_t i = begin;
+#ifdef GEOMETRY_USE_SSE
+    // 4 个三角形的数据转成 SoA，每个分量一个寄存器
+    const __m128 epsilon = _mm_set1_ps(1e-12f);
+    const __m128 absMask = _mm_castsi128_ps(_mm_set1_epi32(0x7fffffff));
+    alignas(16) float tx[4], ty[4], tz[4], bx[4], by[4], bz[4];
+    for (; i + 4 <= end; i += 4)
+    {
+      alignas(16) float e1[3][4], e2[3][4], d1[2][4], d2[2][4];
+      for (int k = 0; k < 4; ++k)
+      {
+        const Vertex &v0 = vertices[tri[(i + k) * 3 + 0]];
+        const Vertex &v1 = vertices[tri[(i + k) * 3 + 1]];
+        const Vertex &v2 = vertices[tri[(i + k) * 3 + 2]];
+        for (int c = 0; c < 3; ++c)
+        {
+          e1[c][k] = v1.Position[c] - v0.Position[c];
+          e2[c][k] = v2.Position[c] - v0.Position[c];
+        }
+        for (int c = 0; c < 2; ++c)
+        {
+          d1[c][k] = v1.TexCoords[c] - v0.TexCoords[c];
+          d2[c][k] = v2.TexCoords[c] - v0.TexCoords[c];
+        }
+      }
+      __m128 du1 = _mm_load_ps(d1[0]), dv1 = _mm_load_ps(d1[1]);
+      __m128 du2 = _mm_load_ps(d2[0]), dv2 = _mm_load_ps(d2[1]);
+      // UV 退化（行列式接近 0）的三角形不贡献
+      __m128 det = _mm_sub_ps(_mm_mul_ps(du1, dv2), _mm_mul_ps(du2, dv1));
+      __m128 valid = _mm_cmpgt_ps(_mm_and_ps(det, absMask), epsilon);
+      __m128 r = _mm_and_ps(valid, _mm_div_ps(_mm_set1_ps(1.0f), det));
+
+      float *tOut[3] = { tx, ty, tz };
+      float *bOut[3] = { bx, by, bz };
+      for (int c = 0; c < 3; ++c)
+      {
+        __m128 a = _mm_load_ps(e1[c]), b = _mm_load_ps(e2[c]);
+        _mm_store_ps(tOut[c], _mm_mul_ps(_mm_sub_ps(_mm_mul_ps(a, dv2), _mm_mul_ps(b, dv1)), r));
+        _mm_store_ps(bOut[c], _mm_mul_ps(_mm_sub_ps(_mm_mul_ps(b, du1), _mm_mul_ps(a, du2)), r));
+      }
+      for (int k = 0; k < 4; ++k)
+      {
+        glm::vec3 tangent(tx[k], ty[k], tz[k]);
+        glm::vec3 bitangent(bx[k], by[k], bz[k]);
+        for (int corner = 0; corner < 3; ++corner)
+        {
+          size_t index = tri[(i + k) * 3 + corner] - first;
+          tangents[index] += tangent;
+          bitangents[index] += bitangent;
+        }
+      }
+    }
+#endif
+    // 剩下不足 4 个的三角形（或不支持 SSE 时的全部三角形）
+    for (; i < end; ++i)
+    {
+      const Vertex &v0 = vertices[tri[i * 3 + 0]];
+      const Vertex &v1 = vertices[tri[i * 3 + 1]];
+      const Vertex &v2 = vertices[tri[i * 3 + 2]];
+      glm::vec3 edge1 = v1.Position - v0.Position;
+      glm::vec3 edge2 = v2.Position - v0.Position;
+      glm::vec2 deltaUV1 = v1.TexCoords - v0.TexCoords;
+      glm::vec2 deltaUV2 = v2.TexCoords - v0.TexCoords;
+
+      float det = deltaUV1.x * deltaUV2.y - deltaUV2.x * deltaUV1.y;
+      if (glm::abs(det) <= 1e-12f)
+        continue;
+      float r = 1.0f / det;
+      glm::vec3 tangent = (edge1 * deltaUV2.y - edge2 * deltaUV1.y) * r;
+      glm::vec3 bitangent = (edge2 * deltaUV1.x - edge1 * deltaUV2.x) * r;
+      for (int corner = 0; corner < 3; ++corner)
+      {
+        size_t index = tri[i * 3 + corner] - first;
+        tangents[index] += tangent;
+        bitangents[index] += bitangent;
+      }
+    }
+  }
+
+  // Gram-Schmidt 正交化，切线和法线平行或没有累加到切线时随便取一个和法线垂直的方向
+  static void orthogonalize(Vertex &vertex, glm::vec3 tangent, const glm::vec3 &bitangent)
+  {
+    const glm::vec3 &normal = vertex.Normal;
+    tangent -= normal * glm::dot(normal, tangent);
+    float length2 = glm::dot(tangent, tangent);
+    if (length2 > 1e-20f)
+      tangent *= glm::inversesqrt(length2);
+    else if (glm::dot(normal, normal) > 1e-20f)
+      tangent = glm::normalize(glm::cross(glm::abs(normal.x) < 0.9f ? glm::vec3(1.0f, 0.0f, 0.0f) : glm::vec3(0.0f, 1.0f, 0.0f), normal));
+    else
+      tangent = glm::vec3(1.0f, 0.0f, 0.0f);
+
+    float handedness = glm::dot(glm::cross(normal, tangent), bitangent) < 0.0f ? -1.0f : 1.0f;
+    vertex.Tangent = tangent;
+    vertex.Bitangent = glm::cross(normal, tangent) * handedness;
+  }
+
 protected:
   unsigned int VBO = 0; // 初始化VBO
   unsigned int EBO = 0; // 初始化EBO
 
+  // 少于这个数量的顶点不值得开线程生成
+  static constexpr size_t MIN_VERTICES_PER_THREAD = 65536;
+
+  // 子类构造时用类名和构造参数生成缓存的键，setupBuffers 时命中就直接共用已有的缓冲，不再创建和上传
+  // 参数按浮点数的二进制比较，只有完全相同的参数才会命中
+  // 同样的参数换一种顶点布局是另一份缓冲，layoutMask 为布局的 VertexLayout::mask
+  void useCache(const char *name, std::initializer_list<float> params, unsigned int layoutMask)
+  {
+    cacheKey = name + std::string(":") + std::to_string(layoutMask);
+    for (float param : params)
+      cacheKey += ':' + std::to_string(std::bit_cast<std::uint32_t>(param));
+  }
+
+  // requested 为 0 时按硬件线程数，工作量不够 minWorkPerThread 的部分不多开线程
+  static unsigned int threadsFor(size_t work, size_t minWorkPerThread, unsigned int requested = 0)
+  {
+    if (requested == 0)
+      requested = glm::max(std::thread::hardware_concurrency(), 1u);
+    return static_cast<unsigned int>(std::clamp<size_t>(work / minWorkPerThread, 1, requested));
+  }
+
+  // task(t) 对 t = [0, threadCount) 各执行一次，最后一份在当前线程上执行
+  template <typename Task>
+  static void runParallel(unsigned int threadCount, const Task &task)
+  {
+    std::vector<std::thread> workers;
+    workers.reserve(threadCount - 1);
+    for (unsigned int t = 0; t + 1 < threadCount; ++t)
+      workers.emplace_back([&task, t]() { task(t); });
+    task(threadCount - 1);
+    for (std::thread &worker : workers)
+      worker.join();
+  }
+
+  // 把 rowCount 行分段交给多个线程，每段调用 row(iy)；每行写的顶点和索引位置由调用方按行号算出，互不重叠
+  template <typename Row>
+  static void parallelRows(unsigned int rowCount, size_t verticesPerRow, const Row &row)
+  {
+    if (rowCount == 0)
+      return;
+    unsigned int threadCount = threadsFor(rowCount * verticesPerRow, MIN_VERTICES_PER_THREAD);
+    threadCount = glm::min(threadCount, rowCount);
+    runParallel(threadCount, [&](unsigned int t)
+    {
+      unsigned int begin = rowCount * t / threadCount;
+      unsigned int end = rowCount * (t + 1) / threadCount;
+      for (unsigned int iy = begin; iy < end; ++iy)
+        row(iy);
+    });
+  }
+
+  // 按 Layout 打包上传顶点，只启用布局中有的属性；布局中没有切线时也不用计算切线
+  template <typename Layout = FullVertexLayout>
   void setupBuffers()
   {
+    if constexpr (Layout::template has<VertexAttribute::Tangent> || Layout::template has<VertexAttribute::Bitangent>)
+      computeTangents();
+    layoutSetup = &Layout::setup;
+
+    if (!cacheKey.empty())
+    {
+      auto it = cache().find(cacheKey);
+      if (it != cache().end())
+      {
+        VAO = it->second.VAO;
+        VBO = it->second.VBO;
+        EBO = it->second.EBO;
+        ++it->second.refCount;
+        return;
+      }
+    }
+
     glGenVertexArrays(1, &VAO);
     glGenBuffers(1, &VBO);
     glGenBuffers(1, &EBO);
@@ -75,26 +406,19 @@ protected:
 
     // vertex attribute
     glBindBuffer(GL_ARRAY_BUFFER, VBO);
-    glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(Vertex), &vertices[0], GL_DYNAMIC_DRAW);
+    Layout::bufferData(GL_ARRAY_BUFFER, vertices, GL_DYNAMIC_DRAW);
 
     // indixes
     glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
     glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(unsigned int), &indices[0], GL_STATIC_DRAW);
 
-    // 设置顶点属性指针
-    // Position
-    glEnableVertexAttribArray(0);
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void *)0);
-
-    // Normal
-    glEnableVertexAttribArray(1);
-    glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void *)offsetof(Vertex, Normal));
-
-    // TexCoords
-    glEnableVertexAttribArray(2);
-    glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void *)offsetof(Vertex, TexCoords));
+    // 设置顶点属性指针，步长和偏移由布局在编译期算出
+    Layout::setup();
 
     glBindBuffer(GL_ARRAY_BUFFER, 0);
     glBindVertexArray(0);
+
+    if (!cacheKey.empty())
+      cache()[cacheKey] = { VAO, VBO, EBO, 1 };
   }
 };
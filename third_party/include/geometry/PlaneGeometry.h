@@ -2,57 +2,67 @@
 
 #include <geometry/BufferGeometry.h>
 
-class PlaneGeometry : public BufferGeometry
+template <typename Layout = FullVertexLayout>
+class BasicPlaneGeometry : public BufferGeometry
 {
 public:
-  PlaneGeometry(float width = 1.0, float height = 1.0, float wSegment = 1.0, float hSegment = 1.0)
+  BasicPlaneGeometry(float width = 1.0, float height = 1.0, float wSegment = 1.0, float hSegment = 1.0)
   {
+    const unsigned int gridX = static_cast<unsigned int>(glm::max(1.0f, glm::floor(wSegment)));
+    const unsigned int gridY = static_cast<unsigned int>(glm::max(1.0f, glm::floor(hSegment)));
+
+    this->useCache("Plane", { width, height, float(gridX), float(gridY) }, Layout::mask);
 
     float width_half = width / 2.0f;
     float height_half = height / 2.0f;
 
-    float gridX1 = wSegment + 1.0f;
-    float gridY1 = hSegment + 1.0f;
+    const unsigned int gridX1 = gridX + 1;
+    const unsigned int gridY1 = gridY + 1;
 
-    float segment_width = width / wSegment;
-    float segment_height = height / hSegment;
+    float segment_width = width / gridX;
+    float segment_height = height / gridY;
 
-    Vertex vertex{};
+    // 顶点和索引数量可以直接算出来，一次分配好，每一行写自己的那一段
+    this->vertices.resize(size_t(gridX1) * gridY1);
+    this->indices.resize(size_t(gridX) * gridY * 6);
 
     // generate Position Normal TexCoords
-    for (int iy = 0; iy < gridY1; ++iy)
+    parallelRows(gridY1, gridX1, [&](unsigned int iy)
     {
-
       float y = iy * segment_height - height_half;
+      Vertex *row = &this->vertices[size_t(iy) * gridX1];
 
-      for (int ix = 0; ix < gridX1; ++ix)
+      for (unsigned int ix = 0; ix < gridX1; ++ix)
       {
-        float x = ix * segment_width - height_half;
-        vertex.Position = glm::vec3(x, -y, 0.0f);
-        vertex.Normal = glm::vec3(0.0f, 0.0f, 1.0f);
-        vertex.TexCoords = glm::vec2(ix / wSegment, 1.0f - (iy / hSegment));
-
-        this->vertices.push_back(vertex);
+        float x = ix * segment_width - width_half;
+        row[ix] = Vertex{};
+        row[ix].Position = glm::vec3(x, -y, 0.0f);
+        row[ix].Normal = glm::vec3(0.0f, 0.0f, 1.0f);
+        row[ix].TexCoords = glm::vec2(float(ix) / gridX, 1.0f - (float(iy) / gridY));
       }
-    }
+    });
     // generate indices
-    for (int iy = 0; iy < hSegment; ++iy)
+    parallelRows(gridY, gridX, [&](unsigned int iy)
     {
-      for (int ix = 0; ix < wSegment; ++ix)
+      unsigned int *index = &this->indices[size_t(iy) * gridX * 6];
+      for (unsigned int ix = 0; ix < gridX; ++ix)
       {
-        float a = ix + gridX1 * iy;
-        float b = ix + gridX1 * (iy + 1);
-        float c = (ix + 1) + gridX1 * (iy + 1);
-        float d = (ix + 1) + gridX1 * iy;
-        this->indices.push_back(static_cast<unsigned int>(a));
-        this->indices.push_back(static_cast<unsigned int>(b));
-        this->indices.push_back(static_cast<unsigned int>(d));
-        this->indices.push_back(static_cast<unsigned int>(b));
-        this->indices.push_back(static_cast<unsigned int>(c));
-        this->indices.push_back(static_cast<unsigned int>(d));
+        unsigned int a = ix + gridX1 * iy;
+        unsigned int b = ix + gridX1 * (iy + 1);
+        unsigned int c = (ix + 1) + gridX1 * (iy + 1);
+        unsigned int d = (ix + 1) + gridX1 * iy;
+        *index++ = a;
+        *index++ = b;
+        *index++ = d;
+        *index++ = b;
+        *index++ = c;
+        *index++ = d;
       }
-    }
+    });
 
-    this->setupBuffers();
+    this->template setupBuffers<Layout>();
   }
-};
\ No newline at end of file
+};
+
+// 完整顶点布局，其它布局用 BasicPlaneGeometry<Layout>
+using PlaneGeometry = BasicPlaneGeometry<>;
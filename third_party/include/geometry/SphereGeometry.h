@@ -2,30 +2,35 @@
 
 #include <geometry/BufferGeometry.h>
 
-class SphereGeometry : public BufferGeometry
+template <typename Layout = FullVertexLayout>
+class BasicSphereGeometry : public BufferGeometry
 {
 public:
-  SphereGeometry(float radius = 1.0f, float widthSegments = 8.0f, float heightSegments = 6.0f, float phiStart = 0.0f, float phiLength = PI * 2.0f, float thetaStart = 0.0f, float thetaLength = PI)
+  BasicSphereGeometry(float radius = 1.0f, float widthSegments = 8.0f, float heightSegments = 6.0f, float phiStart = 0.0f, float phiLength = PI * 2.0f, float thetaStart = 0.0f, float thetaLength = PI)
   {
 
     const float thetaEnd = glm::min(thetaStart + thetaLength, PI);
-    int index = 0;
 
     widthSegments = glm::max(3.0f, glm::floor(widthSegments));
     heightSegments = glm::max(2.0f, glm::floor(heightSegments));
 
-    std::vector<std::vector<int>> grid;
+    this->useCache("Sphere", { radius, widthSegments, heightSegments, phiStart, phiLength, thetaStart, thetaLength }, Layout::mask);
 
-    glm::vec3 position = glm::vec3(0.0f);
-    glm::vec3 normal = glm::vec3(0.0f);
+    const unsigned int gridX = static_cast<unsigned int>(widthSegments);
+    const unsigned int gridY = static_cast<unsigned int>(heightSegments);
+    const unsigned int gridX1 = gridX + 1;
 
-    Vertex vertex{};
+    // 两极是否收成一个点，收成一个点时那一行只有一半的三角形
+    const bool topCap = thetaStart <= 0.0f;
+    const bool bottomCap = thetaEnd >= PI;
+
+    // 第 iy 行顶点 grid[iy][ix] 的下标为 iy * gridX1 + ix；每行 gridX 个格子，除两极外每个格子两个三角形
+    this->vertices.resize(size_t(gridX1) * (gridY + 1));
+    this->indices.resize((size_t(gridY) * 2 - (topCap ? 1 : 0) - (bottomCap ? 1 : 0)) * gridX * 3);
 
     // 计算 vertices normals 和 uvs
-    for (unsigned int iy = 0; iy <= heightSegments; ++iy)
+    parallelRows(gridY + 1, gridX1, [&](unsigned int iy)
     {
-      std::vector<int> verticesRow;
-
       float v = iy / heightSegments;
 
       float uOffset = 0;
@@ -34,60 +39,66 @@ public:
       {
         uOffset = 0.5f / widthSegments;
       }
-      else if (iy == heightSegments && thetaEnd == PI)
+      else if (iy == gridY && thetaEnd == PI)
       {
         uOffset = -0.5f / widthSegments;
       }
-      for (unsigned int ix = 0; ix <= widthSegments; ++ix)
+
+      const float sinTheta = glm::sin(thetaStart + v * thetaLength);
+      const float cosTheta = glm::cos(thetaStart + v * thetaLength);
+      Vertex *row = &this->vertices[size_t(iy) * gridX1];
+      for (unsigned int ix = 0; ix <= gridX; ++ix)
       {
         const float u = ix / widthSegments;
 
         // position
-        position.x = -radius * glm::cos(phiStart + u * phiLength) * glm::sin(thetaStart + v * thetaLength);
-        position.y = radius * glm::cos(thetaStart + v * thetaLength);
-        position.z = radius * glm::sin(phiStart + u * phiLength) * glm::sin(thetaStart + v * thetaLength);
+        glm::vec3 position;
+        position.x = -radius * glm::cos(phiStart + u * phiLength) * sinTheta;
+        position.y = radius * cosTheta;
+        position.z = radius * glm::sin(phiStart + u * phiLength) * sinTheta;
 
-        vertex.Position = position;
+        row[ix] = Vertex{};
+        row[ix].Position = position;
 
         // normal
-        normal = glm::normalize(position);
-        vertex.Normal = normal;
+        row[ix].Normal = glm::normalize(position);
 
         // uv
-        vertex.TexCoords = glm::vec2(u + uOffset, 1 - v);
-
-        this->vertices.push_back(vertex);
-
-        verticesRow.push_back(index++);
+        row[ix].TexCoords = glm::vec2(u + uOffset, 1 - v);
       }
-      grid.push_back(verticesRow);
-    }
+    });
 
     // indices
-    for (unsigned int iy = 0; iy < heightSegments; ++iy)
+    parallelRows(gridY, gridX, [&](unsigned int iy)
     {
-      for (unsigned ix = 0; ix < widthSegments; ++ix)
+      // 前面各行的索引数：第 0 行在收口时少一半
+      size_t offset = size_t(iy) * gridX * 6 - (iy > 0 && topCap ? size_t(gridX) * 3 : 0);
+      unsigned int *index = &this->indices[offset];
+      for (unsigned int ix = 0; ix < gridX; ++ix)
       {
-        unsigned int a = grid[iy][ix + 1];
-        unsigned int b = grid[iy][ix];
-        unsigned int c = grid[iy + 1][ix];
-        unsigned int d = grid[iy + 1][ix + 1];
+        unsigned int a = iy * gridX1 + ix + 1;
+        unsigned int b = iy * gridX1 + ix;
+        unsigned int c = (iy + 1) * gridX1 + ix;
+        unsigned int d = (iy + 1) * gridX1 + ix + 1;
 
-        if (iy != 0 || thetaStart > 0)
+        if (iy != 0 || !topCap)
         {
-          this->indices.push_back(a);
-          this->indices.push_back(b);
-          this->indices.push_back(d);
+          *index++ = a;
+          *index++ = b;
+          *index++ = d;
         }
-        if (iy != heightSegments - 1 || thetaEnd < PI)
+        if (iy != gridY - 1 || !bottomCap)
         {
-          this->indices.push_back(b);
-          this->indices.push_back(c);
-          this->indices.push_back(d);
+          *index++ = b;
+          *index++ = c;
+          *index++ = d;
         }
       }
-    }
+    });
 
-    this->setupBuffers();
+    this->template setupBuffers<Layout>();
   }
-};
\ No newline at end of file
+};
+
+// 完整顶点布局，其它布局用 BasicSphereGeometry<Layout>
+using SphereGeometry = BasicSphereGeometry<>;
@@ -0,0 +1,6 @@
+#version 330 core
+
+// 只写深度，颜色写入由 glColorMask 关掉
+void main()
+{
+}
@@ -0,0 +1,21 @@
+#version 330 core
+
+/*
+    深度预渲染和过度绘制统计共用的顶点着色器
+    只读 location 0 的位置，Shader::positionOnly 为 true，网格建立了位置流时自动换用
+    颜色 pass 用 GL_EQUAL 比较深度，两边的深度必须逐位相等：
+    颜色 pass 的顶点着色器要写成同一个表达式 projection * view * model * vec4(aPos, 1.0)，并同样声明 invariant gl_Position
+*/
+
+layout (location = 0) in vec3 aPos;
+
+uniform mat4 model;
+uniform mat4 view;
+uniform mat4 projection;
+
+invariant gl_Position;
+
+void main()
+{
+    gl_Position = projection * view * model * vec4(aPos, 1.0);
+}
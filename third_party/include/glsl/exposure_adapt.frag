@@ -0,0 +1,23 @@
+#version 330 core
+
+/*
+    人眼适应（GL 3.3 版本）：读取 log 亮度纹理 mip 链最高一级的平均值，和上一帧的结果混合
+    输出到 1x1 的纹理：r 为适应后的平均亮度，g 为曝光
+*/
+
+out vec2 Exposure;
+
+uniform sampler2D logLuminance;
+uniform sampler2D previousExposure;
+uniform int topLevel;
+uniform float adaptation; // 1 - exp(-deltaTime * 速度)
+uniform float keyValue;
+uniform bool resetHistory;
+
+void main()
+{
+    float luminance = exp2(texelFetch(logLuminance, ivec2(0), topLevel).r);
+    float previous = texelFetch(previousExposure, ivec2(0), 0).r;
+    float adapted = resetHistory ? luminance : previous + (luminance - previous) * adaptation;
+    Exposure = vec2(adapted, keyValue / max(adapted, 1.0e-4));
+}
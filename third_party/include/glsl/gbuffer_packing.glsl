@@ -0,0 +1,61 @@
+/*
+    紧凑 G-Buffer 的编码 / 解码
+        法线：八面体映射到 [0, 1]^2，存在 RG16（每像素 4 字节）
+        高光强度 + 材质 ID：一起放进反照率的 alpha 通道，高 5 位为高光，低 3 位为材质 ID
+        位置：不存，用硬件深度和投影矩阵的逆重建
+*/
+
+#define GBUFFER_MATERIAL_COUNT 8
+
+vec2 octahedralWrap(vec2 v)
+{
+    return (1.0 - abs(v.yx)) * vec2(v.x >= 0.0 ? 1.0 : -1.0, v.y >= 0.0 ? 1.0 : -1.0);
+}
+
+// n 为单位向量
+vec2 encodeNormal(vec3 n)
+{
+    n /= abs(n.x) + abs(n.y) + abs(n.z);
+    vec2 e = n.z >= 0.0 ? n.xy : octahedralWrap(n.xy);
+    return e * 0.5 + 0.5;
+}
+
+vec3 decodeNormal(vec2 e)
+{
+    e = e * 2.0 - 1.0;
+    vec3 n = vec3(e, 1.0 - abs(e.x) - abs(e.y));
+    float t = clamp(-n.z, 0.0, 1.0);
+    n.xy += vec2(n.x >= 0.0 ? -t : t, n.y >= 0.0 ? -t : t);
+    return normalize(n);
+}
+
+float packSpecularMaterial(float specular, int materialID)
+{
+    float level = floor(clamp(specular, 0.0, 1.0) * 31.0 + 0.5);
+    return (level * float(GBUFFER_MATERIAL_COUNT) + float(clamp(materialID, 0, GBUFFER_MATERIAL_COUNT - 1))) / 255.0;
+}
+
+float unpackSpecular(float packed)
+{
+    return float(int(packed * 255.0 + 0.5) / GBUFFER_MATERIAL_COUNT) / 31.0;
+}
+
+int unpackMaterialID(float packed)
+{
+    return int(packed * 255.0 + 0.5) % GBUFFER_MATERIAL_COUNT;
+}
+
+// uv 为 [0, 1] 的屏幕坐标，depth 为深度缓冲中的值
+// inverseMatrix 为 inverse(projection) 时得到观察空间位置，为 inverse(projection * view) 时得到世界空间位置
+vec3 reconstructPosition(vec2 uv, float depth, mat4 inverseMatrix)
+{
+    vec4 position = inverseMatrix * vec4(vec3(uv, depth) * 2.0 - 1.0, 1.0);
+    return position.xyz / position.w;
+}
+
+// pixel 为深度纹理中的像素坐标
+vec3 reconstructPosition(sampler2D depthTexture, ivec2 pixel, mat4 inverseMatrix)
+{
+    vec2 uv = (vec2(pixel) + 0.5) / vec2(textureSize(depthTexture, 0));
+    return reconstructPosition(uv, texelFetch(depthTexture, pixel, 0).r, inverseMatrix);
+}
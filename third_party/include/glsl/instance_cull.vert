@@ -0,0 +1,39 @@
+#version 330 core
+
+/*
+    GPU 实例剔除（GL 3.3）：每个顶点就是一个实例，用实例矩阵算出世界空间的包围球
+    1. 和视锥的 6 个平面比较，完全在某个平面外侧的剔除
+    2. 到摄像机的距离落在 [lodMinDistance, lodMaxDistance) 的才属于当前这一级 LOD
+    结果交给 instance_cull.geom，只有可见的实例才输出，由 transform feedback 紧凑地写进这一级的实例缓冲
+*/
+
+layout (location = 0) in mat4 instanceMatrix;
+
+flat out uint vsInstanceIndex;
+flat out int vsVisible;
+
+uniform vec4 frustumPlanes[6];  // xyz 为指向视锥内侧的单位法线，w 为距离
+uniform bool frustumCulling;
+uniform vec3 cameraPosition;
+uniform float boundingRadius;   // 模型空间的包围球半径
+uniform float lodMinDistance;
+uniform float lodMaxDistance;
+
+void main()
+{
+    vec3 center = instanceMatrix[3].xyz;
+    float scale = max(max(length(instanceMatrix[0].xyz), length(instanceMatrix[1].xyz)), length(instanceMatrix[2].xyz));
+    float radius = boundingRadius * scale;
+
+    bool visible = true;
+    if (frustumCulling)
+    {
+        for (int i = 0; i < 6; ++i)
+            visible = visible && dot(frustumPlanes[i].xyz, center) + frustumPlanes[i].w > -radius;
+    }
+    float distanceToCamera = distance(cameraPosition, center);
+    visible = visible && distanceToCamera >= lodMinDistance && distanceToCamera < lodMaxDistance;
+
+    vsInstanceIndex = uint(gl_VertexID);
+    vsVisible = visible ? 1 : 0;
+}
@@ -0,0 +1,13 @@
+/*
+    从纹理缓冲里取实例矩阵（tools/instance_culler.h），每个矩阵按列占 4 个 RGBA32F 纹素
+    instanceIndex 为剔除后紧凑实例缓冲里的下标（每个实例前进一次的整数顶点属性）
+*/
+
+mat4 fetchInstanceMatrix(samplerBuffer instanceMatrices, uint instanceIndex)
+{
+    int base = int(instanceIndex) * 4;
+    return mat4(texelFetch(instanceMatrices, base),
+                texelFetch(instanceMatrices, base + 1),
+                texelFetch(instanceMatrices, base + 2),
+                texelFetch(instanceMatrices, base + 3));
+}
@@ -0,0 +1,21 @@
+#version 330 core
+
+/*
+    自动曝光的片段着色器版本（GL 3.3）：把 HDR 颜色转成 log2 亮度写进一张 2 的幂大小的纹理，
+    之后 glGenerateMipmap 一路平均到 1x1，最高一级就是画面的平均 log 亮度
+    亮度范围和直方图版本一致，全黑的像素按 minLogLuminance 计入
+*/
+
+out float LogLuminance;
+
+in vec2 TexCoords;
+
+uniform sampler2D hdrTexture;
+uniform float minLogLuminance;
+uniform float maxLogLuminance;
+
+void main()
+{
+    float luminance = dot(texture(hdrTexture, TexCoords).rgb, vec3(0.2126, 0.7152, 0.0722));
+    LogLuminance = clamp(log2(max(luminance, 1.0e-4)), minLogLuminance, maxLogLuminance);
+}
@@ -0,0 +1,13 @@
+#version 330 core
+
+/*
+    过度绘制统计：每个通过深度测试的片段输出 1，以 GL_ONE, GL_ONE 叠加进 R16F 纹理
+    结果就是每个像素执行了几次片段着色器（16 位浮点在 2048 以内是精确的整数）
+*/
+
+out float Count;
+
+void main()
+{
+    Count = 1.0;
+}
@@ -0,0 +1,28 @@
+#version 330 core
+
+/*
+    过度绘制热度图：没有片段的像素为黑色，1 次为蓝色，之后经过绿、黄到红色，maxOverdraw 次及以上为红色
+*/
+
+out vec4 FragColor;
+
+in vec2 TexCoords;
+
+uniform sampler2D overdrawTexture;
+uniform float maxOverdraw;
+
+void main()
+{
+    float count = texelFetch(overdrawTexture, ivec2(gl_FragCoord.xy), 0).r;
+    if (count < 0.5)
+    {
+        FragColor = vec4(0.0, 0.0, 0.0, 1.0);
+        return;
+    }
+
+    float t = clamp((count - 1.0) / max(maxOverdraw - 1.0, 1.0), 0.0, 1.0) * 3.0;
+    vec3 color = t < 1.0 ? mix(vec3(0.0, 0.2, 1.0), vec3(0.0, 1.0, 0.2), t)
+               : t < 2.0 ? mix(vec3(0.0, 1.0, 0.2), vec3(1.0, 1.0, 0.0), t - 1.0)
+               :           mix(vec3(1.0, 1.0, 0.0), vec3(1.0, 0.0, 0.0), t - 2.0);
+    FragColor = vec4(color, 1.0);
+}
@@ -0,0 +1,48 @@
+#version 330 core
+
+/*
+    可分离滤波的片段着色器版本，GL 3.3 上下文时使用
+    参数和 separable_filter.comp 相同，每个像素直接从纹理读取 2 * radius + 1 个像素
+*/
+
+#define MAX_RADIUS 16
+
+out vec4 FragColor;
+
+uniform sampler2D srcTexture;
+uniform sampler2D guideTexture;
+
+uniform ivec2 direction;
+uniform int radius;
+uniform float weights[MAX_RADIUS + 1];
+uniform bool bilateral;
+uniform float depthSigma;
+
+void main()
+{
+    ivec2 size = textureSize(srcTexture, 0);
+    ivec2 pixel = ivec2(gl_FragCoord.xy);
+
+    vec4 result = texelFetch(srcTexture, pixel, 0) * weights[0];
+    float total = weights[0];
+    float centerDepth = bilateral ? texelFetch(guideTexture, pixel, 0).z : 0.0;
+    float depthFalloff = 1.0 / (2.0 * depthSigma * depthSigma);
+    for (int i = 1; i <= radius; ++i)
+    {
+        ivec2 p0 = clamp(pixel + direction * i, ivec2(0), size - 1);
+        ivec2 p1 = clamp(pixel - direction * i, ivec2(0), size - 1);
+        float w0 = weights[i];
+        float w1 = weights[i];
+        if (bilateral)
+        {
+            float d0 = texelFetch(guideTexture, p0, 0).z - centerDepth;
+            float d1 = texelFetch(guideTexture, p1, 0).z - centerDepth;
+            w0 *= exp(-d0 * d0 * depthFalloff);
+            w1 *= exp(-d1 * d1 * depthFalloff);
+        }
+        result += texelFetch(srcTexture, p0, 0) * w0 + texelFetch(srcTexture, p1, 0) * w1;
+        total += w0 + w1;
+    }
+
+    FragColor = result / total;
+}
@@ -0,0 +1,155 @@
+/*
+    阴影过滤公共库，用 Shader 的 defines 参数选择一种：
+        SHADOW_FILTER_PCF   硬件比较的 PCF，4 次双线性比较覆盖 3x3 个纹素（默认）
+        SHADOW_FILTER_VOGEL 按像素旋转的 Vogel 圆盘，tap 数和半径可调
+        SHADOW_FILTER_VSM   方差阴影贴图，采样预过滤后的 (d, d²)
+        SHADOW_FILTER_ESM   指数阴影贴图，采样预过滤后的 exp(c·d)
+    PCF / VOGEL 需要开启比较模式的深度贴图，VSM / ESM 需要 ShadowFilter 生成的矩贴图
+    所有函数返回阴影量：0 为完全照亮，1 为完全在阴影中
+*/
+
+#if !defined(SHADOW_FILTER_PCF) && !defined(SHADOW_FILTER_VOGEL) && !defined(SHADOW_FILTER_VSM) && !defined(SHADOW_FILTER_ESM)
+#define SHADOW_FILTER_PCF
+#endif
+
+// 着色器里用这两个宏声明阴影贴图，类型跟着过滤方式变
+#if defined(SHADOW_FILTER_VSM) || defined(SHADOW_FILTER_ESM)
+#define SHADOW_MAP_2D sampler2D
+#define SHADOW_MAP_ARRAY sampler2DArray
+#else
+#define SHADOW_MAP_2D sampler2DShadow
+#define SHADOW_MAP_ARRAY sampler2DArrayShadow
+#endif
+
+struct ShadowParams
+{
+    int taps;             // VOGEL：采样数
+    float radius;         // VOGEL：圆盘半径，单位为纹素
+    float minVariance;    // VSM：最小方差，防止平面上的自阴影
+    float bleedReduction; // VSM：漏光抑制，把 [0, x] 的可见度截成 0
+    float exponent;       // ESM：指数 c，要和预过滤时一致
+};
+
+// 屏幕空间的交错梯度噪声，用于旋转采样圆盘
+float interleavedGradientNoise(vec2 position)
+{
+    return fract(52.9829189 * fract(dot(position, vec2(0.06711056, 0.00583715))));
+}
+
+// 第 i 个 Vogel 圆盘采样点，半径为 1
+vec2 vogelDiskSample(int i, int taps, float phi)
+{
+    const float GOLDEN_ANGLE = 2.4;
+    float r = sqrt((float(i) + 0.5) / float(taps));
+    float theta = float(i) * GOLDEN_ANGLE + phi;
+    return r * vec2(cos(theta), sin(theta));
+}
+
+// ------------------------------------------------------------
+// 硬件 PCF
+float shadowPCF(sampler2DShadow shadowMap, vec2 uv, float depth)
+{
+    vec2 texel = 1.0 / vec2(textureSize(shadowMap, 0));
+    float lit = 0.0;
+    lit += texture(shadowMap, vec3(uv + vec2(-0.5, -0.5) * texel, depth));
+    lit += texture(shadowMap, vec3(uv + vec2( 0.5, -0.5) * texel, depth));
+    lit += texture(shadowMap, vec3(uv + vec2(-0.5,  0.5) * texel, depth));
+    lit += texture(shadowMap, vec3(uv + vec2( 0.5,  0.5) * texel, depth));
+    return 1.0 - lit * 0.25;
+}
+
+float shadowPCF(sampler2DArrayShadow shadowMap, vec3 uvLayer, float depth)
+{
+    vec2 texel = 1.0 / vec2(textureSize(shadowMap, 0).xy);
+    float lit = 0.0;
+    lit += texture(shadowMap, vec4(uvLayer.xy + vec2(-0.5, -0.5) * texel, uvLayer.z, depth));
+    lit += texture(shadowMap, vec4(uvLayer.xy + vec2( 0.5, -0.5) * texel, uvLayer.z, depth));
+    lit += texture(shadowMap, vec4(uvLayer.xy + vec2(-0.5,  0.5) * texel, uvLayer.z, depth));
+    lit += texture(shadowMap, vec4(uvLayer.xy + vec2( 0.5,  0.5) * texel, uvLayer.z, depth));
+    return 1.0 - lit * 0.25;
+}
+
+// ------------------------------------------------------------
+// Vogel 圆盘，每个采样仍然是一次硬件比较
+float shadowVogel(sampler2DShadow shadowMap, vec2 uv, float depth, int taps, float radius)
+{
+    vec2 scale = radius / vec2(textureSize(shadowMap, 0));
+    float phi = interleavedGradientNoise(gl_FragCoord.xy) * 6.2831853;
+    float lit = 0.0;
+    for (int i = 0; i < taps; ++i)
+        lit += texture(shadowMap, vec3(uv + vogelDiskSample(i, taps, phi) * scale, depth));
+    return 1.0 - lit / float(taps);
+}
+
+float shadowVogel(sampler2DArrayShadow shadowMap, vec3 uvLayer, float depth, int taps, float radius)
+{
+    vec2 scale = radius / vec2(textureSize(shadowMap, 0).xy);
+    float phi = interleavedGradientNoise(gl_FragCoord.xy) * 6.2831853;
+    float lit = 0.0;
+    for (int i = 0; i < taps; ++i)
+        lit += texture(shadowMap, vec4(uvLayer.xy + vogelDiskSample(i, taps, phi) * scale, uvLayer.z, depth));
+    return 1.0 - lit / float(taps);
+}
+
+// ------------------------------------------------------------
+// VSM：切比雪夫不等式给出可见度的上界
+float chebyshevUpperBound(vec2 moments, float depth, float minVariance, float bleedReduction)
+{
+    if (depth <= moments.x)
+        return 0.0;
+    float variance = max(moments.y - moments.x * moments.x, minVariance);
+    float d = depth - moments.x;
+    float pMax = variance / (variance + d * d);
+    pMax = clamp((pMax - bleedReduction) / (1.0 - bleedReduction), 0.0, 1.0);
+    return 1.0 - pMax;
+}
+
+float shadowVSM(sampler2D momentsMap, vec2 uv, float depth, float minVariance, float bleedReduction)
+{
+    return chebyshevUpperBound(texture(momentsMap, uv).rg, depth, minVariance, bleedReduction);
+}
+
+float shadowVSM(sampler2DArray momentsMap, vec3 uvLayer, float depth, float minVariance, float bleedReduction)
+{
+    return chebyshevUpperBound(texture(momentsMap, uvLayer).rg, depth, minVariance, bleedReduction);
+}
+
+// ------------------------------------------------------------
+// ESM：exp(c·z) 经过滤后乘上 exp(-c·d)
+float shadowESM(sampler2D momentsMap, vec2 uv, float depth, float exponent)
+{
+    return 1.0 - clamp(texture(momentsMap, uv).r * exp(-exponent * depth), 0.0, 1.0);
+}
+
+float shadowESM(sampler2DArray momentsMap, vec3 uvLayer, float depth, float exponent)
+{
+    return 1.0 - clamp(texture(momentsMap, uvLayer).r * exp(-exponent * depth), 0.0, 1.0);
+}
+
+// ------------------------------------------------------------
+// 按定义的宏分派
+float filterShadow(SHADOW_MAP_2D shadowMap, vec2 uv, float depth, ShadowParams params)
+{
+#if defined(SHADOW_FILTER_VSM)
+    return shadowVSM(shadowMap, uv, depth, params.minVariance, params.bleedReduction);
+#elif defined(SHADOW_FILTER_ESM)
+    return shadowESM(shadowMap, uv, depth, params.exponent);
+#elif defined(SHADOW_FILTER_VOGEL)
+    return shadowVogel(shadowMap, uv, depth, params.taps, params.radius);
+#else
+    return shadowPCF(shadowMap, uv, depth);
+#endif
+}
+
+float filterShadow(SHADOW_MAP_ARRAY shadowMap, vec3 uvLayer, float depth, ShadowParams params)
+{
+#if defined(SHADOW_FILTER_VSM)
+    return shadowVSM(shadowMap, uvLayer, depth, params.minVariance, params.bleedReduction);
+#elif defined(SHADOW_FILTER_ESM)
+    return shadowESM(shadowMap, uvLayer, depth, params.exponent);
+#elif defined(SHADOW_FILTER_VOGEL)
+    return shadowVogel(shadowMap, uvLayer, depth, params.taps, params.radius);
+#else
+    return shadowPCF(shadowMap, uvLayer, depth);
+#endif
+}
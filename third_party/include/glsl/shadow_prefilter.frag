@@ -0,0 +1,53 @@
+#version 330 core
+out vec2 FragMoments;
+
+in vec2 TexCoords;
+
+/*
+    VSM / ESM 的可分离预过滤
+    第一趟：读深度贴图的一层，转换成矩（VSM：d, d²；ESM：exp(c·d)），横向模糊
+    第二趟：读第一趟的结果，纵向模糊，写回矩贴图数组的对应层
+*/
+
+uniform sampler2DArray depthMap;
+uniform sampler2D momentsMap;
+uniform int layer;
+uniform bool firstPass;
+uniform int radius;     // 模糊半径，0 表示不模糊
+uniform float exponent; // ESM 的指数 c
+
+vec2 toMoments(float depth)
+{
+#ifdef SHADOW_FILTER_ESM
+    return vec2(exp(exponent * depth), 0.0);
+#else
+    return vec2(depth, depth * depth);
+#endif
+}
+
+vec2 fetch(ivec2 coord)
+{
+    if (firstPass)
+        return toMoments(texelFetch(depthMap, ivec3(coord, layer), 0).r);
+    return texelFetch(momentsMap, coord, 0).rg;
+}
+
+void main()
+{
+    ivec2 size = firstPass ? textureSize(depthMap, 0).xy : textureSize(momentsMap, 0);
+    ivec2 coord = ivec2(gl_FragCoord.xy);
+    ivec2 direction = firstPass ? ivec2(1, 0) : ivec2(0, 1);
+
+    // 高斯权重，sigma 取半径的一半
+    float sigma = max(float(radius) * 0.5, 0.5);
+    vec2 sum = vec2(0.0);
+    float weightSum = 0.0;
+    for (int i = -radius; i <= radius; ++i)
+    {
+        ivec2 c = clamp(coord + direction * i, ivec2(0), size - 1);
+        float w = exp(-float(i * i) / (2.0 * sigma * sigma));
+        sum += fetch(c) * w;
+        weightSum += w;
+    }
+    FragMoments = sum / weightSum;
+}
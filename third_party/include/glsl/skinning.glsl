@@ -0,0 +1,22 @@
+/*
+    顶点蒙皮（tools/animation.h），骨骼矩阵放在纹理缓冲里，每个矩阵按列占 4 个 RGBA32F 纹素
+    paletteBase 为这个实例第一根骨骼的矩阵下标（实例号 * 骨骼数）
+    boneIDs / weights 来自 SkinVertexLayout 的 location 5 / 6，权重之和为 1
+*/
+
+mat4 fetchBoneMatrix(samplerBuffer bonePalette, int index)
+{
+    int base = index * 4;
+    return mat4(texelFetch(bonePalette, base),
+                texelFetch(bonePalette, base + 1),
+                texelFetch(bonePalette, base + 2),
+                texelFetch(bonePalette, base + 3));
+}
+
+mat4 skinMatrix(samplerBuffer bonePalette, int paletteBase, uvec4 boneIDs, vec4 weights)
+{
+    return fetchBoneMatrix(bonePalette, paletteBase + int(boneIDs.x)) * weights.x
+         + fetchBoneMatrix(bonePalette, paletteBase + int(boneIDs.y)) * weights.y
+         + fetchBoneMatrix(bonePalette, paletteBase + int(boneIDs.z)) * weights.z
+         + fetchBoneMatrix(bonePalette, paletteBase + int(boneIDs.w)) * weights.w;
+}
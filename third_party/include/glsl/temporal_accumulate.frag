@@ -0,0 +1,63 @@
+#version 330 core
+
+/*
+    时间累积（与 tools/temporal_accumulator.h 配套）
+    用当前帧的观察空间位置反算出上一帧的屏幕坐标，取历史结果和这一帧的噪声结果按累计帧数混合
+    历史信息里存上一帧的观察空间深度和累计帧数，重投影后的深度对不上（被遮挡 / 新露出来的像素）时丢弃历史
+*/
+
+layout (location = 0) out vec4 FragColor;
+// x 为观察空间深度（正值，0 表示没有几何体），y 为已累计的帧数
+layout (location = 1) out vec2 HistoryInfo;
+
+in vec2 TexCoords;
+
+uniform sampler2D currentTexture;
+// 观察空间位置，和 currentTexture 同尺寸
+uniform sampler2D positionTexture;
+uniform sampler2D historyTexture;
+uniform sampler2D historyInfo;
+
+// 当前帧观察空间 -> 上一帧观察空间
+uniform mat4 currentToPrevView;
+uniform mat4 prevProjection;
+uniform float depthTolerance;
+uniform int maxFrames;
+uniform bool resetHistory;
+
+void main()
+{
+    ivec2 pixel = ivec2(gl_FragCoord.xy);
+    vec4 current = texelFetch(currentTexture, pixel, 0);
+    vec3 position = texelFetch(positionTexture, pixel, 0).xyz;
+
+    // 背景处 G-Buffer 清成了 0，没有可重投影的几何体
+    if (position.z >= 0.0 || resetHistory)
+    {
+        FragColor = current;
+        HistoryInfo = vec2(max(-position.z, 0.0), 1.0);
+        return;
+    }
+
+    vec4 prevView = currentToPrevView * vec4(position, 1.0);
+    vec4 prevClip = prevProjection * prevView;
+    vec2 prevUV = prevClip.xy / prevClip.w * 0.5 + 0.5;
+
+    float frames = 1.0;
+    vec4 history = current;
+    if (all(greaterThanEqual(prevUV, vec2(0.0))) && all(lessThanEqual(prevUV, vec2(1.0))))
+    {
+        // 深度就近取，避免在边缘处把前后两个表面的深度插值到一起
+        vec2 info = texelFetch(historyInfo, ivec2(prevUV * vec2(textureSize(historyInfo, 0))), 0).xy;
+        float expectedDepth = -prevView.z;
+        if (info.x > 0.0 && abs(info.x - expectedDepth) < depthTolerance * expectedDepth)
+        {
+            history = texture(historyTexture, prevUV);
+            frames = min(info.y + 1.0, float(maxFrames));
+        }
+    }
+
+    // 累计帧数少时更相信当前帧，之后退化为 1 / maxFrames 的指数滑动平均
+    FragColor = mix(history, current, 1.0 / frames);
+    HistoryInfo = vec2(-position.z, frames);
+}
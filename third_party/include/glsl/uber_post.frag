@@ -0,0 +1,79 @@
+#version 330 core
+
+/*
+    合并的后处理 pass（与 tools/uber_post.h 配套）：一次读取 HDR 颜色，依次做
+        泛光叠加 -> 曝光 -> 色调映射 -> sRGB 编码 -> 3D LUT 调色
+    每一步都用宏开关，由 UberPost 按选项编译成不同的变体，没开的步骤不产生任何指令和纹理读取
+        UBER_BLOOM              叠加泛光纹理
+        UBER_AUTO_EXPOSURE      曝光取自 AutoExposure 的 1x1 纹理，否则用 exposure uniform
+        TONEMAP_REINHARD / TONEMAP_EXPOSURE / TONEMAP_ACES，都没定义时直接截断到 [0, 1]
+        UBER_SRGB               精确的 sRGB 编码（分段函数），否则输出线性值
+        UBER_COLOR_GRADING      在编码后的颜色上查 3D LUT
+*/
+
+out vec4 FragColor;
+
+in vec2 TexCoords;
+
+uniform sampler2D hdrTexture;
+#ifdef UBER_BLOOM
+uniform sampler2D bloomTexture;
+uniform float bloomStrength;
+#endif
+#ifdef UBER_AUTO_EXPOSURE
+uniform sampler2D exposureTexture;
+#else
+uniform float exposure;
+#endif
+#ifdef UBER_COLOR_GRADING
+uniform sampler3D gradingLUT;
+uniform float lutSize;
+#endif
+
+vec3 toneMap(vec3 color)
+{
+#if defined(TONEMAP_REINHARD)
+    return color / (color + vec3(1.0));
+#elif defined(TONEMAP_EXPOSURE)
+    return vec3(1.0) - exp(-color);
+#elif defined(TONEMAP_ACES)
+    // Narkowicz 对 ACES 胶片曲线的拟合
+    return clamp((color * (2.51 * color + 0.03)) / (color * (2.43 * color + 0.59) + 0.14), 0.0, 1.0);
+#else
+    return clamp(color, 0.0, 1.0);
+#endif
+}
+
+vec3 encodeSRGB(vec3 color)
+{
+    vec3 low = color * 12.92;
+    vec3 high = 1.055 * pow(color, vec3(1.0 / 2.4)) - 0.055;
+    return mix(high, low, vec3(lessThanEqual(color, vec3(0.0031308))));
+}
+
+void main()
+{
+    vec3 color = texture(hdrTexture, TexCoords).rgb;
+#ifdef UBER_BLOOM
+    color += texture(bloomTexture, TexCoords).rgb * bloomStrength;
+#endif
+
+#ifdef UBER_AUTO_EXPOSURE
+    color *= texelFetch(exposureTexture, ivec2(0), 0).g;
+#else
+    color *= exposure;
+#endif
+
+    color = toneMap(color);
+
+#ifdef UBER_SRGB
+    color = encodeSRGB(color);
+#endif
+
+#ifdef UBER_COLOR_GRADING
+    // 把 [0, 1] 映射到第一个和最后一个纹素的中心，线性过滤才不会越过边界
+    color = texture(gradingLUT, color * ((lutSize - 1.0) / lutSize) + 0.5 / lutSize).rgb;
+#endif
+
+    FragColor = vec4(color, 1.0);
+}
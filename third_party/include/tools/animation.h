@@ -0,0 +1,415 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include <glm/gtc/quaternion.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <tools/thread_pool.h>
+#include <tools/transform_graph.h>
+
+#include <cmath>
+#include <string>
+#include <vector>
+#include <iostream>
+#include <algorithm>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define ANIMATION_USE_SSE
+#endif
+
+/*
+    骨骼动画
+    1. Skeleton：节点层级（和 Model::nodes 一样按先序排列）+ 骨骼列表，每根骨骼对应一个节点和一个 offset 矩阵
+    2. AnimationClip：每个通道对应一个节点，平移、旋转、缩放各自一组关键帧，时间单位是 tick
+    3. SkeletonAnimator：很多个实例各自播放自己的动画和时间，update() 把实例分块交给线程池：
+       二分查找关键帧 -> 旋转四个一组用 SSE 做 slerp -> 按层级求世界矩阵 -> 骨骼矩阵 = globalInverse * world * offset
+    4. BonePaletteBuffer：所有实例的骨骼矩阵放进一个纹理缓冲，顶点着色器用 glsl/skinning.glsl 蒙皮
+*/
+struct Skeleton
+{
+    std::vector<int> parents;
+    std::vector<glm::mat4> bindLocals; // 没有动画通道的节点保持绑定姿势
+    std::vector<std::string> boneNames;
+    std::vector<glm::mat4> offsets;    // 模型空间 -> 骨骼空间（aiBone::mOffsetMatrix）
+    std::vector<int> boneNodes;        // 第 i 根骨骼对应的节点
+    glm::mat4 globalInverse = glm::mat4(1.0f);
+
+    size_t boneCount() const
+    {
+        return boneNames.size();
+    }
+
+    int findBone(const std::string &name) const
+    {
+        auto it = std::find(boneNames.begin(), boneNames.end(), name);
+        return it == boneNames.end() ? -1 : static_cast<int>(it - boneNames.begin());
+    }
+
+    // 同名的骨骼只加一次（多个网格共用一套骨骼），返回骨骼下标
+    int addBone(const std::string &name, const glm::mat4 &offset)
+    {
+        int bone = findBone(name);
+        if (bone >= 0)
+            return bone;
+        boneNames.push_back(name);
+        offsets.push_back(offset);
+        boneNodes.push_back(-1);
+        return static_cast<int>(boneNames.size() - 1);
+    }
+
+    // 从节点层级取父节点和绑定姿势，按名字找到每根骨骼的节点
+    void setHierarchy(const TransformGraph &nodes)
+    {
+        parents = nodes.parents;
+        bindLocals = nodes.locals;
+        globalInverse = nodes.size() ? glm::inverse(nodes.locals[0]) : glm::mat4(1.0f);
+        for (size_t i = 0; i < boneNames.size(); ++i)
+        {
+            boneNodes[i] = nodes.find(boneNames[i]);
+            if (boneNodes[i] < 0)
+                std::cout << "ERROR::SKELETON:: bone " << boneNames[i] << " has no node" << std::endl;
+        }
+    }
+};
+
+struct AnimationChannel
+{
+    int node = -1;
+    std::vector<float> positionTimes;
+    std::vector<glm::vec3> positions;
+    std::vector<float> rotationTimes;
+    std::vector<glm::quat> rotations;
+    std::vector<float> scaleTimes;
+    std::vector<glm::vec3> scales;
+};
+
+struct AnimationClip
+{
+    std::string name;
+    float duration = 0.0f; // tick
+    float ticksPerSecond = 25.0f;
+    std::vector<AnimationChannel> channels;
+};
+
+namespace AnimationMath
+{
+    // times 递增，返回 k 使 times[k] <= t < times[k + 1]（两端夹住），需要至少两个关键帧
+    inline size_t findKey(const std::vector<float> &times, float t)
+    {
+        size_t k = static_cast<size_t>(std::upper_bound(times.begin() + 1, times.end(), t) - times.begin()) - 1;
+        return std::min(k, times.size() - 2);
+    }
+
+    // t 在 [times[k], times[k + 1]] 里的比例
+    inline float keyFactor(const std::vector<float> &times, size_t k, float t)
+    {
+        float span = times[k + 1] - times[k];
+        return span > 0.0f ? glm::clamp((t - times[k]) / span, 0.0f, 1.0f) : 0.0f;
+    }
+
+    inline glm::vec3 sampleVec3(const std::vector<float> &times, const std::vector<glm::vec3> &values, float t, const glm::vec3 &fallback)
+    {
+        if (values.empty())
+            return fallback;
+        if (values.size() == 1)
+            return values[0];
+        size_t k = findKey(times, t);
+        return glm::mix(values[k], values[k + 1], keyFactor(times, k, t));
+    }
+
+    // out[i] = slerp(a[i], b[i], t[i])，走最短路径
+    // SSE 时四个一组，acos / sin 用 Eberly 的多项式近似（A Fast and Accurate Algorithm for Computing SLERP），
+    // 只有乘加，float 下和 glm::slerp 相差不超过 1e-4（相邻关键帧夹角小，实际远小于这个）；剩下不满四个的用 glm::slerp
+    inline void slerpBatch(const glm::quat *a, const glm::quat *b, const float *t, glm::quat *out, size_t count)
+    {
+        size_t i = 0;
+#if defined(ANIMATION_USE_SSE)
+        constexpr float onePlusMu = 1.90110745351730037f;
+        static const float u[8] = { 1.0f / (1 * 3), 1.0f / (2 * 5), 1.0f / (3 * 7), 1.0f / (4 * 9),
+                                    1.0f / (5 * 11), 1.0f / (6 * 13), 1.0f / (7 * 15), onePlusMu / (8 * 17) };
+        static const float v[8] = { 1.0f / 3, 2.0f / 5, 3.0f / 7, 4.0f / 9,
+                                    5.0f / 11, 6.0f / 13, 7.0f / 15, onePlusMu * 8 / 17 };
+        const __m128 one = _mm_set1_ps(1.0f);
+        const __m128 signBit = _mm_set1_ps(-0.0f);
+        for (; i + 4 <= count; i += 4)
+        {
+            // 四个四元数转成 SoA
+            alignas(16) float ax[4], ay[4], az[4], aw[4], bx[4], by[4], bz[4], bw[4];
+            for (int lane = 0; lane < 4; ++lane)
+            {
+                const glm::quat &qa = a[i + lane];
+                const glm::quat &qb = b[i + lane];
+                ax[lane] = qa.x; ay[lane] = qa.y; az[lane] = qa.z; aw[lane] = qa.w;
+                bx[lane] = qb.x; by[lane] = qb.y; bz[lane] = qb.z; bw[lane] = qb.w;
+            }
+            __m128 Ax = _mm_load_ps(ax), Ay = _mm_load_ps(ay), Az = _mm_load_ps(az), Aw = _mm_load_ps(aw);
+            __m128 Bx = _mm_load_ps(bx), By = _mm_load_ps(by), Bz = _mm_load_ps(bz), Bw = _mm_load_ps(bw);
+
+            __m128 x = _mm_add_ps(_mm_add_ps(_mm_mul_ps(Ax, Bx), _mm_mul_ps(Ay, By)), _mm_add_ps(_mm_mul_ps(Az, Bz), _mm_mul_ps(Aw, Bw)));
+            // 点积为负时把 b 取反，走最短路径
+            __m128 sign = _mm_and_ps(x, signBit);
+            x = _mm_xor_ps(x, sign);
+            Bx = _mm_xor_ps(Bx, sign);
+            By = _mm_xor_ps(By, sign);
+            Bz = _mm_xor_ps(Bz, sign);
+            Bw = _mm_xor_ps(Bw, sign);
+
+            __m128 T = _mm_loadu_ps(t + i);
+            __m128 D = _mm_sub_ps(one, T);
+            __m128 sqrT = _mm_mul_ps(T, T);
+            __m128 sqrD = _mm_mul_ps(D, D);
+            __m128 xm1 = _mm_sub_ps(x, one);
+            __m128 fT = one, fD = one;
+            for (int k = 7; k >= 0; --k)
+            {
+                __m128 uk = _mm_set1_ps(u[k]), vk = _mm_set1_ps(v[k]);
+                fT = _mm_add_ps(one, _mm_mul_ps(_mm_mul_ps(_mm_sub_ps(_mm_mul_ps(uk, sqrT), vk), xm1), fT));
+                fD = _mm_add_ps(one, _mm_mul_ps(_mm_mul_ps(_mm_sub_ps(_mm_mul_ps(uk, sqrD), vk), xm1), fD));
+            }
+            __m128 cT = _mm_mul_ps(T, fT);
+            __m128 cD = _mm_mul_ps(D, fD);
+
+            _mm_store_ps(ax, _mm_add_ps(_mm_mul_ps(Ax, cD), _mm_mul_ps(Bx, cT)));
+            _mm_store_ps(ay, _mm_add_ps(_mm_mul_ps(Ay, cD), _mm_mul_ps(By, cT)));
+            _mm_store_ps(az, _mm_add_ps(_mm_mul_ps(Az, cD), _mm_mul_ps(Bz, cT)));
+            _mm_store_ps(aw, _mm_add_ps(_mm_mul_ps(Aw, cD), _mm_mul_ps(Bw, cT)));
+            for (int lane = 0; lane < 4; ++lane)
+                out[i + lane] = glm::quat(aw[lane], ax[lane], ay[lane], az[lane]);
+        }
+#endif
+        for (; i < count; ++i)
+            out[i] = glm::slerp(a[i], b[i], t[i]);
+    }
+}
+
+class SkeletonAnimator
+{
+public:
+    struct Instance
+    {
+        int clip = 0;
+        float time = 0.0f; // 秒
+        float speed = 1.0f;
+    };
+
+    // false 时逐个用 glm::slerp，用来对比
+    bool simdSlerp = true;
+    std::vector<Instance> instances;
+    // 每个实例 boneCount() 个骨骼矩阵，实例 i 从 i * boneCount() 开始
+    std::vector<glm::mat4> palettes;
+
+    SkeletonAnimator(const Skeleton &skeleton, const std::vector<AnimationClip> &clips, size_t instanceCount = 1)
+        : skeleton(&skeleton), clips(&clips)
+    {
+        resize(instanceCount);
+    }
+
+    void resize(size_t instanceCount)
+    {
+        instances.resize(instanceCount);
+        palettes.assign(instanceCount * boneCount(), glm::mat4(1.0f));
+    }
+
+    size_t boneCount() const
+    {
+        return skeleton->boneCount();
+    }
+
+    const glm::mat4 *palette(size_t instance) const
+    {
+        return palettes.data() + instance * boneCount();
+    }
+
+    // 推进每个实例的时间并重新采样；pool 为空时在当前线程上完成，grain 为每块的实例数
+    void update(float deltaTime, ThreadPool *pool = nullptr, size_t grain = 16)
+    {
+        if (clips->empty() || boneCount() == 0)
+            return;
+        for (Instance &instance : instances)
+            instance.time += deltaTime * instance.speed;
+
+        if (pool)
+            pool->parallelFor(instances.size(), grain, [this](size_t begin, size_t end) { sampleRange(begin, end); });
+        else
+            sampleRange(0, instances.size());
+    }
+
+private:
+    const Skeleton *skeleton;
+    const std::vector<AnimationClip> *clips;
+
+    // 每个线程自己的临时数组，块之间复用
+    struct Scratch
+    {
+        std::vector<glm::vec3> translations;
+        std::vector<glm::vec3> scales;
+        std::vector<glm::quat> rotationsFrom;
+        std::vector<glm::quat> rotationsTo;
+        std::vector<float> factors;
+        std::vector<glm::quat> rotations;
+        std::vector<glm::mat4> locals;
+        std::vector<glm::mat4> worlds;
+    };
+
+    float clipTicks(const Instance &instance) const
+    {
+        const AnimationClip &clip = (*clips)[instance.clip];
+        float ticks = instance.time * clip.ticksPerSecond;
+        if (clip.duration <= 0.0f)
+            return 0.0f;
+        ticks = std::fmod(ticks, clip.duration);
+        return ticks < 0.0f ? ticks + clip.duration : ticks;
+    }
+
+    void sampleRange(size_t begin, size_t end)
+    {
+        using namespace AnimationMath;
+        thread_local Scratch scratch;
+        scratch.translations.clear();
+        scratch.scales.clear();
+        scratch.rotationsFrom.clear();
+        scratch.rotationsTo.clear();
+        scratch.factors.clear();
+
+        // 1. 每个实例、每个通道二分查找关键帧；平移和缩放直接插值，旋转只记下两端和比例，留给下一步批量 slerp
+        for (size_t i = begin; i < end; ++i)
+        {
+            const AnimationClip &clip = (*clips)[instances[i].clip];
+            const float ticks = clipTicks(instances[i]);
+            for (const AnimationChannel &channel : clip.channels)
+            {
+                const glm::mat4 &bind = skeleton->bindLocals[glm::max(channel.node, 0)];
+                scratch.translations.push_back(sampleVec3(channel.positionTimes, channel.positions, ticks, glm::vec3(bind[3])));
+                scratch.scales.push_back(sampleVec3(channel.scaleTimes, channel.scales, ticks, glm::vec3(1.0f)));
+                if (channel.rotations.size() < 2)
+                {
+                    glm::quat rotation = channel.rotations.empty() ? glm::quat_cast(glm::mat3(bind)) : channel.rotations[0];
+                    scratch.rotationsFrom.push_back(rotation);
+                    scratch.rotationsTo.push_back(rotation);
+                    scratch.factors.push_back(0.0f);
+                    continue;
+                }
+                size_t k = findKey(channel.rotationTimes, ticks);
+                scratch.rotationsFrom.push_back(channel.rotations[k]);
+                scratch.rotationsTo.push_back(channel.rotations[k + 1]);
+                scratch.factors.push_back(keyFactor(channel.rotationTimes, k, ticks));
+            }
+        }
+
+        // 2. 这一块里所有实例的旋转一起插值
+        const size_t rotationCount = scratch.factors.size();
+        scratch.rotations.resize(rotationCount);
+        if (simdSlerp)
+            slerpBatch(scratch.rotationsFrom.data(), scratch.rotationsTo.data(), scratch.factors.data(), scratch.rotations.data(), rotationCount);
+        else
+            for (size_t r = 0; r < rotationCount; ++r)
+                scratch.rotations[r] = glm::slerp(scratch.rotationsFrom[r], scratch.rotationsTo[r], scratch.factors[r]);
+
+        // 3. 局部矩阵 -> 按先序求世界矩阵 -> 骨骼矩阵
+        const size_t nodeCount = skeleton->parents.size();
+        const size_t bones = boneCount();
+        scratch.worlds.resize(nodeCount);
+        size_t key = 0;
+        for (size_t i = begin; i < end; ++i)
+        {
+            scratch.locals = skeleton->bindLocals;
+            for (const AnimationChannel &channel : (*clips)[instances[i].clip].channels)
+            {
+                if (channel.node >= 0)
+                {
+                    glm::mat4 local = glm::mat4_cast(glm::normalize(scratch.rotations[key]));
+                    local[0] *= scratch.scales[key].x;
+                    local[1] *= scratch.scales[key].y;
+                    local[2] *= scratch.scales[key].z;
+                    local[3] = glm::vec4(scratch.translations[key], 1.0f);
+                    scratch.locals[channel.node] = local;
+                }
+                ++key;
+            }
+
+            for (size_t n = 0; n < nodeCount; ++n)
+            {
+                int parent = skeleton->parents[n];
+                if (parent < 0)
+                    scratch.worlds[n] = scratch.locals[n];
+                else
+                    TransformGraph::multiply(scratch.worlds[parent], scratch.locals[n], scratch.worlds[n]);
+            }
+
+            glm::mat4 *palette = palettes.data() + i * bones;
+            for (size_t bone = 0; bone < bones; ++bone)
+            {
+                int node = skeleton->boneNodes[bone];
+                glm::mat4 boneWorld = node < 0 ? glm::mat4(1.0f) : scratch.worlds[node];
+                TransformGraph::multiply(skeleton->globalInverse, boneWorld, boneWorld);
+                TransformGraph::multiply(boneWorld, skeleton->offsets[bone], palette[bone]);
+            }
+        }
+    }
+};
+
+/*
+    所有实例的骨骼矩阵放在一个纹理缓冲里（GL_RGBA32F，每个矩阵按列占 4 个纹素），
+    比 UBO 的 64KB 限制大得多，1000 个实例 x 几十根骨骼也放得下；每帧整体重新上传（先孤立旧的存储）
+*/
+class BonePaletteBuffer
+{
+public:
+    BonePaletteBuffer()
+    {
+        glGenBuffers(1, &buffer);
+        glGenTextures(1, &texture);
+    }
+
+    void upload(const std::vector<glm::mat4> &palettes)
+    {
+        const size_t size = palettes.size() * sizeof(glm::mat4);
+        glBindBuffer(GL_TEXTURE_BUFFER, buffer);
+        if (size != capacity)
+        {
+            GLint maxTexels = 0;
+            glGetIntegerv(GL_MAX_TEXTURE_BUFFER_SIZE, &maxTexels);
+            if (static_cast<long long>(palettes.size()) * 4 > maxTexels)
+                std::cout << "ERROR::BONE_PALETTE:: " << palettes.size() << " matrices exceed GL_MAX_TEXTURE_BUFFER_SIZE" << std::endl;
+            glBufferData(GL_TEXTURE_BUFFER, size, palettes.data(), GL_STREAM_DRAW);
+            capacity = size;
+            glBindTexture(GL_TEXTURE_BUFFER, texture);
+            glTexBuffer(GL_TEXTURE_BUFFER, GL_RGBA32F, buffer);
+            glBindTexture(GL_TEXTURE_BUFFER, 0);
+        }
+        else
+        {
+            glBufferData(GL_TEXTURE_BUFFER, size, nullptr, GL_STREAM_DRAW);
+            glBufferSubData(GL_TEXTURE_BUFFER, 0, size, palettes.data());
+        }
+        glBindBuffer(GL_TEXTURE_BUFFER, 0);
+    }
+
+    // 着色器里为 samplerBuffer
+    void bind(GLuint unit) const
+    {
+        glActiveTexture(GL_TEXTURE0 + unit);
+        glBindTexture(GL_TEXTURE_BUFFER, texture);
+        glActiveTexture(GL_TEXTURE0);
+    }
+
+    size_t bytes() const
+    {
+        return capacity;
+    }
+
+    void dispose()
+    {
+        glDeleteBuffers(1, &buffer);
+        glDeleteTextures(1, &texture);
+        buffer = texture = 0;
+        capacity = 0;
+    }
+
+private:
+    unsigned int buffer = 0;
+    unsigned int texture = 0;
+    size_t capacity = 0;
+};
@@ -0,0 +1,235 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include <tools/shader.h>
+#include <tools/compute_shader.h>
+
+#include <iostream>
+#include <vector>
+
+/*
+    自动曝光：统计 HDR 画面的平均亮度，按人眼适应的速度平滑过渡，算出色调映射用的曝光
+    1. 支持计算着色器（GL 4.3+）时用 glsl/luminance_histogram.comp 统计 log 亮度直方图，
+       再用 glsl/luminance_average.comp 求平均（不计全黑的像素）并做适应
+    2. 否则退回片段着色器：log 亮度画进 256x256 的纹理，glGenerateMipmap 平均到 1x1，glsl/exposure_adapt.frag 做适应
+    结果一直留在 GPU 上，不读回 CPU：texture() 是 1x1 的 RG32F 纹理，r 为适应后的平均亮度，g 为曝光
+    色调映射时直接 texelFetch(exposureTexture, ivec2(0), 0).g
+*/
+class AutoExposure
+{
+public:
+    static constexpr int BIN_COUNT = 256;
+    // 片段着色器版本 log 亮度纹理的边长，必须是 2 的幂
+    static constexpr int LOG_LUMINANCE_SIZE = 256;
+
+    // 参与统计的 log2 亮度范围，超出的截到两端
+    float minLogLuminance = -8.0f;
+    float maxLogLuminance = 4.0f;
+    // 平均亮度映射到的中灰值
+    float keyValue = 0.18f;
+    // 适应速度，越大越快
+    float adaptationSpeed = 1.5f;
+    bool useCompute = false;
+
+    AutoExposure()
+        : logShader(GLSL_INCLUDE_DIR "/fullscreen_triangle.vert", GLSL_INCLUDE_DIR "/luminance_log.frag"),
+          adaptShader(GLSL_INCLUDE_DIR "/fullscreen_triangle.vert", GLSL_INCLUDE_DIR "/exposure_adapt.frag")
+    {
+        if (ComputeGL::supported)
+        {
+            histogramShader = ComputeShader(GLSL_INCLUDE_DIR "/luminance_histogram.comp");
+            averageShader = ComputeShader(GLSL_INCLUDE_DIR "/luminance_average.comp");
+            useCompute = true;
+
+            std::vector<GLuint> zeros(BIN_COUNT, 0);
+            glGenBuffers(1, &histogramBuffer);
+            glBindBuffer(ComputeGL::SHADER_STORAGE_BUFFER, histogramBuffer);
+            glBufferData(ComputeGL::SHADER_STORAGE_BUFFER, BIN_COUNT * sizeof(GLuint), zeros.data(), GL_DYNAMIC_COPY);
+            glBindBuffer(ComputeGL::SHADER_STORAGE_BUFFER, 0);
+        }
+
+        logShader.use();
+        logShader.setInt("hdrTexture", 0);
+        adaptShader.use();
+        adaptShader.setInt("logLuminance", 0);
+        adaptShader.setInt("previousExposure", 1);
+
+        glGenTextures(1, &logLuminanceTexture);
+        glBindTexture(GL_TEXTURE_2D, logLuminanceTexture);
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_R16F, LOG_LUMINANCE_SIZE, LOG_LUMINANCE_SIZE, 0, GL_RED, GL_FLOAT, nullptr);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        glGenerateMipmap(GL_TEXTURE_2D);
+
+        // 两张 1x1 的结果纹理乒乓使用，计算着色器版本原地读写 exposureTextures[0]
+        const float initial[2] = { 1.0f, keyValue };
+        glGenTextures(2, exposureTextures);
+        glGenFramebuffers(3, FBOs);
+        for (int i = 0; i < 2; ++i)
+        {
+            glBindTexture(GL_TEXTURE_2D, exposureTextures[i]);
+            glTexImage2D(GL_TEXTURE_2D, 0, GL_RG32F, 1, 1, 0, GL_RG, GL_FLOAT, initial);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+            attach(FBOs[i], exposureTextures[i]);
+        }
+        attach(FBOs[2], logLuminanceTexture);
+        glBindTexture(GL_TEXTURE_2D, 0);
+
+        glGenVertexArrays(1, &emptyVAO);
+    }
+
+    bool computeAvailable() const
+    {
+        return histogramShader.ID != 0 && averageShader.ID != 0;
+    }
+
+    // 下一次 update 直接跳到当前画面的亮度，不做过渡（比如切换场景）
+    void reset()
+    {
+        resetHistory = true;
+    }
+
+    // hdrTexture 为线性的 HDR 颜色，width / height 为它的尺寸，deltaTime 单位为秒
+    unsigned int update(unsigned int hdrTexture, int width, int height, float deltaTime)
+    {
+        float adaptation = 1.0f - glm::exp(-deltaTime * adaptationSpeed);
+        if (useCompute && computeAvailable())
+            updateCompute(hdrTexture, width, height, adaptation);
+        else
+            updateFragment(hdrTexture, adaptation);
+        resetHistory = false;
+        return texture();
+    }
+
+    unsigned int texture() const
+    {
+        return exposureTextures[current];
+    }
+
+    void dispose()
+    {
+        glDeleteTextures(1, &logLuminanceTexture);
+        glDeleteTextures(2, exposureTextures);
+        glDeleteFramebuffers(3, FBOs);
+        glDeleteBuffers(1, &histogramBuffer);
+        glDeleteVertexArrays(1, &emptyVAO);
+        glDeleteProgram(logShader.ID);
+        glDeleteProgram(adaptShader.ID);
+        histogramShader.dispose();
+        averageShader.dispose();
+        logLuminanceTexture = histogramBuffer = emptyVAO = 0;
+        exposureTextures[0] = exposureTextures[1] = 0;
+        FBOs[0] = FBOs[1] = FBOs[2] = 0;
+    }
+
+private:
+    Shader logShader;
+    Shader adaptShader;
+    ComputeShader histogramShader;
+    ComputeShader averageShader;
+    unsigned int histogramBuffer = 0;
+    unsigned int logLuminanceTexture = 0;
+    unsigned int exposureTextures[2] = {};
+    // 0 / 1 为两张结果纹理，2 为 log 亮度纹理
+    unsigned int FBOs[3] = {};
+    unsigned int emptyVAO = 0;
+    int current = 0;
+    bool resetHistory = true;
+
+    static void attach(unsigned int FBO, unsigned int texture)
+    {
+        glBindFramebuffer(GL_FRAMEBUFFER, FBO);
+        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, texture, 0);
+        if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+            std::cout << "ERROR::FRAMEBUFFER:: Auto exposure framebuffer is not complete!" << std::endl;
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    }
+
+    void updateCompute(unsigned int hdrTexture, int width, int height, float adaptation)
+    {
+        // 从片段着色器版本切过来时，上一帧的结果可能在另一张纹理里
+        if (current != 0)
+        {
+            current = 0;
+            resetHistory = true;
+        }
+        glBindBufferBase(ComputeGL::SHADER_STORAGE_BUFFER, 0, histogramBuffer);
+
+        histogramShader.use();
+        histogramShader.setInt("hdrTexture", 0);
+        histogramShader.setFloat("minLogLuminance", minLogLuminance);
+        histogramShader.setFloat("inverseLogLuminanceRange", 1.0f / (maxLogLuminance - minLogLuminance));
+        glActiveTexture(GL_TEXTURE0);
+        glBindTexture(GL_TEXTURE_2D, hdrTexture);
+        histogramShader.dispatch((width + 15) / 16, (height + 15) / 16);
+        ComputeGL::memoryBarrier(ComputeGL::SHADER_STORAGE_BARRIER_BIT);
+
+        averageShader.use();
+        glUniform1ui(glGetUniformLocation(averageShader.ID, "pixelCount"), static_cast<GLuint>(width * height));
+        averageShader.setFloat("minLogLuminance", minLogLuminance);
+        averageShader.setFloat("logLuminanceRange", maxLogLuminance - minLogLuminance);
+        averageShader.setFloat("adaptation", adaptation);
+        averageShader.setFloat("keyValue", keyValue);
+        averageShader.setBool("resetHistory", resetHistory);
+        ComputeGL::bindImageTexture(0, exposureTextures[0], 0, GL_FALSE, 0, GL_READ_WRITE, GL_RG32F);
+        averageShader.dispatch(1);
+        ComputeGL::memoryBarrier(ComputeGL::TEXTURE_FETCH_BARRIER_BIT | ComputeGL::SHADER_IMAGE_ACCESS_BARRIER_BIT);
+    }
+
+    void updateFragment(unsigned int hdrTexture, float adaptation)
+    {
+        GLint viewport[4];
+        glGetIntegerv(GL_VIEWPORT, viewport);
+        GLboolean depthTest = glIsEnabled(GL_DEPTH_TEST);
+        GLboolean blend = glIsEnabled(GL_BLEND);
+        glDisable(GL_DEPTH_TEST);
+        glDisable(GL_BLEND);
+        glBindVertexArray(emptyVAO);
+
+        // 1. log 亮度，再平均到 1x1
+        logShader.use();
+        logShader.setFloat("minLogLuminance", minLogLuminance);
+        logShader.setFloat("maxLogLuminance", maxLogLuminance);
+        glActiveTexture(GL_TEXTURE0);
+        glBindTexture(GL_TEXTURE_2D, hdrTexture);
+        glBindFramebuffer(GL_FRAMEBUFFER, FBOs[2]);
+        glViewport(0, 0, LOG_LUMINANCE_SIZE, LOG_LUMINANCE_SIZE);
+        glDrawArrays(GL_TRIANGLES, 0, 3);
+        glBindTexture(GL_TEXTURE_2D, logLuminanceTexture);
+        glGenerateMipmap(GL_TEXTURE_2D);
+
+        // 2. 和上一帧的结果混合
+        int previous = current;
+        current = 1 - current;
+        adaptShader.use();
+        adaptShader.setInt("topLevel", topLevel());
+        adaptShader.setFloat("adaptation", adaptation);
+        adaptShader.setFloat("keyValue", keyValue);
+        adaptShader.setBool("resetHistory", resetHistory);
+        glActiveTexture(GL_TEXTURE1);
+        glBindTexture(GL_TEXTURE_2D, exposureTextures[previous]);
+        glBindFramebuffer(GL_FRAMEBUFFER, FBOs[current]);
+        glViewport(0, 0, 1, 1);
+        glDrawArrays(GL_TRIANGLES, 0, 3);
+
+        glBindVertexArray(0);
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+        glActiveTexture(GL_TEXTURE0);
+        glViewport(viewport[0], viewport[1], viewport[2], viewport[3]);
+        if (blend)
+            glEnable(GL_BLEND);
+        if (depthTest)
+            glEnable(GL_DEPTH_TEST);
+    }
+
+    static int topLevel()
+    {
+        int level = 0;
+        for (int size = LOG_LUMINANCE_SIZE; size > 1; size >>= 1)
+            ++level;
+        return level;
+    }
+};
@@ -0,0 +1,159 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <tools/camera.h>
+
+#include <array>
+#include <iostream>
+
+/*
+    级联阴影贴图（Cascaded Shadow Maps）
+    1. 按对数/均匀混合的方式把摄像机视锥 [near, shadowDistance] 切成 N 段
+    2. 每段视锥用一个包围球包住，球的半径只和视锥形状有关，摄像机旋转时不变，正交投影的大小也就不变
+    3. 球心变换到光源空间后按一个阴影纹素的大小取整，摄像机平移时阴影不会闪烁
+    4. 每段只渲染和它的正交盒相交的投射物，光源方向上超出近平面的投射物用 GL_DEPTH_CLAMP 压到近平面
+    所有级联放在一张 GL_TEXTURE_2D_ARRAY 深度纹理里，一层一段
+*/
+class CascadedShadowMap
+{
+public:
+    static const int MAX_CASCADES = 8;
+
+    unsigned int FBO = 0;
+    unsigned int depthArray = 0;
+    int resolution = 0;
+    int cascadeCount = 0;
+    // 0 为均匀划分，1 为纯对数划分
+    float splitLambda = 0.75f;
+
+    // 每段在观察空间下的远平面距离
+    std::array<float, MAX_CASCADES> splits{};
+    std::array<float, MAX_CASCADES> radii{};
+    std::array<glm::mat4, MAX_CASCADES> lightSpaceMatrices{};
+
+    CascadedShadowMap() = default;
+
+    CascadedShadowMap(int resolution, int cascadeCount)
+        : resolution(resolution), cascadeCount(glm::clamp(cascadeCount, 1, MAX_CASCADES))
+    {
+        glGenTextures(1, &depthArray);
+        glBindTexture(GL_TEXTURE_2D_ARRAY, depthArray);
+        glTexImage3D(GL_TEXTURE_2D_ARRAY, 0, GL_DEPTH_COMPONENT32F, resolution, resolution, MAX_CASCADES, 0, GL_DEPTH_COMPONENT, GL_FLOAT, nullptr);
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_BORDER);
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_BORDER);
+        float borderColor[] = { 1.0f, 1.0f, 1.0f, 1.0f };
+        glTexParameterfv(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_BORDER_COLOR, borderColor);
+        glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+
+        glGenFramebuffers(1, &FBO);
+        glBindFramebuffer(GL_FRAMEBUFFER, FBO);
+        glFramebufferTextureLayer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, depthArray, 0, 0);
+        glDrawBuffer(GL_NONE);
+        glReadBuffer(GL_NONE);
+        if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+            std::cout << "ERROR::FRAMEBUFFER:: Cascaded shadow framebuffer is not complete!" << std::endl;
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    }
+
+    // lightDir 为光线的传播方向（从光源指向场景）
+    void update(const Camera &camera, float aspect, float nearPlane, float shadowDistance, const glm::vec3 &lightDir)
+    {
+        glm::vec3 dir = glm::normalize(lightDir);
+        glm::vec3 up = glm::abs(dir.y) > 0.99f ? glm::vec3(0.0f, 0.0f, 1.0f) : glm::vec3(0.0f, 1.0f, 0.0f);
+        // 光源空间原点固定在世界原点，纹素网格才不会随摄像机移动
+        lightView = glm::lookAt(glm::vec3(0.0f), dir, up);
+
+        float tanHalfFov = glm::tan(glm::radians(camera.Zoom) * 0.5f);
+        float prevSplit = nearPlane;
+        for (int i = 0; i < cascadeCount; ++i)
+        {
+            float p = static_cast<float>(i + 1) / cascadeCount;
+            float logSplit = nearPlane * glm::pow(shadowDistance / nearPlane, p);
+            float uniformSplit = nearPlane + (shadowDistance - nearPlane) * p;
+            splits[i] = glm::mix(uniformSplit, logSplit, splitLambda);
+
+            // 视锥切片的 8 个角点
+            glm::vec3 corners[8];
+            int n = 0;
+            for (float d : { prevSplit, splits[i] })
+            {
+                glm::vec3 center = camera.Position + camera.Front * d;
+                glm::vec3 halfUp = camera.Up * (d * tanHalfFov);
+                glm::vec3 halfRight = camera.Right * (d * tanHalfFov * aspect);
+                corners[n++] = center - halfRight - halfUp;
+                corners[n++] = center + halfRight - halfUp;
+                corners[n++] = center - halfRight + halfUp;
+                corners[n++] = center + halfRight + halfUp;
+            }
+
+            glm::vec3 sphereCenter(0.0f);
+            for (const glm::vec3 &c : corners)
+                sphereCenter += c;
+            sphereCenter /= 8.0f;
+            float radius = 0.0f;
+            for (const glm::vec3 &c : corners)
+                radius = glm::max(radius, glm::length(c - sphereCenter));
+            // 取整去掉浮点误差带来的抖动
+            radius = glm::ceil(radius * 16.0f) / 16.0f;
+            radii[i] = radius;
+
+            // 球心按纹素取整
+            glm::vec3 center = glm::vec3(lightView * glm::vec4(sphereCenter, 1.0f));
+            float texelSize = 2.0f * radius / resolution;
+            center.x = glm::floor(center.x / texelSize) * texelSize;
+            center.y = glm::floor(center.y / texelSize) * texelSize;
+            centers[i] = center;
+
+            glm::mat4 lightProjection = glm::ortho(center.x - radius, center.x + radius,
+                center.y - radius, center.y + radius,
+                -(center.z + radius), -(center.z - radius));
+            lightSpaceMatrices[i] = lightProjection * lightView;
+
+            prevSplit = splits[i];
+        }
+    }
+
+    // 投射物的包围球是否落在第 cascade 段的正交盒内，朝向光源一侧不设上限
+    bool intersects(int cascade, const glm::vec3 &center, float radius) const
+    {
+        glm::vec3 c = glm::vec3(lightView * glm::vec4(center, 1.0f));
+        const glm::vec3 &box = centers[cascade];
+        float extent = radii[cascade] + radius;
+        return glm::abs(c.x - box.x) <= extent
+            && glm::abs(c.y - box.y) <= extent
+            && c.z >= box.z - extent;
+    }
+
+    // 开始渲染第 cascade 段，调用者负责之后恢复视口和帧缓冲
+    void beginCascade(int cascade)
+    {
+        if (cascade == 0)
+            glEnable(GL_DEPTH_CLAMP);
+        glBindFramebuffer(GL_FRAMEBUFFER, FBO);
+        glFramebufferTextureLayer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, depthArray, 0, cascade);
+        glViewport(0, 0, resolution, resolution);
+        glClear(GL_DEPTH_BUFFER_BIT);
+    }
+
+    void end()
+    {
+        glDisable(GL_DEPTH_CLAMP);
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    }
+
+    void dispose()
+    {
+        glDeleteTextures(1, &depthArray);
+        glDeleteFramebuffers(1, &FBO);
+        depthArray = FBO = 0;
+    }
+
+private:
+    glm::mat4 lightView = glm::mat4(1.0f);
+    std::array<glm::vec3, MAX_CASCADES> centers{};
+};
@@ -0,0 +1,144 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include <tools/shader.h>
+
+#include <string>
+#include <fstream>
+#include <sstream>
+#include <iostream>
+#include <string_view>
+
+/*
+    计算着色器
+    项目里的 glad 只生成到 GL 3.3，没有计算着色器相关的函数和枚举，这里在运行时自己加载
+    上下文版本不到 4.3（或驱动没有导出这些函数）时 ComputeGL::supported 为 false，调用方应退回片段着色器
+*/
+namespace ComputeGL
+{
+    constexpr GLenum COMPUTE_SHADER = 0x91B9;
+    constexpr GLbitfield SHADER_IMAGE_ACCESS_BARRIER_BIT = 0x00000020;
+    constexpr GLbitfield TEXTURE_FETCH_BARRIER_BIT = 0x00000008;
+    constexpr GLbitfield SHADER_STORAGE_BARRIER_BIT = 0x00002000;
+    constexpr GLenum SHADER_STORAGE_BUFFER = 0x90D2;
+
+    typedef void (APIENTRYP PFNDISPATCHCOMPUTE)(GLuint numGroupsX, GLuint numGroupsY, GLuint numGroupsZ);
+    typedef void (APIENTRYP PFNMEMORYBARRIER)(GLbitfield barriers);
+    typedef void (APIENTRYP PFNBINDIMAGETEXTURE)(GLuint unit, GLuint texture, GLint level, GLboolean layered, GLint layer, GLenum access, GLenum format);
+
+    inline PFNDISPATCHCOMPUTE dispatchCompute = nullptr;
+    inline PFNMEMORYBARRIER memoryBarrier = nullptr;
+    inline PFNBINDIMAGETEXTURE bindImageTexture = nullptr;
+    inline bool supported = false;
+
+    // 在 gladLoadGLLoader 之后调用，传入同一个加载函数
+    inline bool load(GLADloadproc loader)
+    {
+        GLint major = 0, minor = 0;
+        glGetIntegerv(GL_MAJOR_VERSION, &major);
+        glGetIntegerv(GL_MINOR_VERSION, &minor);
+        if (major < 4 || (major == 4 && minor < 3))
+            return supported = false;
+
+        dispatchCompute = reinterpret_cast<PFNDISPATCHCOMPUTE>(loader("glDispatchCompute"));
+        memoryBarrier = reinterpret_cast<PFNMEMORYBARRIER>(loader("glMemoryBarrier"));
+        bindImageTexture = reinterpret_cast<PFNBINDIMAGETEXTURE>(loader("glBindImageTexture"));
+        supported = dispatchCompute && memoryBarrier && bindImageTexture;
+        return supported;
+    }
+}
+
+class ComputeShader
+{
+public:
+    unsigned int ID = 0;
+
+    ComputeShader() = default;
+
+    ComputeShader(std::string_view computePath, std::string_view defines = { })
+    {
+        if (!ComputeGL::supported)
+            return;
+
+        std::string code;
+        std::ifstream file;
+        file.exceptions(std::ifstream::failbit | std::ifstream::badbit);
+        try
+        {
+            file.open(computePath.data());
+            std::stringstream stream;
+            stream << file.rdbuf();
+            file.close();
+            code = stream.str();
+        }
+        catch (const std::ifstream::failure &)
+        {
+            std::cerr << "ERROR::SHADER::FILE_NOT_SUCCESFULLY_READ: " << computePath << std::endl;
+        }
+        code = Shader::preprocess(code, computePath, defines);
+        const char *source = code.c_str();
+
+        unsigned int compute = glCreateShader(ComputeGL::COMPUTE_SHADER);
+        glShaderSource(compute, 1, &source, NULL);
+        glCompileShader(compute);
+        GLint success;
+        GLchar infoLog[1024];
+        glGetShaderiv(compute, GL_COMPILE_STATUS, &success);
+        if (!success)
+        {
+            glGetShaderInfoLog(compute, 1024, NULL, infoLog);
+            std::cout << "ERROR::SHADER_COMPILATION_ERROR of type: COMPUTE\n"
+                      << infoLog << "\n -- --------------------------------------------------- -- " << std::endl;
+        }
+
+        ID = glCreateProgram();
+        glAttachShader(ID, compute);
+        glLinkProgram(ID);
+        glGetProgramiv(ID, GL_LINK_STATUS, &success);
+        if (!success)
+        {
+            glGetProgramInfoLog(ID, 1024, NULL, infoLog);
+            std::cout << "ERROR::PROGRAM_LINKING_ERROR of type: PROGRAM\n"
+                      << infoLog << "\n -- --------------------------------------------------- -- " << std::endl;
+        }
+        glDeleteShader(compute);
+    }
+
+    void use() const
+    {
+        glUseProgram(ID);
+    }
+
+    void dispatch(GLuint x, GLuint y = 1, GLuint z = 1) const
+    {
+        ComputeGL::dispatchCompute(x, y, z);
+    }
+
+    void setInt(const std::string_view name, int value) const
+    {
+        glUniform1i(glGetUniformLocation(ID, name.data()), value);
+    }
+
+    void setFloat(const std::string_view name, float value) const
+    {
+        glUniform1f(glGetUniformLocation(ID, name.data()), value);
+    }
+
+    void setBool(const std::string_view name, bool value) const
+    {
+        glUniform1i(glGetUniformLocation(ID, name.data()), (int)value);
+    }
+
+    void setIVec2(const std::string_view name, const glm::ivec2 &value) const
+    {
+        glUniform2iv(glGetUniformLocation(ID, name.data()), 1, &value[0]);
+    }
+
+    void dispose()
+    {
+        glDeleteProgram(ID);
+        ID = 0;
+    }
+};
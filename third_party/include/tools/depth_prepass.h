@@ -0,0 +1,208 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include <tools/shader.h>
+
+#include <iostream>
+
+/*
+    前向渲染的深度预渲染（depth prepass）
+    1. 先用只写深度的着色器（glsl/depth_prepass.vert + depth_only.frag）把不透明物体画一遍，颜色写入关掉
+    2. 颜色 pass 深度测试改为 GL_EQUAL、不写深度，每个像素只有最前面的片段执行光照，重叠再多也只着色一次
+    代价是几何体多画一遍，片段着色器便宜或物体很少重叠时不一定划算，用过度绘制热度图按场景决定：
+    measureOverdraw() 按当前模式统计每个像素执行了几次片段着色器，showHeatmap() 把结果画出来
+    注意：
+        颜色 pass 的顶点着色器要和 depth_prepass.vert 写成同一个表达式并声明 invariant gl_Position，否则 GL_EQUAL 会漏掉片段
+        会 discard 的片段着色器（alpha 测试、视差贴图的边缘）预渲染时不会 discard，被丢掉的地方会露出背景色
+*/
+class DepthPrepass
+{
+public:
+    bool enabled = false;
+    // 最近一次 measureOverdraw() 的结果：整个画面平均每个像素执行了几次片段着色器
+    float averageOverdraw = 0.0f;
+
+    DepthPrepass(int width, int height)
+        : depthShader(GLSL_INCLUDE_DIR "/depth_prepass.vert", GLSL_INCLUDE_DIR "/depth_only.frag"),
+          countShader(GLSL_INCLUDE_DIR "/depth_prepass.vert", GLSL_INCLUDE_DIR "/overdraw_count.frag"),
+          heatmapShader(GLSL_INCLUDE_DIR "/fullscreen_triangle.vert", GLSL_INCLUDE_DIR "/overdraw_heatmap.frag")
+    {
+        heatmapShader.use();
+        heatmapShader.setInt("overdrawTexture", 0);
+
+        glGenVertexArrays(1, &emptyVAO);
+        resize(width, height);
+    }
+
+    void resize(int width, int height)
+    {
+        this->width = width;
+        this->height = height;
+
+        if (FBO == 0)
+        {
+            glGenFramebuffers(1, &FBO);
+            glGenTextures(1, &overdrawTexture);
+            glGenRenderbuffers(1, &RBO);
+        }
+
+        glBindTexture(GL_TEXTURE_2D, overdrawTexture);
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_R16F, width, height, 0, GL_RED, GL_FLOAT, nullptr);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST_MIPMAP_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+        glGenerateMipmap(GL_TEXTURE_2D);
+        glBindTexture(GL_TEXTURE_2D, 0);
+
+        glBindRenderbuffer(GL_RENDERBUFFER, RBO);
+        glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, width, height);
+        glBindRenderbuffer(GL_RENDERBUFFER, 0);
+
+        glBindFramebuffer(GL_FRAMEBUFFER, FBO);
+        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, overdrawTexture, 0);
+        glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, RBO);
+        if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+            std::cout << "ERROR::FRAMEBUFFER:: Overdraw framebuffer is not complete!" << std::endl;
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    }
+
+    // 画到当前绑定的帧缓冲的深度缓冲上，enabled 为 false 时什么都不做
+    // drawScene(Shader &shader) 用传入的着色器画出所有不透明物体，每个物体自己设置 "model"
+    template <typename DrawScene>
+    void renderDepth(const glm::mat4 &view, const glm::mat4 &projection, DrawScene &&drawScene)
+    {
+        if (!enabled)
+            return;
+
+        glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
+        glDepthMask(GL_TRUE);
+        glDepthFunc(GL_LESS);
+        depthShader.use();
+        depthShader.setMat4("view", view);
+        depthShader.setMat4("projection", projection);
+        drawScene(depthShader);
+        glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+    }
+
+    // 颜色 pass 前后调用，只有预渲染过的物体才能画在 beginColor() 和 endColor() 之间
+    void beginColor() const
+    {
+        if (!enabled)
+            return;
+        glDepthFunc(GL_EQUAL);
+        glDepthMask(GL_FALSE);
+    }
+
+    void endColor() const
+    {
+        glDepthFunc(GL_LESS);
+        glDepthMask(GL_TRUE);
+    }
+
+    // 用和颜色 pass 相同的深度状态把场景画进自己的帧缓冲，统计每个像素的片段数，并读回平均值
+    // 读回会让 CPU 等 GPU，只在打开热度图时调用
+    template <typename DrawScene>
+    void measureOverdraw(const glm::mat4 &view, const glm::mat4 &projection, DrawScene &&drawScene)
+    {
+        GLint previousFBO = 0;
+        GLint viewport[4];
+        GLfloat clearColor[4];
+        GLint blendSrcRGB, blendDstRGB, blendSrcAlpha, blendDstAlpha;
+        glGetIntegerv(GL_FRAMEBUFFER_BINDING, &previousFBO);
+        glGetIntegerv(GL_VIEWPORT, viewport);
+        glGetFloatv(GL_COLOR_CLEAR_VALUE, clearColor);
+        glGetIntegerv(GL_BLEND_SRC_RGB, &blendSrcRGB);
+        glGetIntegerv(GL_BLEND_DST_RGB, &blendDstRGB);
+        glGetIntegerv(GL_BLEND_SRC_ALPHA, &blendSrcAlpha);
+        glGetIntegerv(GL_BLEND_DST_ALPHA, &blendDstAlpha);
+        GLboolean depthTest = glIsEnabled(GL_DEPTH_TEST);
+        GLboolean blend = glIsEnabled(GL_BLEND);
+
+        glBindFramebuffer(GL_FRAMEBUFFER, FBO);
+        glViewport(0, 0, width, height);
+        glClearColor(0.0f, 0.0f, 0.0f, 0.0f);
+        glDepthMask(GL_TRUE);
+        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+        glEnable(GL_DEPTH_TEST);
+        glDisable(GL_BLEND);
+
+        renderDepth(view, projection, drawScene);
+        beginColor();
+        glEnable(GL_BLEND);
+        glBlendFunc(GL_ONE, GL_ONE);
+        countShader.use();
+        countShader.setMat4("view", view);
+        countShader.setMat4("projection", projection);
+        drawScene(countShader);
+        endColor();
+
+        // mipmap 一路平均到 1x1，最高一级就是平均每像素的片段数
+        glBindTexture(GL_TEXTURE_2D, overdrawTexture);
+        glGenerateMipmap(GL_TEXTURE_2D);
+        glGetTexImage(GL_TEXTURE_2D, topLevel(), GL_RED, GL_FLOAT, &averageOverdraw);
+        glBindTexture(GL_TEXTURE_2D, 0);
+
+        glBindFramebuffer(GL_FRAMEBUFFER, previousFBO);
+        glViewport(viewport[0], viewport[1], viewport[2], viewport[3]);
+        glClearColor(clearColor[0], clearColor[1], clearColor[2], clearColor[3]);
+        glBlendFuncSeparate(blendSrcRGB, blendDstRGB, blendSrcAlpha, blendDstAlpha);
+        if (!blend)
+            glDisable(GL_BLEND);
+        if (!depthTest)
+            glDisable(GL_DEPTH_TEST);
+    }
+
+    // 把 measureOverdraw() 的结果画成热度图，覆盖当前绑定的帧缓冲（尺寸要和统计时一致）
+    void showHeatmap(float maxOverdraw = 8.0f)
+    {
+        heatmapShader.use();
+        heatmapShader.setFloat("maxOverdraw", maxOverdraw);
+        glActiveTexture(GL_TEXTURE0);
+        glBindTexture(GL_TEXTURE_2D, overdrawTexture);
+
+        GLboolean depthTest = glIsEnabled(GL_DEPTH_TEST);
+        GLboolean blend = glIsEnabled(GL_BLEND);
+        glDisable(GL_DEPTH_TEST);
+        glDisable(GL_BLEND);
+        glBindVertexArray(emptyVAO);
+        glDrawArrays(GL_TRIANGLES, 0, 3);
+        glBindVertexArray(0);
+        glBindTexture(GL_TEXTURE_2D, 0);
+        if (blend)
+            glEnable(GL_BLEND);
+        if (depthTest)
+            glEnable(GL_DEPTH_TEST);
+    }
+
+    void dispose()
+    {
+        glDeleteFramebuffers(1, &FBO);
+        glDeleteTextures(1, &overdrawTexture);
+        glDeleteRenderbuffers(1, &RBO);
+        glDeleteVertexArrays(1, &emptyVAO);
+        glDeleteProgram(depthShader.ID);
+        glDeleteProgram(countShader.ID);
+        glDeleteProgram(heatmapShader.ID);
+        FBO = overdrawTexture = RBO = emptyVAO = 0;
+    }
+
+private:
+    Shader depthShader;
+    Shader countShader;
+    Shader heatmapShader;
+    unsigned int FBO = 0;
+    unsigned int overdrawTexture = 0;
+    unsigned int RBO = 0;
+    unsigned int emptyVAO = 0;
+    int width = 0;
+    int height = 0;
+
+    int topLevel() const
+    {
+        int level = 0;
+        for (int size = glm::max(width, height); size > 1; size >>= 1)
+            ++level;
+        return level;
+    }
+};
@@ -0,0 +1,55 @@
+#pragma once
+
+#include <glad/glad.h>
+
+/*
+    GPU 计时（GL_TIME_ELAPSED 查询，GL 3.3 核心）
+    查询对象轮流使用，只读取已经可用的结果，不会让 CPU 等待 GPU
+    结果比当前帧晚几帧，用来在 ImGui 上显示足够了
+*/
+class GpuTimer
+{
+public:
+    float ms = 0.0f; // 最近一次可用的结果，单位毫秒
+
+    GpuTimer()
+    {
+        glGenQueries(QUERY_COUNT, queries);
+    }
+
+    void begin()
+    {
+        glBeginQuery(GL_TIME_ELAPSED, queries[current]);
+    }
+
+    void end()
+    {
+        glEndQuery(GL_TIME_ELAPSED);
+        issued[current] = true;
+        current = (current + 1) % QUERY_COUNT;
+
+        // 下一个要复用的就是最早发出的那个
+        if (issued[current])
+        {
+            GLint available = 0;
+            glGetQueryObjectiv(queries[current], GL_QUERY_RESULT_AVAILABLE, &available);
+            if (available)
+            {
+                GLuint64 elapsed = 0;
+                glGetQueryObjectui64v(queries[current], GL_QUERY_RESULT, &elapsed);
+                ms = static_cast<float>(elapsed) / 1.0e6f;
+            }
+        }
+    }
+
+    void dispose()
+    {
+        glDeleteQueries(QUERY_COUNT, queries);
+    }
+
+private:
+    static const int QUERY_COUNT = 4;
+    unsigned int queries[QUERY_COUNT] = {};
+    bool issued[QUERY_COUNT] = {};
+    int current = 0;
+};
@@ -0,0 +1,287 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include <tools/shader.h>
+
+#include <array>
+#include <vector>
+#include <cfloat>
+#include <cstddef>
+#include <iostream>
+
+/*
+    间接绘制
+    项目里的 glad 只生成到 GL 3.3，这里在运行时加载 glDrawElementsIndirect（GL 4.0），
+    并要求 GL 4.4 的查询缓冲（GL_QUERY_BUFFER），查询结果由 GPU 直接写进间接绘制的参数，不经过 CPU
+    不满足时 IndirectGL::supported 为 false，调用方应退回 glDrawElementsInstanced
+*/
+namespace IndirectGL
+{
+    constexpr GLenum DRAW_INDIRECT_BUFFER = 0x8F3F;
+    constexpr GLenum QUERY_BUFFER = 0x9192;
+
+    typedef void (APIENTRYP PFNDRAWELEMENTSINDIRECT)(GLenum mode, GLenum type, const void *indirect);
+
+    inline PFNDRAWELEMENTSINDIRECT drawElementsIndirect = nullptr;
+    inline bool supported = false;
+
+    // 在 gladLoadGLLoader 之后调用，传入同一个加载函数
+    inline bool load(GLADloadproc loader)
+    {
+        GLint major = 0, minor = 0;
+        glGetIntegerv(GL_MAJOR_VERSION, &major);
+        glGetIntegerv(GL_MINOR_VERSION, &minor);
+        if (major < 4 || (major == 4 && minor < 4))
+            return supported = false;
+
+        drawElementsIndirect = reinterpret_cast<PFNDRAWELEMENTSINDIRECT>(loader("glDrawElementsIndirect"));
+        supported = drawElementsIndirect != nullptr;
+        return supported;
+    }
+
+    struct DrawElementsCommand
+    {
+        GLuint count;
+        GLuint instanceCount;
+        GLuint firstIndex;
+        GLint baseVertex;
+        GLuint baseInstance;
+    };
+}
+
+/*
+    GPU 实例剔除和 LOD 选择，GL 3.3 就能用（glsl/instance_cull.vert + instance_cull.geom）
+    1. 所有实例矩阵只上传一次，同一个缓冲既是剔除 pass 的顶点输入，也是绘制时取矩阵的纹理缓冲
+    2. 每帧每级 LOD 跑一次剔除 pass：开着 GL_RASTERIZER_DISCARD 画 GL_POINTS，每个点是一个实例，
+       几何着色器只输出可见且距离落在这一级的实例下标，transform feedback 把它们紧凑地写进这一级的实例缓冲
+    3. GL_TRANSFORM_FEEDBACK_PRIMITIVES_WRITTEN 查询得到每级的可见数量：
+       IndirectGL::supported 时查询结果由 GPU 写进间接绘制参数的 instanceCount，CPU 不用等
+       否则在 cull() 末尾读回数量再 glDrawElementsInstanced，会等剔除 pass 做完，但 CPU 仍然不碰任何一个实例
+    绘制用的 VAO 先 attach()，顶点着色器用 glsl/instance_matrix.glsl 的 fetchInstanceMatrix 取矩阵
+*/
+class InstanceCuller
+{
+public:
+    static constexpr int MAX_LODS = 4;
+
+    bool frustumCulling = true;
+    // 关掉时所有实例都用第 0 级
+    bool lodSelection = true;
+    // 第 i 级 LOD 用到 lodDistances[i] 为止，之后是第 i + 1 级
+    std::array<float, MAX_LODS - 1> lodDistances = { 30.0f, 60.0f, 120.0f };
+    // 每一级的可见实例数量，间接绘制时比实际晚一帧（只用来显示）
+    std::array<GLuint, MAX_LODS> visibleCounts = { };
+
+    // boundingRadius 为模型空间的包围球半径（包含所有 LOD），lodCount 不超过 MAX_LODS
+    InstanceCuller(const std::vector<glm::mat4> &instances, float boundingRadius, int lodCount = 1)
+        : cullShader(GLSL_INCLUDE_DIR "/instance_cull.vert", GLSL_INCLUDE_DIR "/depth_only.frag", GLSL_INCLUDE_DIR "/instance_cull.geom", { }, { "visibleInstance" }),
+          boundingRadius(boundingRadius),
+          lodCount(glm::clamp(lodCount, 1, MAX_LODS))
+    {
+        glGenBuffers(1, &instanceBuffer);
+        glGenTextures(1, &instanceTexture);
+        glGenBuffers(MAX_LODS, visibleBuffers);
+        glGenBuffers(MAX_LODS, indirectBuffers);
+        glGenQueries(MAX_LODS, queries);
+
+        // 剔除 pass 的输入：一个实例一个顶点，mat4 占 location 0 ~ 3
+        glGenVertexArrays(1, &cullVAO);
+        glBindVertexArray(cullVAO);
+        glBindBuffer(GL_ARRAY_BUFFER, instanceBuffer);
+        for (GLuint i = 0; i < 4; ++i)
+        {
+            glEnableVertexAttribArray(i);
+            glVertexAttribPointer(i, 4, GL_FLOAT, GL_FALSE, sizeof(glm::mat4), reinterpret_cast<void *>(i * sizeof(glm::vec4)));
+        }
+        glBindVertexArray(0);
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+        if (IndirectGL::supported)
+        {
+            IndirectGL::DrawElementsCommand command = { };
+            for (int lod = 0; lod < MAX_LODS; ++lod)
+            {
+                glBindBuffer(IndirectGL::DRAW_INDIRECT_BUFFER, indirectBuffers[lod]);
+                glBufferData(IndirectGL::DRAW_INDIRECT_BUFFER, sizeof(command), &command, GL_DYNAMIC_DRAW);
+            }
+            glBindBuffer(IndirectGL::DRAW_INDIRECT_BUFFER, 0);
+        }
+
+        setInstances(instances);
+    }
+
+    // 替换全部实例，缓冲对象不变，已经 attach 的 VAO 不用重新设置
+    void setInstances(const std::vector<glm::mat4> &instances)
+    {
+        instanceCount = static_cast<GLsizei>(instances.size());
+
+        GLint maxTexels = 0;
+        glGetIntegerv(GL_MAX_TEXTURE_BUFFER_SIZE, &maxTexels);
+        if (static_cast<long long>(instanceCount) * 4 > maxTexels)
+            std::cout << "ERROR::INSTANCE_CULLER:: " << instanceCount << " instances exceed GL_MAX_TEXTURE_BUFFER_SIZE" << std::endl;
+
+        glBindBuffer(GL_ARRAY_BUFFER, instanceBuffer);
+        glBufferData(GL_ARRAY_BUFFER, instances.size() * sizeof(glm::mat4), instances.data(), GL_STATIC_DRAW);
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+        glBindTexture(GL_TEXTURE_BUFFER, instanceTexture);
+        glTexBuffer(GL_TEXTURE_BUFFER, GL_RGBA32F, instanceBuffer);
+        glBindTexture(GL_TEXTURE_BUFFER, 0);
+
+        // 每级最坏情况下所有实例都可见，每个实例只存 4 字节的下标
+        for (int lod = 0; lod < MAX_LODS; ++lod)
+        {
+            glBindBuffer(GL_TRANSFORM_FEEDBACK_BUFFER, visibleBuffers[lod]);
+            glBufferData(GL_TRANSFORM_FEEDBACK_BUFFER, instances.size() * sizeof(GLuint), nullptr, GL_DYNAMIC_COPY);
+        }
+        glBindBuffer(GL_TRANSFORM_FEEDBACK_BUFFER, 0);
+        visibleCounts.fill(0);
+        pending.fill(false);
+    }
+
+    // 每帧绘制前调用一次，viewProjection 为 projection * view
+    void cull(const glm::mat4 &viewProjection, const glm::vec3 &cameraPosition)
+    {
+        std::array<glm::vec4, 6> planes = frustumPlanes(viewProjection);
+        cullShader.use();
+        glUniform4fv(glGetUniformLocation(cullShader.ID, "frustumPlanes"), 6, &planes[0][0]);
+        cullShader.setBool("frustumCulling", frustumCulling);
+        cullShader.setVec3("cameraPosition", cameraPosition);
+        cullShader.setFloat("boundingRadius", boundingRadius);
+
+        glEnable(GL_RASTERIZER_DISCARD);
+        glBindVertexArray(cullVAO);
+        for (int lod = 0; lod < activeLods(); ++lod)
+        {
+            // 上一帧的数量，间接绘制时不读回，只在结果已经可用时顺便取来显示
+            if (IndirectGL::supported && pending[lod])
+            {
+                GLuint available = 0;
+                glGetQueryObjectuiv(queries[lod], GL_QUERY_RESULT_AVAILABLE, &available);
+                if (available)
+                    glGetQueryObjectuiv(queries[lod], GL_QUERY_RESULT, &visibleCounts[lod]);
+            }
+
+            cullShader.setFloat("lodMinDistance", lod == 0 ? 0.0f : lodDistances[lod - 1]);
+            cullShader.setFloat("lodMaxDistance", lod == activeLods() - 1 ? FLT_MAX : lodDistances[lod]);
+            glBindBufferBase(GL_TRANSFORM_FEEDBACK_BUFFER, 0, visibleBuffers[lod]);
+            glBeginQuery(GL_TRANSFORM_FEEDBACK_PRIMITIVES_WRITTEN, queries[lod]);
+            glBeginTransformFeedback(GL_POINTS);
+            glDrawArrays(GL_POINTS, 0, instanceCount);
+            glEndTransformFeedback();
+            glEndQuery(GL_TRANSFORM_FEEDBACK_PRIMITIVES_WRITTEN);
+            pending[lod] = true;
+
+            if (IndirectGL::supported)
+            {
+                // GPU 把可见数量写进间接绘制参数的 instanceCount
+                glBindBuffer(IndirectGL::QUERY_BUFFER, indirectBuffers[lod]);
+                glGetQueryObjectuiv(queries[lod], GL_QUERY_RESULT, reinterpret_cast<GLuint *>(offsetof(IndirectGL::DrawElementsCommand, instanceCount)));
+                glBindBuffer(IndirectGL::QUERY_BUFFER, 0);
+            }
+        }
+        glBindBufferBase(GL_TRANSFORM_FEEDBACK_BUFFER, 0, 0);
+        glBindVertexArray(0);
+        glDisable(GL_RASTERIZER_DISCARD);
+
+        if (!IndirectGL::supported)
+        {
+            for (int lod = 0; lod < activeLods(); ++lod)
+                glGetQueryObjectuiv(queries[lod], GL_QUERY_RESULT, &visibleCounts[lod]);
+        }
+        for (int lod = activeLods(); lod < MAX_LODS; ++lod)
+            visibleCounts[lod] = 0;
+    }
+
+    // 把第 lod 级的可见实例下标接到 VAO 的 location 上（uint，每个实例前进一次）
+    // VAO 来自 BufferGeometry 时先调用它的 detachFromCache()，否则会改到参数相同、共用缓冲的几何体
+    void attach(unsigned int VAO, int lod, GLuint location) const
+    {
+        glBindVertexArray(VAO);
+        glBindBuffer(GL_ARRAY_BUFFER, visibleBuffers[lod]);
+        glEnableVertexAttribArray(location);
+        glVertexAttribIPointer(location, 1, GL_UNSIGNED_INT, sizeof(GLuint), reinterpret_cast<void *>(0));
+        glVertexAttribDivisor(location, 1);
+        glBindVertexArray(0);
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+    }
+
+    // 实例矩阵的纹理缓冲绑定到 unit，着色器里为 samplerBuffer
+    void bindInstanceTexture(GLuint unit) const
+    {
+        glActiveTexture(GL_TEXTURE0 + unit);
+        glBindTexture(GL_TEXTURE_BUFFER, instanceTexture);
+        glActiveTexture(GL_TEXTURE0);
+    }
+
+    // 画第 lod 级的可见实例，VAO 需要先 attach 到同一级
+    void draw(int lod, unsigned int VAO, GLsizei indexCount) const
+    {
+        if (lod >= activeLods())
+            return;
+
+        glBindVertexArray(VAO);
+        if (IndirectGL::supported)
+        {
+            GLuint count = static_cast<GLuint>(indexCount);
+            glBindBuffer(IndirectGL::DRAW_INDIRECT_BUFFER, indirectBuffers[lod]);
+            glBufferSubData(IndirectGL::DRAW_INDIRECT_BUFFER, offsetof(IndirectGL::DrawElementsCommand, count), sizeof(count), &count);
+            IndirectGL::drawElementsIndirect(GL_TRIANGLES, GL_UNSIGNED_INT, nullptr);
+            glBindBuffer(IndirectGL::DRAW_INDIRECT_BUFFER, 0);
+        }
+        else if (visibleCounts[lod] > 0)
+        {
+            glDrawElementsInstanced(GL_TRIANGLES, indexCount, GL_UNSIGNED_INT, 0, static_cast<GLsizei>(visibleCounts[lod]));
+        }
+        glBindVertexArray(0);
+    }
+
+    int activeLods() const
+    {
+        return lodSelection ? lodCount : 1;
+    }
+
+    GLsizei count() const
+    {
+        return instanceCount;
+    }
+
+    void dispose()
+    {
+        glDeleteBuffers(1, &instanceBuffer);
+        glDeleteTextures(1, &instanceTexture);
+        glDeleteBuffers(MAX_LODS, visibleBuffers);
+        glDeleteBuffers(MAX_LODS, indirectBuffers);
+        glDeleteQueries(MAX_LODS, queries);
+        glDeleteVertexArrays(1, &cullVAO);
+        glDeleteProgram(cullShader.ID);
+        instanceBuffer = instanceTexture = cullVAO = 0;
+    }
+
+private:
+    Shader cullShader;
+    float boundingRadius;
+    int lodCount;
+    GLsizei instanceCount = 0;
+    unsigned int instanceBuffer = 0;
+    unsigned int instanceTexture = 0;
+    unsigned int cullVAO = 0;
+    unsigned int visibleBuffers[MAX_LODS] = { };
+    unsigned int indirectBuffers[MAX_LODS] = { };
+    unsigned int queries[MAX_LODS] = { };
+    std::array<bool, MAX_LODS> pending = { };
+
+    // 从 projection * view 的行组合出 6 个平面（左右下上近远），法线指向视锥内侧并归一化
+    static std::array<glm::vec4, 6> frustumPlanes(const glm::mat4 &m)
+    {
+        glm::vec4 row0(m[0][0], m[1][0], m[2][0], m[3][0]);
+        glm::vec4 row1(m[0][1], m[1][1], m[2][1], m[3][1]);
+        glm::vec4 row2(m[0][2], m[1][2], m[2][2], m[3][2]);
+        glm::vec4 row3(m[0][3], m[1][3], m[2][3], m[3][3]);
+        std::array<glm::vec4, 6> planes = { row3 + row0, row3 - row0, row3 + row1, row3 - row1, row3 + row2, row3 - row2 };
+        for (glm::vec4 &plane : planes)
+            plane /= glm::length(glm::vec3(plane));
+        return planes;
+    }
+};
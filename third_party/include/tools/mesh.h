@@ -5,23 +5,12 @@
 #include <glm/gtc/matrix_transform.hpp>
 
 #include <tools/shader.h>
+#include <tools/vertex_layout.h>
+#include <tools/position_stream.h>
 
 #include <string>
 #include <vector>
-
-#ifndef DEFINE_VERTEX
-#define DEFINE_VERTEX
-struct Vertex
-{
-	glm::vec3 Position;	 // 顶点属性
-	glm::vec3 Normal;		 // 法线
-	glm::vec2 TexCoords; // 纹理坐标
-
-	// 切线空间属性
-	glm::vec3 Tangent;
-	glm::vec3 Bitangent;
-};
-#endif
+#include <utility>
 
 struct Texture
 {
@@ -30,7 +19,9 @@ struct Texture
 	std::string path;
 };
 
-class Mesh
+// 顶点按 Layout 打包上传，只启用布局中有的属性
+template <typename Layout = FullVertexLayout>
+class BasicMesh
 {
 public:
 	// mesh Data
@@ -38,8 +29,14 @@ public:
 	std::vector<unsigned int> indices;
 	std::vector<Texture> textures;
 	unsigned int VAO;
-
-	Mesh(std::vector<Vertex> vertices, std::vector<unsigned int> indices, std::vector<Texture> textures)
+	// 纹理数组中的层号：diffuse, specular, normal, height，没有则为 -1
+	glm::ivec4 layers = glm::ivec4(-1);
+	// buildPositionStream() 之后有效，只读位置的着色器自动用它绘制
+	PositionStream positionStream;
+	// setSkin() 之后有效，每个顶点的骨骼下标和权重
+	std::vector<SkinVertex> skin;
+
+	BasicMesh(std::vector<Vertex> vertices, std::vector<unsigned int> indices, std::vector<Texture> textures)
 	{
 		this->vertices = vertices;
 		this->indices = indices;
@@ -48,9 +45,35 @@ public:
 		// now that we have all the required data, set the vertex buffers and its attribute pointers.
 		setupMesh();
 	}
+	void buildPositionStream()
+	{
+		positionStream.build(vertices, indices);
+	}
+
+	// 上传蒙皮数据到单独的顶点缓冲，挂在同一个 VAO 的 location 5 / 6 上
+	void setSkin(std::vector<SkinVertex> skin)
+	{
+		this->skin = std::move(skin);
+		if (skinVBO == 0)
+			glGenBuffers(1, &skinVBO);
+		glBindVertexArray(VAO);
+		glBindBuffer(GL_ARRAY_BUFFER, skinVBO);
+		glBufferData(GL_ARRAY_BUFFER, this->skin.size() * sizeof(SkinVertex), this->skin.data(), GL_STATIC_DRAW);
+		SkinVertexLayout::setup();
+		glBindVertexArray(0);
+		glBindBuffer(GL_ARRAY_BUFFER, 0);
+	}
+
 	// render the mesh
 	void Draw(Shader &shader)
 	{
+		// 只写深度的着色器不需要纹理和完整的顶点
+		if (shader.positionOnly && positionStream.valid())
+		{
+			positionStream.draw();
+			return;
+		}
+
 		// bind appropriate textures
 		unsigned int diffuseNr = 1;
 		unsigned int specularNr = 1;
@@ -86,9 +109,19 @@ public:
 		glActiveTexture(GL_TEXTURE0);
 	}
 
+	// render the mesh with textures from a bound GL_TEXTURE_2D_ARRAY, only the layer indices change per draw
+	void DrawLayered(GLint layersLocation)
+	{
+		glUniform4iv(layersLocation, 1, &layers[0]);
+		glBindVertexArray(VAO);
+		glDrawElements(GL_TRIANGLES, static_cast<GLsizei>(indices.size()), GL_UNSIGNED_INT, 0);
+		glBindVertexArray(0);
+	}
+
 private:
 	// render data
 	unsigned int VBO, EBO;
+	unsigned int skinVBO = 0;
 
 	void setupMesh()
 	{
@@ -100,31 +133,16 @@ private:
 		glBindVertexArray(VAO);
 		// load data into vertex buffers
 		glBindBuffer(GL_ARRAY_BUFFER, VBO);
-		// A great thing about structs is that their memory layout is sequential for all its items.
-		// The effect is that we can simply pass a pointer to the struct and it translates perfectly to a glm::vec3/2 array which
-		// again translates to 3/2 floats which translates to a byte array.
-		glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(Vertex), &vertices[0], GL_STATIC_DRAW);
+		Layout::bufferData(GL_ARRAY_BUFFER, vertices, GL_STATIC_DRAW);
 
 		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
 		glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(unsigned int), &indices[0], GL_STATIC_DRAW);
 
 		// set the vertex attribute pointers
-		// vertex Positions
-		glEnableVertexAttribArray(0);
-		glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void *)0);
-		// vertex normals
-		glEnableVertexAttribArray(1);
-		glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void *)offsetof(Vertex, Normal));
-		// vertex texture coords
-		glEnableVertexAttribArray(2);
-		glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void *)offsetof(Vertex, TexCoords));
-		// vertex tangent
-		glEnableVertexAttribArray(3);
-		glVertexAttribPointer(3, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void *)offsetof(Vertex, Tangent));
-		// vertex bitangent
-		glEnableVertexAttribArray(4);
-		glVertexAttribPointer(4, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void *)offsetof(Vertex, Bitangent));
+		Layout::setup();
 
 		glBindVertexArray(0);
 	}
-};
\ No newline at end of file
+};
+
+using Mesh = BasicMesh<>;
@@ -0,0 +1,145 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include <tools/shader.h>
+
+#include <vector>
+#include <iostream>
+
+/*
+    逐级降采样 / 升采样的泛光（Call of Duty: Advanced Warfare 的做法）
+    1. 从半分辨率开始逐级降采样到 1/(2^mipCount)，每级用 13 个采样点的滤波，
+       第一级用 Karis 平均（按 1 / (1 + 亮度) 加权）压掉单个极亮像素造成的闪烁
+    2. 再从最小的一级开始，用 3x3 的帐篷滤波升采样，加法混合到上一级
+    最终结果在 mips[0]（半分辨率），所有级加起来的像素数不到全分辨率的 1/3
+*/
+class MipBloom
+{
+public:
+    struct Mip
+    {
+        unsigned int texture = 0;
+        int width = 0;
+        int height = 0;
+    };
+
+    unsigned int FBO = 0;
+    std::vector<Mip> mips;
+    // 升采样的帐篷滤波半径，单位为 uv
+    float filterRadius = 0.005f;
+
+    MipBloom() = default;
+
+    MipBloom(int width, int height, int mipCount = 6)
+    {
+        glGenFramebuffers(1, &FBO);
+        mips.resize(mipCount);
+        for (Mip &mip : mips)
+        {
+            glGenTextures(1, &mip.texture);
+            glBindTexture(GL_TEXTURE_2D, mip.texture);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        }
+        resize(width, height);
+    }
+
+    // 按新的源尺寸重新分配每一级，纹理对象不变
+    void resize(int width, int height)
+    {
+        int w = width;
+        int h = height;
+        for (Mip &mip : mips)
+        {
+            w = glm::max(1, w / 2);
+            h = glm::max(1, h / 2);
+            mip.width = w;
+            mip.height = h;
+            glBindTexture(GL_TEXTURE_2D, mip.texture);
+            // 泛光不需要 alpha，用 32 位的浮点格式省一半带宽
+            glTexImage2D(GL_TEXTURE_2D, 0, GL_R11F_G11F_B10F, w, h, 0, GL_RGB, GL_FLOAT, nullptr);
+        }
+        glBindTexture(GL_TEXTURE_2D, 0);
+
+        glBindFramebuffer(GL_FRAMEBUFFER, FBO);
+        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, mips[0].texture, 0);
+        if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+            std::cout << "ERROR::FRAMEBUFFER:: Bloom framebuffer is not complete!" << std::endl;
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    }
+
+    // quadVAO 为覆盖全屏的四边形，结果纹理为 texture()
+    void render(unsigned int srcTexture, int srcWidth, int srcHeight,
+        const Shader &downsampleShader, const Shader &upsampleShader,
+        unsigned int quadVAO, GLsizei indexCount)
+    {
+        GLboolean depthTest = glIsEnabled(GL_DEPTH_TEST);
+        GLboolean blend = glIsEnabled(GL_BLEND);
+        glDisable(GL_DEPTH_TEST);
+        glDisable(GL_BLEND);
+
+        glBindFramebuffer(GL_FRAMEBUFFER, FBO);
+        glBindVertexArray(quadVAO);
+        glActiveTexture(GL_TEXTURE0);
+
+        // 降采样
+        downsampleShader.use();
+        downsampleShader.setInt("srcTexture", 0);
+        glBindTexture(GL_TEXTURE_2D, srcTexture);
+        glm::vec2 srcResolution(srcWidth, srcHeight);
+        for (size_t i = 0; i < mips.size(); ++i)
+        {
+            const Mip &mip = mips[i];
+            glViewport(0, 0, mip.width, mip.height);
+            glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, mip.texture, 0);
+            downsampleShader.setVec2("srcResolution", srcResolution);
+            downsampleShader.setBool("karisAverage", i == 0);
+            glDrawElements(GL_TRIANGLES, indexCount, GL_UNSIGNED_INT, 0);
+
+            srcResolution = glm::vec2(mip.width, mip.height);
+            glBindTexture(GL_TEXTURE_2D, mip.texture);
+        }
+
+        // 升采样，加法混合到上一级
+        upsampleShader.use();
+        upsampleShader.setInt("srcTexture", 0);
+        upsampleShader.setFloat("filterRadius", filterRadius);
+        glEnable(GL_BLEND);
+        glBlendFunc(GL_ONE, GL_ONE);
+        glBlendEquation(GL_FUNC_ADD);
+        for (size_t i = mips.size() - 1; i > 0; --i)
+        {
+            const Mip &target = mips[i - 1];
+            glBindTexture(GL_TEXTURE_2D, mips[i].texture);
+            glViewport(0, 0, target.width, target.height);
+            glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, target.texture, 0);
+            glDrawElements(GL_TRIANGLES, indexCount, GL_UNSIGNED_INT, 0);
+        }
+        glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+
+        glBindVertexArray(0);
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+        if (!blend)
+            glDisable(GL_BLEND);
+        if (depthTest)
+            glEnable(GL_DEPTH_TEST);
+    }
+
+    unsigned int texture() const
+    {
+        return mips.empty() ? 0 : mips[0].texture;
+    }
+
+    void dispose()
+    {
+        for (Mip &mip : mips)
+            glDeleteTextures(1, &mip.texture);
+        mips.clear();
+        glDeleteFramebuffers(1, &FBO);
+        FBO = 0;
+    }
+};
@@ -4,40 +4,149 @@
 #include <assimp/scene.h>
 #include <assimp/postprocess.h>
 
+#include <tools/texture_uploader.h>
+#include <tools/texture_array.h>
+#include <tools/transform_graph.h>
+#include <tools/animation.h>
+
 #include <string>
+#include <string_view>
 #include <fstream>
 #include <sstream>
 #include <iostream>
 #include <map>
 #include <vector>
+#include <algorithm>
 
 unsigned int TextureFromFile(const char *path, const std::string &directory, bool gamma = false);
 
-class Model
+// 网格按 Layout 上传顶点，布局中没有切线时导入也不计算切线
+template <typename Layout = FullVertexLayout>
+class BasicModel
 {
 public:
 	std::vector<Texture> textures_loaded; // stores all the textures loaded so far, optimization to make sure textures aren't loaded more than once.
-	std::vector<Mesh> meshes;
+	std::vector<BasicMesh<Layout>> meshes;
 	std::string directory;
 	bool gammaCorrection;
+	TextureUploader *uploader = nullptr; // 非空时纹理通过异步上传队列加载
+	TextureArray textureArray;			 // buildTextureArray() 之后有效
+	TransformGraph nodes;				 // Assimp 的节点层级，按先序扁平化，局部矩阵来自 aiNode::mTransformation
+	std::vector<int> meshNodes;			 // meshes[i] 所在的节点
+	Skeleton skeleton;					 // 所有网格的骨骼合在一起，没有骨骼时为空
+	std::vector<AnimationClip> animations; // aiScene::mAnimations，通道按名字对应到 nodes
+
+	BasicModel(std::string const &path, bool gamma = false) : gammaCorrection(gamma)
+	{
+		loadModel(path);
+	}
 
-	Model(std::string const &path, bool gamma = false) : gammaCorrection(gamma)
+	BasicModel(std::string const &path, TextureUploader &uploader, bool gamma = false) : gammaCorrection(gamma), uploader(&uploader)
 	{
 		loadModel(path);
 	}
 
+	// 调用方自己设置 "model"，不使用节点变换，只适合所有网格都在同一个节点上的模型
 	void Draw(Shader &shader)
 	{
 		for (unsigned int i = 0; i < meshes.size(); ++i)
 			meshes[i].Draw(shader);
 	}
 
+	// 每个网格用 model * 所在节点的世界矩阵绘制，多部件的模型各部分位置才正确；
+	// 先更新被 nodes.setLocal() 改过的子树；蒙皮网格的骨骼矩阵已经是模型空间，只用 model
+	void Draw(Shader &shader, const glm::mat4 &model, std::string_view modelName = "model")
+	{
+		nodes.update();
+		glm::mat4 meshModel;
+		for (unsigned int i = 0; i < meshes.size(); ++i)
+		{
+			if (meshes[i].skin.empty())
+				TransformGraph::multiply(model, nodes.worlds[meshNodes[i]], meshModel);
+			else
+				meshModel = model;
+			shader.setMat4(modelName, meshModel);
+			meshes[i].Draw(shader);
+		}
+	}
+
+	// 为每个网格建立只有位置的顶点流，之后用只读位置的着色器 Draw 时自动使用
+	void buildPositionStreams()
+	{
+		for (BasicMesh<Layout> &mesh : meshes)
+			mesh.buildPositionStream();
+	}
+
+	// 把所有材质贴图打包进一个纹理数组，尺寸取出现最多的那一种，其余缩放到该尺寸
+	// 使用异步上传时需要等上传完成后再调用
+	void buildTextureArray(GLint wrap = GL_REPEAT)
+	{
+		if (textures_loaded.empty())
+			return;
+
+		std::map<std::pair<int, int>, int> sizeCount;
+		for (const Texture &texture : textures_loaded)
+		{
+			int width, height;
+			glBindTexture(GL_TEXTURE_2D, texture.id);
+			glGetTexLevelParameteriv(GL_TEXTURE_2D, 0, GL_TEXTURE_WIDTH, &width);
+			glGetTexLevelParameteriv(GL_TEXTURE_2D, 0, GL_TEXTURE_HEIGHT, &height);
+			++sizeCount[{ width, height }];
+		}
+		auto common = sizeCount.begin();
+		for (auto it = sizeCount.begin(); it != sizeCount.end(); ++it)
+			if (it->second > common->second)
+				common = it;
+
+		if (textureArray.ID)
+			textureArray.dispose();
+		textureArray = TextureArray(common->first.first, common->first.second, static_cast<int>(textures_loaded.size()), wrap);
+		std::map<unsigned int, int> layerOf;
+		for (const Texture &texture : textures_loaded)
+			layerOf[texture.id] = textureArray.addTexture(texture.id);
+		textureArray.generateMipmap();
+
+		for (BasicMesh<Layout> &mesh : meshes)
+		{
+			mesh.layers = glm::ivec4(-1);
+			for (const Texture &texture : mesh.textures)
+			{
+				int slot = -1;
+				if (texture.type == "texture_diffuse")
+					slot = 0;
+				else if (texture.type == "texture_specular")
+					slot = 1;
+				else if (texture.type == "texture_normal")
+					slot = 2;
+				else if (texture.type == "texture_height")
+					slot = 3;
+				// 每种贴图只取第一张
+				if (slot >= 0 && mesh.layers[slot] < 0)
+					mesh.layers[slot] = layerOf[texture.id];
+			}
+		}
+	}
+
+	// 纹理数组只绑定一次，着色器中使用 sampler2DArray 和 ivec4 layersName
+	void DrawLayered(Shader &shader, unsigned int textureUnit = 0, std::string_view layersName = "materialLayers")
+	{
+		glActiveTexture(GL_TEXTURE0 + textureUnit);
+		glBindTexture(GL_TEXTURE_2D_ARRAY, textureArray.ID);
+		GLint location = glGetUniformLocation(shader.ID, layersName.data());
+		for (unsigned int i = 0; i < meshes.size(); ++i)
+			meshes[i].DrawLayered(location);
+		glActiveTexture(GL_TEXTURE0);
+	}
+
 private:
 	void loadModel(std::string const &path)
 	{
 		// read file via ASSIMP
 		Assimp::Importer importer;
-		const aiScene *scene = importer.ReadFile(path, aiProcess_Triangulate | aiProcess_GenSmoothNormals | aiProcess_FlipUVs | aiProcess_CalcTangentSpace);
+		unsigned int flags = aiProcess_Triangulate | aiProcess_GenSmoothNormals | aiProcess_FlipUVs | aiProcess_LimitBoneWeights;
+		if constexpr (Layout::template has<VertexAttribute::Tangent> || Layout::template has<VertexAttribute::Bitangent>)
+			flags |= aiProcess_CalcTangentSpace;
+		const aiScene *scene = importer.ReadFile(path, flags);
 		// check for errors
 		if (!scene || scene->mFlags & AI_SCENE_FLAGS_INCOMPLETE || !scene->mRootNode) // if is Not Zero
 		{
@@ -48,12 +157,57 @@ private:
 		directory = path.substr(0, path.find_last_of('/'));
 
 		// process ASSIMP's root node recursively
-		processNode(scene->mRootNode, scene);
+		processNode(scene->mRootNode, scene, -1);
+		// 节点都加进来之后才能按名字找到骨骼和动画通道对应的节点
+		skeleton.setHierarchy(nodes);
+		loadAnimations(scene);
+	}
+
+	void loadAnimations(const aiScene *scene)
+	{
+		for (unsigned int i = 0; i < scene->mNumAnimations; ++i)
+		{
+			const aiAnimation *animation = scene->mAnimations[i];
+			AnimationClip clip;
+			clip.name = animation->mName.C_Str();
+			clip.duration = static_cast<float>(animation->mDuration);
+			clip.ticksPerSecond = animation->mTicksPerSecond > 0.0 ? static_cast<float>(animation->mTicksPerSecond) : 25.0f;
+			for (unsigned int j = 0; j < animation->mNumChannels; ++j)
+			{
+				const aiNodeAnim *source = animation->mChannels[j];
+				AnimationChannel channel;
+				channel.node = nodes.find(source->mNodeName.C_Str());
+				if (channel.node < 0)
+					continue;
+				for (unsigned int k = 0; k < source->mNumPositionKeys; ++k)
+				{
+					const aiVectorKey &key = source->mPositionKeys[k];
+					channel.positionTimes.push_back(static_cast<float>(key.mTime));
+					channel.positions.emplace_back(key.mValue.x, key.mValue.y, key.mValue.z);
+				}
+				for (unsigned int k = 0; k < source->mNumRotationKeys; ++k)
+				{
+					const aiQuatKey &key = source->mRotationKeys[k];
+					channel.rotationTimes.push_back(static_cast<float>(key.mTime));
+					channel.rotations.emplace_back(key.mValue.w, key.mValue.x, key.mValue.y, key.mValue.z);
+				}
+				for (unsigned int k = 0; k < source->mNumScalingKeys; ++k)
+				{
+					const aiVectorKey &key = source->mScalingKeys[k];
+					channel.scaleTimes.push_back(static_cast<float>(key.mTime));
+					channel.scales.emplace_back(key.mValue.x, key.mValue.y, key.mValue.z);
+				}
+				clip.channels.push_back(std::move(channel));
+			}
+			animations.push_back(std::move(clip));
+		}
 	}
 
 	// processes a node in a recursive fashion. Processes each individual mesh located at the node and repeats this process on its children nodes (if any).
-	void processNode(aiNode *node, const aiScene *scene)
+	// 递归的顺序就是先序，节点按这个顺序加入 nodes
+	void processNode(aiNode *node, const aiScene *scene, int parent)
 	{
+		int index = nodes.addNode(parent, toGlm(node->mTransformation), node->mName.C_Str());
 		// process each mesh located at the current node
 		for (unsigned int i = 0; i < node->mNumMeshes; ++i)
 		{
@@ -61,15 +215,25 @@ private:
 			// the scene contains all the data, node is just to keep stuff organized (like relations between nodes).
 			aiMesh *mesh = scene->mMeshes[node->mMeshes[i]];
 			meshes.push_back(processMesh(mesh, scene));
+			meshNodes.push_back(index);
 		}
 		// after we've processed all of the meshes (if any) we then recursively process each of the children nodes
 		for (unsigned int i = 0; i < node->mNumChildren; ++i)
 		{
-			processNode(node->mChildren[i], scene);
+			processNode(node->mChildren[i], scene, index);
 		}
 	}
 
-	Mesh processMesh(aiMesh *mesh, const aiScene *scene)
+	// Assimp 的矩阵按行存储，glm 按列存储
+	static glm::mat4 toGlm(const aiMatrix4x4 &m)
+	{
+		return glm::mat4(m.a1, m.b1, m.c1, m.d1,
+						 m.a2, m.b2, m.c2, m.d2,
+						 m.a3, m.b3, m.c3, m.d3,
+						 m.a4, m.b4, m.c4, m.d4);
+	}
+
+	BasicMesh<Layout> processMesh(aiMesh *mesh, const aiScene *scene)
 	{
 		// data to fill
 		std::vector<Vertex> vertices;
@@ -79,7 +243,7 @@ private:
 		// walk through each of the mesh's vertices
 		for (unsigned int i = 0; i < mesh->mNumVertices; ++i)
 		{
-			Vertex vertex;
+			Vertex vertex{};
 			glm::vec3 vector; // we declare a placeholder vector since assimp uses its own vector class that doesn't directly convert to glm's vec3 class so we transfer the data to this placeholder glm::vec3 first.
 												// positions
 			vector.x = mesh->mVertices[i].x;
@@ -103,6 +267,11 @@ private:
 				vec.x = mesh->mTextureCoords[0][i].x;
 				vec.y = mesh->mTextureCoords[0][i].y;
 				vertex.TexCoords = vec;
+			}
+			else
+				vertex.TexCoords = glm::vec2(0.0f, 0.0f);
+			if (mesh->mTangents && mesh->mBitangents)
+			{
 				// tangent
 				vector.x = mesh->mTangents[i].x;
 				vector.y = mesh->mTangents[i].y;
@@ -114,8 +283,6 @@ private:
 				vector.z = mesh->mBitangents[i].z;
 				vertex.Bitangent = vector;
 			}
-			else
-				vertex.TexCoords = glm::vec2(0.0f, 0.0f);
 
 			vertices.push_back(vertex);
 		}
@@ -150,7 +317,59 @@ private:
 		textures.insert(textures.end(), heightMaps.begin(), heightMaps.end());
 
 		// return a mesh object created from the extracted mesh data
-		return Mesh(vertices, indices, textures);
+		BasicMesh<Layout> result(vertices, indices, textures);
+		if (mesh->HasBones())
+			result.setSkin(processSkin(mesh));
+		return result;
+	}
+
+	// 每个顶点保留权重最大的 4 根骨骼，重新归一化后量化成 16 位
+	std::vector<SkinVertex> processSkin(aiMesh *mesh)
+	{
+		std::vector<glm::uvec4> boneIDs(mesh->mNumVertices, glm::uvec4(0));
+		std::vector<glm::vec4> weights(mesh->mNumVertices, glm::vec4(0.0f));
+		for (unsigned int i = 0; i < mesh->mNumBones; ++i)
+		{
+			const aiBone *bone = mesh->mBones[i];
+			int boneIndex = skeleton.addBone(bone->mName.C_Str(), toGlm(bone->mOffsetMatrix));
+			if (boneIndex > 255)
+			{
+				std::cout << "ERROR::ASSIMP:: more than 256 bones, " << bone->mName.C_Str() << " is ignored" << std::endl;
+				continue;
+			}
+			for (unsigned int j = 0; j < bone->mNumWeights; ++j)
+			{
+				const aiVertexWeight &weight = bone->mWeights[j];
+				glm::vec4 &vertexWeights = weights[weight.mVertexId];
+				// 替换当前最小的权重
+				int slot = 0;
+				for (int k = 1; k < 4; ++k)
+					if (vertexWeights[k] < vertexWeights[slot])
+						slot = k;
+				if (weight.mWeight > vertexWeights[slot])
+				{
+					vertexWeights[slot] = weight.mWeight;
+					boneIDs[weight.mVertexId][slot] = static_cast<unsigned int>(boneIndex);
+				}
+			}
+		}
+
+		std::vector<SkinVertex> skin(mesh->mNumVertices);
+		for (unsigned int i = 0; i < mesh->mNumVertices; ++i)
+		{
+			float sum = weights[i].x + weights[i].y + weights[i].z + weights[i].w;
+			glm::vec4 normalized = sum > 0.0f ? weights[i] / sum : glm::vec4(1.0f, 0.0f, 0.0f, 0.0f);
+			// 最后一个权重取余数，量化后的和仍然是 65535
+			long remaining = 65535;
+			for (int k = 0; k < 4; ++k)
+			{
+				long quantized = k < 3 ? std::min(std::lround(normalized[k] * 65535.0f), remaining) : remaining;
+				skin[i].BoneIDs[k] = static_cast<std::uint8_t>(boneIDs[i][k]);
+				skin[i].Weights[k] = static_cast<std::uint16_t>(quantized);
+				remaining -= quantized;
+			}
+		}
+		return skin;
 	}
 
 	std::vector<Texture> loadMaterialTextures(aiMaterial *mat, aiTextureType type, std::string typeName)
@@ -174,7 +393,10 @@ private:
 			if (!skip)
 			{ // if texture hasn't been loaded already, load it
 				Texture texture;
-				texture.id = TextureFromFile(str.C_Str(), this->directory);
+				if (uploader)
+					texture.id = uploader->loadTexture(this->directory + '/' + str.C_Str(), false, gammaCorrection);
+				else
+					texture.id = TextureFromFile(str.C_Str(), this->directory);
 				texture.type = typeName;
 				texture.path = str.C_Str();
 				textures.push_back(texture);
@@ -185,6 +407,9 @@ private:
 	}
 };
 
+// 完整顶点布局，其它布局用 BasicModel<Layout>
+using Model = BasicModel<>;
+
 unsigned int TextureFromFile(const char *path, const std::string &directory, bool gamma)
 {
 	std::string filename = std::string(path);
@@ -0,0 +1,224 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <tools/shader.h>
+
+#include <vector>
+#include <initializer_list>
+#include <unordered_map>
+
+/*
+    硬件遮挡查询 + 条件渲染
+    1. 遮挡物先画进深度缓冲，之后每个重物体画一个包围盒代理（不写颜色和深度），用遮挡查询统计有没有样本通过
+    2. 物体本身用上一帧的查询结果包在 glBeginConditionalRender(GL_QUERY_NO_WAIT) 里画：
+       结果由 GPU 自己判断，CPU 不读查询、不等待；结果还没出来时照常绘制
+    3. 查询对象放在池里循环使用，每帧每个物体取一个，用过的下一帧还回池里
+    GL 4.3 以上用 GL_ANY_SAMPLES_PASSED_CONSERVATIVE（允许驱动用更粗的深度测试，更快），否则退回 GL_ANY_SAMPLES_PASSED
+    结果晚一帧：物体刚从遮挡物后面出来的那一帧还是被剔除的，摄像机在包围盒里时不做查询，直接画
+    使用方式：
+        beginQueries(view, projection, cameraPosition); query(id, model, min, max) ...; endQueries();
+        draw(id, [&] { ... }) ...; endFrame();
+*/
+class OcclusionCuller
+{
+public:
+    static constexpr GLenum ANY_SAMPLES_PASSED_CONSERVATIVE = 0x8D6A;
+
+    // 上一次 endFrame() 时的统计：参与的物体数、CPU 端已经能看到结果且被遮挡的物体数（只用来显示，不影响绘制）
+    int objectCount = 0;
+    int occludedCount = 0;
+
+    OcclusionCuller()
+        : proxyShader(GLSL_INCLUDE_DIR "/depth_prepass.vert", GLSL_INCLUDE_DIR "/depth_only.frag")
+    {
+        GLint major = 0, minor = 0;
+        glGetIntegerv(GL_MAJOR_VERSION, &major);
+        glGetIntegerv(GL_MINOR_VERSION, &minor);
+        queryTarget = (major > 4 || (major == 4 && minor >= 3)) ? ANY_SAMPLES_PASSED_CONSERVATIVE : GL_ANY_SAMPLES_PASSED;
+
+        // [0, 1]^3 的单位立方体，画的时候缩放到包围盒
+        const float vertices[] = {
+            0.0f, 0.0f, 0.0f,  1.0f, 0.0f, 0.0f,  1.0f, 1.0f, 0.0f,  0.0f, 1.0f, 0.0f,
+            0.0f, 0.0f, 1.0f,  1.0f, 0.0f, 1.0f,  1.0f, 1.0f, 1.0f,  0.0f, 1.0f, 1.0f
+        };
+        const unsigned int indices[] = {
+            0, 2, 1, 0, 3, 2,  4, 5, 6, 4, 6, 7,
+            0, 1, 5, 0, 5, 4,  3, 6, 2, 3, 7, 6,
+            0, 4, 7, 0, 7, 3,  1, 2, 6, 1, 6, 5
+        };
+        glGenVertexArrays(1, &cubeVAO);
+        glGenBuffers(1, &cubeVBO);
+        glGenBuffers(1, &cubeEBO);
+        glBindVertexArray(cubeVAO);
+        glBindBuffer(GL_ARRAY_BUFFER, cubeVBO);
+        glBufferData(GL_ARRAY_BUFFER, sizeof(vertices), vertices, GL_STATIC_DRAW);
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, cubeEBO);
+        glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(indices), indices, GL_STATIC_DRAW);
+        glEnableVertexAttribArray(0);
+        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float), reinterpret_cast<void *>(0));
+        glBindVertexArray(0);
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+    }
+
+    bool conservative() const
+    {
+        return queryTarget == ANY_SAMPLES_PASSED_CONSERVATIVE;
+    }
+
+    // 遮挡物画完之后调用，接下来的 query() 只测深度，不写颜色和深度
+    void beginQueries(const glm::mat4 &view, const glm::mat4 &projection, const glm::vec3 &cameraPosition, float nearPlane = 0.1f)
+    {
+        this->cameraPosition = cameraPosition;
+        this->nearPlane = nearPlane;
+        cullFace = glIsEnabled(GL_CULL_FACE);
+        glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
+        glDepthMask(GL_FALSE);
+        // 摄像机离包围盒很近时正面可能被近平面裁掉，背面也要参与测试
+        glDisable(GL_CULL_FACE);
+        proxyShader.use();
+        proxyShader.setMat4("view", view);
+        proxyShader.setMat4("projection", projection);
+        glBindVertexArray(cubeVAO);
+    }
+
+    // 画 id 号物体的包围盒代理，min / max 为模型空间的包围盒
+    void query(int id, const glm::mat4 &model, const glm::vec3 &min, const glm::vec3 &max)
+    {
+        // 摄像机在（放大了近平面距离的）包围盒里时代理会被近平面裁掉，不查询，这一帧和下一帧都直接画
+        glm::vec3 localCamera = glm::vec3(glm::inverse(model) * glm::vec4(cameraPosition, 1.0f));
+        float scale = glm::min(glm::min(glm::length(glm::vec3(model[0])), glm::length(glm::vec3(model[1]))), glm::length(glm::vec3(model[2])));
+        glm::vec3 margin = glm::vec3(nearPlane / scale);
+        if (glm::all(glm::greaterThanEqual(localCamera, min - margin)) && glm::all(glm::lessThanEqual(localCamera, max + margin)))
+        {
+            current[id] = 0;
+            return;
+        }
+
+        GLuint queryObject = acquire();
+        proxyShader.setMat4("model", glm::scale(glm::translate(model, min), max - min));
+        glBeginQuery(queryTarget, queryObject);
+        glDrawElements(GL_TRIANGLES, 36, GL_UNSIGNED_INT, 0);
+        glEndQuery(queryTarget);
+        current[id] = queryObject;
+    }
+
+    void endQueries() const
+    {
+        glBindVertexArray(0);
+        glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+        glDepthMask(GL_TRUE);
+        if (cullFace)
+            glEnable(GL_CULL_FACE);
+    }
+
+    // 用 id 号物体上一帧的查询结果决定是否执行 drawObject，第一次出现或上一帧没有查询时直接画
+    template <typename DrawObject>
+    void draw(int id, DrawObject &&drawObject)
+    {
+        ++frameObjects;
+        auto it = previous.find(id);
+        GLuint queryObject = it == previous.end() ? 0 : it->second;
+        if (queryObject == 0)
+        {
+            drawObject();
+            return;
+        }
+
+        // 只在结果已经可用时读来统计，不会等待
+        GLuint available = 0;
+        glGetQueryObjectuiv(queryObject, GL_QUERY_RESULT_AVAILABLE, &available);
+        if (available)
+        {
+            GLuint passed = 0;
+            glGetQueryObjectuiv(queryObject, GL_QUERY_RESULT, &passed);
+            if (!passed)
+                ++frameOccluded;
+        }
+
+        glBeginConditionalRender(queryObject, GL_QUERY_NO_WAIT);
+        drawObject();
+        glEndConditionalRender();
+    }
+
+    // 上一帧的查询都已经用过，还回池里；这一帧的留给下一帧
+    void endFrame()
+    {
+        for (auto &[id, queryObject] : previous)
+        {
+            if (queryObject != 0)
+                pool.push_back(queryObject);
+        }
+        previous.swap(current);
+        current.clear();
+        objectCount = frameObjects;
+        occludedCount = frameOccluded;
+        frameObjects = frameOccluded = 0;
+    }
+
+    // 关闭遮挡剔除时调用，丢掉还没用的查询，重新打开后第一帧全部直接画
+    void reset()
+    {
+        for (std::unordered_map<int, GLuint> *queries : { &previous, &current })
+        {
+            for (auto &[id, queryObject] : *queries)
+            {
+                if (queryObject != 0)
+                    pool.push_back(queryObject);
+            }
+            queries->clear();
+        }
+    }
+
+    // 池里和正在使用的查询对象总数
+    size_t queryCount() const
+    {
+        return allocated;
+    }
+
+    void dispose()
+    {
+        reset();
+        glDeleteQueries(static_cast<GLsizei>(pool.size()), pool.data());
+        pool.clear();
+        allocated = 0;
+        glDeleteVertexArrays(1, &cubeVAO);
+        glDeleteBuffers(1, &cubeVBO);
+        glDeleteBuffers(1, &cubeEBO);
+        glDeleteProgram(proxyShader.ID);
+        cubeVAO = cubeVBO = cubeEBO = 0;
+    }
+
+private:
+    Shader proxyShader;
+    GLenum queryTarget = GL_ANY_SAMPLES_PASSED;
+    unsigned int cubeVAO = 0;
+    unsigned int cubeVBO = 0;
+    unsigned int cubeEBO = 0;
+    std::vector<GLuint> pool;
+    size_t allocated = 0;
+    // 物体 id -> 查询对象，0 表示没有查询（直接画）
+    std::unordered_map<int, GLuint> previous;
+    std::unordered_map<int, GLuint> current;
+    glm::vec3 cameraPosition = glm::vec3(0.0f);
+    float nearPlane = 0.1f;
+    GLboolean cullFace = GL_FALSE;
+    int frameObjects = 0;
+    int frameOccluded = 0;
+
+    GLuint acquire()
+    {
+        if (pool.empty())
+        {
+            GLuint queryObject = 0;
+            glGenQueries(1, &queryObject);
+            ++allocated;
+            return queryObject;
+        }
+        GLuint queryObject = pool.back();
+        pool.pop_back();
+        return queryObject;
+    }
+};
@@ -0,0 +1,592 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include <tools/gpu_timer.h>
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <functional>
+#include <algorithm>
+#include <iostream>
+
+/*
+    渲染图（Frame Graph）
+    1. 每个 pass 在 setup 里声明读写哪些纹理，临时纹理只给出格式和相对渲染分辨率的缩放，由渲染图统一创建
+    2. compile() 从输出（写默认帧缓冲的 pass、setOutput 标记的纹理）往前倒推，结果没人用的 pass 直接剔除
+    3. 按执行顺序求出每张临时纹理的生命周期，生命周期不重叠、格式和尺寸相同的临时纹理共用同一张 GL 纹理
+    4. 每个 pass 的 FBO 在 compile() 时建好；窗口大小变化时 resize()，所有临时纹理和 FBO 按新尺寸重建
+    外部创建的纹理（比如自己管理帧缓冲的 MipBloom）用 importTexture 接入，只参与依赖分析，不参与分配；
+    只写导入纹理的 pass 没有 FBO，执行前也不绑定帧缓冲、不设视口，由 pass 自己处理
+*/
+class RenderGraph
+{
+public:
+    using Handle = int;
+    static constexpr Handle INVALID_HANDLE = -1;
+
+    struct TextureDesc
+    {
+        GLenum internalFormat = GL_RGBA16F;
+        // 相对于渲染分辨率的缩放
+        float scale = 1.0f;
+        GLenum filter = GL_LINEAR;
+    };
+
+    struct PassStats
+    {
+        std::string name;
+        bool culled;
+        float ms;
+    };
+
+    class PassBuilder;
+    class PassContext;
+    using SetupFunc = std::function<void(PassBuilder &)>;
+    using ExecuteFunc = std::function<void(const PassContext &)>;
+
+    class PassBuilder
+    {
+    public:
+        // 新建一张临时纹理，由这个 pass 第一次写入
+        Handle create(std::string_view name, const TextureDesc &desc)
+        {
+            Handle handle = graph.addResource(name, desc);
+            graph.passes[passIndex].writes.push_back(handle);
+            return handle;
+        }
+
+        Handle read(Handle handle)
+        {
+            graph.passes[passIndex].reads.push_back(handle);
+            return handle;
+        }
+
+        // 在已有内容上继续写，同时算作一次读
+        Handle write(Handle handle)
+        {
+            graph.passes[passIndex].reads.push_back(handle);
+            graph.passes[passIndex].writes.push_back(handle);
+            return handle;
+        }
+
+        // 写默认帧缓冲，这样的 pass 永远不会被剔除
+        void writeBackbuffer()
+        {
+            graph.passes[passIndex].backbuffer = true;
+        }
+
+        // 执行前清除所有附件
+        void clear(const glm::vec4 &color = glm::vec4(0.0f, 0.0f, 0.0f, 1.0f))
+        {
+            graph.passes[passIndex].clear = true;
+            graph.passes[passIndex].clearColor = color;
+        }
+
+    private:
+        friend class RenderGraph;
+        PassBuilder(RenderGraph &graph, size_t passIndex) : graph(graph), passIndex(passIndex) { }
+
+        RenderGraph &graph;
+        size_t passIndex;
+    };
+
+    class PassContext
+    {
+    public:
+        // 当前 pass 的视口大小
+        int width;
+        int height;
+
+        unsigned int texture(Handle handle) const
+        {
+            return graph.texture(handle);
+        }
+
+        // 把 src（需要在 setup 里 read）复制到当前 pass 的目标上，mask 同 glBlitFramebuffer
+        void blit(Handle src, GLbitfield mask) const
+        {
+            const Resource &resource = graph.resources[src];
+            GLenum attachment = attachmentPoint(resource.desc.internalFormat);
+            glBindFramebuffer(GL_READ_FRAMEBUFFER, graph.blitFBO);
+            glFramebufferTexture2D(GL_READ_FRAMEBUFFER, attachment, GL_TEXTURE_2D, graph.texture(src), 0);
+            glBindFramebuffer(GL_DRAW_FRAMEBUFFER, framebuffer);
+            glBlitFramebuffer(0, 0, resource.width, resource.height, 0, 0, width, height, mask, GL_NEAREST);
+            glFramebufferTexture2D(GL_READ_FRAMEBUFFER, attachment, GL_TEXTURE_2D, 0, 0);
+            glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+        }
+
+    private:
+        friend class RenderGraph;
+        PassContext(const RenderGraph &graph, unsigned int framebuffer, int width, int height)
+            : width(width), height(height), graph(graph), framebuffer(framebuffer) { }
+
+        const RenderGraph &graph;
+        unsigned int framebuffer;
+    };
+
+    RenderGraph(int width, int height) : width(width), height(height) { }
+
+    // 清空 pass 和资源，准备重新搭建；已分配的纹理留到下次 compile() 时复用
+    void reset()
+    {
+        releaseFramebuffers();
+        passes.clear();
+        resources.clear();
+        outputs.clear();
+        compiled = false;
+    }
+
+    Handle importTexture(std::string_view name, unsigned int texture, int textureWidth, int textureHeight, GLenum internalFormat = GL_RGBA16F)
+    {
+        Resource resource;
+        resource.name = name;
+        resource.desc.internalFormat = internalFormat;
+        resource.imported = true;
+        resource.texture = texture;
+        resource.width = textureWidth;
+        resource.height = textureHeight;
+        resources.push_back(resource);
+        return static_cast<Handle>(resources.size() - 1);
+    }
+
+    // 导入的纹理换成了另一张（比如历史缓冲乒乓交换）时调用，之后执行的 pass 通过 texture() 取到新纹理
+    // 同时写临时纹理和导入纹理的 pass 的 FBO 还挂着旧纹理，所以写它的 pass 最好只写导入的纹理（不建 FBO，自己绑定帧缓冲）
+    void setImportedTexture(Handle handle, unsigned int texture)
+    {
+        resources[handle].texture = texture;
+    }
+
+    void addPass(std::string_view name, const SetupFunc &setup, ExecuteFunc execute)
+    {
+        Pass pass;
+        pass.name = name;
+        pass.execute = std::move(execute);
+        passes.push_back(std::move(pass));
+        PassBuilder builder(*this, passes.size() - 1);
+        setup(builder);
+    }
+
+    // 标记为输出的纹理在整帧结束前都不会被别的纹理复用
+    void setOutput(Handle handle)
+    {
+        outputs.push_back(handle);
+    }
+
+    void compile()
+    {
+        releaseFramebuffers();
+        if (blitFBO == 0)
+            glGenFramebuffers(1, &blitFBO);
+
+        // 1. 剔除：倒序遍历，写了被需要的纹理（或默认帧缓冲）的 pass 才保留，并把它读的纹理标记为需要
+        std::vector<bool> needed(resources.size(), false);
+        for (Handle handle : outputs)
+            needed[handle] = true;
+        for (size_t i = passes.size(); i-- > 0;)
+        {
+            Pass &pass = passes[i];
+            pass.culled = !pass.backbuffer && std::none_of(pass.writes.begin(), pass.writes.end(),
+                [&](Handle handle) { return needed[handle]; });
+            if (!pass.culled)
+                for (Handle handle : pass.reads)
+                    needed[handle] = true;
+        }
+
+        // 2. 生命周期：第一次和最后一次被保留的 pass 访问
+        for (Resource &resource : resources)
+        {
+            resource.firstPass = resource.lastPass = -1;
+            if (!resource.imported)
+                resource.physical = -1;
+        }
+        for (size_t i = 0; i < passes.size(); ++i)
+        {
+            if (passes[i].culled)
+                continue;
+            for (const std::vector<Handle> *list : { &passes[i].writes, &passes[i].reads })
+            {
+                for (Handle handle : *list)
+                {
+                    Resource &resource = resources[handle];
+                    if (resource.firstPass < 0)
+                        resource.firstPass = static_cast<int>(i);
+                    resource.lastPass = static_cast<int>(i);
+                }
+            }
+        }
+        for (Handle handle : outputs)
+            resources[handle].lastPass = static_cast<int>(passes.size());
+
+        // 3. 分配：先给这个 pass 新写的纹理分配，再释放这个 pass 之后不再用的纹理，输入和输出不会共用一张纹理
+        for (PhysicalTexture &physical : pool)
+            physical.used = physical.busy = false;
+        for (size_t i = 0; i < passes.size(); ++i)
+        {
+            const Pass &pass = passes[i];
+            if (pass.culled)
+                continue;
+            for (Handle handle : pass.writes)
+            {
+                Resource &resource = resources[handle];
+                if (!resource.imported && resource.firstPass == static_cast<int>(i))
+                {
+                    resource.width = glm::max(1, static_cast<int>(width * resource.desc.scale));
+                    resource.height = glm::max(1, static_cast<int>(height * resource.desc.scale));
+                    resource.physical = acquire(resource);
+                }
+            }
+            for (const std::vector<Handle> *list : { &pass.writes, &pass.reads })
+            {
+                for (Handle handle : *list)
+                {
+                    const Resource &resource = resources[handle];
+                    if (!resource.imported && resource.lastPass == static_cast<int>(i) && resource.physical >= 0)
+                        pool[resource.physical].busy = false;
+                }
+            }
+        }
+
+        // 这次没用上的纹理删掉，剩下的重新编号
+        std::vector<int> remap(pool.size(), -1);
+        std::vector<PhysicalTexture> kept;
+        for (size_t i = 0; i < pool.size(); ++i)
+        {
+            if (pool[i].used)
+            {
+                remap[i] = static_cast<int>(kept.size());
+                kept.push_back(pool[i]);
+            }
+            else
+            {
+                glDeleteTextures(1, &pool[i].texture);
+            }
+        }
+        pool.swap(kept);
+        for (Resource &resource : resources)
+            if (!resource.imported && resource.physical >= 0)
+                resource.physical = remap[resource.physical];
+
+        // 4. 每个 pass 的 FBO，只写导入纹理（或什么都不写）的 pass 自己管理帧缓冲，不用建
+        for (Pass &pass : passes)
+        {
+            if (pass.culled || pass.backbuffer)
+                continue;
+            if (std::all_of(pass.writes.begin(), pass.writes.end(), [&](Handle handle) { return resources[handle].imported; }))
+                continue;
+
+            glGenFramebuffers(1, &pass.framebuffer);
+            glBindFramebuffer(GL_FRAMEBUFFER, pass.framebuffer);
+            std::vector<GLenum> drawBuffers;
+            std::vector<Handle> attached;
+            for (Handle handle : pass.writes)
+            {
+                if (std::find(attached.begin(), attached.end(), handle) != attached.end())
+                    continue;
+                attached.push_back(handle);
+
+                const Resource &resource = resources[handle];
+                GLenum attachment = attachmentPoint(resource.desc.internalFormat);
+                if (attachment == GL_COLOR_ATTACHMENT0)
+                {
+                    attachment = GL_COLOR_ATTACHMENT0 + static_cast<GLenum>(drawBuffers.size());
+                    drawBuffers.push_back(attachment);
+                }
+                glFramebufferTexture2D(GL_FRAMEBUFFER, attachment, GL_TEXTURE_2D, texture(handle), 0);
+                pass.width = resource.width;
+                pass.height = resource.height;
+            }
+            if (drawBuffers.empty())
+            {
+                glDrawBuffer(GL_NONE);
+                glReadBuffer(GL_NONE);
+            }
+            else
+            {
+                glDrawBuffers(static_cast<GLsizei>(drawBuffers.size()), drawBuffers.data());
+            }
+            if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+                std::cout << "ERROR::FRAMEBUFFER:: Render graph pass '" << pass.name << "' framebuffer is not complete!" << std::endl;
+        }
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+        for (GpuTimer &timer : timers)
+            timer.dispose();
+        timers.clear();
+        timers.resize(passes.size());
+        compiled = true;
+    }
+
+    void execute()
+    {
+        if (!compiled)
+            compile();
+
+        for (size_t i = 0; i < passes.size(); ++i)
+        {
+            Pass &pass = passes[i];
+            if (pass.culled)
+                continue;
+
+            timers[i].begin();
+            unsigned int framebuffer = pass.framebuffer;
+            int passWidth = pass.width;
+            int passHeight = pass.height;
+            if (pass.backbuffer)
+            {
+                framebuffer = 0;
+                passWidth = width;
+                passHeight = height;
+            }
+            // 没有 FBO 的 pass（只写导入的纹理，或者什么都不写）自己管理帧缓冲和视口
+            if (pass.backbuffer || pass.framebuffer != 0)
+            {
+                glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+                glViewport(0, 0, passWidth, passHeight);
+                if (pass.clear)
+                {
+                    glClearColor(pass.clearColor.r, pass.clearColor.g, pass.clearColor.b, pass.clearColor.a);
+                    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT | GL_STENCIL_BUFFER_BIT);
+                }
+            }
+            pass.execute(PassContext(*this, framebuffer, passWidth, passHeight));
+            timers[i].end();
+        }
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    }
+
+    // 尺寸变化后重新分配所有临时纹理，外部导入的纹理由调用者自己重建后重新搭建渲染图
+    void resize(int newWidth, int newHeight)
+    {
+        if (newWidth == width && newHeight == height)
+            return;
+        width = newWidth;
+        height = newHeight;
+        if (compiled)
+            compile();
+    }
+
+    unsigned int texture(Handle handle) const
+    {
+        const Resource &resource = resources[handle];
+        if (resource.imported)
+            return resource.texture;
+        return resource.physical >= 0 ? pool[resource.physical].texture : 0;
+    }
+
+    // 实际分配的临时纹理占用的显存（字节）
+    size_t transientBytes() const
+    {
+        size_t bytes = 0;
+        for (const PhysicalTexture &physical : pool)
+            bytes += static_cast<size_t>(physical.width) * physical.height * bytesPerPixel(physical.internalFormat);
+        return bytes;
+    }
+
+    // 每张临时纹理各自分配（即不复用）时需要的显存
+    size_t unaliasedBytes() const
+    {
+        size_t bytes = 0;
+        for (const Resource &resource : resources)
+            if (!resource.imported && resource.physical >= 0)
+                bytes += static_cast<size_t>(resource.width) * resource.height * bytesPerPixel(resource.desc.internalFormat);
+        return bytes;
+    }
+
+    std::vector<PassStats> stats() const
+    {
+        std::vector<PassStats> result;
+        for (size_t i = 0; i < passes.size(); ++i)
+            result.push_back({ passes[i].name, passes[i].culled, passes[i].culled || i >= timers.size() ? 0.0f : timers[i].ms });
+        return result;
+    }
+
+    int getWidth() const
+    {
+        return width;
+    }
+
+    int getHeight() const
+    {
+        return height;
+    }
+
+    void dispose()
+    {
+        reset();
+        for (PhysicalTexture &physical : pool)
+            glDeleteTextures(1, &physical.texture);
+        pool.clear();
+        for (GpuTimer &timer : timers)
+            timer.dispose();
+        timers.clear();
+        glDeleteFramebuffers(1, &blitFBO);
+        blitFBO = 0;
+    }
+
+    static size_t bytesPerPixel(GLenum internalFormat)
+    {
+        switch (internalFormat)
+        {
+        case GL_R8:
+            return 1;
+        case GL_R16F:
+        case GL_RG8:
+        case GL_DEPTH_COMPONENT16:
+            return 2;
+        case GL_RGB8:
+            return 3;
+        case GL_RGB16F:
+            return 6;
+        case GL_RGBA16F:
+        case GL_RG32F:
+        case GL_DEPTH32F_STENCIL8:
+            return 8;
+        case GL_RGB32F:
+            return 12;
+        case GL_RGBA32F:
+            return 16;
+        default:
+            // RGBA8、RG16、RG16F、R32F、R11F_G11F_B10F、RGB10_A2、DEPTH24_STENCIL8 等都是 4 字节
+            return 4;
+        }
+    }
+
+private:
+    struct Resource
+    {
+        std::string name;
+        TextureDesc desc;
+        bool imported = false;
+        unsigned int texture = 0; // 只对导入的纹理有效
+        int width = 0;
+        int height = 0;
+        int physical = -1;
+        int firstPass = -1;
+        int lastPass = -1;
+    };
+
+    struct Pass
+    {
+        std::string name;
+        ExecuteFunc execute;
+        std::vector<Handle> reads;
+        std::vector<Handle> writes;
+        bool backbuffer = false;
+        bool clear = false;
+        glm::vec4 clearColor = glm::vec4(0.0f);
+        bool culled = false;
+        unsigned int framebuffer = 0;
+        int width = 0;
+        int height = 0;
+    };
+
+    struct PhysicalTexture
+    {
+        unsigned int texture = 0;
+        GLenum internalFormat = GL_NONE;
+        GLenum filter = GL_LINEAR;
+        int width = 0;
+        int height = 0;
+        bool used = false; // 这次 compile 中被分配过
+        bool busy = false; // 当前正被某张临时纹理占用
+    };
+
+    int width;
+    int height;
+    bool compiled = false;
+    std::vector<Resource> resources;
+    std::vector<Pass> passes;
+    std::vector<Handle> outputs;
+    std::vector<PhysicalTexture> pool;
+    std::vector<GpuTimer> timers;
+    unsigned int blitFBO = 0;
+
+    Handle addResource(std::string_view name, const TextureDesc &desc)
+    {
+        Resource resource;
+        resource.name = name;
+        resource.desc = desc;
+        resources.push_back(resource);
+        return static_cast<Handle>(resources.size() - 1);
+    }
+
+    static bool isDepthFormat(GLenum internalFormat)
+    {
+        return internalFormat == GL_DEPTH_COMPONENT16 || internalFormat == GL_DEPTH_COMPONENT24
+            || internalFormat == GL_DEPTH_COMPONENT32F || internalFormat == GL_DEPTH_COMPONENT
+            || internalFormat == GL_DEPTH24_STENCIL8 || internalFormat == GL_DEPTH32F_STENCIL8;
+    }
+
+    static GLenum attachmentPoint(GLenum internalFormat)
+    {
+        if (internalFormat == GL_DEPTH24_STENCIL8 || internalFormat == GL_DEPTH32F_STENCIL8)
+            return GL_DEPTH_STENCIL_ATTACHMENT;
+        if (isDepthFormat(internalFormat))
+            return GL_DEPTH_ATTACHMENT;
+        return GL_COLOR_ATTACHMENT0;
+    }
+
+    // 找一张空闲且格式、尺寸相同的纹理，没有就新建
+    int acquire(const Resource &resource)
+    {
+        for (size_t i = 0; i < pool.size(); ++i)
+        {
+            PhysicalTexture &physical = pool[i];
+            if (!physical.busy && physical.internalFormat == resource.desc.internalFormat && physical.filter == resource.desc.filter
+                && physical.width == resource.width && physical.height == resource.height)
+            {
+                physical.used = physical.busy = true;
+                return static_cast<int>(i);
+            }
+        }
+
+        PhysicalTexture physical;
+        physical.internalFormat = resource.desc.internalFormat;
+        physical.filter = resource.desc.filter;
+        physical.width = resource.width;
+        physical.height = resource.height;
+        physical.used = physical.busy = true;
+
+        GLenum format = GL_RGBA;
+        GLenum type = GL_FLOAT;
+        if (physical.internalFormat == GL_DEPTH24_STENCIL8)
+        {
+            format = GL_DEPTH_STENCIL;
+            type = GL_UNSIGNED_INT_24_8;
+        }
+        else if (physical.internalFormat == GL_DEPTH32F_STENCIL8)
+        {
+            format = GL_DEPTH_STENCIL;
+            type = GL_FLOAT_32_UNSIGNED_INT_24_8_REV;
+        }
+        else if (isDepthFormat(physical.internalFormat))
+        {
+            format = GL_DEPTH_COMPONENT;
+        }
+
+        glGenTextures(1, &physical.texture);
+        glBindTexture(GL_TEXTURE_2D, physical.texture);
+        glTexImage2D(GL_TEXTURE_2D, 0, physical.internalFormat, physical.width, physical.height, 0, format, type, nullptr);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, physical.filter);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, physical.filter);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        glBindTexture(GL_TEXTURE_2D, 0);
+
+        pool.push_back(physical);
+        return static_cast<int>(pool.size() - 1);
+    }
+
+    void releaseFramebuffers()
+    {
+        for (Pass &pass : passes)
+        {
+            if (pass.framebuffer != 0)
+                glDeleteFramebuffers(1, &pass.framebuffer);
+            pass.framebuffer = 0;
+        }
+    }
+};
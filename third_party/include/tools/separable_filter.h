@@ -0,0 +1,243 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include <tools/shader.h>
+#include <tools/compute_shader.h>
+
+#include <array>
+#include <iostream>
+
+/*
+    可分离的后处理滤波：高斯、方框、双边（按引导纹理的深度差降低权重）
+    1. 支持计算着色器（GL 4.3+）时用 glsl/separable_filter.comp，一行的像素和两侧的边缘先读进共享内存
+    2. 否则退回 glsl/separable_filter.frag，一次横向 + 一次纵向的全屏绘制
+    两条路径的参数和结果相同，useCompute 可以随时切换，方便对比性能
+    结果在 texture() 中，格式和构造时给的 internalFormat 相同
+*/
+class SeparableFilter
+{
+public:
+    enum class Kind
+    {
+        Gaussian,
+        Box,
+        Bilateral,
+        Count
+    };
+
+    static constexpr int KIND_COUNT = static_cast<int>(Kind::Count);
+    static constexpr int MAX_RADIUS = 16;
+    // 与 separable_filter.comp 的 TILE 一致
+    static constexpr int TILE = 128;
+
+    Kind kind = Kind::Gaussian;
+    int radius = 4;
+    float sigma = 2.0f;
+    // 双边滤波的深度容差，单位和引导纹理相同
+    float depthSigma = 0.5f;
+    bool useCompute = false;
+
+    int width = 0;
+    int height = 0;
+
+    // internalFormat 只支持 GL_RGBA16F / GL_RGBA32F / GL_R16F / GL_R32F / GL_R11F_G11F_B10F
+    SeparableFilter(int width, int height, GLenum internalFormat = GL_RGBA16F)
+        : width(width), height(height), internalFormat(internalFormat),
+          fragmentShader(GLSL_INCLUDE_DIR "/fullscreen_triangle.vert", GLSL_INCLUDE_DIR "/separable_filter.frag")
+    {
+        if (ComputeGL::supported)
+        {
+            computeShader = ComputeShader(GLSL_INCLUDE_DIR "/separable_filter.comp", imageFormatDefine(internalFormat));
+            useCompute = true;
+        }
+
+        for (unsigned int &texture : textures)
+        {
+            glGenTextures(1, &texture);
+            glBindTexture(GL_TEXTURE_2D, texture);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        }
+        resize(width, height);
+
+        glGenFramebuffers(1, &FBO);
+        glBindFramebuffer(GL_FRAMEBUFFER, FBO);
+        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, textures[1], 0);
+        if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+            std::cout << "ERROR::FRAMEBUFFER:: Separable filter framebuffer is not complete!" << std::endl;
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+        glGenVertexArrays(1, &emptyVAO);
+    }
+
+    static const char *name(Kind kind)
+    {
+        static const std::array<const char *, KIND_COUNT> names = { "Gaussian", "Box", "Bilateral" };
+        return names[static_cast<int>(kind)];
+    }
+
+    // 按新尺寸重新分配中间和结果纹理，纹理对象不变
+    void resize(int newWidth, int newHeight)
+    {
+        width = newWidth;
+        height = newHeight;
+        for (unsigned int texture : textures)
+        {
+            glBindTexture(GL_TEXTURE_2D, texture);
+            glTexImage2D(GL_TEXTURE_2D, 0, internalFormat, width, height, 0, GL_RGBA, GL_FLOAT, nullptr);
+        }
+        glBindTexture(GL_TEXTURE_2D, 0);
+    }
+
+    bool computeAvailable() const
+    {
+        return computeShader.ID != 0;
+    }
+
+    // 横向 + 纵向为一次迭代；双边滤波需要 guide（和 src 同尺寸，.z 为深度）
+    // src 必须和滤波器同尺寸，结果为 texture()
+    unsigned int apply(unsigned int src, unsigned int guide = 0, int iterations = 1)
+    {
+        updateWeights();
+        bool bilateral = kind == Kind::Bilateral && guide != 0;
+
+        glActiveTexture(GL_TEXTURE1);
+        glBindTexture(GL_TEXTURE_2D, guide);
+        if (useCompute && computeAvailable())
+            applyCompute(src, bilateral, iterations);
+        else
+            applyFragment(src, bilateral, iterations);
+        glActiveTexture(GL_TEXTURE0);
+        return texture();
+    }
+
+    unsigned int texture() const
+    {
+        return textures[1];
+    }
+
+    void dispose()
+    {
+        glDeleteTextures(2, textures);
+        glDeleteFramebuffers(1, &FBO);
+        glDeleteVertexArrays(1, &emptyVAO);
+        glDeleteProgram(fragmentShader.ID);
+        computeShader.dispose();
+        textures[0] = textures[1] = FBO = emptyVAO = 0;
+    }
+
+private:
+    GLenum internalFormat;
+    // 0 为横向的中间结果，1 为最终结果
+    unsigned int textures[2] = {};
+    unsigned int FBO = 0;
+    unsigned int emptyVAO = 0;
+    Shader fragmentShader;
+    ComputeShader computeShader;
+    std::array<float, MAX_RADIUS + 1> weights{};
+
+    static const char *imageFormatDefine(GLenum format)
+    {
+        switch (format)
+        {
+        case GL_RGBA32F:
+            return "#define IMAGE_FORMAT rgba32f\n";
+        case GL_R16F:
+            return "#define IMAGE_FORMAT r16f\n";
+        case GL_R32F:
+            return "#define IMAGE_FORMAT r32f\n";
+        case GL_R11F_G11F_B10F:
+            return "#define IMAGE_FORMAT r11f_g11f_b10f\n";
+        default:
+            return "#define IMAGE_FORMAT rgba16f\n";
+        }
+    }
+
+    void updateWeights()
+    {
+        radius = glm::clamp(radius, 0, MAX_RADIUS);
+        float sum = 0.0f;
+        for (int i = 0; i <= radius; ++i)
+        {
+            // 方框滤波所有权重相同，高斯和双边用高斯的空间权重
+            weights[i] = kind == Kind::Box ? 1.0f : glm::exp(-0.5f * i * i / (sigma * sigma));
+            sum += i == 0 ? weights[i] : 2.0f * weights[i];
+        }
+        for (int i = 0; i <= radius; ++i)
+            weights[i] /= sum;
+    }
+
+    void applyCompute(unsigned int src, bool bilateral, int iterations)
+    {
+        computeShader.use();
+        computeShader.setInt("srcTexture", 0);
+        computeShader.setInt("guideTexture", 1);
+        computeShader.setInt("radius", radius);
+        computeShader.setBool("bilateral", bilateral);
+        computeShader.setFloat("depthSigma", depthSigma);
+        glUniform1fv(glGetUniformLocation(computeShader.ID, "weights"), MAX_RADIUS + 1, weights.data());
+
+        GLuint groupsX = (width + TILE - 1) / TILE;
+        GLuint groupsY = (height + TILE - 1) / TILE;
+        glActiveTexture(GL_TEXTURE0);
+        for (int i = 0; i < iterations; ++i)
+        {
+            // 横向：src -> textures[0]，一个工作组处理一行中的 TILE 个像素
+            glBindTexture(GL_TEXTURE_2D, i == 0 ? src : textures[1]);
+            ComputeGL::bindImageTexture(0, textures[0], 0, GL_FALSE, 0, GL_WRITE_ONLY, internalFormat);
+            computeShader.setIVec2("direction", glm::ivec2(1, 0));
+            computeShader.dispatch(groupsX, height);
+            ComputeGL::memoryBarrier(ComputeGL::TEXTURE_FETCH_BARRIER_BIT);
+
+            // 纵向：textures[0] -> textures[1]，一个工作组处理一列中的 TILE 个像素
+            glBindTexture(GL_TEXTURE_2D, textures[0]);
+            ComputeGL::bindImageTexture(0, textures[1], 0, GL_FALSE, 0, GL_WRITE_ONLY, internalFormat);
+            computeShader.setIVec2("direction", glm::ivec2(0, 1));
+            computeShader.dispatch(groupsY, width);
+            ComputeGL::memoryBarrier(ComputeGL::TEXTURE_FETCH_BARRIER_BIT);
+        }
+    }
+
+    void applyFragment(unsigned int src, bool bilateral, int iterations)
+    {
+        fragmentShader.use();
+        fragmentShader.setInt("srcTexture", 0);
+        fragmentShader.setInt("guideTexture", 1);
+        fragmentShader.setInt("radius", radius);
+        fragmentShader.setBool("bilateral", bilateral);
+        fragmentShader.setFloat("depthSigma", depthSigma);
+        glUniform1fv(glGetUniformLocation(fragmentShader.ID, "weights"), MAX_RADIUS + 1, weights.data());
+        GLint directionLocation = glGetUniformLocation(fragmentShader.ID, "direction");
+
+        GLboolean depthTest = glIsEnabled(GL_DEPTH_TEST);
+        GLboolean blend = glIsEnabled(GL_BLEND);
+        glDisable(GL_DEPTH_TEST);
+        glDisable(GL_BLEND);
+        glViewport(0, 0, width, height);
+        glBindFramebuffer(GL_FRAMEBUFFER, FBO);
+        glBindVertexArray(emptyVAO);
+        glActiveTexture(GL_TEXTURE0);
+        for (int i = 0; i < iterations; ++i)
+        {
+            glBindTexture(GL_TEXTURE_2D, i == 0 ? src : textures[1]);
+            glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, textures[0], 0);
+            glUniform2i(directionLocation, 1, 0);
+            glDrawArrays(GL_TRIANGLES, 0, 3);
+
+            glBindTexture(GL_TEXTURE_2D, textures[0]);
+            glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, textures[1], 0);
+            glUniform2i(directionLocation, 0, 1);
+            glDrawArrays(GL_TRIANGLES, 0, 3);
+        }
+        glBindVertexArray(0);
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+        if (blend)
+            glEnable(GL_BLEND);
+        if (depthTest)
+            glEnable(GL_DEPTH_TEST);
+    }
+};
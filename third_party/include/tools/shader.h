@@ -10,15 +10,25 @@
 #include <iostream>
 #include <string_view>
 #include <filesystem>
+#include <vector>
+
+/*
+    着色器源码在编译前做一次简单的预处理：
+    1. defines 插在 #version 之后，同一份源码可以编出不同的变体（例如不同的阴影过滤方式）
+    2. #include "xxx.glsl" 先在当前文件所在目录找，找不到再去 GLSL_INCLUDE_DIR（third_party/include/glsl）找
+    feedbackVaryings 不为空时，链接前把这些输出设为 transform feedback 捕获的变量（交错写进一个缓冲）
+*/
 
 class Shader
 {
 public:
     unsigned int ID;
+    // 顶点着色器只读 location 0（位置）时为 true，网格据此自动换用紧凑的位置流（见 tools/position_stream.h）
+    bool positionOnly = false;
 
     // constructor generates the shader on the fly
     // ------------------------------------------------------------------------
-    Shader(std::string_view vertexPath, std::string_view fragmentPath, std::string_view geometryPath = { })
+    Shader(std::string_view vertexPath, std::string_view fragmentPath, std::string_view geometryPath = { }, std::string_view defines = { }, const std::vector<const char *> &feedbackVaryings = { })
     {
         // 1. retrieve the vertex/fragment source code from filePath
         std::string vertexCode;
@@ -60,6 +70,10 @@ public:
         {
             std::cerr << "ERROR::SHADER::FILE_NOT_SUCCESFULLY_READ" << std::endl;
         }
+        vertexCode = preprocess(vertexCode, vertexPath, defines);
+        fragmentCode = preprocess(fragmentCode, fragmentPath, defines);
+        if (!geometryPath.empty())
+            geometryCode = preprocess(geometryCode, geometryPath, defines);
         const char *vShaderCode = vertexCode.c_str();
         const char *fShaderCode = fragmentCode.c_str();
         // 2. compile shaders
@@ -90,8 +104,11 @@ public:
         glAttachShader(ID, fragment);
         if (!geometryPath.empty())
             glAttachShader(ID, geometry);
+        if (!feedbackVaryings.empty())
+            glTransformFeedbackVaryings(ID, static_cast<GLsizei>(feedbackVaryings.size()), feedbackVaryings.data(), GL_INTERLEAVED_ATTRIBS);
         glLinkProgram(ID);
         checkCompileErrors(ID, "PROGRAM");
+        positionOnly = readsOnlyPosition();
         // delete the shaders as they're linked into our program now and no longer necessery
         glDeleteShader(vertex);
         glDeleteShader(fragment);
@@ -163,7 +180,98 @@ public:
         glUniformMatrix4fv(glGetUniformLocation(ID, name.data()), 1, GL_FALSE, &mat[0][0]);
     }
 
+    // 展开 #include 并插入 defines，插入的内容后面补上 #line，报错的行号仍然对应原文件
+    // GLSL 3.30 中 "#line n" 的下一行是第 n + 1 行，所以写出 #include / #version 所在的行号
+    // 计算着色器等不走构造函数的程序也可以直接用
+    // ------------------------------------------------------------------------
+    static std::string preprocess(const std::string &code, std::string_view path, std::string_view defines)
+    {
+        std::vector<std::filesystem::path> included;
+        return expand(code, std::filesystem::path(path).parent_path(), defines, included);
+    }
+
 private:
+    bool readsOnlyPosition() const
+    {
+        GLint count = 0;
+        glGetProgramiv(ID, GL_ACTIVE_ATTRIBUTES, &count);
+        int attributes = 0;
+        for (GLint i = 0; i < count; ++i)
+        {
+            char name[256];
+            GLsizei length = 0;
+            GLint size = 0;
+            GLenum type = 0;
+            glGetActiveAttrib(ID, i, sizeof(name), &length, &size, &type, name);
+            // gl_VertexID 等内置变量不占用顶点属性
+            if (std::string_view(name, length).starts_with("gl_"))
+                continue;
+            if (glGetAttribLocation(ID, name) != 0)
+                return false;
+            ++attributes;
+        }
+        return attributes == 1;
+    }
+
+    static std::string expand(const std::string &code, const std::filesystem::path &dir, std::string_view defines, std::vector<std::filesystem::path> &included)
+    {
+        std::istringstream input(code);
+        std::ostringstream output;
+        std::string line;
+        int lineNumber = 0;
+        while (std::getline(input, line))
+        {
+            ++lineNumber;
+            size_t start = line.find_first_not_of(" \t");
+            if (start != std::string::npos && line.compare(start, 8, "#include") == 0)
+            {
+                size_t open = line.find('"', start);
+                size_t close = open == std::string::npos ? open : line.find('"', open + 1);
+                if (close == std::string::npos)
+                {
+                    std::cerr << "ERROR::SHADER::INVALID_INCLUDE: " << line << std::endl;
+                    continue;
+                }
+                std::string name = line.substr(open + 1, close - open - 1);
+                std::filesystem::path file = dir / name;
+#ifdef GLSL_INCLUDE_DIR
+                if (!std::filesystem::exists(file))
+                    file = std::filesystem::path(GLSL_INCLUDE_DIR) / name;
+#endif
+                std::ifstream includeFile(file);
+                if (!includeFile)
+                {
+                    std::cerr << "ERROR::SHADER::INCLUDE_NOT_FOUND: " << name << std::endl;
+                    continue;
+                }
+                // 同一个文件只展开一次
+                file = std::filesystem::weakly_canonical(file);
+                bool seen = false;
+                for (const std::filesystem::path &p : included)
+                    seen = seen || p == file;
+                if (!seen)
+                {
+                    included.push_back(file);
+                    std::stringstream includeStream;
+                    includeStream << includeFile.rdbuf();
+                    output << expand(includeStream.str(), file.parent_path(), { }, included);
+                }
+                output << "#line " << lineNumber << "\n";
+                continue;
+            }
+
+            output << line << "\n";
+            if (!defines.empty() && start != std::string::npos && line.compare(start, 8, "#version") == 0)
+            {
+                output << defines;
+                if (defines.back() != '\n')
+                    output << "\n";
+                output << "#line " << lineNumber << "\n";
+            }
+        }
+        return output.str();
+    }
+
     // utility function for checking shader compilation/linking errors.
     // ------------------------------------------------------------------------
     void checkCompileErrors(GLuint shader, std::string type)
@@ -0,0 +1,443 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <tools/shader.h>
+
+#include <vector>
+#include <algorithm>
+#include <numeric>
+#include <iostream>
+
+/*
+    阴影图集
+    一张大的深度纹理，按 2 的幂切成正方形的块，用四叉树式的伙伴分配：
+    大块不够时拆成 4 个小块，释放时 4 个兄弟都空闲就合并回去
+    块的位置在释放之前不会变，所以已经渲染好的内容可以跨帧复用
+*/
+class ShadowAtlas
+{
+public:
+    struct Tile
+    {
+        int x = 0;
+        int y = 0;
+        int size = 0; // 0 表示没有分配到
+    };
+
+    unsigned int FBO = 0;
+    unsigned int depthTexture = 0;
+    int size = 0;
+    int minTileSize = 0;
+
+    ShadowAtlas() = default;
+
+    ShadowAtlas(int size, int minTileSize = 64)
+        : size(size), minTileSize(minTileSize)
+    {
+        for (int s = size; s >= minTileSize; s /= 2)
+            freeLists.emplace_back();
+        freeLists[0].push_back({ 0, 0, size });
+
+        glGenTextures(1, &depthTexture);
+        glBindTexture(GL_TEXTURE_2D, depthTexture);
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_DEPTH_COMPONENT24, size, size, 0, GL_DEPTH_COMPONENT, GL_FLOAT, nullptr);
+        // 硬件比较，一次采样就是 2x2 的双线性 PCF
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_COMPARE_MODE, GL_COMPARE_REF_TO_TEXTURE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_COMPARE_FUNC, GL_LEQUAL);
+        glBindTexture(GL_TEXTURE_2D, 0);
+
+        glGenFramebuffers(1, &FBO);
+        glBindFramebuffer(GL_FRAMEBUFFER, FBO);
+        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_TEXTURE_2D, depthTexture, 0);
+        glDrawBuffer(GL_NONE);
+        glReadBuffer(GL_NONE);
+        if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+            std::cout << "ERROR::FRAMEBUFFER:: Shadow atlas framebuffer is not complete!" << std::endl;
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    }
+
+    // tileSize 必须是 2 的幂，且在 [minTileSize, size] 之间
+    Tile allocate(int tileSize)
+    {
+        int level = levelOf(tileSize);
+        if (level < 0)
+            return {};
+
+        // 向上找最近一个有空闲块的层
+        int from = level;
+        while (from >= 0 && freeLists[from].empty())
+            --from;
+        if (from < 0)
+            return {};
+
+        // 逐层拆分到需要的大小
+        for (; from < level; ++from)
+        {
+            Tile parent = freeLists[from].back();
+            freeLists[from].pop_back();
+            int half = parent.size / 2;
+            freeLists[from + 1].push_back({ parent.x + half, parent.y + half, half });
+            freeLists[from + 1].push_back({ parent.x, parent.y + half, half });
+            freeLists[from + 1].push_back({ parent.x + half, parent.y, half });
+            freeLists[from + 1].push_back({ parent.x, parent.y, half });
+        }
+
+        Tile tile = freeLists[level].back();
+        freeLists[level].pop_back();
+        return tile;
+    }
+
+    void release(Tile tile)
+    {
+        int level = levelOf(tile.size);
+        while (level > 0)
+        {
+            // 兄弟块都空闲时合并成父块
+            int parentSize = tile.size * 2;
+            int px = tile.x / parentSize * parentSize;
+            int py = tile.y / parentSize * parentSize;
+            std::vector<Tile> &list = freeLists[level];
+            int found = 0;
+            for (const Tile &t : list)
+                if (t.x / parentSize * parentSize == px && t.y / parentSize * parentSize == py)
+                    ++found;
+            if (found < 3)
+                break;
+
+            list.erase(std::remove_if(list.begin(), list.end(), [&](const Tile &t)
+                {
+                    return t.x / parentSize * parentSize == px && t.y / parentSize * parentSize == py;
+                }), list.end());
+            tile = { px, py, parentSize };
+            --level;
+        }
+        freeLists[level].push_back(tile);
+    }
+
+    // 块在图集中的 uv 范围：xy 为起点，zw 为大小
+    glm::vec4 uvRect(const Tile &tile) const
+    {
+        float inv = 1.0f / size;
+        return glm::vec4(tile.x * inv, tile.y * inv, tile.size * inv, tile.size * inv);
+    }
+
+    // 绑定图集并把渲染限制在这个块里
+    void beginTile(const Tile &tile)
+    {
+        glBindFramebuffer(GL_FRAMEBUFFER, FBO);
+        glViewport(tile.x, tile.y, tile.size, tile.size);
+        glEnable(GL_SCISSOR_TEST);
+        glScissor(tile.x, tile.y, tile.size, tile.size);
+        glClear(GL_DEPTH_BUFFER_BIT);
+    }
+
+    void end()
+    {
+        glDisable(GL_SCISSOR_TEST);
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    }
+
+    void dispose()
+    {
+        glDeleteTextures(1, &depthTexture);
+        glDeleteFramebuffers(1, &FBO);
+        depthTexture = FBO = 0;
+    }
+
+private:
+    // 下标 0 是整张图集，每往下一层边长减半
+    std::vector<std::vector<Tile>> freeLists;
+
+    int levelOf(int tileSize) const
+    {
+        int level = 0;
+        for (int s = size; s > tileSize; s /= 2)
+            ++level;
+        if (tileSize < minTileSize || level >= static_cast<int>(freeLists.size()) || (size >> level) != tileSize)
+            return -1;
+        return level;
+    }
+};
+
+/*
+    点光源阴影图集
+    1. 每个点光源的 6 个立方体面各占图集中的一块，块的大小按光源在屏幕上的覆盖范围分配
+    2. 光源没动、面视锥内的投射物也没动，就直接复用上一次渲染的结果
+    3. 每帧只重新渲染有限个面，按重要程度先后处理
+    每个面的 uv 范围写进一张 6 x maxLights 的 RGBA32F 纹理，着色器用 texelFetch(faceTable, ivec2(face, light)) 读取
+*/
+class PointShadowAtlas
+{
+public:
+    struct Light
+    {
+        glm::vec3 position = glm::vec3(0.0f);
+        float range = 25.0f;
+        bool enabled = true;
+        float importance = 0.0f;
+        int requestedSize = 0; // 按重要程度想要的大小
+        int tileSize = 0;      // 实际分配到的大小，图集满了会比 requestedSize 小，0 表示没有阴影
+        ShadowAtlas::Tile faces[6];
+        bool dirty[6] = { true, true, true, true, true, true };
+        bool rendered[6] = {};
+    };
+
+    ShadowAtlas atlas;
+    std::vector<Light> lights;
+    unsigned int faceTable = 0;
+    int maxLights = 0;
+    int maxTileSize = 512;
+    // 上一帧实际重新渲染的面数
+    int facesRendered = 0;
+
+    PointShadowAtlas() = default;
+
+    PointShadowAtlas(int atlasSize, int maxLights, int minTileSize = 64)
+        : atlas(atlasSize, minTileSize), maxLights(maxLights)
+    {
+        lights.reserve(maxLights);
+        faceRects.resize(static_cast<size_t>(maxLights) * 6, glm::vec4(0.0f));
+
+        glGenTextures(1, &faceTable);
+        glBindTexture(GL_TEXTURE_2D, faceTable);
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA32F, 6, maxLights, 0, GL_RGBA, GL_FLOAT, faceRects.data());
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+        glBindTexture(GL_TEXTURE_2D, 0);
+    }
+
+    int addLight(const glm::vec3 &position, float range)
+    {
+        if (static_cast<int>(lights.size()) >= maxLights)
+            return -1;
+        Light light;
+        light.position = position;
+        light.range = range;
+        lights.push_back(light);
+        return static_cast<int>(lights.size()) - 1;
+    }
+
+    void setLightPosition(int index, const glm::vec3 &position)
+    {
+        Light &light = lights[index];
+        if (position == light.position)
+            return;
+        light.position = position;
+        for (bool &d : light.dirty)
+            d = true;
+    }
+
+    // 关闭的光源立即归还图集里的块
+    void setLightEnabled(int index, bool enabled)
+    {
+        Light &light = lights[index];
+        if (light.enabled == enabled)
+            return;
+        light.enabled = enabled;
+        if (!enabled)
+        {
+            releaseFaces(light);
+            light.requestedSize = 0;
+        }
+    }
+
+    // 动态投射物移动后调用，新旧两个位置各调用一次
+    void invalidate(const glm::vec3 &center, float radius)
+    {
+        for (Light &light : lights)
+            for (int face = 0; face < 6; ++face)
+                if (faceIntersects(light, face, center, radius))
+                    light.dirty[face] = true;
+    }
+
+    // 按屏幕上的覆盖范围给每个光源分配块的大小，大小变了才重新分配
+    void assignResolutions(const glm::vec3 &viewPos, float fovY, int screenHeight)
+    {
+        float pixelsPerUnit = screenHeight * 0.5f / glm::tan(glm::radians(fovY) * 0.5f);
+        for (Light &light : lights)
+        {
+            float distance = glm::max(glm::length(light.position - viewPos) - light.range, 0.1f);
+            light.importance = light.range / distance;
+        }
+
+        order.resize(lights.size());
+        std::iota(order.begin(), order.end(), 0);
+        std::sort(order.begin(), order.end(), [&](int a, int b)
+            {
+                return lights[a].importance > lights[b].importance;
+            });
+
+        // 先释放所有需要换大小的块，再按重要程度从高到低分配
+        std::vector<int> &pending = pendingScratch;
+        pending.clear();
+        for (int index : order)
+        {
+            Light &light = lights[index];
+            if (!light.enabled)
+                continue;
+            int desired = desiredTileSize(light.importance * pixelsPerUnit);
+            // 只小了一级时保持不变，避免在边界上来回重新分配
+            bool keep = desired == light.requestedSize || desired * 2 == light.requestedSize;
+            if (keep && light.tileSize != 0)
+                continue;
+            if (!keep)
+                light.requestedSize = desired;
+            releaseFaces(light);
+            pending.push_back(index);
+        }
+        for (int index : pending)
+        {
+            Light &light = lights[index];
+            for (int size = light.requestedSize; size >= atlas.minTileSize; size /= 2)
+            {
+                if (allocateFaces(light, size))
+                    break;
+            }
+        }
+    }
+
+    /*
+        重新渲染脏的面，每帧最多 budget 个
+        drawCasters(lightIndex, face) 负责用已经设置好 shadowMatrix 的 depthShader 画出这个面视锥内的投射物
+    */
+    template <typename DrawCasters>
+    void render(Shader &depthShader, int budget, DrawCasters drawCasters)
+    {
+        facesRendered = 0;
+        depthShader.use();
+        for (int index : order)
+        {
+            Light &light = lights[index];
+            if (light.tileSize == 0)
+                continue;
+            for (int face = 0; face < 6 && facesRendered < budget; ++face)
+            {
+                if (!light.dirty[face])
+                    continue;
+                atlas.beginTile(light.faces[face]);
+                depthShader.setMat4("shadowMatrix", faceMatrix(light, face));
+                depthShader.setVec3("lightPos", light.position);
+                depthShader.setFloat("farPlane", light.range);
+                drawCasters(index, face);
+                light.dirty[face] = false;
+                light.rendered[face] = true;
+                ++facesRendered;
+            }
+        }
+        atlas.end();
+        uploadFaceTable();
+    }
+
+    glm::mat4 faceMatrix(const Light &light, int face) const
+    {
+        // 视锥比 90 度稍大，块的边缘各多出一个纹素，PCF 采样不会跨到相邻的块
+        float k = static_cast<float>(light.tileSize) / (light.tileSize - 2);
+        glm::mat4 projection = glm::perspective(2.0f * glm::atan(k), 1.0f, 0.05f, light.range);
+        return projection * glm::lookAt(light.position, light.position + FACE_DIRECTIONS[face], FACE_UPS[face]);
+    }
+
+    // 包围球是否和光源某个面的视锥相交（保守判断）
+    static bool faceIntersects(const Light &light, int face, const glm::vec3 &center, float radius)
+    {
+        glm::vec3 v = center - light.position;
+        if (glm::length(v) > light.range + radius)
+            return false;
+        glm::vec3 f = FACE_DIRECTIONS[face];
+        glm::vec3 s = glm::normalize(glm::cross(f, FACE_UPS[face]));
+        glm::vec3 u = glm::cross(s, f);
+        float z = glm::dot(f, v);
+        float slack = radius * 1.5f;
+        return z > -radius
+            && glm::abs(glm::dot(s, v)) <= z + slack
+            && glm::abs(glm::dot(u, v)) <= z + slack;
+    }
+
+    void dispose()
+    {
+        atlas.dispose();
+        glDeleteTextures(1, &faceTable);
+        faceTable = 0;
+    }
+
+    // 与 GL_TEXTURE_CUBE_MAP_POSITIVE_X ... NEGATIVE_Z 的顺序和朝向一致
+    inline static const glm::vec3 FACE_DIRECTIONS[6] =
+    {
+        glm::vec3( 1.0f,  0.0f,  0.0f), glm::vec3(-1.0f,  0.0f,  0.0f),
+        glm::vec3( 0.0f,  1.0f,  0.0f), glm::vec3( 0.0f, -1.0f,  0.0f),
+        glm::vec3( 0.0f,  0.0f,  1.0f), glm::vec3( 0.0f,  0.0f, -1.0f)
+    };
+    inline static const glm::vec3 FACE_UPS[6] =
+    {
+        glm::vec3( 0.0f, -1.0f,  0.0f), glm::vec3( 0.0f, -1.0f,  0.0f),
+        glm::vec3( 0.0f,  0.0f,  1.0f), glm::vec3( 0.0f,  0.0f, -1.0f),
+        glm::vec3( 0.0f, -1.0f,  0.0f), glm::vec3( 0.0f, -1.0f,  0.0f)
+    };
+
+private:
+    std::vector<glm::vec4> faceRects;
+    std::vector<int> order;
+    std::vector<int> pendingScratch;
+
+    int desiredTileSize(float projectedRadius) const
+    {
+        int size = atlas.minTileSize;
+        while (size < maxTileSize && size < projectedRadius)
+            size *= 2;
+        return size;
+    }
+
+    bool allocateFaces(Light &light, int tileSize)
+    {
+        for (int face = 0; face < 6; ++face)
+        {
+            light.faces[face] = atlas.allocate(tileSize);
+            if (light.faces[face].size == 0)
+            {
+                for (int i = 0; i < face; ++i)
+                    atlas.release(light.faces[i]);
+                light.tileSize = 0;
+                return false;
+            }
+        }
+        light.tileSize = tileSize;
+        return true;
+    }
+
+    void releaseFaces(Light &light)
+    {
+        for (int face = 0; face < 6; ++face)
+        {
+            if (light.tileSize != 0)
+                atlas.release(light.faces[face]);
+            light.faces[face] = {};
+            light.dirty[face] = true;
+            light.rendered[face] = false;
+        }
+        light.tileSize = 0;
+    }
+
+    void uploadFaceTable()
+    {
+        for (size_t i = 0; i < lights.size(); ++i)
+        {
+            const Light &light = lights[i];
+            for (int face = 0; face < 6; ++face)
+            {
+                // 还没渲染过的面宽度写 0，着色器当作没有阴影
+                faceRects[i * 6 + face] = light.tileSize != 0 && light.rendered[face]
+                    ? atlas.uvRect(light.faces[face])
+                    : glm::vec4(0.0f);
+            }
+        }
+        glBindTexture(GL_TEXTURE_2D, faceTable);
+        glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, 6, maxLights, GL_RGBA, GL_FLOAT, faceRects.data());
+        glBindTexture(GL_TEXTURE_2D, 0);
+    }
+};
@@ -0,0 +1,209 @@
+#pragma once
+
+#include <glad/glad.h>
+
+#include <tools/shader.h>
+
+#include <array>
+#include <iostream>
+
+/*
+    阴影过滤方式的 C++ 端，与 glsl/shadow_filtering.glsl 配套
+    1. defines() 给出每种方式对应的宏，传给 Shader 编出各自的变体
+    2. 同一张深度贴图用两个采样器对象读取：比较采样器给 PCF / Vogel，原始采样器给预过滤
+    3. VSM / ESM 先把每一层深度转换成矩并做可分离的高斯模糊，结果放在 RG32F 纹理数组里
+*/
+class ShadowFilter
+{
+public:
+    enum class Technique
+    {
+        HardwarePCF,
+        Vogel,
+        VSM,
+        ESM,
+        Count
+    };
+
+    static constexpr int TECHNIQUE_COUNT = static_cast<int>(Technique::Count);
+
+    unsigned int compareSampler = 0;
+    unsigned int momentsSampler = 0;
+    unsigned int momentsArray = 0;
+    int resolution = 0;
+    int layers = 0;
+
+    // 可调参数，通过 setUniforms 传给 ShadowParams
+    int taps = 16;
+    float radius = 2.5f;
+    float minVariance = 0.00002f;
+    float bleedReduction = 0.3f;
+    float exponent = 80.0f;
+    int blurRadius = 2;
+
+    ShadowFilter(int resolution, int layers)
+        : resolution(resolution), layers(layers),
+          vsmPrefilter(GLSL_INCLUDE_DIR "/fullscreen_triangle.vert", GLSL_INCLUDE_DIR "/shadow_prefilter.frag", { }, defines(Technique::VSM)),
+          esmPrefilter(GLSL_INCLUDE_DIR "/fullscreen_triangle.vert", GLSL_INCLUDE_DIR "/shadow_prefilter.frag", { }, defines(Technique::ESM))
+    {
+        // 比较采样器：双线性 + 硬件深度比较，阴影贴图外都当作照亮
+        glGenSamplers(1, &compareSampler);
+        glSamplerParameteri(compareSampler, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+        glSamplerParameteri(compareSampler, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        glSamplerParameteri(compareSampler, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_BORDER);
+        glSamplerParameteri(compareSampler, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_BORDER);
+        float borderColor[] = { 1.0f, 1.0f, 1.0f, 1.0f };
+        glSamplerParameterfv(compareSampler, GL_TEXTURE_BORDER_COLOR, borderColor);
+        glSamplerParameteri(compareSampler, GL_TEXTURE_COMPARE_MODE, GL_COMPARE_REF_TO_TEXTURE);
+        glSamplerParameteri(compareSampler, GL_TEXTURE_COMPARE_FUNC, GL_LEQUAL);
+
+        glGenSamplers(1, &momentsSampler);
+        glSamplerParameteri(momentsSampler, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+        glSamplerParameteri(momentsSampler, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        glSamplerParameteri(momentsSampler, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glSamplerParameteri(momentsSampler, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+
+        glGenTextures(1, &momentsArray);
+        glBindTexture(GL_TEXTURE_2D_ARRAY, momentsArray);
+        glTexImage3D(GL_TEXTURE_2D_ARRAY, 0, GL_RG32F, resolution, resolution, layers, 0, GL_RG, GL_FLOAT, nullptr);
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+
+        // 横向模糊的中间结果
+        glGenTextures(1, &tempTexture);
+        glBindTexture(GL_TEXTURE_2D, tempTexture);
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_RG32F, resolution, resolution, 0, GL_RG, GL_FLOAT, nullptr);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+        glBindTexture(GL_TEXTURE_2D, 0);
+
+        glGenFramebuffers(1, &FBO);
+        glBindFramebuffer(GL_FRAMEBUFFER, FBO);
+        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, tempTexture, 0);
+        if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+            std::cout << "ERROR::FRAMEBUFFER:: Shadow prefilter framebuffer is not complete!" << std::endl;
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+        glGenVertexArrays(1, &emptyVAO);
+    }
+
+    static const char *name(Technique technique)
+    {
+        static const std::array<const char *, TECHNIQUE_COUNT> names = { "Hardware PCF", "Vogel Disk", "VSM", "ESM" };
+        return names[static_cast<int>(technique)];
+    }
+
+    static const char *defines(Technique technique)
+    {
+        static const std::array<const char *, TECHNIQUE_COUNT> macros =
+        {
+            "#define SHADOW_FILTER_PCF\n",
+            "#define SHADOW_FILTER_VOGEL\n",
+            "#define SHADOW_FILTER_VSM\n",
+            "#define SHADOW_FILTER_ESM\n"
+        };
+        return macros[static_cast<int>(technique)];
+    }
+
+    static bool usesMoments(Technique technique)
+    {
+        return technique == Technique::VSM || technique == Technique::ESM;
+    }
+
+    // 深度数组的所有层渲染完后调用，只有 VSM / ESM 需要
+    void prefilter(Technique technique, unsigned int depthArray, int layerCount)
+    {
+        if (!usesMoments(technique))
+            return;
+
+        Shader &shader = technique == Technique::VSM ? vsmPrefilter : esmPrefilter;
+        shader.use();
+        shader.setInt("depthMap", 0);
+        shader.setInt("momentsMap", 1);
+        shader.setInt("radius", blurRadius);
+        shader.setFloat("exponent", exponent);
+
+        // 用纹理自身的参数读取，去掉之前 bind() 可能留下的采样器
+        glBindSampler(0, 0);
+        glBindSampler(1, 0);
+        glActiveTexture(GL_TEXTURE0);
+        glBindTexture(GL_TEXTURE_2D_ARRAY, depthArray);
+        glActiveTexture(GL_TEXTURE1);
+        glBindTexture(GL_TEXTURE_2D, tempTexture);
+
+        GLboolean depthTest = glIsEnabled(GL_DEPTH_TEST);
+        glDisable(GL_DEPTH_TEST);
+        glViewport(0, 0, resolution, resolution);
+        glBindFramebuffer(GL_FRAMEBUFFER, FBO);
+        glBindVertexArray(emptyVAO);
+        for (int layer = 0; layer < layerCount && layer < layers; ++layer)
+        {
+            // 横向：深度 -> 中间纹理
+            glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, tempTexture, 0);
+            shader.setBool("firstPass", true);
+            shader.setInt("layer", layer);
+            glDrawArrays(GL_TRIANGLES, 0, 3);
+
+            // 纵向：中间纹理 -> 矩贴图数组的一层
+            glFramebufferTextureLayer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, momentsArray, 0, layer);
+            shader.setBool("firstPass", false);
+            glDrawArrays(GL_TRIANGLES, 0, 3);
+        }
+        glBindVertexArray(0);
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+        if (depthTest)
+            glEnable(GL_DEPTH_TEST);
+    }
+
+    // 把阴影贴图绑到 unit 上：PCF / Vogel 绑深度数组 + 比较采样器，VSM / ESM 绑矩贴图数组
+    void bind(Technique technique, unsigned int depthArray, unsigned int unit) const
+    {
+        glActiveTexture(GL_TEXTURE0 + unit);
+        if (usesMoments(technique))
+        {
+            glBindTexture(GL_TEXTURE_2D_ARRAY, momentsArray);
+            glBindSampler(unit, momentsSampler);
+        }
+        else
+        {
+            glBindTexture(GL_TEXTURE_2D_ARRAY, depthArray);
+            glBindSampler(unit, compareSampler);
+        }
+    }
+
+    void unbind(unsigned int unit) const
+    {
+        glBindSampler(unit, 0);
+    }
+
+    void setUniforms(const Shader &shader, std::string_view name = "shadowParams") const
+    {
+        std::string prefix(name);
+        shader.setInt(prefix + ".taps", taps);
+        shader.setFloat(prefix + ".radius", radius);
+        shader.setFloat(prefix + ".minVariance", minVariance);
+        shader.setFloat(prefix + ".bleedReduction", bleedReduction);
+        shader.setFloat(prefix + ".exponent", exponent);
+    }
+
+    void dispose()
+    {
+        glDeleteSamplers(1, &compareSampler);
+        glDeleteSamplers(1, &momentsSampler);
+        glDeleteTextures(1, &momentsArray);
+        glDeleteTextures(1, &tempTexture);
+        glDeleteFramebuffers(1, &FBO);
+        glDeleteVertexArrays(1, &emptyVAO);
+        glDeleteProgram(vsmPrefilter.ID);
+        glDeleteProgram(esmPrefilter.ID);
+        compareSampler = momentsSampler = momentsArray = tempTexture = FBO = emptyVAO = 0;
+    }
+
+private:
+    unsigned int tempTexture = 0;
+    unsigned int FBO = 0;
+    unsigned int emptyVAO = 0;
+    Shader vsmPrefilter;
+    Shader esmPrefilter;
+};
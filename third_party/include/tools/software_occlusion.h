@@ -0,0 +1,621 @@
+#pragma once
+
+#include <glm/glm.hpp>
+
+#include <tools/vertex_layout.h>
+#include <tools/thread_pool.h>
+#include <tools/position_stream.h>
+
+#include <bit>
+#include <memory>
+#include <vector>
+#include <chrono>
+#include <thread>
+#include <cfloat>
+#include <cstdint>
+#include <algorithm>
+#include <unordered_map>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#define OCCLUSION_USE_AVX2
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define OCCLUSION_USE_SSE
+#endif
+
+/*
+    CPU 上的软件遮挡剔除，不需要和 GPU 来回同步，结果当帧可用
+    1. 选出来的遮挡物（简化成只有位置的网格）在 CPU 上变换、近平面裁剪，画进一张低分辨率的深度缓冲（默认 320x180）
+    2. 三角形设置一次处理 8 个（AVX2 时是一个 __m256，SSE 时两个 __m128），算出边方程、深度平面和包围矩形，按屏幕块分箱
+    3. 光栅化按 32x32 的屏幕块交给常驻线程池（tools/thread_pool.h），块之间没有共享的像素，不用加锁；
+       每行一次测 8 个像素，三条边方程得到覆盖掩码，覆盖且更近的像素写入深度
+    4. 深度缓冲逐级取 2x2 的最大值，建成层级最大深度（Hi-Z），测试时按包围盒在屏幕上的大小选一级，
+       只看几个像素：包围盒最近的深度比覆盖范围内所有的最大深度都远，就是被挡住了
+    测试一侧是保守的：跨过近平面的包围盒、屏幕外的部分都当作可见；
+    但遮挡物按像素中心是否覆盖写入深度，轮廓上只盖住半个像素的也会写满整个像素，
+    所以结果并不严格保守，紧贴遮挡物轮廓的物体可能被多剔除最多一个像素宽的范围（320x180 时约为屏幕宽度的 0.3%）
+    使用方式：
+        begin(projection * view); addOccluder(mesh, model) ...; rasterize();
+        if (isVisible(model, min, max)) 加入绘制列表
+*/
+namespace OcclusionSimd
+{
+    // 8 个 float 一组，没有 SSE 时逐个计算
+    struct Float8
+    {
+#if defined(OCCLUSION_USE_AVX2)
+        __m256 v;
+#elif defined(OCCLUSION_USE_SSE)
+        __m128 lo, hi;
+#else
+        float v[8];
+#endif
+    };
+
+#if defined(OCCLUSION_USE_AVX2)
+    inline Float8 set1(float x) { return { _mm256_set1_ps(x) }; }
+    inline Float8 load(const float *p) { return { _mm256_loadu_ps(p) }; }
+    inline void store(float *p, Float8 a) { _mm256_storeu_ps(p, a.v); }
+    inline Float8 operator+(Float8 a, Float8 b) { return { _mm256_add_ps(a.v, b.v) }; }
+    inline Float8 operator-(Float8 a, Float8 b) { return { _mm256_sub_ps(a.v, b.v) }; }
+    inline Float8 operator*(Float8 a, Float8 b) { return { _mm256_mul_ps(a.v, b.v) }; }
+    inline Float8 operator/(Float8 a, Float8 b) { return { _mm256_div_ps(a.v, b.v) }; }
+    inline Float8 min(Float8 a, Float8 b) { return { _mm256_min_ps(a.v, b.v) }; }
+    inline Float8 max(Float8 a, Float8 b) { return { _mm256_max_ps(a.v, b.v) }; }
+    // 比较结果是掩码：满足的分量全 1，否则全 0
+    inline Float8 less(Float8 a, Float8 b) { return { _mm256_cmp_ps(a.v, b.v, _CMP_LT_OQ) }; }
+    inline Float8 operator&(Float8 a, Float8 b) { return { _mm256_and_ps(a.v, b.v) }; }
+    // mask ? a : b
+    inline Float8 select(Float8 mask, Float8 a, Float8 b) { return { _mm256_blendv_ps(b.v, a.v, mask.v) }; }
+    // 每个分量的掩码压成一位，第 i 个像素对应第 i 位
+    inline int movemask(Float8 mask) { return _mm256_movemask_ps(mask.v); }
+#elif defined(OCCLUSION_USE_SSE)
+    inline Float8 set1(float x) { return { _mm_set1_ps(x), _mm_set1_ps(x) }; }
+    inline Float8 load(const float *p) { return { _mm_loadu_ps(p), _mm_loadu_ps(p + 4) }; }
+    inline void store(float *p, Float8 a) { _mm_storeu_ps(p, a.lo); _mm_storeu_ps(p + 4, a.hi); }
+    inline Float8 operator+(Float8 a, Float8 b) { return { _mm_add_ps(a.lo, b.lo), _mm_add_ps(a.hi, b.hi) }; }
+    inline Float8 operator-(Float8 a, Float8 b) { return { _mm_sub_ps(a.lo, b.lo), _mm_sub_ps(a.hi, b.hi) }; }
+    inline Float8 operator*(Float8 a, Float8 b) { return { _mm_mul_ps(a.lo, b.lo), _mm_mul_ps(a.hi, b.hi) }; }
+    inline Float8 operator/(Float8 a, Float8 b) { return { _mm_div_ps(a.lo, b.lo), _mm_div_ps(a.hi, b.hi) }; }
+    inline Float8 min(Float8 a, Float8 b) { return { _mm_min_ps(a.lo, b.lo), _mm_min_ps(a.hi, b.hi) }; }
+    inline Float8 max(Float8 a, Float8 b) { return { _mm_max_ps(a.lo, b.lo), _mm_max_ps(a.hi, b.hi) }; }
+    inline Float8 less(Float8 a, Float8 b) { return { _mm_cmplt_ps(a.lo, b.lo), _mm_cmplt_ps(a.hi, b.hi) }; }
+    inline Float8 operator&(Float8 a, Float8 b) { return { _mm_and_ps(a.lo, b.lo), _mm_and_ps(a.hi, b.hi) }; }
+    inline Float8 select(Float8 mask, Float8 a, Float8 b)
+    {
+        return { _mm_or_ps(_mm_and_ps(mask.lo, a.lo), _mm_andnot_ps(mask.lo, b.lo)),
+                 _mm_or_ps(_mm_and_ps(mask.hi, a.hi), _mm_andnot_ps(mask.hi, b.hi)) };
+    }
+    inline int movemask(Float8 mask) { return _mm_movemask_ps(mask.lo) | (_mm_movemask_ps(mask.hi) << 4); }
+#else
+    template <typename Op>
+    inline Float8 apply(Float8 a, Float8 b, Op op)
+    {
+        Float8 r;
+        for (int i = 0; i < 8; ++i)
+            r.v[i] = op(a.v[i], b.v[i]);
+        return r;
+    }
+    inline Float8 set1(float x) { return { { x, x, x, x, x, x, x, x } }; }
+    inline Float8 load(const float *p) { Float8 r; std::copy(p, p + 8, r.v); return r; }
+    inline void store(float *p, Float8 a) { std::copy(a.v, a.v + 8, p); }
+    inline Float8 operator+(Float8 a, Float8 b) { return apply(a, b, [](float x, float y) { return x + y; }); }
+    inline Float8 operator-(Float8 a, Float8 b) { return apply(a, b, [](float x, float y) { return x - y; }); }
+    inline Float8 operator*(Float8 a, Float8 b) { return apply(a, b, [](float x, float y) { return x * y; }); }
+    inline Float8 operator/(Float8 a, Float8 b) { return apply(a, b, [](float x, float y) { return x / y; }); }
+    inline Float8 min(Float8 a, Float8 b) { return apply(a, b, [](float x, float y) { return y < x ? y : x; }); }
+    inline Float8 max(Float8 a, Float8 b) { return apply(a, b, [](float x, float y) { return x < y ? y : x; }); }
+    inline Float8 less(Float8 a, Float8 b) { return apply(a, b, [](float x, float y) { return std::bit_cast<float>(x < y ? 0xFFFFFFFFu : 0u); }); }
+    inline Float8 operator&(Float8 a, Float8 b)
+    {
+        return apply(a, b, [](float x, float y) { return std::bit_cast<float>(std::bit_cast<std::uint32_t>(x) & std::bit_cast<std::uint32_t>(y)); });
+    }
+    inline Float8 select(Float8 mask, Float8 a, Float8 b)
+    {
+        Float8 r;
+        for (int i = 0; i < 8; ++i)
+            r.v[i] = std::bit_cast<std::uint32_t>(mask.v[i]) ? a.v[i] : b.v[i];
+        return r;
+    }
+    inline int movemask(Float8 mask)
+    {
+        int bits = 0;
+        for (int i = 0; i < 8; ++i)
+            bits |= (std::bit_cast<std::uint32_t>(mask.v[i]) >> 31) << i;
+        return bits;
+    }
+#endif
+
+    // start, start + 1, ..., start + 7
+    inline Float8 ramp(float start)
+    {
+        alignas(32) float values[8];
+        for (int i = 0; i < 8; ++i)
+            values[i] = start + static_cast<float>(i);
+        return load(values);
+    }
+}
+
+class SoftwareOcclusion
+{
+public:
+    static constexpr int TILE_WIDTH = 32;
+    static constexpr int TILE_HEIGHT = 32;
+    static constexpr size_t MIN_TRIANGLES_PER_THREAD = 256;
+
+    // 只有位置的遮挡物网格，由 simplify() 从 Mesh / 几何体的数据生成
+    struct OccluderMesh
+    {
+        std::vector<glm::vec3> positions;
+        std::vector<unsigned int> indices;
+    };
+
+    // 最近一次 rasterize() 的统计
+    struct Stats
+    {
+        size_t submittedTriangles = 0;  // addOccluder() 提交的三角形
+        size_t rasterizedTriangles = 0; // 裁剪、背面剔除后真正光栅化的三角形（近平面裁剪可能一分为二）
+        unsigned int threads = 1;
+        float setupMs = 0.0f;           // 三角形设置和分箱
+        float rasterMs = 0.0f;          // 按块光栅化
+        float hierarchyMs = 0.0f;       // 建立层级最大深度
+    };
+
+    // 遮挡物是封闭网格时只画正面（逆时针），背面一定被正面挡住
+    bool backfaceCulling = true;
+    // 0 为使用全部硬件线程
+    unsigned int threadCount = 0;
+    Stats stats;
+
+    SoftwareOcclusion(int width = 320, int height = 180)
+    {
+        resize(width, height);
+    }
+
+    // 宽度向上取整到 8 的倍数，每行按 8 个像素一组处理
+    void resize(int width, int height)
+    {
+        this->width = (glm::max(width, 8) + 7) / 8 * 8;
+        this->height = glm::max(height, 1);
+        tilesX = (this->width + TILE_WIDTH - 1) / TILE_WIDTH;
+        tilesY = (this->height + TILE_HEIGHT - 1) / TILE_HEIGHT;
+
+        hierarchy.clear();
+        levelSizes.clear();
+        int w = this->width, h = this->height;
+        while (true)
+        {
+            hierarchy.emplace_back(static_cast<size_t>(w) * h, 1.0f);
+            levelSizes.emplace_back(w, h);
+            if (w == 1 && h == 1)
+                break;
+            w = (w + 1) / 2;
+            h = (h + 1) / 2;
+        }
+    }
+
+    int getWidth() const { return width; }
+    int getHeight() const { return height; }
+    int levelCount() const { return static_cast<int>(hierarchy.size()); }
+
+    // 第 0 级就是深度缓冲本身，[0, 1]，没有被覆盖的像素为 1
+    const std::vector<float> &depth(int level = 0) const
+    {
+        return hierarchy[level];
+    }
+
+    // 把网格简化成遮挡物：只保留位置，相同位置的顶点合并，去掉退化的三角形
+    // cellSize > 0 时把顶点吸附到这个大小的网格上再合并（顶点聚类），面数少很多，但轮廓会变化几何体半个格子，
+    // 只适合作遮挡物本身比较大、方正的物体（墙、建筑）；MeshType 需要有 vertices（Vertex）和 indices
+    template <typename MeshType>
+    static OccluderMesh simplify(const MeshType &mesh, float cellSize = 0.0f)
+    {
+        return simplify(mesh.vertices, mesh.indices, cellSize);
+    }
+
+    static OccluderMesh simplify(const std::vector<Vertex> &vertices, const std::vector<unsigned int> &indices, float cellSize = 0.0f)
+    {
+        std::unordered_map<glm::vec3, unsigned int, PositionHash> lookup;
+        lookup.reserve(vertices.size());
+
+        OccluderMesh result;
+        std::vector<unsigned int> remap(vertices.size());
+        for (size_t i = 0; i < vertices.size(); ++i)
+        {
+            glm::vec3 position = vertices[i].Position;
+            if (cellSize > 0.0f)
+                position = glm::round(position / cellSize) * cellSize;
+            auto [it, inserted] = lookup.try_emplace(position, static_cast<unsigned int>(result.positions.size()));
+            if (inserted)
+                result.positions.push_back(position);
+            remap[i] = it->second;
+        }
+
+        result.indices.reserve(indices.size());
+        for (size_t i = 0; i + 2 < indices.size(); i += 3)
+        {
+            unsigned int a = remap[indices[i]], b = remap[indices[i + 1]], c = remap[indices[i + 2]];
+            if (a == b || b == c || a == c)
+                continue;
+            result.indices.insert(result.indices.end(), { a, b, c });
+        }
+        return result;
+    }
+
+    // 每帧开始时调用，清空上一帧提交的遮挡物
+    void begin(const glm::mat4 &viewProjection)
+    {
+        this->viewProjection = viewProjection;
+        for (std::vector<float> *coordinates : { &xs, &ys, &zs })
+            coordinates->clear();
+        stats.submittedTriangles = 0;
+    }
+
+    // 变换到屏幕空间、做近平面裁剪，三角形留到 rasterize() 统一处理
+    void addOccluder(const OccluderMesh &mesh, const glm::mat4 &model)
+    {
+        glm::mat4 mvp = viewProjection * model;
+        clipPositions.resize(mesh.positions.size());
+        for (size_t i = 0; i < mesh.positions.size(); ++i)
+            clipPositions[i] = mvp * glm::vec4(mesh.positions[i], 1.0f);
+
+        stats.submittedTriangles += mesh.indices.size() / 3;
+        for (size_t i = 0; i + 2 < mesh.indices.size(); i += 3)
+            addTriangle(clipPositions[mesh.indices[i]], clipPositions[mesh.indices[i + 1]], clipPositions[mesh.indices[i + 2]]);
+    }
+
+    void rasterize()
+    {
+        using Clock = std::chrono::steady_clock;
+        auto start = Clock::now();
+
+        // 补齐到 8 的倍数，补的三角形面积为 0，设置时被丢掉
+        const size_t triangleCount = xs.size() / 3;
+        const size_t batchCount = (triangleCount + 7) / 8;
+        for (std::vector<float> *coordinates : { &xs, &ys, &zs })
+            coordinates->resize(batchCount * 8 * 3, 0.0f);
+
+        // threadCount 改变时才重建线程池，平时每帧复用同一组线程
+        const unsigned int wantedThreads = threadCount ? threadCount : glm::max(std::thread::hardware_concurrency(), 1u);
+        if (!pool || pool->size() != wantedThreads)
+            pool = std::make_unique<ThreadPool>(wantedThreads);
+        stats.threads = pool->size();
+
+        // 三角形分成若干段，每段至少 MIN_TRIANGLES_PER_THREAD 个，最多和线程数一样多
+        chunkCount = static_cast<unsigned int>(std::clamp<size_t>(triangleCount / MIN_TRIANGLES_PER_THREAD, 1, stats.threads));
+        if (setups.size() < chunkCount)
+        {
+            setups.resize(chunkCount);
+            bins.resize(chunkCount);
+        }
+        for (unsigned int c = 0; c < chunkCount; ++c)
+        {
+            setups[c].clear();
+            bins[c].resize(static_cast<size_t>(tilesX) * tilesY);
+            for (std::vector<unsigned int> &bin : bins[c])
+                bin.clear();
+        }
+
+        // 每段三角形设置好后分到这一段自己的箱子里
+        pool->parallelFor(chunkCount, 1, [&](size_t begin, size_t end)
+        {
+            for (size_t c = begin; c < end; ++c)
+                for (size_t batch = batchCount * c / chunkCount; batch < batchCount * (c + 1) / chunkCount; ++batch)
+                    setupBatch(batch, setups[c], bins[c]);
+        });
+        auto setupEnd = Clock::now();
+
+        for (float &value : hierarchy[0])
+            value = 1.0f;
+
+        // 屏幕块逐个从线程池里领取，画面中间的块通常三角形更多，动态领取负载更均匀
+        pool->parallelFor(static_cast<size_t>(tilesX) * tilesY, 1, [&](size_t begin, size_t end)
+        {
+            for (size_t tile = begin; tile < end; ++tile)
+                rasterizeTile(static_cast<unsigned int>(tile));
+        });
+        auto rasterEnd = Clock::now();
+
+        buildHierarchy();
+        auto hierarchyEnd = Clock::now();
+
+        stats.rasterizedTriangles = 0;
+        for (unsigned int c = 0; c < chunkCount; ++c)
+            stats.rasterizedTriangles += setups[c].size();
+        stats.setupMs = std::chrono::duration<float, std::milli>(setupEnd - start).count();
+        stats.rasterMs = std::chrono::duration<float, std::milli>(rasterEnd - setupEnd).count();
+        stats.hierarchyMs = std::chrono::duration<float, std::milli>(hierarchyEnd - rasterEnd).count();
+    }
+
+    // model 空间的包围盒 [min, max] 是否可能可见，rasterize() 之后调用，只读，可以多个线程同时测试
+    bool isVisible(const glm::mat4 &model, const glm::vec3 &min, const glm::vec3 &max) const
+    {
+        glm::mat4 mvp = viewProjection * model;
+        float minX = FLT_MAX, minY = FLT_MAX, maxX = -FLT_MAX, maxY = -FLT_MAX;
+        float nearestDepth = FLT_MAX;
+        for (int corner = 0; corner < 8; ++corner)
+        {
+            glm::vec3 p((corner & 1) ? max.x : min.x, (corner & 2) ? max.y : min.y, (corner & 4) ? max.z : min.z);
+            glm::vec4 clip = mvp * glm::vec4(p, 1.0f);
+            // 跨过近平面，投影后的矩形不可靠，当作可见
+            if (clip.z < -clip.w)
+                return true;
+            glm::vec3 screen = toScreen(clip);
+            minX = glm::min(minX, screen.x);
+            minY = glm::min(minY, screen.y);
+            maxX = glm::max(maxX, screen.x);
+            maxY = glm::max(maxY, screen.y);
+            nearestDepth = glm::min(nearestDepth, screen.z);
+        }
+
+        // 整个在屏幕外或远平面外
+        if (maxX < 0.0f || maxY < 0.0f || minX > static_cast<float>(width) || minY > static_cast<float>(height) || nearestDepth > 1.0f)
+            return false;
+
+        int x0 = glm::clamp(static_cast<int>(minX), 0, width - 1);
+        int y0 = glm::clamp(static_cast<int>(minY), 0, height - 1);
+        int x1 = glm::clamp(static_cast<int>(maxX), 0, width - 1);
+        int y1 = glm::clamp(static_cast<int>(maxY), 0, height - 1);
+
+        // 选一级使矩形在这一级上最多跨 4 到 5 个像素
+        int level = 0;
+        int size = glm::max(x1 - x0, y1 - y0) + 1;
+        while ((size >> level) > 4 && level + 1 < levelCount())
+            ++level;
+
+        const std::vector<float> &levelDepth = hierarchy[level];
+        const int levelWidth = levelSizes[level].x;
+        for (int y = y0 >> level; y <= (y1 >> level); ++y)
+            for (int x = x0 >> level; x <= (x1 >> level); ++x)
+                if (nearestDepth <= levelDepth[static_cast<size_t>(y) * levelWidth + x])
+                    return true;
+        return false;
+    }
+
+    bool isVisible(const glm::vec3 &min, const glm::vec3 &max) const
+    {
+        return isVisible(glm::mat4(1.0f), min, max);
+    }
+
+private:
+    // 设置好的三角形：三条边方程 E(x, y) = A x + B y + C（内部为正），深度平面 z = Dx x + Dy y + D0，像素包围矩形
+    struct TriangleSetup
+    {
+        float A[3], B[3], C[3];
+        float Dx, Dy, D0;
+        int minX, minY, maxX, maxY;
+    };
+
+    int width = 0;
+    int height = 0;
+    int tilesX = 0;
+    int tilesY = 0;
+    glm::mat4 viewProjection = glm::mat4(1.0f);
+
+    // 屏幕空间的三角形，每个三角形连续 3 个顶点
+    std::vector<float> xs, ys, zs;
+    std::vector<glm::vec4> clipPositions;
+    // 每段设置好的三角形和每个屏幕块的箱子（下标指向同一段的 setups）
+    std::vector<std::vector<TriangleSetup>> setups;
+    std::vector<std::vector<std::vector<unsigned int>>> bins;
+    // 第 0 级为深度缓冲，往上每级取 2x2 的最大值
+    std::vector<std::vector<float>> hierarchy;
+    std::vector<glm::ivec2> levelSizes;
+    std::unique_ptr<ThreadPool> pool;
+    unsigned int chunkCount = 1;
+
+    glm::vec3 toScreen(const glm::vec4 &clip) const
+    {
+        glm::vec3 ndc = glm::vec3(clip) / clip.w;
+        return glm::vec3((ndc.x * 0.5f + 0.5f) * static_cast<float>(width), (ndc.y * 0.5f + 0.5f) * static_cast<float>(height), ndc.z * 0.5f + 0.5f);
+    }
+
+    void addTriangle(const glm::vec4 &a, const glm::vec4 &b, const glm::vec4 &c)
+    {
+        // 三个顶点都在同一个裁剪平面外，整个三角形看不见
+        for (int axis = 0; axis < 3; ++axis)
+        {
+            if (a[axis] > a.w && b[axis] > b.w && c[axis] > c.w)
+                return;
+            if (a[axis] < -a.w && b[axis] < -b.w && c[axis] < -c.w)
+                return;
+        }
+
+        // 近平面 z = -w 裁剪，三角形变成最多 4 个顶点的多边形，再拆成扇形
+        const glm::vec4 input[3] = { a, b, c };
+        glm::vec4 polygon[4];
+        int count = 0;
+        for (int i = 0; i < 3; ++i)
+        {
+            const glm::vec4 &p = input[i];
+            const glm::vec4 &q = input[(i + 1) % 3];
+            float dp = p.z + p.w, dq = q.z + q.w;
+            if (dp >= 0.0f)
+                polygon[count++] = p;
+            if ((dp >= 0.0f) != (dq >= 0.0f))
+                polygon[count++] = p + (q - p) * (dp / (dp - dq));
+        }
+
+        for (int i = 1; i + 1 < count; ++i)
+        {
+            for (const glm::vec4 *v : { &polygon[0], &polygon[i], &polygon[i + 1] })
+            {
+                glm::vec3 screen = toScreen(*v);
+                xs.push_back(screen.x);
+                ys.push_back(screen.y);
+                zs.push_back(screen.z);
+            }
+        }
+    }
+
+    // 一次设置 8 个三角形（batch * 8 起），留下有面积、在屏幕内的，按包围矩形放进屏幕块的箱子
+    void setupBatch(size_t batch, std::vector<TriangleSetup> &output, std::vector<std::vector<unsigned int>> &tileBins) const
+    {
+        using namespace OcclusionSimd;
+
+        // 顶点按三角形交错存放，先转成 8 个三角形的 SoA
+        alignas(32) float vx[3][8], vy[3][8], vz[3][8];
+        for (int lane = 0; lane < 8; ++lane)
+            for (int v = 0; v < 3; ++v)
+            {
+                size_t index = (batch * 8 + lane) * 3 + v;
+                vx[v][lane] = xs[index];
+                vy[v][lane] = ys[index];
+                vz[v][lane] = zs[index];
+            }
+        Float8 x0 = load(vx[0]), x1 = load(vx[1]), x2 = load(vx[2]);
+        Float8 y0 = load(vy[0]), y1 = load(vy[1]), y2 = load(vy[2]);
+        Float8 z0 = load(vz[0]), z1 = load(vz[1]), z2 = load(vz[2]);
+
+        // 有向面积，逆时针为正
+        Float8 area = (x1 - x0) * (y2 - y0) - (x2 - x0) * (y1 - y0);
+        Float8 zero = set1(0.0f);
+        Float8 clockwise = less(area, zero);
+        // 不剔除背面时把顺时针的三角形翻过来：边方程、面积和深度梯度的分子同时取反
+        Float8 sign = select(clockwise, set1(backfaceCulling ? 0.0f : -1.0f), set1(1.0f));
+        area = area * sign;
+
+        // 边 (a, b)：A = ya - yb, B = xb - xa, C = xa yb - xb ya
+        Float8 edgeA[3] = { (y0 - y1) * sign, (y1 - y2) * sign, (y2 - y0) * sign };
+        Float8 edgeB[3] = { (x1 - x0) * sign, (x2 - x1) * sign, (x0 - x2) * sign };
+        Float8 edgeC[3] = { (x0 * y1 - x1 * y0) * sign, (x1 * y2 - x2 * y1) * sign, (x2 * y0 - x0 * y2) * sign };
+
+        // 面积为 0 时除出来的不会被用到，避免除零
+        Float8 valid = less(set1(1e-6f), area);
+        Float8 safeArea = select(valid, area, set1(1.0f));
+        Float8 dx = ((z1 - z0) * (y2 - y0) - (z2 - z0) * (y1 - y0)) * sign / safeArea;
+        Float8 dy = ((z2 - z0) * (x1 - x0) - (z1 - z0) * (x2 - x0)) * sign / safeArea;
+        Float8 d0 = z0 - dx * x0 - dy * y0;
+
+        Float8 boundsMinX = min(min(x0, x1), x2), boundsMaxX = max(max(x0, x1), x2);
+        Float8 boundsMinY = min(min(y0, y1), y2), boundsMaxY = max(max(y0, y1), y2);
+        // 离摄像机最近的顶点在远平面外时整个三角形也在外面
+        Float8 nearestZ = min(min(z0, z1), z2);
+        valid = valid & less(nearestZ, set1(1.0f));
+
+        alignas(32) float a[3][8], b[3][8], c[3][8];
+        alignas(32) float outDx[8], outDy[8], outD0[8];
+        alignas(32) float outMinX[8], outMaxX[8], outMinY[8], outMaxY[8];
+        for (int e = 0; e < 3; ++e)
+        {
+            store(a[e], edgeA[e]);
+            store(b[e], edgeB[e]);
+            store(c[e], edgeC[e]);
+        }
+        store(outDx, dx);
+        store(outDy, dy);
+        store(outD0, d0);
+        store(outMinX, boundsMinX);
+        store(outMaxX, boundsMaxX);
+        store(outMinY, boundsMinY);
+        store(outMaxY, boundsMaxY);
+
+        int validMask = movemask(valid);
+        for (int lane = 0; lane < 8; ++lane)
+        {
+            if (!(validMask & (1 << lane)))
+                continue;
+
+            // 覆盖像素中心 (x + 0.5, y + 0.5) 的像素范围
+            TriangleSetup setup;
+            setup.minX = glm::max(static_cast<int>(glm::ceil(outMinX[lane] - 0.5f)), 0);
+            setup.minY = glm::max(static_cast<int>(glm::ceil(outMinY[lane] - 0.5f)), 0);
+            setup.maxX = glm::min(static_cast<int>(glm::floor(outMaxX[lane] - 0.5f)), width - 1);
+            setup.maxY = glm::min(static_cast<int>(glm::floor(outMaxY[lane] - 0.5f)), height - 1);
+            if (setup.minX > setup.maxX || setup.minY > setup.maxY)
+                continue;
+
+            for (int e = 0; e < 3; ++e)
+            {
+                setup.A[e] = a[e][lane];
+                setup.B[e] = b[e][lane];
+                setup.C[e] = c[e][lane];
+            }
+            setup.Dx = outDx[lane];
+            setup.Dy = outDy[lane];
+            setup.D0 = outD0[lane];
+
+            unsigned int index = static_cast<unsigned int>(output.size());
+            output.push_back(setup);
+            for (int ty = setup.minY / TILE_HEIGHT; ty <= setup.maxY / TILE_HEIGHT; ++ty)
+                for (int tx = setup.minX / TILE_WIDTH; tx <= setup.maxX / TILE_WIDTH; ++tx)
+                    tileBins[static_cast<size_t>(ty) * tilesX + tx].push_back(index);
+        }
+    }
+
+    void rasterizeTile(unsigned int tile)
+    {
+        using namespace OcclusionSimd;
+
+        const int tileX0 = static_cast<int>(tile % tilesX) * TILE_WIDTH;
+        const int tileY0 = static_cast<int>(tile / tilesX) * TILE_HEIGHT;
+        const int tileX1 = glm::min(tileX0 + TILE_WIDTH, width) - 1;
+        const int tileY1 = glm::min(tileY0 + TILE_HEIGHT, height) - 1;
+        float *depthBuffer = hierarchy[0].data();
+
+        for (unsigned int c = 0; c < chunkCount; ++c)
+        {
+            for (unsigned int index : bins[c][tile])
+            {
+                const TriangleSetup &setup = setups[c][index];
+                // 行内按 8 个像素对齐，块的宽度是 8 的倍数，不会越过块的边界
+                const int x0 = glm::max(setup.minX, tileX0) & ~7;
+                const int x1 = glm::min(setup.maxX, tileX1);
+                const int y0 = glm::max(setup.minY, tileY0);
+                const int y1 = glm::min(setup.maxY, tileY1);
+
+                const Float8 A0 = set1(setup.A[0]), A1 = set1(setup.A[1]), A2 = set1(setup.A[2]);
+                const Float8 Dx = set1(setup.Dx);
+                const Float8 zero = set1(0.0f);
+                const Float8 laneCenters = ramp(0.5f);
+                for (int y = y0; y <= y1; ++y)
+                {
+                    const float py = static_cast<float>(y) + 0.5f;
+                    const Float8 rowC0 = set1(setup.B[0] * py + setup.C[0]);
+                    const Float8 rowC1 = set1(setup.B[1] * py + setup.C[1]);
+                    const Float8 rowC2 = set1(setup.B[2] * py + setup.C[2]);
+                    const Float8 rowD = set1(setup.Dy * py + setup.D0);
+                    float *row = depthBuffer + static_cast<size_t>(y) * width;
+                    for (int x = x0; x <= x1; x += 8)
+                    {
+                        const Float8 px = laneCenters + set1(static_cast<float>(x));
+                        // 三条边方程都不为负的像素被覆盖，压成 8 位的覆盖掩码；
+                        // 像素中心正好落在边上时两边的三角形都算覆盖，相邻三角形之间不会漏掉一条缝
+                        Float8 outside = less(min(min(A0 * px + rowC0, A1 * px + rowC1), A2 * px + rowC2), zero);
+                        int coverage = ~movemask(outside) & 0xFF;
+                        if (coverage == 0)
+                            continue;
+
+                        Float8 current = load(row + x);
+                        Float8 z = select(outside, current, Dx * px + rowD);
+                        store(row + x, min(z, current));
+                    }
+                }
+            }
+        }
+    }
+
+    void buildHierarchy()
+    {
+        for (size_t level = 1; level < hierarchy.size(); ++level)
+        {
+            const std::vector<float> &source = hierarchy[level - 1];
+            std::vector<float> &target = hierarchy[level];
+            const glm::ivec2 sourceSize = levelSizes[level - 1];
+            const glm::ivec2 targetSize = levelSizes[level];
+            for (int y = 0; y < targetSize.y; ++y)
+            {
+                // 尺寸为奇数时最后一行 / 列只有一个子像素
+                const int sy0 = 2 * y, sy1 = glm::min(2 * y + 1, sourceSize.y - 1);
+                for (int x = 0; x < targetSize.x; ++x)
+                {
+                    const int sx0 = 2 * x, sx1 = glm::min(2 * x + 1, sourceSize.x - 1);
+                    float value = glm::max(glm::max(source[static_cast<size_t>(sy0) * sourceSize.x + sx0], source[static_cast<size_t>(sy0) * sourceSize.x + sx1]),
+                                           glm::max(source[static_cast<size_t>(sy1) * sourceSize.x + sx0], source[static_cast<size_t>(sy1) * sourceSize.x + sx1]));
+                    target[static_cast<size_t>(y) * targetSize.x + x] = value;
+                }
+            }
+        }
+    }
+};
@@ -0,0 +1,175 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include <tools/shader.h>
+
+#include <iostream>
+
+/*
+    时间累积 / 重投影：把每帧只有少量采样的噪声结果（SSAO 等）在多帧间累积起来
+    1. 记录上一帧的观察矩阵和投影矩阵，用当前帧的观察空间位置求出这个像素在上一帧的屏幕坐标
+    2. 历史结果和历史深度各两张纹理乒乓使用，深度对不上的像素（遮挡关系变化）丢弃历史重新累积
+    3. 累计帧数上限为 maxFrames，静止时相当于 maxFrames 帧的平均
+    调用方每帧应该换一组采样（frameIndex() 可以用来旋转采样核），否则累积不出新的信息
+*/
+class TemporalAccumulator
+{
+public:
+    int maxFrames = 16;
+    // 重投影深度和历史深度的相对误差超过这个值就认为是新露出来的像素
+    float depthTolerance = 0.05f;
+
+    int width = 0;
+    int height = 0;
+
+    TemporalAccumulator(int width, int height, GLenum internalFormat = GL_RGBA16F)
+        : width(width), height(height), internalFormat(internalFormat),
+          shader(GLSL_INCLUDE_DIR "/fullscreen_triangle.vert", GLSL_INCLUDE_DIR "/temporal_accumulate.frag")
+    {
+        shader.use();
+        shader.setInt("currentTexture", 0);
+        shader.setInt("positionTexture", 1);
+        shader.setInt("historyTexture", 2);
+        shader.setInt("historyInfo", 3);
+
+        glGenTextures(2, colorTextures);
+        glGenTextures(2, infoTextures);
+        for (int i = 0; i < 2; ++i)
+        {
+            // 历史结果在亚像素位置上双线性采样，历史深度只取最近的像素
+            setupTexture(colorTextures[i], GL_LINEAR);
+            setupTexture(infoTextures[i], GL_NEAREST);
+        }
+        resize(width, height);
+
+        glGenFramebuffers(2, FBOs);
+        for (int i = 0; i < 2; ++i)
+        {
+            glBindFramebuffer(GL_FRAMEBUFFER, FBOs[i]);
+            glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, colorTextures[i], 0);
+            glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT1, GL_TEXTURE_2D, infoTextures[i], 0);
+            unsigned int attachments[2] = { GL_COLOR_ATTACHMENT0, GL_COLOR_ATTACHMENT1 };
+            glDrawBuffers(2, attachments);
+            if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+                std::cout << "ERROR::FRAMEBUFFER:: Temporal accumulator framebuffer is not complete!" << std::endl;
+        }
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+        glGenVertexArrays(1, &emptyVAO);
+    }
+
+    // 按新尺寸重新分配历史纹理，纹理对象不变，历史作废
+    void resize(int newWidth, int newHeight)
+    {
+        width = newWidth;
+        height = newHeight;
+        for (int i = 0; i < 2; ++i)
+        {
+            glBindTexture(GL_TEXTURE_2D, colorTextures[i]);
+            glTexImage2D(GL_TEXTURE_2D, 0, internalFormat, width, height, 0, GL_RGBA, GL_FLOAT, nullptr);
+            glBindTexture(GL_TEXTURE_2D, infoTextures[i]);
+            glTexImage2D(GL_TEXTURE_2D, 0, GL_RG32F, width, height, 0, GL_RG, GL_FLOAT, nullptr);
+        }
+        glBindTexture(GL_TEXTURE_2D, 0);
+        reset();
+    }
+
+    // 下一帧不使用历史（比如切换了场景或参数）
+    void reset()
+    {
+        historyValid = false;
+    }
+
+    // current 和 position（观察空间位置）必须和累积器同尺寸，返回累积后的结果
+    unsigned int accumulate(unsigned int current, unsigned int position, const glm::mat4 &view, const glm::mat4 &projection)
+    {
+        int prev = frame % 2;
+        int next = 1 - prev;
+
+        shader.use();
+        shader.setMat4("currentToPrevView", prevView * glm::inverse(view));
+        shader.setMat4("prevProjection", prevProjection);
+        shader.setFloat("depthTolerance", depthTolerance);
+        shader.setInt("maxFrames", glm::max(maxFrames, 1));
+        shader.setBool("resetHistory", !historyValid);
+
+        glActiveTexture(GL_TEXTURE0);
+        glBindTexture(GL_TEXTURE_2D, current);
+        glActiveTexture(GL_TEXTURE1);
+        glBindTexture(GL_TEXTURE_2D, position);
+        glActiveTexture(GL_TEXTURE2);
+        glBindTexture(GL_TEXTURE_2D, colorTextures[prev]);
+        glActiveTexture(GL_TEXTURE3);
+        glBindTexture(GL_TEXTURE_2D, infoTextures[prev]);
+
+        GLboolean depthTest = glIsEnabled(GL_DEPTH_TEST);
+        GLboolean blend = glIsEnabled(GL_BLEND);
+        glDisable(GL_DEPTH_TEST);
+        glDisable(GL_BLEND);
+        glViewport(0, 0, width, height);
+        glBindFramebuffer(GL_FRAMEBUFFER, FBOs[next]);
+        glBindVertexArray(emptyVAO);
+        glDrawArrays(GL_TRIANGLES, 0, 3);
+        glBindVertexArray(0);
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+        glActiveTexture(GL_TEXTURE0);
+        if (blend)
+            glEnable(GL_BLEND);
+        if (depthTest)
+            glEnable(GL_DEPTH_TEST);
+
+        prevView = view;
+        prevProjection = projection;
+        historyValid = true;
+        ++frame;
+        return texture();
+    }
+
+    // 最近一次 accumulate 的结果
+    unsigned int texture() const
+    {
+        return colorTextures[frame % 2];
+    }
+
+    // 已累积的帧数，用来每帧旋转采样核
+    unsigned int frameIndex() const
+    {
+        return frame;
+    }
+
+    void dispose()
+    {
+        glDeleteTextures(2, colorTextures);
+        glDeleteTextures(2, infoTextures);
+        glDeleteFramebuffers(2, FBOs);
+        glDeleteVertexArrays(1, &emptyVAO);
+        glDeleteProgram(shader.ID);
+        colorTextures[0] = colorTextures[1] = infoTextures[0] = infoTextures[1] = 0;
+        FBOs[0] = FBOs[1] = emptyVAO = 0;
+    }
+
+private:
+    GLenum internalFormat;
+    // 0 / 1 乒乓使用，frame % 2 为最新的结果
+    unsigned int colorTextures[2] = {};
+    unsigned int infoTextures[2] = {};
+    unsigned int FBOs[2] = {};
+    unsigned int emptyVAO = 0;
+    Shader shader;
+
+    glm::mat4 prevView = glm::mat4(1.0f);
+    glm::mat4 prevProjection = glm::mat4(1.0f);
+    bool historyValid = false;
+    unsigned int frame = 0;
+
+    static void setupTexture(unsigned int texture, GLint filter)
+    {
+        glBindTexture(GL_TEXTURE_2D, texture);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, filter);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, filter);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    }
+};
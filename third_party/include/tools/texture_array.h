@@ -0,0 +1,126 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include <string_view>
+#include <iostream>
+
+// 依赖 tools/stb_image.h，与 model.h 一样需要在包含本文件之前包含
+
+/*
+    材质纹理数组
+    所有层尺寸、格式相同（RGBA8），尺寸不一致的纹理用 glBlitFramebuffer 线性缩放后写入
+    一个模型或一组物体的贴图放进同一个 GL_TEXTURE_2D_ARRAY 后，只需绑定一次，每次绘制只传层号
+*/
+class TextureArray
+{
+public:
+    unsigned int ID = 0;
+    int width = 0;
+    int height = 0;
+    int capacity = 0;
+    int layers = 0;
+
+    TextureArray() = default;
+
+    TextureArray(int width, int height, int capacity, GLint wrap = GL_REPEAT)
+        : width(width), height(height), capacity(capacity)
+    {
+        glGenTextures(1, &ID);
+        glBindTexture(GL_TEXTURE_2D_ARRAY, ID);
+        // 一次性分配所有 mip 层
+        int levels = 1;
+        for (int size = glm::max(width, height); size > 1; size /= 2)
+            ++levels;
+        for (int level = 0, w = width, h = height; level < levels; ++level, w = glm::max(1, w / 2), h = glm::max(1, h / 2))
+            glTexImage3D(GL_TEXTURE_2D_ARRAY, level, GL_RGBA8, w, h, capacity, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, wrap);
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, wrap);
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+
+        glGenFramebuffers(1, &readFBO);
+        glGenFramebuffers(1, &drawFBO);
+    }
+
+    // 把已有的 2D 纹理缩放拷贝到下一层，返回层号，满了返回 -1
+    int addTexture(unsigned int texture)
+    {
+        if (layers >= capacity)
+            return -1;
+
+        int srcWidth, srcHeight;
+        glBindTexture(GL_TEXTURE_2D, texture);
+        glGetTexLevelParameteriv(GL_TEXTURE_2D, 0, GL_TEXTURE_WIDTH, &srcWidth);
+        glGetTexLevelParameteriv(GL_TEXTURE_2D, 0, GL_TEXTURE_HEIGHT, &srcHeight);
+
+        glBindFramebuffer(GL_READ_FRAMEBUFFER, readFBO);
+        glFramebufferTexture2D(GL_READ_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, texture, 0);
+        glBindFramebuffer(GL_DRAW_FRAMEBUFFER, drawFBO);
+        glFramebufferTextureLayer(GL_DRAW_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, ID, 0, layers);
+        glBlitFramebuffer(0, 0, srcWidth, srcHeight, 0, 0, width, height, GL_COLOR_BUFFER_BIT, GL_LINEAR);
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+        return layers++;
+    }
+
+    // 从文件读取一张图片放进下一层
+    int addFromFile(std::string_view path, bool flip = true)
+    {
+        if (layers >= capacity)
+            return -1;
+
+        stbi_set_flip_vertically_on_load(flip);
+        int w, h, nrComponents;
+        unsigned char *data = stbi_load(path.data(), &w, &h, &nrComponents, 4);
+        if (!data)
+        {
+            std::cout << "Texture failed to load at path: " << path << std::endl;
+            return -1;
+        }
+
+        int layer;
+        if (w == width && h == height)
+        {
+            glBindTexture(GL_TEXTURE_2D_ARRAY, ID);
+            glTexSubImage3D(GL_TEXTURE_2D_ARRAY, 0, 0, 0, layers, width, height, 1, GL_RGBA, GL_UNSIGNED_BYTE, data);
+            glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+            layer = layers++;
+        }
+        else
+        {
+            // 尺寸不一致，先上传成临时 2D 纹理再缩放拷贝
+            unsigned int temp;
+            glGenTextures(1, &temp);
+            glBindTexture(GL_TEXTURE_2D, temp);
+            glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, w, h, 0, GL_RGBA, GL_UNSIGNED_BYTE, data);
+            layer = addTexture(temp);
+            glDeleteTextures(1, &temp);
+        }
+        stbi_image_free(data);
+        return layer;
+    }
+
+    // 所有层写入完成后调用
+    void generateMipmap()
+    {
+        glBindTexture(GL_TEXTURE_2D_ARRAY, ID);
+        glGenerateMipmap(GL_TEXTURE_2D_ARRAY);
+        glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+    }
+
+    void dispose()
+    {
+        glDeleteTextures(1, &ID);
+        glDeleteFramebuffers(1, &readFBO);
+        glDeleteFramebuffers(1, &drawFBO);
+        ID = readFBO = drawFBO = 0;
+    }
+
+private:
+    unsigned int readFBO = 0;
+    unsigned int drawFBO = 0;
+};
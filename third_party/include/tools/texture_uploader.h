@@ -0,0 +1,384 @@
+#pragma once
+
+#include <glad/glad.h>
+
+#include <string>
+#include <vector>
+#include <deque>
+#include <unordered_map>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <chrono>
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+
+// 依赖 tools/stb_image.h，与 model.h 一样需要在包含本文件之前包含
+
+/*
+    异步纹理上传
+    1. 工作线程解码图片，并把像素逐行带(band)拷贝进已映射的 PBO 环形槽位
+    2. 渲染线程每帧调用 update()，在字节预算内对已填充的槽位执行 glTexSubImage2D，并插入 fence
+    3. fence 完成后槽位重新映射，交还给工作线程
+
+    GL 3.3 没有 glBufferStorage（持久映射需要 4.4），这里用 GL_MAP_UNSYNCHRONIZED_BIT + fence
+    让槽位在 GPU 读完之前一直处于映射状态，效果等同于持久映射的环形缓冲
+*/
+class TextureUploader
+{
+public:
+    // slotSize: 单个 PBO 的字节数；slotCount: 环形槽位数量；frameBudget: 每帧最多上传的字节数
+    TextureUploader(size_t slotSize = 4u << 20, unsigned int slotCount = 4, size_t frameBudget = 4u << 20)
+        : slotSize(slotSize), frameBudget(frameBudget)
+    {
+        slots.resize(slotCount);
+        for (unsigned int i = 0; i < slotCount; ++i)
+        {
+            glGenBuffers(1, &slots[i].PBO);
+            glBindBuffer(GL_PIXEL_UNPACK_BUFFER, slots[i].PBO);
+            glBufferData(GL_PIXEL_UNPACK_BUFFER, slotSize, nullptr, GL_STREAM_DRAW);
+            mapSlot(i);
+        }
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+
+        worker = std::thread(&TextureUploader::workerLoop, this);
+    }
+
+    ~TextureUploader()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stop = true;
+        }
+        cv.notify_all();
+        worker.join();
+
+        for (Slot &slot : slots)
+        {
+            if (slot.fence)
+                glDeleteSync(slot.fence);
+            if (slot.mapped)
+            {
+                glBindBuffer(GL_PIXEL_UNPACK_BUFFER, slot.PBO);
+                glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+            }
+            glDeleteBuffers(1, &slot.PBO);
+        }
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+    }
+
+    TextureUploader(const TextureUploader &) = delete;
+    TextureUploader &operator=(const TextureUploader &) = delete;
+
+    // 立即返回纹理 ID，数据上传完成前纹理是 1x1 的占位图
+    unsigned int loadTexture(std::string path, bool flip = true, bool gamma = false, GLint wrap = GL_REPEAT)
+    {
+        unsigned int textureID;
+        glGenTextures(1, &textureID);
+        glBindTexture(GL_TEXTURE_2D, textureID);
+        const unsigned char placeholder[4] = { 128, 128, 128, 255 };
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, 1, 1, 0, GL_RGBA, GL_UNSIGNED_BYTE, placeholder);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+
+        pending[textureID] = Pending{ GL_TEXTURE_2D, 1, wrap };
+        pushJob(Job{ std::move(path), textureID, GL_TEXTURE_2D, flip, gamma });
+        return textureID;
+    }
+
+    // 六个面按 +X -X +Y -Y +Z -Z 的顺序
+    unsigned int loadCubeMap(const std::vector<std::string> &faces)
+    {
+        unsigned int textureID;
+        glGenTextures(1, &textureID);
+        glBindTexture(GL_TEXTURE_CUBE_MAP, textureID);
+        glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+
+        pending[textureID] = Pending{ GL_TEXTURE_CUBE_MAP, static_cast<int>(faces.size()), GL_CLAMP_TO_EDGE };
+        for (unsigned int i = 0; i < faces.size(); ++i)
+            pushJob(Job{ faces[i], textureID, GL_TEXTURE_CUBE_MAP_POSITIVE_X + i, false, false });
+        return textureID;
+    }
+
+    // 每帧在渲染线程调用一次
+    void update()
+    {
+        auto start = std::chrono::steady_clock::now();
+        lastFrameBytes = 0;
+
+        // 回收 GPU 已经读完的槽位
+        for (unsigned int i = 0; i < slots.size(); ++i)
+        {
+            Slot &slot = slots[i];
+            if (!slot.fence)
+                continue;
+            GLenum status = glClientWaitSync(slot.fence, 0, 0);
+            if (status == GL_ALREADY_SIGNALED || status == GL_CONDITION_SATISFIED)
+            {
+                glDeleteSync(slot.fence);
+                slot.fence = nullptr;
+                mapSlot(i);
+            }
+        }
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+        cv.notify_all();
+
+        // 在预算内消费已填充的槽位，至少处理一个保证进度
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+        while (true)
+        {
+            Band band;
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                if (filled.empty())
+                    break;
+                size_t cost = filled.front().bytes + (filled.front().last ? filled.front().mipBytes : 0);
+                if (lastFrameBytes > 0 && lastFrameBytes + cost > frameBudget)
+                    break;
+                band = filled.front();
+                filled.pop_front();
+            }
+            submitBand(band);
+        }
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+
+        lastFrameMs = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - start).count();
+    }
+
+    // 是否还有未完成的上传
+    bool busy() const
+    {
+        return !pending.empty();
+    }
+
+    size_t lastFrameBytes = 0;
+    float lastFrameMs = 0.0f;
+
+private:
+    struct Slot
+    {
+        unsigned int PBO = 0;
+        void *mapped = nullptr;
+        GLsync fence = nullptr;
+    };
+
+    struct Job
+    {
+        std::string path;
+        unsigned int texture;
+        GLenum target;
+        bool flip;
+        bool gamma;
+    };
+
+    // 一个槽位里的一段连续行
+    struct Band
+    {
+        unsigned int slot = 0;
+        unsigned int texture = 0;
+        GLenum target = GL_TEXTURE_2D;
+        GLenum format = GL_RGB;
+        GLenum internalFormat = GL_RGB;
+        int width = 0;
+        int height = 0;
+        int y = 0;
+        int rows = 0;
+        size_t bytes = 0;
+        size_t mipBytes = 0;
+        bool first = false;
+        bool last = false;
+        bool failed = false;
+        std::string path;
+    };
+
+    struct Pending
+    {
+        GLenum target;
+        int parts;
+        GLint wrap;
+    };
+
+    size_t slotSize;
+    size_t frameBudget;
+    std::vector<Slot> slots;
+
+    std::mutex mutex;
+    std::condition_variable cv;
+    std::deque<Job> jobs;
+    std::deque<unsigned int> freeSlots; // 已映射、可供工作线程写入
+    std::deque<Band> filled;            // 已写入、等待提交
+    bool stop = false;
+    std::thread worker;
+
+    // 只在渲染线程访问
+    std::unordered_map<unsigned int, Pending> pending;
+
+    void pushJob(Job job)
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            jobs.push_back(std::move(job));
+        }
+        cv.notify_all();
+    }
+
+    // 渲染线程：映射槽位并交给工作线程
+    void mapSlot(unsigned int i)
+    {
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, slots[i].PBO);
+        slots[i].mapped = glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, slotSize,
+            GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT | GL_MAP_UNSYNCHRONIZED_BIT);
+        std::lock_guard<std::mutex> lock(mutex);
+        freeSlots.push_back(i);
+    }
+
+    // 渲染线程：把一个行带从 PBO 拷贝到纹理
+    void submitBand(const Band &band)
+    {
+        Slot &slot = slots[band.slot];
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, slot.PBO);
+        glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+        slot.mapped = nullptr;
+
+        GLenum bindTarget = band.target == GL_TEXTURE_2D ? GL_TEXTURE_2D : GL_TEXTURE_CUBE_MAP;
+        glBindTexture(bindTarget, band.texture);
+
+        if (band.failed)
+        {
+            std::cout << "Texture failed to load at path: " << band.path << std::endl;
+        }
+        else
+        {
+            if (band.first)
+                glTexImage2D(band.target, 0, band.internalFormat, band.width, band.height, 0, band.format, GL_UNSIGNED_BYTE, nullptr);
+            glTexSubImage2D(band.target, 0, 0, band.y, band.width, band.rows, band.format, GL_UNSIGNED_BYTE, nullptr);
+            lastFrameBytes += band.bytes;
+        }
+        slot.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+
+        if (band.last)
+            finishPart(band);
+    }
+
+    void finishPart(const Band &band)
+    {
+        auto it = pending.find(band.texture);
+        if (it == pending.end() || --it->second.parts > 0)
+            return;
+
+        Pending &p = it->second;
+        if (p.target == GL_TEXTURE_2D)
+        {
+            if (!band.failed)
+            {
+                glGenerateMipmap(GL_TEXTURE_2D);
+                lastFrameBytes += band.mipBytes;
+            }
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, p.wrap);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, p.wrap);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        }
+        else
+        {
+            glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+            glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+            glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
+        }
+        pending.erase(it);
+    }
+
+    // 工作线程：等待一个已映射的槽位
+    bool acquireSlot(unsigned int &slot)
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        cv.wait(lock, [this] { return stop || !freeSlots.empty(); });
+        if (stop)
+            return false;
+        slot = freeSlots.front();
+        freeSlots.pop_front();
+        return true;
+    }
+
+    void pushBand(Band band)
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        filled.push_back(std::move(band));
+    }
+
+    void workerLoop()
+    {
+        while (true)
+        {
+            Job job;
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                cv.wait(lock, [this] { return stop || !jobs.empty(); });
+                if (stop)
+                    return;
+                job = std::move(jobs.front());
+                jobs.pop_front();
+            }
+
+            stbi_set_flip_vertically_on_load_thread(job.flip);
+            int width, height, nrComponents;
+            unsigned char *data = stbi_load(job.path.c_str(), &width, &height, &nrComponents, 0);
+
+            Band band;
+            band.texture = job.texture;
+            band.target = job.target;
+            band.path = job.path;
+
+            size_t rowBytes = data ? static_cast<size_t>(width) * nrComponents : 0;
+            if (!data || rowBytes > slotSize)
+            {
+                // 失败也要占用一个槽位，让渲染线程按顺序回收计数
+                if (!acquireSlot(band.slot))
+                {
+                    stbi_image_free(data);
+                    return;
+                }
+                band.failed = true;
+                band.first = band.last = true;
+                pushBand(band);
+                stbi_image_free(data);
+                continue;
+            }
+
+            band.format = GL_RGB;
+            if (nrComponents == 1)
+                band.format = GL_RED;
+            else if (nrComponents == 4)
+                band.format = GL_RGBA;
+            band.internalFormat = band.format;
+            if (job.gamma && band.format == GL_RGB)
+                band.internalFormat = GL_SRGB;
+            else if (job.gamma && band.format == GL_RGBA)
+                band.internalFormat = GL_SRGB_ALPHA;
+            band.width = width;
+            band.height = height;
+            band.mipBytes = rowBytes * height / 3; // 整条 mip 链约为原图的 1/3
+
+            int rowsPerBand = static_cast<int>(slotSize / rowBytes);
+            for (int y = 0; y < height; y += rowsPerBand)
+            {
+                if (!acquireSlot(band.slot))
+                {
+                    stbi_image_free(data);
+                    return;
+                }
+                band.y = y;
+                band.rows = std::min(rowsPerBand, height - y);
+                band.bytes = rowBytes * band.rows;
+                band.first = y == 0;
+                band.last = y + band.rows >= height;
+                std::memcpy(slots[band.slot].mapped, data + rowBytes * y, band.bytes);
+                pushBand(band);
+            }
+            stbi_image_free(data);
+        }
+    }
+};
@@ -0,0 +1,123 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/*
+    常驻线程池，给每帧都要做的并行任务用（动画采样、软件遮挡剔除等），避免每帧创建线程
+    parallelFor(count, grain, task)：把 [0, count) 切成 grain 大小的块，工作线程和调用线程一起用原子计数器抢块，
+    task(begin, end) 全部执行完才返回；同一时间只能有一个线程调用 parallelFor
+*/
+class ThreadPool
+{
+public:
+    // threadCount 为参与计算的总线程数（包括调用线程），0 为硬件线程数
+    explicit ThreadPool(unsigned int threadCount = 0)
+    {
+        if (threadCount == 0)
+            threadCount = std::max(std::thread::hardware_concurrency(), 1u);
+        workers.reserve(threadCount - 1);
+        for (unsigned int i = 0; i + 1 < threadCount; ++i)
+            workers.emplace_back(&ThreadPool::workerLoop, this);
+    }
+
+    ~ThreadPool()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stop = true;
+        }
+        wake.notify_all();
+        for (std::thread &worker : workers)
+            worker.join();
+    }
+
+    ThreadPool(const ThreadPool &) = delete;
+    ThreadPool &operator=(const ThreadPool &) = delete;
+
+    unsigned int size() const
+    {
+        return static_cast<unsigned int>(workers.size()) + 1;
+    }
+
+    void parallelFor(size_t count, size_t grain, const std::function<void(size_t, size_t)> &task)
+    {
+        if (count == 0)
+            return;
+        grain = std::max<size_t>(grain, 1);
+        // 只有一块时不用唤醒工作线程
+        if (workers.empty() || count <= grain)
+        {
+            task(0, count);
+            return;
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            job = &task;
+            jobCount = count;
+            jobGrain = grain;
+            next = 0;
+            busyWorkers = workers.size();
+            ++generation;
+        }
+        wake.notify_all();
+        runChunks();
+
+        std::unique_lock<std::mutex> lock(mutex);
+        done.wait(lock, [this] { return busyWorkers == 0; });
+        job = nullptr;
+    }
+
+private:
+    std::vector<std::thread> workers;
+    std::mutex mutex;
+    std::condition_variable wake;
+    std::condition_variable done;
+    bool stop = false;
+    // 每次 parallelFor 加一，工作线程据此判断有没有新任务
+    size_t generation = 0;
+    size_t busyWorkers = 0;
+
+    const std::function<void(size_t, size_t)> *job = nullptr;
+    size_t jobCount = 0;
+    size_t jobGrain = 1;
+    std::atomic<size_t> next{ 0 };
+
+    void runChunks()
+    {
+        while (true)
+        {
+            size_t begin = next.fetch_add(jobGrain);
+            if (begin >= jobCount)
+                break;
+            (*job)(begin, std::min(begin + jobGrain, jobCount));
+        }
+    }
+
+    void workerLoop()
+    {
+        size_t seen = 0;
+        while (true)
+        {
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                wake.wait(lock, [&] { return stop || generation != seen; });
+                if (stop)
+                    return;
+                seen = generation;
+            }
+            runChunks();
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                if (--busyWorkers == 0)
+                    done.notify_one();
+            }
+        }
+    }
+};
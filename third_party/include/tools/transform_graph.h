@@ -0,0 +1,158 @@
+#pragma once
+
+#include <glm/glm.hpp>
+
+#include <bit>
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <algorithm>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define TRANSFORM_USE_SSE
+#endif
+
+/*
+    扁平化的变换层级（场景节点树）
+    1. 节点按深度优先的先序排列：父节点一定在子节点之前，每个节点的整棵子树是连续的一段 [i, subtreeEnd[i])
+    2. 父节点下标、局部矩阵、世界矩阵各自是一个连续数组（SoA），更新时顺序扫描，不用沿指针递归
+    3. setLocal() 只把节点在脏位集里标记一下，update() 按 64 位一组找脏节点，
+       只重算脏节点的子树（先序排列保证父节点先算），干净的子树直接跳过
+    世界矩阵 = 父节点的世界矩阵 * 局部矩阵，根节点的父节点为 -1
+*/
+class TransformGraph
+{
+public:
+    std::vector<int> parents;
+    std::vector<int> subtreeEnds;
+    std::vector<glm::mat4> locals;
+    std::vector<glm::mat4> worlds;
+    std::vector<std::string> names;
+
+    size_t size() const
+    {
+        return parents.size();
+    }
+
+    // 按先序添加：parent 必须是最近添加的节点或它的祖先（-1 为新的根），返回新节点的下标
+    int addNode(int parent, const glm::mat4 &local, std::string name = {})
+    {
+        int index = static_cast<int>(parents.size());
+        parents.push_back(parent);
+        subtreeEnds.push_back(index + 1);
+        locals.push_back(local);
+        worlds.push_back(parent < 0 ? local : worlds[parent] * local);
+        names.push_back(std::move(name));
+        for (int ancestor = parent; ancestor >= 0; ancestor = parents[ancestor])
+            subtreeEnds[ancestor] = index + 1;
+        dirty.resize((parents.size() + 63) / 64, 0);
+        return index;
+    }
+
+    // 按名字查找节点，没有返回 -1
+    int find(const std::string &name) const
+    {
+        auto it = std::find(names.begin(), names.end(), name);
+        return it == names.end() ? -1 : static_cast<int>(it - names.begin());
+    }
+
+    void setLocal(int node, const glm::mat4 &local)
+    {
+        locals[node] = local;
+        dirty[node >> 6] |= 1ull << (node & 63);
+    }
+
+    bool isDirty(int node) const
+    {
+        return (dirty[node >> 6] >> (node & 63)) & 1;
+    }
+
+    // 重算所有脏节点的子树，返回重算的节点数
+    size_t update()
+    {
+        size_t updated = 0;
+        const size_t count = size();
+        size_t word = 0;
+        while (word < dirty.size())
+        {
+            if (dirty[word] == 0)
+            {
+                ++word;
+                continue;
+            }
+            size_t node = word * 64 + std::countr_zero(dirty[word]);
+            size_t end = static_cast<size_t>(subtreeEnds[node]);
+            for (size_t i = node; i < end; ++i)
+            {
+                int parent = parents[i];
+                if (parent < 0)
+                    worlds[i] = locals[i];
+                else
+                    multiply(worlds[parent], locals[i], worlds[i]);
+            }
+            updated += end - node;
+            clearDirty(node, end);
+            word = node / 64;
+            if (end >= count)
+                break;
+        }
+        return updated;
+    }
+
+    // 所有节点都标记为脏，下一次 update() 全部重算
+    void markAllDirty()
+    {
+        std::fill(dirty.begin(), dirty.end(), ~0ull);
+        if (size() % 64)
+            dirty.back() = (1ull << (size() % 64)) - 1;
+    }
+
+    void clear()
+    {
+        parents.clear();
+        subtreeEnds.clear();
+        locals.clear();
+        worlds.clear();
+        names.clear();
+        dirty.clear();
+    }
+
+    // out = a * b，SSE 时每一列是 a 的四列按 b 这一列的四个分量加权求和；out 可以是 a，不能是 b
+    static void multiply(const glm::mat4 &a, const glm::mat4 &b, glm::mat4 &out)
+    {
+#if defined(TRANSFORM_USE_SSE)
+        const __m128 a0 = _mm_loadu_ps(&a[0][0]);
+        const __m128 a1 = _mm_loadu_ps(&a[1][0]);
+        const __m128 a2 = _mm_loadu_ps(&a[2][0]);
+        const __m128 a3 = _mm_loadu_ps(&a[3][0]);
+        for (int c = 0; c < 4; ++c)
+        {
+            __m128 column = _mm_mul_ps(a0, _mm_set1_ps(b[c][0]));
+            column = _mm_add_ps(column, _mm_mul_ps(a1, _mm_set1_ps(b[c][1])));
+            column = _mm_add_ps(column, _mm_mul_ps(a2, _mm_set1_ps(b[c][2])));
+            column = _mm_add_ps(column, _mm_mul_ps(a3, _mm_set1_ps(b[c][3])));
+            _mm_storeu_ps(&out[c][0], column);
+        }
+#else
+        out = a * b;
+#endif
+    }
+
+private:
+    std::vector<std::uint64_t> dirty;
+
+    // 清掉 [begin, end) 的脏标记
+    void clearDirty(size_t begin, size_t end)
+    {
+        while (begin < end)
+        {
+            size_t word = begin / 64;
+            size_t bit = begin % 64;
+            size_t bits = std::min<size_t>(64 - bit, end - begin);
+            std::uint64_t mask = bits == 64 ? ~0ull : ((1ull << bits) - 1) << bit;
+            dirty[word] &= ~mask;
+            begin += bits;
+        }
+    }
+};
@@ -0,0 +1,198 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include <vector>
+#include <cstdint>
+#include <cstring>
+#include <utility>
+
+#if defined(__SSE2__) || defined(_M_X64) || defined(_M_AMD64)
+#include <emmintrin.h>
+#define TRANSPARENT_SORTER_SSE2
+#endif
+
+/*
+    透明物体排序
+    1. 批量计算每个实例到摄像机的平方距离（SSE2 一次 4 个）
+    2. 把浮点数的位模式当作 32 位键做基数排序，平方距离非负，位模式和大小顺序一致，取反后就是由远到近
+    3. 按排好的顺序把实例位置写进实例缓冲，一次 glDrawElementsInstanced 画完
+    所有缓冲都预先分配并复用，距离相同的物体不会像 std::map 那样被覆盖掉
+*/
+class TransparentSorter
+{
+public:
+    TransparentSorter(size_t capacity = 1024)
+    {
+        reserve(capacity);
+    }
+
+    void reserve(size_t capacity)
+    {
+        keys.reserve(capacity);
+        keysTemp.reserve(capacity);
+        order.reserve(capacity);
+        orderTemp.reserve(capacity);
+        sortedPositions.reserve(capacity);
+    }
+
+    // 返回由远到近的索引
+    const std::vector<uint32_t> &sort(const std::vector<glm::vec3> &positions, const glm::vec3 &viewPos)
+    {
+        const size_t count = positions.size();
+        keys.resize(count);
+        keysTemp.resize(count);
+        order.resize(count);
+        orderTemp.resize(count);
+
+        computeKeys(positions.data(), count, viewPos);
+        for (size_t i = 0; i < count; ++i)
+            order[i] = static_cast<uint32_t>(i);
+        radixSort(count);
+
+        return order;
+    }
+
+    const std::vector<uint32_t> &indices() const
+    {
+        return order;
+    }
+
+    // 给 VAO 添加一个每实例的 vec3 偏移属性；VAO 来自 BufferGeometry 时先调用它的 detachFromCache()，
+    // 否则参数相同、共用缓冲的几何体也会带上这个属性
+    void attach(unsigned int VAO, unsigned int location = 3)
+    {
+        if (!instanceVBO)
+            glGenBuffers(1, &instanceVBO);
+        glBindVertexArray(VAO);
+        glBindBuffer(GL_ARRAY_BUFFER, instanceVBO);
+        glEnableVertexAttribArray(location);
+        glVertexAttribPointer(location, 3, GL_FLOAT, GL_FALSE, sizeof(glm::vec3), (void *)0);
+        glVertexAttribDivisor(location, 1);
+        glBindVertexArray(0);
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+    }
+
+    // 按 sort() 的结果把位置写进实例缓冲，sorted 为 false 时保持原顺序（顺序无关透明用）
+    void upload(const std::vector<glm::vec3> &positions, bool sorted = true)
+    {
+        if (sorted)
+        {
+            sortedPositions.resize(order.size());
+            for (size_t i = 0; i < order.size(); ++i)
+                sortedPositions[i] = positions[order[i]];
+        }
+        else
+        {
+            sortedPositions.assign(positions.begin(), positions.end());
+        }
+
+        glBindBuffer(GL_ARRAY_BUFFER, instanceVBO);
+        size_t bytes = sortedPositions.size() * sizeof(glm::vec3);
+        if (bytes > instanceCapacity)
+        {
+            instanceCapacity = bytes;
+            glBufferData(GL_ARRAY_BUFFER, bytes, sortedPositions.data(), GL_STREAM_DRAW);
+        }
+        else
+        {
+            // 先丢弃旧的存储，避免等待上一帧的绘制
+            glBufferData(GL_ARRAY_BUFFER, instanceCapacity, nullptr, GL_STREAM_DRAW);
+            glBufferSubData(GL_ARRAY_BUFFER, 0, bytes, sortedPositions.data());
+        }
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+    }
+
+    void draw(unsigned int VAO, GLsizei indexCount)
+    {
+        glBindVertexArray(VAO);
+        glDrawElementsInstanced(GL_TRIANGLES, indexCount, GL_UNSIGNED_INT, 0, static_cast<GLsizei>(sortedPositions.size()));
+        glBindVertexArray(0);
+    }
+
+    void dispose()
+    {
+        glDeleteBuffers(1, &instanceVBO);
+        instanceVBO = 0;
+        instanceCapacity = 0;
+    }
+
+private:
+    std::vector<uint32_t> keys;
+    std::vector<uint32_t> keysTemp;
+    std::vector<uint32_t> order;
+    std::vector<uint32_t> orderTemp;
+    std::vector<glm::vec3> sortedPositions;
+    unsigned int instanceVBO = 0;
+    size_t instanceCapacity = 0;
+
+    void computeKeys(const glm::vec3 *positions, size_t count, const glm::vec3 &viewPos)
+    {
+        size_t i = 0;
+#ifdef TRANSPARENT_SORTER_SSE2
+        const __m128 camX = _mm_set1_ps(viewPos.x);
+        const __m128 camY = _mm_set1_ps(viewPos.y);
+        const __m128 camZ = _mm_set1_ps(viewPos.z);
+        const __m128i ones = _mm_set1_epi32(-1);
+        for (; i + 4 <= count; i += 4)
+        {
+            const glm::vec3 *p = positions + i;
+            __m128 dx = _mm_sub_ps(_mm_set_ps(p[3].x, p[2].x, p[1].x, p[0].x), camX);
+            __m128 dy = _mm_sub_ps(_mm_set_ps(p[3].y, p[2].y, p[1].y, p[0].y), camY);
+            __m128 dz = _mm_sub_ps(_mm_set_ps(p[3].z, p[2].z, p[1].z, p[0].z), camZ);
+            __m128 dist2 = _mm_add_ps(_mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy)), _mm_mul_ps(dz, dz));
+            // 取反：距离越远键越小，排在前面
+            __m128i key = _mm_xor_si128(_mm_castps_si128(dist2), ones);
+            _mm_storeu_si128(reinterpret_cast<__m128i *>(keys.data() + i), key);
+        }
+#endif
+        for (; i < count; ++i)
+        {
+            glm::vec3 d = positions[i] - viewPos;
+            float dist2 = glm::dot(d, d);
+            uint32_t bits;
+            std::memcpy(&bits, &dist2, sizeof(bits));
+            keys[i] = ~bits;
+        }
+    }
+
+    // LSD 基数排序，每次 8 位，所有键该位都相同时跳过这一趟
+    void radixSort(size_t count)
+    {
+        uint32_t histogram[4][256] = {};
+        for (size_t i = 0; i < count; ++i)
+        {
+            uint32_t key = keys[i];
+            ++histogram[0][key & 0xFF];
+            ++histogram[1][(key >> 8) & 0xFF];
+            ++histogram[2][(key >> 16) & 0xFF];
+            ++histogram[3][key >> 24];
+        }
+
+        for (int pass = 0; pass < 4; ++pass)
+        {
+            const int shift = pass * 8;
+            uint32_t *bucket = histogram[pass];
+            if (count == 0 || bucket[(keys[0] >> shift) & 0xFF] == count)
+                continue;
+
+            uint32_t sum = 0;
+            for (int b = 0; b < 256; ++b)
+            {
+                uint32_t c = bucket[b];
+                bucket[b] = sum;
+                sum += c;
+            }
+            for (size_t i = 0; i < count; ++i)
+            {
+                uint32_t key = keys[i];
+                uint32_t dst = bucket[(key >> shift) & 0xFF]++;
+                keysTemp[dst] = key;
+                orderTemp[dst] = order[i];
+            }
+            std::swap(keys, keysTemp);
+            std::swap(order, orderTemp);
+        }
+    }
+};
@@ -0,0 +1,206 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include <tools/shader.h>
+
+#include <array>
+#include <string>
+#include <vector>
+#include <unordered_map>
+
+/*
+    合并的最终后处理 pass：泛光叠加、曝光、色调映射、3D LUT 调色、sRGB 编码在一个全屏绘制里完成（glsl/uber_post.frag）
+    1. 每种选项组合是一个着色器变体，第一次用到时编译并缓存，运行时没有分支
+    2. 调色 LUT 在 CPU 上按 Grading 参数烘焙成 LUT_SIZE^3 的 3D 纹理，在 sRGB 编码后的颜色上查表
+    3. 分开做时每一步都要把中间结果完整写一次再读一次，separateBytesPerPixel / fusedBytesPerPixel 用来估算省下的带宽
+    apply() 画到当前绑定的帧缓冲上，视口由调用方设置
+*/
+class UberPost
+{
+public:
+    enum class Tonemap
+    {
+        None,
+        Reinhard,
+        Exposure,
+        ACES,
+        Count
+    };
+
+    struct Options
+    {
+        bool bloom = false;
+        bool autoExposure = false;
+        Tonemap tonemap = Tonemap::Exposure;
+        bool srgb = true;
+        bool colorGrading = false;
+
+        int key() const
+        {
+            return (bloom ? 1 : 0) | (autoExposure ? 2 : 0) | (srgb ? 4 : 0) | (colorGrading ? 8 : 0) | (static_cast<int>(tonemap) << 4);
+        }
+    };
+
+    // 在 sRGB 编码后的颜色上做的调色
+    struct Grading
+    {
+        float contrast = 1.0f;
+        float saturation = 1.0f;
+        // 色温，正值偏暖（加红减蓝），负值偏冷
+        float temperature = 0.0f;
+    };
+
+    static constexpr int TONEMAP_COUNT = static_cast<int>(Tonemap::Count);
+    static constexpr int LUT_SIZE = 32;
+
+    Options options;
+    float exposure = 1.0f;
+    float bloomStrength = 1.0f;
+
+    UberPost()
+    {
+        glGenTextures(1, &lutTexture);
+        glBindTexture(GL_TEXTURE_3D, lutTexture);
+        glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
+        glBindTexture(GL_TEXTURE_3D, 0);
+        bakeLUT(Grading{});
+
+        glGenVertexArrays(1, &emptyVAO);
+    }
+
+    static const char *name(Tonemap tonemap)
+    {
+        static const std::array<const char *, TONEMAP_COUNT> names = { "None", "Reinhard", "Exposure", "ACES" };
+        return names[static_cast<int>(tonemap)];
+    }
+
+    // 重新烘焙调色 LUT，参数变化时调用
+    void bakeLUT(const Grading &grading)
+    {
+        std::vector<glm::vec3> data(LUT_SIZE * LUT_SIZE * LUT_SIZE);
+        for (int b = 0; b < LUT_SIZE; ++b)
+            for (int g = 0; g < LUT_SIZE; ++g)
+                for (int r = 0; r < LUT_SIZE; ++r)
+                {
+                    glm::vec3 color = glm::vec3(r, g, b) / float(LUT_SIZE - 1);
+                    color += glm::vec3(grading.temperature, 0.0f, -grading.temperature) * 0.1f;
+                    color = (color - 0.5f) * grading.contrast + 0.5f;
+                    float luma = glm::dot(color, glm::vec3(0.2126f, 0.7152f, 0.0722f));
+                    color = glm::mix(glm::vec3(luma), color, grading.saturation);
+                    data[(b * LUT_SIZE + g) * LUT_SIZE + r] = glm::clamp(color, 0.0f, 1.0f);
+                }
+        glBindTexture(GL_TEXTURE_3D, lutTexture);
+        glTexImage3D(GL_TEXTURE_3D, 0, GL_RGB16F, LUT_SIZE, LUT_SIZE, LUT_SIZE, 0, GL_RGB, GL_FLOAT, data.data());
+        glBindTexture(GL_TEXTURE_3D, 0);
+    }
+
+    // bloomTexture 只在 options.bloom 时使用，exposureTexture 只在 options.autoExposure 时使用
+    void apply(unsigned int hdrTexture, unsigned int bloomTexture = 0, unsigned int exposureTexture = 0)
+    {
+        const Shader &shader = permutation(options);
+        shader.use();
+        shader.setFloat("exposure", exposure);
+        shader.setFloat("bloomStrength", bloomStrength);
+        shader.setFloat("lutSize", static_cast<float>(LUT_SIZE));
+
+        glActiveTexture(GL_TEXTURE0);
+        glBindTexture(GL_TEXTURE_2D, hdrTexture);
+        glActiveTexture(GL_TEXTURE1);
+        glBindTexture(GL_TEXTURE_2D, options.bloom ? bloomTexture : 0);
+        glActiveTexture(GL_TEXTURE2);
+        glBindTexture(GL_TEXTURE_2D, options.autoExposure ? exposureTexture : 0);
+        glActiveTexture(GL_TEXTURE3);
+        glBindTexture(GL_TEXTURE_3D, lutTexture);
+
+        GLboolean depthTest = glIsEnabled(GL_DEPTH_TEST);
+        GLboolean blend = glIsEnabled(GL_BLEND);
+        glDisable(GL_DEPTH_TEST);
+        glDisable(GL_BLEND);
+        glBindVertexArray(emptyVAO);
+        glDrawArrays(GL_TRIANGLES, 0, 3);
+        glBindVertexArray(0);
+        glActiveTexture(GL_TEXTURE3);
+        glBindTexture(GL_TEXTURE_3D, 0);
+        glActiveTexture(GL_TEXTURE0);
+        if (blend)
+            glEnable(GL_BLEND);
+        if (depthTest)
+            glEnable(GL_DEPTH_TEST);
+    }
+
+    // 合并后每个像素的读写量：读 HDR 颜色（RGBA16F）、泛光（RGBA16F），写一次 RGBA8
+    static size_t fusedBytesPerPixel(const Options &options)
+    {
+        return 8 + (options.bloom ? 8 : 0) + 4;
+    }
+
+    // 每一步单独一个全屏 pass 时的读写量：每个中间结果多一次写和一次读
+    static size_t separateBytesPerPixel(const Options &options)
+    {
+        std::vector<size_t> intermediates;
+        // 叠加泛光后的 HDR 颜色
+        if (options.bloom)
+            intermediates.push_back(8);
+        // 曝光 + 色调映射后的线性颜色，用 16 位浮点避免 sRGB 编码前出现色带
+        if (options.srgb || options.colorGrading)
+            intermediates.push_back(8);
+        // sRGB 编码后的颜色
+        if (options.srgb && options.colorGrading)
+            intermediates.push_back(4);
+
+        size_t bytes = fusedBytesPerPixel(options);
+        for (size_t intermediate : intermediates)
+            bytes += 2 * intermediate;
+        return bytes;
+    }
+
+    void dispose()
+    {
+        for (auto &[key, shader] : permutations)
+            glDeleteProgram(shader.ID);
+        permutations.clear();
+        glDeleteTextures(1, &lutTexture);
+        glDeleteVertexArrays(1, &emptyVAO);
+        lutTexture = emptyVAO = 0;
+    }
+
+private:
+    std::unordered_map<int, Shader> permutations;
+    unsigned int lutTexture = 0;
+    unsigned int emptyVAO = 0;
+
+    const Shader &permutation(const Options &options)
+    {
+        auto it = permutations.find(options.key());
+        if (it != permutations.end())
+            return it->second;
+
+        std::string defines;
+        if (options.bloom)
+            defines += "#define UBER_BLOOM\n";
+        if (options.autoExposure)
+            defines += "#define UBER_AUTO_EXPOSURE\n";
+        if (options.srgb)
+            defines += "#define UBER_SRGB\n";
+        if (options.colorGrading)
+            defines += "#define UBER_COLOR_GRADING\n";
+        static const std::array<const char *, TONEMAP_COUNT> tonemapDefines = {
+            "", "#define TONEMAP_REINHARD\n", "#define TONEMAP_EXPOSURE\n", "#define TONEMAP_ACES\n"
+        };
+        defines += tonemapDefines[static_cast<int>(options.tonemap)];
+
+        Shader shader(GLSL_INCLUDE_DIR "/fullscreen_triangle.vert", GLSL_INCLUDE_DIR "/uber_post.frag", { }, defines);
+        shader.use();
+        shader.setInt("hdrTexture", 0);
+        shader.setInt("bloomTexture", 1);
+        shader.setInt("exposureTexture", 2);
+        shader.setInt("gradingLUT", 3);
+        return permutations.emplace(options.key(), shader).first->second;
+    }
+};
@@ -0,0 +1,175 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+#include <type_traits>
+
+#ifndef DEFINE_VERTEX
+#define DEFINE_VERTEX
+struct Vertex
+{
+    glm::vec3 Position;  // 顶点位置
+    glm::vec3 Normal;    // 法线
+    glm::vec2 TexCoords; // 纹理坐标
+
+    glm::vec3 Tangent;   // 切线
+    glm::vec3 Bitangent; // 副切线
+};
+#endif
+
+/*
+    编译期的顶点布局：VertexLayout<VertexAttribute::Position, VertexAttribute::TexCoords> 这样列出需要的属性
+    1. 步长、每个属性的偏移和 glVertexAttribPointer 的参数都由属性的类型在编译期算出
+    2. 属性的 location 固定，和 Vertex 中的成员顺序一致，着色器不用跟着布局改
+    3. CPU 端仍然用完整的 Vertex 生成和处理顶点（计算切线等），上传时才按布局打包，只上传需要的字节
+       布局和 Vertex 完全一致时直接上传，不用打包
+*/
+namespace VertexAttribute
+{
+    struct Position
+    {
+        using Type = glm::vec3;
+        static constexpr GLuint location = 0;
+        static constexpr size_t vertexOffset = offsetof(Vertex, Position);
+        static const Type &get(const Vertex &vertex) { return vertex.Position; }
+    };
+
+    struct Normal
+    {
+        using Type = glm::vec3;
+        static constexpr GLuint location = 1;
+        static constexpr size_t vertexOffset = offsetof(Vertex, Normal);
+        static const Type &get(const Vertex &vertex) { return vertex.Normal; }
+    };
+
+    struct TexCoords
+    {
+        using Type = glm::vec2;
+        static constexpr GLuint location = 2;
+        static constexpr size_t vertexOffset = offsetof(Vertex, TexCoords);
+        static const Type &get(const Vertex &vertex) { return vertex.TexCoords; }
+    };
+
+    struct Tangent
+    {
+        using Type = glm::vec3;
+        static constexpr GLuint location = 3;
+        static constexpr size_t vertexOffset = offsetof(Vertex, Tangent);
+        static const Type &get(const Vertex &vertex) { return vertex.Tangent; }
+    };
+
+    struct Bitangent
+    {
+        using Type = glm::vec3;
+        static constexpr GLuint location = 4;
+        static constexpr size_t vertexOffset = offsetof(Vertex, Bitangent);
+        static const Type &get(const Vertex &vertex) { return vertex.Bitangent; }
+    };
+}
+
+template <typename... Attributes>
+struct VertexLayout
+{
+    static_assert(sizeof...(Attributes) > 0, "VertexLayout needs at least one attribute");
+
+    static constexpr GLsizei stride = static_cast<GLsizei>((sizeof(typename Attributes::Type) + ...));
+    // 用到的 location 的位掩码，区分不同布局（比如几何体缓存的 key）
+    static constexpr unsigned int mask = ((1u << Attributes::location) | ...);
+
+    template <typename Attribute>
+    static constexpr bool has = (std::is_same_v<Attribute, Attributes> || ...);
+
+    // Attribute 之前所有属性的大小之和
+    template <typename Attribute>
+    static constexpr size_t offset()
+    {
+        static_assert(has<Attribute>, "attribute is not part of this layout");
+        size_t result = 0;
+        bool found = false;
+        ((found = found || std::is_same_v<Attribute, Attributes>, result += found ? 0 : sizeof(typename Attributes::Type)), ...);
+        return result;
+    }
+
+    // 和 Vertex 的内存布局完全一致，可以直接上传 std::vector<Vertex>
+    static constexpr bool matchesVertex()
+    {
+        return stride == sizeof(Vertex) && ((offset<Attributes>() == Attributes::vertexOffset) && ...);
+    }
+
+    // 在当前绑定的 VAO 上启用并设置每个属性，GL_ARRAY_BUFFER 需要已经绑定
+    static void setup()
+    {
+        (setupAttribute<Attributes>(), ...);
+    }
+
+    // 按布局打包后上传到当前绑定的 target
+    static void bufferData(GLenum target, const std::vector<Vertex> &vertices, GLenum usage)
+    {
+        if constexpr (matchesVertex())
+        {
+            glBufferData(target, vertices.size() * sizeof(Vertex), vertices.data(), usage);
+        }
+        else
+        {
+            std::vector<std::byte> data = pack(vertices);
+            glBufferData(target, data.size(), data.data(), usage);
+        }
+    }
+
+    static std::vector<std::byte> pack(const std::vector<Vertex> &vertices)
+    {
+        std::vector<std::byte> data(vertices.size() * stride);
+        std::byte *dst = data.data();
+        for (const Vertex &vertex : vertices)
+        {
+            (std::memcpy(dst + offset<Attributes>(), &Attributes::get(vertex), sizeof(typename Attributes::Type)), ...);
+            dst += stride;
+        }
+        return data;
+    }
+
+private:
+    template <typename Attribute>
+    static void setupAttribute()
+    {
+        glEnableVertexAttribArray(Attribute::location);
+        glVertexAttribPointer(Attribute::location, Attribute::Type::length(), GL_FLOAT, GL_FALSE, stride, reinterpret_cast<void *>(offset<Attribute>()));
+    }
+};
+
+// 完整的切线空间顶点（56 字节），法线贴图、视差贴图等使用
+using FullVertexLayout = VertexLayout<VertexAttribute::Position, VertexAttribute::Normal, VertexAttribute::TexCoords, VertexAttribute::Tangent, VertexAttribute::Bitangent>;
+// 普通光照（32 字节）
+using LitVertexLayout = VertexLayout<VertexAttribute::Position, VertexAttribute::Normal, VertexAttribute::TexCoords>;
+// 不受光照的物体和全屏四边形（20 字节）
+using UnlitVertexLayout = VertexLayout<VertexAttribute::Position, VertexAttribute::TexCoords>;
+// 只写深度的 pass（12 字节）
+using PositionVertexLayout = VertexLayout<VertexAttribute::Position>;
+
+// 蒙皮数据，和 Vertex 分开放在第二个顶点缓冲里，只有带骨骼的网格才有
+// 每个顶点最多 4 根骨骼：下标各 1 字节（一个模型最多 256 根骨骼），权重各 2 字节归一化到 [0, 1]，共 12 字节
+struct SkinVertex
+{
+    std::uint8_t BoneIDs[4];
+    std::uint16_t Weights[4];
+};
+
+struct SkinVertexLayout
+{
+    static constexpr GLuint boneIDsLocation = 5;
+    static constexpr GLuint weightsLocation = 6;
+
+    // 在当前绑定的 VAO 上设置，GL_ARRAY_BUFFER 需要已经绑定蒙皮缓冲；着色器里是 uvec4 和 vec4
+    static void setup()
+    {
+        glEnableVertexAttribArray(boneIDsLocation);
+        glVertexAttribIPointer(boneIDsLocation, 4, GL_UNSIGNED_BYTE, sizeof(SkinVertex), reinterpret_cast<void *>(offsetof(SkinVertex, BoneIDs)));
+        glEnableVertexAttribArray(weightsLocation);
+        glVertexAttribPointer(weightsLocation, 4, GL_UNSIGNED_SHORT, GL_TRUE, sizeof(SkinVertex), reinterpret_cast<void *>(offsetof(SkinVertex, Weights)));
+    }
+};
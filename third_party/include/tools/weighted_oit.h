@@ -0,0 +1,121 @@
+#pragma once
+
+#include <glad/glad.h>
+
+#include <tools/shader.h>
+
+#include <iostream>
+
+/*
+    加权混合的顺序无关透明（Weighted Blended OIT, McGuire & Bavoil 2013）
+    1. 累积：透明物体不排序，一次画完，关闭深度写入
+       附件 0（RGBA16F）：rgb 累加加权的预乘颜色，a 乘性累积 revealage
+       附件 1（R16F）   ：累加加权的 alpha
+    2. 合成：全屏四边形，平均颜色 = accum.rgb / weight，覆盖度 = 1 - revealage，混合到目标帧缓冲上
+
+    GL 3.3 没有 glBlendFunci，两个附件只能共用一个混合方程，所以 revealage 放在附件 0 的 alpha 通道，
+    glBlendFuncSeparate(ONE, ONE, ZERO, ONE_MINUS_SRC_ALPHA) 同时得到 rgb 的相加和 alpha 的相乘
+*/
+class WeightedOIT
+{
+public:
+    unsigned int FBO = 0;
+    unsigned int accumTexture = 0;
+    unsigned int weightTexture = 0;
+    int width = 0;
+    int height = 0;
+
+    WeightedOIT(int width, int height)
+    {
+        glGenFramebuffers(1, &FBO);
+        glGenTextures(1, &accumTexture);
+        glGenTextures(1, &weightTexture);
+        glGenRenderbuffers(1, &depthBuffer);
+        resize(width, height);
+    }
+
+    void resize(int width, int height)
+    {
+        this->width = width;
+        this->height = height;
+
+        glBindFramebuffer(GL_FRAMEBUFFER, FBO);
+
+        glBindTexture(GL_TEXTURE_2D, accumTexture);
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA16F, width, height, 0, GL_RGBA, GL_HALF_FLOAT, nullptr);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, accumTexture, 0);
+
+        glBindTexture(GL_TEXTURE_2D, weightTexture);
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_R16F, width, height, 0, GL_RED, GL_HALF_FLOAT, nullptr);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT1, GL_TEXTURE_2D, weightTexture, 0);
+
+        // 与默认帧缓冲的深度格式一致，才能把不透明物体的深度拷贝过来
+        glBindRenderbuffer(GL_RENDERBUFFER, depthBuffer);
+        glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH24_STENCIL8, width, height);
+        glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_RENDERBUFFER, depthBuffer);
+
+        unsigned int attachments[2] = { GL_COLOR_ATTACHMENT0, GL_COLOR_ATTACHMENT1 };
+        glDrawBuffers(2, attachments);
+        if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+            std::cout << "ERROR::FRAMEBUFFER:: OIT framebuffer is not complete!" << std::endl;
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    }
+
+    // 不透明物体画完之后调用，sourceFBO 是不透明物体所在的帧缓冲
+    void beginAccumulate(unsigned int sourceFBO = 0)
+    {
+        glBindFramebuffer(GL_READ_FRAMEBUFFER, sourceFBO);
+        glBindFramebuffer(GL_DRAW_FRAMEBUFFER, FBO);
+        glBlitFramebuffer(0, 0, width, height, 0, 0, width, height, GL_DEPTH_BUFFER_BIT, GL_NEAREST);
+        glBindFramebuffer(GL_FRAMEBUFFER, FBO);
+
+        const float clearAccum[4] = { 0.0f, 0.0f, 0.0f, 1.0f };
+        const float clearWeight[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+        glClearBufferfv(GL_COLOR, 0, clearAccum);
+        glClearBufferfv(GL_COLOR, 1, clearWeight);
+
+        glEnable(GL_DEPTH_TEST);
+        glDepthMask(GL_FALSE);
+        glEnable(GL_BLEND);
+        glBlendFuncSeparate(GL_ONE, GL_ONE, GL_ZERO, GL_ONE_MINUS_SRC_ALPHA);
+    }
+
+    // 把累积结果合成到 targetFBO，quadVAO 是铺满屏幕的四边形
+    void composite(Shader &shader, unsigned int quadVAO, GLsizei indexCount, unsigned int targetFBO = 0)
+    {
+        glBindFramebuffer(GL_FRAMEBUFFER, targetFBO);
+        glDepthMask(GL_TRUE);
+        glDisable(GL_DEPTH_TEST);
+        glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+
+        shader.use();
+        shader.setInt("accumTexture", 0);
+        shader.setInt("weightTexture", 1);
+        glActiveTexture(GL_TEXTURE0);
+        glBindTexture(GL_TEXTURE_2D, accumTexture);
+        glActiveTexture(GL_TEXTURE1);
+        glBindTexture(GL_TEXTURE_2D, weightTexture);
+
+        glBindVertexArray(quadVAO);
+        glDrawElements(GL_TRIANGLES, indexCount, GL_UNSIGNED_INT, 0);
+        glBindVertexArray(0);
+
+        glActiveTexture(GL_TEXTURE0);
+        glEnable(GL_DEPTH_TEST);
+    }
+
+    void dispose()
+    {
+        glDeleteFramebuffers(1, &FBO);
+        glDeleteTextures(1, &accumTexture);
+        glDeleteTextures(1, &weightTexture);
+        glDeleteRenderbuffers(1, &depthBuffer);
+    }
+
+private:
+    unsigned int depthBuffer = 0;
+};